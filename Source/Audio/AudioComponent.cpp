@@ -23,44 +23,66 @@
 
 
 #include "AudioComponent.h"
+#include "InternalClockDevice.h"
 #include <stdio.h>
 
-AudioComponent::AudioComponent() : isPlaying(false)
+AudioComponent::AudioComponent(bool useInternalClock)
+    : isPlaying(false), freeRunning(false), graphPlayer(new AudioProcessorPlayer())
 {
-    // if this is nonempty, we got an error
-    String error = deviceManager.initialise(0,  // numInputChannelsNeeded
-                                            2,  // numOutputChannelsNeeded
-                                            0,  // *savedState (XmlElement)
-                                            true, // selectDefaultDeviceOnFailure
-                                            String::empty, // preferred device
-                                            0); // preferred device setup options
-    if (error != String::empty)
+    // create the built-in device types first, then add the internal clock after them
+    const OwnedArray<AudioIODeviceType>& types = deviceManager.getAvailableDeviceTypes();
+
+    if (types.size() > 0)
+        hardwareDeviceType = types[0]->getTypeName();
+
+    deviceManager.addAudioDeviceType(new InternalClockDeviceType());
+
+    if (useInternalClock)
+    {
+        setUseInternalClock(true);
+    }
+    else
     {
-        String titleMessage = String("Audio device initialization error");
-        String contentMessage = String("There was a problem initializing the audio device:\n" + error);
-        // this uses a bool since there are only two options
-        // also, omitting parameters works fine, even though the docs don't show defaults
-        bool retryButtonClicked = AlertWindow::showOkCancelBox(AlertWindow::QuestionIcon,
-                                                               titleMessage,
-                                                               contentMessage,
-                                                               String("Retry"),
-                                                               String("Quit"));
-
-        if (retryButtonClicked)
+        // if this is nonempty, we got an error
+        String error = deviceManager.initialise(0,  // numInputChannelsNeeded
+                                                2,  // numOutputChannelsNeeded
+                                                0,  // *savedState (XmlElement)
+                                                true, // selectDefaultDeviceOnFailure
+                                                String::empty, // preferred device
+                                                0); // preferred device setup options
+        if (error != String::empty)
         {
-            // as above
-            error = deviceManager.initialise(0, 2, 0, true, String::empty, 0);
+            String titleMessage = String("Audio device initialization error");
+            String contentMessage = String("There was a problem initializing the audio device:\n" + error);
+            // this uses a bool since there are only two options
+            // also, omitting parameters works fine, even though the docs don't show defaults
+            bool retryButtonClicked = AlertWindow::showOkCancelBox(AlertWindow::QuestionIcon,
+                                                                   titleMessage,
+                                                                   contentMessage,
+                                                                   String("Retry"),
+                                                                   String("Quit"));
+
+            if (retryButtonClicked)
+            {
+                // as above
+                error = deviceManager.initialise(0, 2, 0, true, String::empty, 0);
+            }
+            else     // quit button clicked
+            {
+                JUCEApplication::quit();
+            }
         }
-        else     // quit button clicked
+
+        // the error string doesn't tell you if there's no audio device found...
+        if (deviceManager.getCurrentAudioDevice() == 0)
         {
-            JUCEApplication::quit();
+            std::cout << "No audio device found, using the internal clock instead." << std::endl;
+            setUseInternalClock(true);
         }
     }
 
-
     AudioIODevice* aIOd = deviceManager.getCurrentAudioDevice();
 
-    // the error string doesn't tell you if there's no audio device found...
     if (aIOd == 0)
     {
         String titleMessage = String("No audio device found");
@@ -70,6 +92,7 @@ AudioComponent::AudioComponent() : isPlaying(false)
                                     titleMessage,
                                     contentMessage);
         JUCEApplication::quit();
+        return;
     }
 
 
@@ -79,6 +102,16 @@ AudioComponent::AudioComponent() : isPlaying(false)
 
     std::cout << std::endl << "Audio device name: " << devName << std::endl;
 
+    setDefaultDeviceSetup();
+
+    stopDevice(); // reduces the amount of background processing when
+    // device is not in use
+
+
+}
+
+void AudioComponent::setDefaultDeviceSetup()
+{
     AudioDeviceManager::AudioDeviceSetup setup;
     deviceManager.getAudioDeviceSetup(setup);
 
@@ -102,13 +135,39 @@ AudioComponent::AudioComponent() : isPlaying(false)
     std::cout << "Audio output channels: " <<  oC.toInteger() << std::endl;
     std::cout << "Audio device sample rate: " <<  sr << std::endl;
     std::cout << "Audio device buffer size: " << buffSize << std::endl << std::endl;
+}
 
-    graphPlayer = new AudioProcessorPlayer();
+void AudioComponent::setUseInternalClock(bool useClock)
+{
+    if (useClock == isUsingInternalClock())
+        return;
 
-    stopDevice(); // reduces the amount of background processing when
-    // device is not in use
+    const int bufferSize = deviceManager.getCurrentAudioDevice() != 0 ? getBufferSize() : 1024;
+
+    if (useClock)
+        deviceManager.setCurrentAudioDeviceType(InternalClockDeviceType::typeName, true);
+    else
+        deviceManager.setCurrentAudioDeviceType(hardwareDeviceType, true);
+
+    // keep the block size the same as before
+    if (deviceManager.getCurrentAudioDevice() != 0)
+        setBufferSize(bufferSize);
+}
+
+bool AudioComponent::isUsingInternalClock()
+{
+    return deviceManager.getCurrentAudioDeviceType() == InternalClockDeviceType::typeName;
+}
 
+void AudioComponent::setFreeRunning(bool shouldRunFreely)
+{
+    freeRunning = shouldRunFreely;
+
+    // the device may also be recreated by restartDevice(), which applies it again
+    InternalClockDevice* clock = dynamic_cast<InternalClockDevice*>(deviceManager.getCurrentAudioDevice());
 
+    if (clock != nullptr)
+        clock->setFreeRunning(freeRunning);
 }
 
 AudioComponent::~AudioComponent()
@@ -117,8 +176,6 @@ AudioComponent::~AudioComponent()
     if (callbacksAreActive())
         endCallbacks();
 
-    deleteAndZero(graphPlayer);
-
 }
 
 void AudioComponent::setBufferSize(int s)
@@ -152,6 +209,16 @@ int AudioComponent::getBufferSizeMs()
     return int(float(setup.bufferSize)/setup.sampleRate*1000);
 }
 
+int AudioComponent::getOutputLatencyMs()
+{
+    AudioIODevice* device = deviceManager.getCurrentAudioDevice();
+
+    if (device == 0 || device->getCurrentSampleRate() <= 0)
+        return 0;
+
+    return int(float(device->getOutputLatencyInSamples())/device->getCurrentSampleRate()*1000);
+}
+
 void AudioComponent::connectToProcessorGraph(AudioProcessorGraph* processorGraph)
 {
 
@@ -210,6 +277,7 @@ void AudioComponent::beginCallbacks()
     
     
     restartDevice();
+    setFreeRunning(freeRunning);
     
         int64 ms = Time::getCurrentTime().toMilliseconds();
         
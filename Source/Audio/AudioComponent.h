@@ -38,7 +38,11 @@
   Determines the initial size of the sample buffer (crucial for
   real-time feedback latency).
 
-  @see MainWindow, ProcessorGraph
+  Instead of the audio card, the callbacks can be generated by an
+  InternalClockDevice, which is used when no audio device is found and
+  when the GUI runs headless.
+
+  @see MainWindow, ProcessorGraph, InternalClockDevice
 
 */
 
@@ -47,8 +51,9 @@ class AudioComponent
 
 public:
     /** Constructor. Finds the audio component (if there is one), and sets the
-    default sample rate and buffer size.*/
-    AudioComponent();
+    default sample rate and buffer size. If useInternalClock is true, the audio
+    hardware is not opened at all.*/
+    AudioComponent(bool useInternalClock = false);
     ~AudioComponent();
 
     /** Begins the audio callbacks that drive data acquisition.*/
@@ -82,16 +87,36 @@ public:
     /** Returns the buffer size (in ms) currently being used.*/
     int getBufferSizeMs();
 
+    /** Returns the output latency (in ms) reported by the current device.*/
+    int getOutputLatencyMs();
+
     /** Sets the buffer size in samples.*/
     void setBufferSize(int);
 
+    /** Switches between the audio device and the internal clock.*/
+    void setUseInternalClock(bool);
+
+    /** Returns true if the callbacks come from the internal clock.*/
+    bool isUsingInternalClock();
+
+    /** Lets the internal clock start each block as soon as the previous one is
+        done, instead of in real time. Has no effect on audio hardware.*/
+    void setFreeRunning(bool shouldRunFreely);
+
     AudioDeviceManager deviceManager;
 
 private:
 
+    /** Applies the default sample rate and buffer size to the current device.*/
+    void setDefaultDeviceSetup();
+
     bool isPlaying;
+    bool freeRunning;
+
+    /** The device type to go back to when the internal clock is turned off.*/
+    String hardwareDeviceType;
 
-    AudioProcessorPlayer* graphPlayer;
+    ScopedPointer<AudioProcessorPlayer> graphPlayer;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioComponent);
 
@@ -0,0 +1,343 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "InternalClockDevice.h"
+#include <stdio.h>
+
+const char* const InternalClockDeviceType::typeName = "Internal Clock";
+const char* const InternalClockDeviceType::deviceName = "High-resolution clock";
+
+static const double clockSampleRates[] = {30000.0, 44100.0, 48000.0, 96000.0};
+static const int clockBufferSizes[] = {32, 64, 128, 256, 512, 1024, 2048};
+
+#define NUM_OUTPUT_CHANNELS 2
+
+InternalClockDevice::InternalClockDevice(const String& deviceName)
+    : AudioIODevice(deviceName, InternalClockDeviceType::typeName),
+      Thread("Internal Clock"),
+      callback(0), outputBuffer(NUM_OUTPUT_CHANNELS, 1024),
+      currentSampleRate(44100.0), currentBufferSize(1024),
+      deviceIsOpen(false)
+{
+
+}
+
+InternalClockDevice::~InternalClockDevice()
+{
+    close();
+}
+
+StringArray InternalClockDevice::getOutputChannelNames()
+{
+    StringArray names;
+    names.add("Left");
+    names.add("Right");
+    return names;
+}
+
+StringArray InternalClockDevice::getInputChannelNames()
+{
+    return StringArray();
+}
+
+int InternalClockDevice::getNumSampleRates()
+{
+    return numElementsInArray(clockSampleRates);
+}
+
+double InternalClockDevice::getSampleRate(int index)
+{
+    return clockSampleRates[jlimit(0, getNumSampleRates() - 1, index)];
+}
+
+int InternalClockDevice::getNumBufferSizesAvailable()
+{
+    return numElementsInArray(clockBufferSizes);
+}
+
+int InternalClockDevice::getBufferSizeSamples(int index)
+{
+    return clockBufferSizes[jlimit(0, getNumBufferSizesAvailable() - 1, index)];
+}
+
+int InternalClockDevice::getDefaultBufferSize()
+{
+    return 1024;
+}
+
+String InternalClockDevice::open(const BigInteger& inputChannels,
+                                 const BigInteger& outputChannels,
+                                 double sampleRate,
+                                 int bufferSizeSamples)
+{
+    close();
+
+    currentSampleRate = sampleRate > 0 ? sampleRate : 44100.0;
+    currentBufferSize = bufferSizeSamples > 0 ? bufferSizeSamples : getDefaultBufferSize();
+
+    activeOutputChannels = outputChannels;
+    activeOutputChannels.setRange(NUM_OUTPUT_CHANNELS,
+                                  activeOutputChannels.getHighestBit() + 1 - NUM_OUTPUT_CHANNELS,
+                                  false);
+
+    outputBuffer.setSize(NUM_OUTPUT_CHANNELS, currentBufferSize);
+
+    deviceIsOpen = true;
+
+    return String::empty;
+}
+
+void InternalClockDevice::close()
+{
+    stop();
+    deviceIsOpen = false;
+}
+
+bool InternalClockDevice::isOpen()
+{
+    return deviceIsOpen;
+}
+
+void InternalClockDevice::start(AudioIODeviceCallback* newCallback)
+{
+    if (!deviceIsOpen || newCallback == 0)
+        return;
+
+    stop();
+
+    newCallback->audioDeviceAboutToStart(this);
+
+    {
+        const ScopedLock sl(callbackLock);
+        callback = newCallback;
+    }
+
+    numOverruns = 0;
+
+    startThread(10); // highest priority, which is real-time scheduling where available
+}
+
+void InternalClockDevice::stop()
+{
+    stopThread(2000);
+
+    AudioIODeviceCallback* lastCallback;
+
+    {
+        const ScopedLock sl(callbackLock);
+        lastCallback = callback;
+        callback = 0;
+    }
+
+    if (lastCallback != 0)
+        lastCallback->audioDeviceStopped();
+}
+
+bool InternalClockDevice::isPlaying()
+{
+    return callback != 0;
+}
+
+String InternalClockDevice::getLastError()
+{
+    return String::empty;
+}
+
+int InternalClockDevice::getCurrentBufferSizeSamples()
+{
+    return currentBufferSize;
+}
+
+double InternalClockDevice::getCurrentSampleRate()
+{
+    return currentSampleRate;
+}
+
+int InternalClockDevice::getCurrentBitDepth()
+{
+    return 32;
+}
+
+BigInteger InternalClockDevice::getActiveOutputChannels() const
+{
+    return activeOutputChannels;
+}
+
+BigInteger InternalClockDevice::getActiveInputChannels() const
+{
+    return BigInteger();
+}
+
+int InternalClockDevice::getOutputLatencyInSamples()
+{
+    return 0;
+}
+
+int InternalClockDevice::getInputLatencyInSamples()
+{
+    return 0;
+}
+
+void InternalClockDevice::waitUntil(int64 targetTicks)
+{
+    const double ticksPerMs = Time::getHighResolutionTicksPerSecond() / 1000.0;
+
+    for (;;)
+    {
+        const double msLeft = (targetTicks - Time::getHighResolutionTicks()) / ticksPerMs;
+
+        if (msLeft <= 0 || threadShouldExit())
+            return;
+
+        // sleep while there is plenty of time left, as the scheduler can
+        // overshoot by up to a millisecond, then yield for the rest
+        if (msLeft > 2.0)
+            wait(int(msLeft) - 1);
+        else
+            Thread::yield();
+    }
+}
+
+void InternalClockDevice::run()
+{
+
+    const double ticksPerBlock = Time::getHighResolutionTicksPerSecond()
+                                 * currentBufferSize / currentSampleRate;
+
+    std::cout << "Internal clock running at " << currentSampleRate << " Hz, "
+              << currentBufferSize << " samples per block." << std::endl;
+
+    float* outputs[NUM_OUTPUT_CHANNELS];
+
+    for (int i = 0; i < NUM_OUTPUT_CHANNELS; i++)
+        outputs[i] = outputBuffer.getSampleData(i);
+
+    // the start of each block is computed from the start time, so the
+    // rounding errors don't add up over time
+    int64 startTicks = Time::getHighResolutionTicks();
+    int64 blockNumber = 0;
+
+    while (!threadShouldExit())
+    {
+
+        {
+            const ScopedLock sl(callbackLock);
+
+            if (callback != 0)
+            {
+                callback->audioDeviceIOCallback(0, 0, outputs, NUM_OUTPUT_CHANNELS, currentBufferSize);
+            }
+        }
+
+        outputBuffer.clear();
+
+        if (freeRunning.get() != 0)
+        {
+            // no waiting; the schedule starts again from here when this is turned off
+            startTicks = Time::getHighResolutionTicks();
+            blockNumber = 0;
+            Thread::yield();
+            continue;
+        }
+
+        blockNumber++;
+
+        int64 nextBlockStart = startTicks + int64(blockNumber * ticksPerBlock);
+
+        if (Time::getHighResolutionTicks() - nextBlockStart > ticksPerBlock)
+        {
+            // more than a whole block behind, so skip ahead rather than
+            // running the missed blocks back to back
+            ++numOverruns;
+            blockNumber = int64((Time::getHighResolutionTicks() - startTicks) / ticksPerBlock) + 1;
+            nextBlockStart = startTicks + int64(blockNumber * ticksPerBlock);
+        }
+
+        waitUntil(nextBlockStart);
+
+    }
+
+    if (numOverruns.get() > 0)
+    {
+        std::cout << "Internal clock overran " << numOverruns.get() << " times." << std::endl;
+    }
+
+}
+
+//==============================================================================
+
+InternalClockDeviceType::InternalClockDeviceType()
+    : AudioIODeviceType(typeName)
+{
+
+}
+
+InternalClockDeviceType::~InternalClockDeviceType()
+{
+
+}
+
+void InternalClockDeviceType::scanForDevices()
+{
+    // nothing to scan for: the clock is always available
+}
+
+StringArray InternalClockDeviceType::getDeviceNames(bool wantInputNames) const
+{
+    StringArray names;
+
+    if (!wantInputNames)
+        names.add(deviceName);
+
+    return names;
+}
+
+int InternalClockDeviceType::getDefaultDeviceIndex(bool forInput) const
+{
+    return forInput ? -1 : 0;
+}
+
+int InternalClockDeviceType::getIndexOfDevice(AudioIODevice* device, bool asInput) const
+{
+    if (device == 0 || asInput)
+        return -1;
+
+    return dynamic_cast<InternalClockDevice*>(device) != 0 ? 0 : -1;
+}
+
+bool InternalClockDeviceType::hasSeparateInputsAndOutputs() const
+{
+    return false;
+}
+
+AudioIODevice* InternalClockDeviceType::createDevice(const String& outputDeviceName,
+                                                     const String& inputDeviceName)
+{
+    if (outputDeviceName == deviceName || inputDeviceName == deviceName
+        || (outputDeviceName.isEmpty() && inputDeviceName.isEmpty()))
+    {
+        return new InternalClockDevice(deviceName);
+    }
+
+    return 0;
+}
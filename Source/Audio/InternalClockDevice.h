@@ -0,0 +1,160 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __INTERNALCLOCKDEVICE_H_3F8A61D2__
+#define __INTERNALCLOCKDEVICE_H_3F8A61D2__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  An audio device that is driven by the high-resolution clock instead of
+  a sound card.
+
+  A thread running at real-time priority calls the device callback every
+  bufferSize / sampleRate seconds, so the ProcessorGraph can be run at any
+  block size (down to 32 samples) on machines without audio hardware.
+  The output channels are never played; they are cleared after each block.
+
+  Appears as the "Internal Clock" device type in the audio settings window.
+
+  @see AudioComponent, InternalClockDeviceType
+
+*/
+
+class InternalClockDevice : public AudioIODevice,
+    private Thread
+{
+public:
+    InternalClockDevice(const String& deviceName);
+    ~InternalClockDevice();
+
+    StringArray getOutputChannelNames();
+    StringArray getInputChannelNames();
+
+    int getNumSampleRates();
+    double getSampleRate(int index);
+
+    int getNumBufferSizesAvailable();
+    int getBufferSizeSamples(int index);
+    int getDefaultBufferSize();
+
+    String open(const BigInteger& inputChannels,
+                const BigInteger& outputChannels,
+                double sampleRate,
+                int bufferSizeSamples);
+    void close();
+    bool isOpen();
+
+    void start(AudioIODeviceCallback* callback);
+    void stop();
+    bool isPlaying();
+
+    String getLastError();
+
+    int getCurrentBufferSizeSamples();
+    double getCurrentSampleRate();
+    int getCurrentBitDepth();
+
+    BigInteger getActiveOutputChannels() const;
+    BigInteger getActiveInputChannels() const;
+
+    int getOutputLatencyInSamples();
+    int getInputLatencyInSamples();
+
+    /** Returns the number of blocks that started more than one block period late.*/
+    int getNumOverruns()
+    {
+        return numOverruns.get();
+    }
+
+    /** If true, each block starts as soon as the previous one is done, e.g.
+        to replay a file as fast as the signal chain can process it. Only
+        meant for sources that are not tied to real time.*/
+    void setFreeRunning(bool shouldRunFreely)
+    {
+        freeRunning = shouldRunFreely ? 1 : 0;
+    }
+
+private:
+
+    /** Calls the device callback at regular intervals.*/
+    void run();
+
+    /** Sleeps until the high-resolution tick counter reaches targetTicks.*/
+    void waitUntil(int64 targetTicks);
+
+    AudioIODeviceCallback* callback;
+    CriticalSection callbackLock;
+
+    AudioSampleBuffer outputBuffer;
+    BigInteger activeOutputChannels;
+
+    double currentSampleRate;
+    int currentBufferSize;
+
+    bool deviceIsOpen;
+
+    Atomic<int> numOverruns;
+    Atomic<int> freeRunning;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InternalClockDevice);
+
+};
+
+/**
+
+  Lists the InternalClockDevice in the AudioDeviceManager.
+
+  @see InternalClockDevice
+
+*/
+
+class InternalClockDeviceType : public AudioIODeviceType
+{
+public:
+    InternalClockDeviceType();
+    ~InternalClockDeviceType();
+
+    void scanForDevices();
+    StringArray getDeviceNames(bool wantInputNames = false) const;
+    int getDefaultDeviceIndex(bool forInput) const;
+    int getIndexOfDevice(AudioIODevice* device, bool asInput) const;
+    bool hasSeparateInputsAndOutputs() const;
+    AudioIODevice* createDevice(const String& outputDeviceName,
+                                const String& inputDeviceName);
+
+    /** The name of this device type.*/
+    static const char* const typeName;
+
+    /** The name of its only device.*/
+    static const char* const deviceName;
+
+private:
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InternalClockDeviceType);
+
+};
+
+
+#endif  // __INTERNALCLOCKDEVICE_H_3F8A61D2__
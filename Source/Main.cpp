@@ -75,7 +75,25 @@ public:
         customLookAndFeel = new CustomLookAndFeel();
         LookAndFeel::setDefaultLookAndFeel(customLookAndFeel);
 
-        mainWindow = new MainWindow();
+        // --headless <config.xml> runs the signal chain saved in config.xml without
+        // showing the main window, using the internal clock instead of the audio card
+        const int headlessIndex = parameters.indexOf("--headless", true);
+
+        if (headlessIndex >= 0)
+        {
+            mainWindow = new MainWindow(true);
+
+            if (!mainWindow->startAcquisitionFromFile(File::getCurrentWorkingDirectory()
+                                                      .getChildFile(parameters[headlessIndex + 1].unquoted())))
+            {
+                std::cout << "Usage: open-ephys --headless <configuration file>" << std::endl;
+                quit();
+            }
+        }
+        else
+        {
+            mainWindow = new MainWindow();
+        }
 
 
 
@@ -26,10 +26,11 @@
 
 //-----------------------------------------------------------------------
 
-MainWindow::MainWindow()
+MainWindow::MainWindow(bool headless)
     : DocumentWindow(JUCEApplication::getInstance()->getApplicationName(),
                      Colour(Colours::black),
-                     DocumentWindow::allButtons)
+                     DocumentWindow::allButtons),
+      isHeadless(headless)
 {
 
     setResizable(true,      // isResizable
@@ -42,7 +43,7 @@ MainWindow::MainWindow()
     // Callbacks will be set by the play button in the control panel
 
     processorGraph = new ProcessorGraph();
-    audioComponent = new AudioComponent();
+    audioComponent = new AudioComponent(headless);
     audioComponent->connectToProcessorGraph(processorGraph);
 
     setContentOwned(new UIComponent(this, processorGraph, audioComponent), true);
@@ -56,6 +57,12 @@ MainWindow::MainWindow()
 
     addKeyListener(commandManager.getKeyMappings());
 
+    if (headless)
+    {
+        std::cout << "Running headless." << std::endl;
+        return;
+    }
+
     loadWindowBounds();
     setUsingNativeTitleBar(true);
     Component::addToDesktop(getDesktopWindowStyleFlags());  // prevents the maximize
@@ -73,7 +80,8 @@ MainWindow::~MainWindow()
         processorGraph->disableProcessors();
     }
 
-    saveWindowBounds();
+    if (!isHeadless)
+        saveWindowBounds();
 
     audioComponent->disconnectProcessorGraph();
     UIComponent* ui = (UIComponent*) getContentComponent();
@@ -99,6 +107,26 @@ void MainWindow::closeButtonPressed()
 
 }
 
+bool MainWindow::startAcquisitionFromFile(const File& configFile)
+{
+
+    if (!configFile.existsAsFile())
+    {
+        std::cout << "Configuration file " << configFile.getFullPathName() << " not found." << std::endl;
+        return false;
+    }
+
+    UIComponent* ui = (UIComponent*) getContentComponent();
+
+    const String error = ui->getEditorViewport()->loadState(configFile);
+    std::cout << error << std::endl;
+
+    ui->getControlPanel()->setAcquisitionState(true);
+
+    return true;
+
+}
+
 void MainWindow::saveWindowBounds()
 {
 
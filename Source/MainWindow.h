@@ -45,8 +45,11 @@ class MainWindow   : public DocumentWindow
 public:
 
     /** Initializes the MainWindow, creates the AudioComponent, ProcessorGraph,
-        and UIComponent, and sets the window boundaries. */
-    MainWindow();
+        and UIComponent, and sets the window boundaries.
+
+        In headless mode the window is never shown, and the ProcessorGraph is
+        driven by the internal clock instead of the audio device. */
+    MainWindow(bool headless = false);
 
     /** Destroys the AudioComponent, ProcessorGraph, and UIComponent, and saves the window boundaries. */
     ~MainWindow();
@@ -59,8 +62,14 @@ public:
         commands. */
     ApplicationCommandManager commandManager;
 
+    /** Loads a saved configuration and starts acquisition, without any user
+        interaction (used in headless mode). Returns false if the file can't be loaded. */
+    bool startAcquisitionFromFile(const File& configFile);
+
 private:
 
+    bool isHeadless;
+
     /** Saves the MainWindow's boundaries into the file "windowState.xml", located in the directory
         from which the GUI is run. */
     void saveWindowBounds();
@@ -26,7 +26,8 @@
 #include <stdio.h>
 
 ArduinoOutput::ArduinoOutput()
-    : GenericProcessor("Arduino Output"), state(false)
+    : GenericProcessor("Arduino Output"), dispatcher("Arduino Output", this),
+      state(false), timestamp(0)
 {
 
 }
@@ -46,26 +47,15 @@ void ArduinoOutput::handleEvent(int eventType, MidiMessage& event, int sampleNum
 {
     if (eventType == TTL)
     {
-        const uint8* dataptr = event.getRawData();
-
-        int eventNodeId = *(dataptr+1);
-        int eventId = *(dataptr+2);
-        int eventChannel = *(dataptr+3);
-
-        std::cout << "Received event from " << eventNodeId <<
-                  " on channel " << eventChannel <<
-                  " with value " << eventId << std::endl;
-
-        if (state)
-        {
-            arduino.sendDigital(13, ARD_LOW);
-            state = false;
-        }
-        else
-        {
-            arduino.sendDigital(13, ARD_HIGH);
-            state = true;
-        }
+        // const uint8* dataptr = event.getRawData();
+
+        // int eventNodeId = *(dataptr+1);
+        // int eventId = *(dataptr+2);
+        // int eventChannel = *(dataptr+3);
+
+        state = !state;
+
+        dispatcher.push(13, state ? ARD_HIGH : ARD_LOW, timestamp + sampleNum);
 
         //ArduinoOutputEditor* ed = (ArduinoOutputEditor*) getEditor();
         //ed->receivedEvent();
@@ -73,6 +63,11 @@ void ArduinoOutput::handleEvent(int eventType, MidiMessage& event, int sampleNum
 
 }
 
+void ArduinoOutput::writeOutput(int pin, int value)
+{
+    arduino.sendDigital(pin, value);
+}
+
 void ArduinoOutput::setParameter(int parameterIndex, float newValue)
 {
     editor->updateParameterButtons(parameterIndex);
@@ -121,6 +116,7 @@ bool ArduinoOutput::enable()
 
         std::cout << "Arduino is initialized." << std::endl;
         arduino.sendDigitalPinMode(13, ARD_OUTPUT);
+        dispatcher.start();
         return true;
     }
     else
@@ -132,6 +128,8 @@ bool ArduinoOutput::enable()
 
 bool ArduinoOutput::disable()
 {
+    dispatcher.stop();
+
     if (arduino.isInitialized())
         arduino.disconnect();
     return true;
@@ -142,6 +140,13 @@ void ArduinoOutput::process(AudioSampleBuffer& buffer,
                             int& nSamples)
 {
 
+    EventArena::Reader timestamps(getIncomingEvents(), events, TIMESTAMP);
+    EventArena::Event event;
+
+    while (timestamps.getNextEvent(event))
+    {
+        timestamp = EventArena::getTimestamp(event);
+    }
 
     checkForEvents(events);
 
@@ -29,6 +29,7 @@
 #include "Editors/ArduinoOutputEditor.h"
 #include "Serial/ofArduino.h"
 #include "GenericProcessor.h"
+#include "OutputDispatcher.h"
 
 
 /**
@@ -39,11 +40,15 @@
 
 	Based on Open Frameworks ofArduino class.
 
-	@see GenericProcessor
+	Outputs are written by an OutputDispatcher thread, so process()
+	never waits for the serial port.
+
+	@see GenericProcessor, OutputDispatcher
 
 */
 
-class ArduinoOutput : public GenericProcessor
+class ArduinoOutput : public GenericProcessor,
+    public OutputDispatcher::Device
 {
 public:
 
@@ -75,13 +80,22 @@ public:
         return true;
     }
 
+    /** Sets a digital pin; called on the dispatch thread. */
+    void writeOutput(int pin, int value);
+
 private:
 
     /** An open-frameworks Arduino object. */
     ofArduino arduino;
 
+    /** Writes to the Arduino on its own thread. */
+    OutputDispatcher dispatcher;
+
     bool state;
 
+    /** Timestamp of the current buffer. */
+    int64 timestamp;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ArduinoOutput);
 
 };
@@ -22,13 +22,16 @@
 */
 
 #include "AudioResamplingNode.h"
+#include "PolyphaseResampler.h"
 #include <stdio.h>
 
 AudioResamplingNode::AudioResamplingNode()
     : GenericProcessor("Resampling Node"),
-      sourceBufferSampleRate(40000.0), destBufferSampleRate(44100.0),
-      ratio(1.0), lastRatio(1.0), destBuffer(0), tempBuffer(0),
-      destBufferIsTempBuffer(true), isTransmitting(false), destBufferPos(0)
+      deviceSampleRate(44100.0), targetLatencyMs(0.0f),
+      fifo(2, MONITOR_FIFO_SIZE), numWritten(0), readPosition(0.0),
+      targetLevel(0.0), isPlaying(false),
+      inputSamplesPerBlock(0.0), largestInputBlock(0), numBlocks(0),
+      cutoff(0.0), meanLevel(0.0)
 {
 
     settings.numInputs = 2;
@@ -39,28 +42,30 @@ AudioResamplingNode::AudioResamplingNode()
                          44100.0, // sampleRate
                          128);    // blockSize
 
-    filter = new Dsp::SmoothedFilterDesign
-    <Dsp::RBJ::Design::LowPass, 1> (1024);
+    // Kaiser window over the span of the filter, for each fractional position
+    const double beta = 8.0;
+    const double halfSpan = MONITOR_NUM_TAPS / 2;
 
-    if (destBufferIsTempBuffer)
-        destBufferWidth = 1024;
-    else
-        destBufferWidth = 1000;
+    window.malloc((MONITOR_NUM_PHASES + 1) * MONITOR_NUM_TAPS);
+    taps.malloc((MONITOR_NUM_PHASES + 1) * MONITOR_NUM_TAPS);
 
-    destBufferTimebaseSecs = 1.0;
+    for (int p = 0; p <= MONITOR_NUM_PHASES; p++)
+    {
+        const double fraction = double(p) / MONITOR_NUM_PHASES;
 
-    destBuffer = new AudioSampleBuffer(16, destBufferWidth);
-    tempBuffer = new AudioSampleBuffer(16, destBufferWidth);
+        for (int k = 0; k < MONITOR_NUM_TAPS; k++)
+        {
+            const double t = (k - (halfSpan - 1) - fraction) / halfSpan;
+            window[p * MONITOR_NUM_TAPS + k] = (float) PolyphaseResampler::kaiserWindow(t, beta);
+        }
+    }
 
-    continuousDataBuffer = new int16[10000];
+    updateInterpolator(0.45);
 
 }
 
 AudioResamplingNode::~AudioResamplingNode()
 {
-    filter = 0;
-    deleteAndZero(destBuffer);
-    deleteAndZero(tempBuffer);
 
 }
 
@@ -68,23 +73,13 @@ AudioResamplingNode::~AudioResamplingNode()
 
 void AudioResamplingNode::setParameter(int parameterIndex, float newValue)
 {
-    editor->updateParameterButtons(parameterIndex);
 
-    switch (parameterIndex)
+    if (parameterIndex == 0)
     {
-
-        case 0:
-            destBufferTimebaseSecs = newValue;
-            break;
-        case 1:
-            destBufferWidth = roundToInt(newValue);
-
+        // takes effect the next time the FIFO is filled
+        targetLatencyMs = jmax(0.0f, newValue);
     }
 
-    // reset to zero and clear if timebase or width has changed.
-    destBufferPos = 0;
-    destBuffer->clear();
-
 }
 
 
@@ -93,50 +88,69 @@ void AudioResamplingNode::prepareToPlay(double sampleRate_, int estimatedSamples
 
     std::cout << "AudioResamplingNode preparing to play." << std::endl;
 
-    if (destBufferIsTempBuffer)
-    {
-        destBufferSampleRate = sampleRate_;
-        tempBuffer->setSize(getNumInputs(), 4096);
-    }
-    else
-    {
-        destBufferSampleRate = float(destBufferWidth) / destBufferTimebaseSecs;
-        destBuffer->setSize(getNumInputs(), destBufferWidth);
-    }
+    deviceSampleRate = sampleRate_;
+
+    // the interpolator starts from a history of zeros
+    fifo.clear();
+    numWritten = MONITOR_NUM_TAPS;
+    readPosition = MONITOR_NUM_TAPS;
 
-    destBuffer->clear();
-    tempBuffer->clear();
+    isPlaying = false;
+    targetLevel = 0.0;
 
-    destBufferPos = 0;
+    inputSamplesPerBlock = 0.0;
+    largestInputBlock = 0;
+    numBlocks = 0;
 
-    std::cout << "Temp buffer size: " << tempBuffer->getNumChannels() << " x "
-              << tempBuffer->getNumSamples() << std::endl;
+    meanLevel = 0.0;
+    latencyUs = 0;
+    numDropouts = 0;
 
-    updateFilter();
+    updateInterpolator(0.45);
 
 }
 
-void AudioResamplingNode::updateFilter()
+void AudioResamplingNode::updateInterpolator(double cutoff_)
 {
 
-    double cutoffFreq = (ratio > 1.0) ? 2 * destBufferSampleRate  // downsample
-                        : destBufferSampleRate / 2; // upsample
+    cutoff = cutoff_;
+
+    const double halfSpan = MONITOR_NUM_TAPS / 2;
+
+    for (int p = 0; p <= MONITOR_NUM_PHASES; p++)
+    {
+        const double fraction = double(p) / MONITOR_NUM_PHASES;
+
+        float* row = taps + p * MONITOR_NUM_TAPS;
+        double sum = 0;
 
-    double sampleFreq = (ratio > 1.0) ? sourceBufferSampleRate // downsample
-                        : destBufferSampleRate;  // upsample
+        for (int k = 0; k < MONITOR_NUM_TAPS; k++)
+        {
+            const double x = 2.0 * double_Pi * cutoff * (k - (halfSpan - 1) - fraction);
+            const double sinc = (std::abs(x) < 1e-9) ? 1.0 : std::sin(x) / x;
 
-    Dsp::Params params;
-    params[0] = sampleFreq; // sample rate
-    params[1] = cutoffFreq; // cutoff frequency
-    params[2] = 1.25; //Q //
+            row[k] = (float)(sinc * window[p * MONITOR_NUM_TAPS + k]);
+            sum += row[k];
+        }
 
-    filter->setParams(params);
+        // unity gain at DC for every position
+        for (int k = 0; k < MONITOR_NUM_TAPS; k++)
+            row[k] /= (float) sum;
+    }
 
 }
 
 void AudioResamplingNode::releaseResources()
 {
 
+    isPlaying = false;
+    latencyUs = 0;
+
+}
+
+float AudioResamplingNode::getLatencyMs()
+{
+    return latencyUs.get() / 1000.0f;
 }
 
 void AudioResamplingNode::process(AudioSampleBuffer& buffer,
@@ -144,193 +158,158 @@ void AudioResamplingNode::process(AudioSampleBuffer& buffer,
                                   int& nSamples)
 {
 
-    int nSamps = nSamples;
-    int valuesNeeded;
+    const int numInput = jmin(nSamples, MONITOR_FIFO_SIZE / 2);
+    const int numOutput = buffer.getNumSamples();
 
-    if (destBufferIsTempBuffer)
-    {
-        ratio = float(nSamps) / float(buffer.getNumSamples());
-        valuesNeeded = buffer.getNumSamples();
-    }
-    else
+    // write the new samples, wrapping around the end of the FIFO
+    if (numInput > 0)
     {
-        ratio = sourceBufferSampleRate / destBufferSampleRate;
-        valuesNeeded = (int) buffer.getNumSamples() / ratio;
-        //std::cout << std::endl;
-        //std::cout << "Ratio: " << ratio << std::endl;
-        //std::cout << "Values needed: " << valuesNeeded << std::endl;
-    }
+        const int start = int(numWritten & (MONITOR_FIFO_SIZE - 1));
+        const int size1 = jmin(numInput, MONITOR_FIFO_SIZE - start);
 
+        for (int channel = 0; channel < 2; channel++)
+        {
+            fifo.copyFrom(channel, start, buffer, channel, 0, size1);
 
+            if (numInput > size1)
+                fifo.copyFrom(channel, 0, buffer, channel, size1, numInput - size1);
+        }
 
-    if (lastRatio != ratio)
-    {
-        updateFilter();
-        lastRatio = ratio;
+        numWritten += numInput;
+        largestInputBlock = jmax(largestInputBlock, numInput);
     }
 
-
-    if (ratio > 1.0001)
+    // once samples arrive, the mean over the last hundred or so buffers
+    // gives the ratio of the input and output rates
+    if (numWritten > MONITOR_NUM_TAPS)
     {
-        // pre-apply filter before downsampling
-        filter->process(nSamps, buffer.getArrayOfChannels());
+        numBlocks++;
+        const double alpha = jmax(0.01, 1.0 / double(numBlocks));
+        inputSamplesPerBlock += alpha * (numInput - inputSamplesPerBlock);
     }
 
+    nSamples = numOutput;
 
-    // initialize variables
-    tempBuffer->clear();
-    int sourceBufferPos = 0;
-    int sourceBufferSize = buffer.getNumSamples();
-    float subSampleOffset = 0.0;
-    int nextPos = (sourceBufferPos + 1) % sourceBufferSize;
+    const double nominalStep = inputSamplesPerBlock / numOutput;
+    double level = double(numWritten) - readPosition;
 
-    int tempBufferPos;
-    //int totalSamples = 0;
+    // keep enough samples after the read position for the whole filter
+    const double minLevel = MONITOR_NUM_TAPS / 2 + 1;
 
-    // code modified from "juce_ResamplingAudioSource.cpp":
-
-    for (tempBufferPos = 0; tempBufferPos < valuesNeeded; tempBufferPos++)
+    if (nominalStep <= 0.0)
     {
-        float gain = 1.0;
-        float alpha = (float) subSampleOffset;
-        float invAlpha = 1.0f - alpha;
-
-        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-        {
+        buffer.clear(0, 0, numOutput);
+        buffer.clear(1, 0, numOutput);
+        return;
+    }
 
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,  // destSampleOffset
-                                buffer,			// source
-                                channel,		// sourceChannel
-                                sourceBufferPos,// sourceSampleOffset
-                                1,				// number of samples
-                                invAlpha*gain);      // gain to apply to source
-
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,   // destSampleOffset
-                                buffer,			// source
-                                channel,			// sourceChannel
-                                nextPos,		 	// sourceSampleOffset
-                                1,				// number of samples
-                                alpha*gain);     	 // gain to apply to source
+    // a lower output rate needs a lower cut-off
+    const double newCutoff = 0.45 * jmin(1.0, 1.0 / nominalStep);
 
-        }
+    if (std::abs(newCutoff - cutoff) > 0.05 * cutoff)
+        updateInterpolator(newCutoff);
 
-        subSampleOffset += ratio;
+    if (level > MONITOR_FIFO_SIZE - MONITOR_NUM_TAPS)
+    {
+        // the output has stopped for too long; skip ahead
+        readPosition = double(numWritten) - targetLevel;
+        level = targetLevel;
+        ++numDropouts;
+    }
 
+    if (!isPlaying)
+    {
+        // the level has to absorb the largest burst of input
+        double level0 = 1.25 * jmax(double(largestInputBlock), nominalStep * numOutput) + minLevel;
 
+        if (targetLatencyMs > 0)
+            level0 = jmax(level0, targetLatencyMs * 0.001 * nominalStep * deviceSampleRate);
 
-        while (subSampleOffset >= 1.0)
+        if (level < level0)
         {
-            if (++sourceBufferPos >= sourceBufferSize)
-                sourceBufferPos = 0;
-
-            nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-            subSampleOffset -= 1.0;
+            buffer.clear(0, 0, numOutput);
+            buffer.clear(1, 0, numOutput);
+            return;
         }
-    }
 
-    // std::cout << sourceBufferPos << " " << tempBufferPos << std::endl;
+        // start with exactly the target level
+        targetLevel = level0;
+        readPosition = double(numWritten) - targetLevel;
+        level = targetLevel;
+        meanLevel = level;
 
-
-    if (ratio < 0.9999)
-    {
-
-        filter->process(tempBufferPos, tempBuffer->getArrayOfChannels());
-        // apply the filter after upsampling
-        ///////filter->process (totalSamples, buffer.getArrayOfChannels());
+        isPlaying = true;
     }
-    else if (ratio <= 1.0001)
-    {
 
-        // no resampling is being applied, no need to filter, BUT...
-        // keep the filter stoked with samples to avoid discontinuities
+    meanLevel += 0.05 * (level - meanLevel);
 
-    }
+    // nudge the ratio to bring the FIFO back to its target level
+    const double error = (meanLevel - targetLevel) / targetLevel;
+    const double step = nominalStep * (1.0 + jlimit(-0.01, 0.01, 0.05 * error));
 
-    if (destBufferIsTempBuffer)
+    if (readPosition + step * numOutput + minLevel > double(numWritten))
     {
-
-        // copy the temp buffer into the original buffer
-        buffer = AudioSampleBuffer(tempBuffer->getArrayOfChannels(), 2, tempBufferPos);//buffer.getNumSamples());
-
+        // the FIFO ran dry; refill it to a higher level
+        largestInputBlock = jmax(largestInputBlock, roundToInt(targetLevel));
+        isPlaying = false;
+        latencyUs = 0;
+        ++numDropouts;
+
+        buffer.clear(0, 0, numOutput);
+        buffer.clear(1, 0, numOutput);
+        return;
     }
-    else
-    {
 
-        //std::cout << "Copying into dest buffer..." << std::endl;
+    readFromFifo(buffer, numOutput, step);
 
-        // copy the temp buffer into the destination buffer
+    // a sample that arrives now is played after the FIFO's contents and
+    // the rest of this buffer
+    const double inputRate = nominalStep * deviceSampleRate;
+    latencyUs = roundToInt(1.0e6 * (meanLevel / inputRate + numOutput / deviceSampleRate));
 
-        int pos = 0;
-
-        while (*tempBuffer->getSampleData(0,pos) != 0)
-            pos++;
-
-        int spaceAvailable = destBufferWidth - destBufferPos;
-        int blockSize1 = (spaceAvailable > pos) ? pos : spaceAvailable;
-        int blockSize2 = (spaceAvailable > pos) ? 0 : (pos - spaceAvailable);
-
-        for (int channel = 0; channel < destBuffer->getNumChannels(); channel++)
-        {
-
-            // copy first block
-            destBuffer->copyFrom(channel, 		//destChannel
-                                 destBufferPos, //destStartSample
-                                 *tempBuffer, 	//source
-                                 channel, 		//sourceChannel
-                                 0, 			//sourceStartSample
-                                 blockSize1  //numSamples
-                                );
-
-            // copy second block
-            destBuffer->copyFrom(channel, 		//destChannel
-                                 0, 			//destStartSample
-                                 *tempBuffer, 	//source
-                                 channel, 		//sourceChannel
-                                 blockSize1, 	//sourceStartSample
-                                 blockSize2  //numSamples
-                                );
+}
 
-        }
+void AudioResamplingNode::readFromFifo(AudioSampleBuffer& buffer, int numSamples, double step)
+{
 
-        //destBufferPos = (spaceAvailable > tempBufferPos) ? destBufferPos
+    const int mask = MONITOR_FIFO_SIZE - 1;
+    const int halfSpan = MONITOR_NUM_TAPS / 2;
 
-        destBufferPos += pos;
-        destBufferPos %= destBufferWidth;
+    const float* left = fifo.getSampleData(0);
+    const float* right = fifo.getSampleData(1);
 
-        //std::cout << "Temp buffer position: " << tempBufferPos << std::endl;
-        //std::cout << "Resampling node value:" << *destBuffer->getSampleData(0,0) << std::endl;
+    float* leftOut = buffer.getSampleData(0);
+    float* rightOut = buffer.getSampleData(1);
 
-    }
+    for (int n = 0; n < numSamples; n++)
+    {
+        const int64 index = (int64) readPosition;
+        const double phase = (readPosition - double(index)) * MONITOR_NUM_PHASES;
 
-}
+        // interpolate between the two nearest rows of taps
+        const int row = (int) phase;
+        const float alpha = (float)(phase - row);
 
+        const float* taps0 = taps + row * MONITOR_NUM_TAPS;
+        const float* taps1 = taps0 + MONITOR_NUM_TAPS;
 
-void AudioResamplingNode::writeContinuousBuffer(float* data, int nSamples, int channel)
-{
+        const int64 first = index - (halfSpan - 1);
 
-    // find file and write samples to disk
-    timestamp = timer.getHighResolutionTicks();
+        float sumLeft = 0.0f, sumRight = 0.0f;
 
-    AudioDataConverters::convertFloatToInt16BE(data, continuousDataBuffer, nSamples);
+        for (int k = 0; k < MONITOR_NUM_TAPS; k++)
+        {
+            const float h = taps0[k] + alpha * (taps1[k] - taps0[k]);
+            const int i = int((first + k) & mask);
 
-    //int16 samps = nSamples;
+            sumLeft += h * left[i];
+            sumRight += h * right[i];
+        }
 
-    fwrite(&timestamp,							// ptr
-           8,   							// size of each element
-           1, 		  						// count
-           file);   // ptr to FILE object
+        leftOut[n] = sumLeft;
+        rightOut[n] = sumRight;
 
-    fwrite(&nSamples,								// ptr
-           sizeof(nSamples),   				// size of each element
-           1, 		  						// count
-           file);   // ptr to FILE object
+        readPosition += step;
+    }
 
-    fwrite(continuousDataBuffer,			// ptr
-           2,			     					// size of each element
-           nSamples, 		  					// count
-           file);   // ptr to FILE object
-    // FIXME: check that return value of each fwrite() equals "count";
-    // otherwise, there was an error.
 }
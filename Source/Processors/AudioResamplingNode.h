@@ -27,21 +27,34 @@
 
 
 #include "../../JuceLibraryCode/JuceHeader.h"
-#include "../Dsp/Dsp.h"
 #include "GenericProcessor.h"
 
+// input samples per channel held by the FIFO (a power of two)
+#define MONITOR_FIFO_SIZE 65536
+
+// length and resolution of the interpolation filter
+#define MONITOR_NUM_TAPS 16
+#define MONITOR_NUM_PHASES 256
+
 /**
 
-  Changes the sample rate of continuous data, specialized for increasing
-  the sample rate to 44.1 kHz for audio output.
+  Changes the sample rate of the two monitor channels from the acquisition
+  rate to the rate of the audio device.
 
-  Code is based on Juce's ResamplingAudioSource class.
+  Incoming samples go into a FIFO, and each output buffer is filled by
+  reading the FIFO at the ratio of the two rates with a windowed-sinc
+  interpolator, whose fractional position carries over from one buffer to
+  the next. The input rate is estimated from the number of samples that
+  arrive per buffer, and the ratio is nudged (by at most 1%) to keep the
+  FIFO at a fixed level, so the monitoring latency stays the same even if
+  the two clocks drift or the input arrives in bursts.
 
-  This processor could be vastly improved by implementing a scheme to handle
-  inputs that do not provide the same amount of samples in each buffer. At the
-  moment, the resampling process shifts the pitch of the incoming signal.
+  The level is set when playback starts, from the target latency
+  (parameter 0, in ms) or, if that is 0, from the largest input block seen
+  so far. If the FIFO runs dry it refills to a higher level before
+  playback resumes.
 
-  @see GenericProcessor
+  @see GenericProcessor, AudioNode
 
 */
 
@@ -53,51 +66,61 @@ public:
     AudioResamplingNode();
     ~AudioResamplingNode();
 
-    AudioSampleBuffer* getBufferAddress()
-    {
-        return destBuffer;
-    }
-    void updateFilter();
-
     void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock);
     void releaseResources();
     void process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages, int& nSamples);
     void setParameter(int parameterIndex, float newValue);
 
-    AudioSampleBuffer* getContinuousBuffer()
+    /** Returns the measured time from a sample's arrival to the end of the
+        output buffer it is played in, in ms, or 0 if nothing is playing.*/
+    float getLatencyMs();
+
+    /** Returns the number of times the FIFO ran dry or overflowed since
+        playback started.*/
+    int getNumDropouts()
     {
-        return destBuffer;
+        return numDropouts.get();
     }
 
-
 private:
 
-    // sample rate, timebase, and ratio info:
-    double sourceBufferSampleRate, destBufferSampleRate;
-    double ratio, lastRatio;
-    double destBufferTimebaseSecs;
-    int destBufferWidth;
+    /** Computes the interpolation filter for a cut-off given as a fraction
+        of the input rate.*/
+    void updateInterpolator(double cutoff);
+
+    /** Fills numSamples samples of the two output channels from the FIFO.*/
+    void readFromFifo(AudioSampleBuffer& buffer, int numSamples, double step);
+
+    double deviceSampleRate;
+    float targetLatencyMs;
+
+    AudioSampleBuffer fifo;
 
-    // major objects:
-    Dsp::Filter* filter;
-    AudioSampleBuffer* destBuffer;
-    AudioSampleBuffer* tempBuffer;
+    /** Number of input samples written to the FIFO since playback started.*/
+    int64 numWritten;
 
-    // is the destBuffer a temp buffer or not?
-    bool destBufferIsTempBuffer;
-    bool isTransmitting;
+    /** Position of the next output sample, in input samples.*/
+    double readPosition;
 
-    // indexing objects that persist between rounds:
-    int destBufferPos;
+    /** FIFO level, in input samples, that the ratio is adjusted to keep.*/
+    double targetLevel;
+    bool isPlaying;
 
-    // for testing purposes only:
-    void writeContinuousBuffer(float*, int, int);
+    /** Mean number of input samples per output buffer, and the largest
+        number that has arrived at once.*/
+    double inputSamplesPerBlock;
+    int largestInputBlock;
+    int64 numBlocks;
 
-    FILE* file;
-    int64 timestamp;
-    Time timer;
+    /** MONITOR_NUM_PHASES + 1 rows of MONITOR_NUM_TAPS taps, for fractional
+        positions from 0 to 1.*/
+    HeapBlock<float> taps;
+    HeapBlock<float> window;
+    double cutoff;
 
-    int16* continuousDataBuffer;
+    double meanLevel;
+    Atomic<int> latencyUs;
+    Atomic<int> numDropouts;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioResamplingNode);
 
@@ -0,0 +1,241 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+
+  Measures how long it takes to remap and reference the channels of one
+  block, as the ChannelMappingNode does. It compares two ways:
+  - The old one: copy the whole buffer, clear it, add every channel back in
+    map order, then add each reference with a gain of -1.
+  - ChannelRemapper: updateRemapOperations() once per mapping, then
+    process(), which runs remapChannel() in place.
+  Three mappings are timed: the identity, a swap of each pair of channels
+  with every channel referenced to channel 0, and a reversal of all
+  channels with the same reference. It prints the best time per block, in
+  microseconds, for 64, 256 and 1024 channels, and the time
+  updateRemapOperations() takes.
+
+  This is a standalone program; it is not part of the GUI build. To build it
+  from this directory:
+
+    g++ -O3 -march=native -DLINUX=1 -DNDEBUG=1 -I../../JuceLibraryCode -I/usr/include/freetype2 \
+        ChannelMappingBenchmark.cpp ChannelRemapper.cpp \
+        ../../JuceLibraryCode/modules/juce_core/juce_core.cpp \
+        ../../JuceLibraryCode/modules/juce_audio_basics/juce_audio_basics.cpp \
+        -o ChannelMappingBenchmark -lpthread -ldl -lrt
+
+  The program also compares the results, which must be identical. The exit
+  code is non-zero if they are not.
+
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "ChannelRemapper.h"
+
+#define NUM_SAMPLES 1024
+#define NUM_REPEATS 50
+#define NUM_REFERENCES 16
+
+enum Mapping
+{
+    IDENTITY = 0,
+    PAIR_SWAP_WITH_REFERENCE,
+    REVERSAL_WITH_REFERENCE,
+    NUM_MAPPINGS
+};
+
+static const char* mappingNames[NUM_MAPPINGS] =
+{
+    "identity",
+    "pair swap + reference",
+    "reversal + reference"
+};
+
+/** What ChannelMappingNode::process() used to do.*/
+static void remapOld(AudioSampleBuffer& buffer, AudioSampleBuffer& channelBuffer, int nSamples,
+                     const Array<int>& channelArray, const Array<int>& referenceArray,
+                     const Array<int>& referenceChannels, const Array<bool>& enabledChannelArray)
+{
+    int j = 0;
+
+    channelBuffer = buffer;
+
+    buffer.clear();
+
+    for (int i = 0; i < buffer.getNumChannels(); i++)
+    {
+        if (enabledChannelArray[channelArray[i]])
+        {
+            buffer.addFrom(j, 0, channelBuffer, channelArray[i], 0, nSamples, 1.0f);
+            j++;
+        }
+    }
+
+    j = 0;
+
+    for (int i = 0; i < buffer.getNumChannels(); i++)
+    {
+        int realChan = channelArray[i];
+
+        if (enabledChannelArray[realChan])
+        {
+            if ((referenceArray[realChan] > -1) && referenceChannels[referenceArray[realChan]] > -1)
+            {
+                buffer.addFrom(j, 0, channelBuffer, referenceChannels[referenceArray[realChan]],
+                               0, nSamples, -1.0f);
+            }
+
+            j++;
+        }
+    }
+}
+
+static double ticksToMicroseconds(int64 ticks)
+{
+    return Time::highResolutionTicksToSeconds(ticks) * 1.0e6;
+}
+
+int main()
+{
+
+    Random random(1);
+
+    bool allMatch = true;
+
+    std::cout << "ChannelRemapper (" << ChannelRemapper::getInstructionSet() << "), "
+              << NUM_SAMPLES << " samples per channel, best of " << NUM_REPEATS
+              << ", us per block:" << std::endl;
+
+    for (int numChannels = 64; numChannels <= 1024; numChannels *= 4)
+    {
+
+        AudioSampleBuffer input(numChannels, NUM_SAMPLES);
+
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            float* samples = input.getSampleData(chan);
+
+            for (int n = 0; n < NUM_SAMPLES; n++)
+                samples[n] = (random.nextFloat() * 2.0f - 1.0f) * 500.0f;
+        }
+
+        AudioSampleBuffer oldResult(numChannels, NUM_SAMPLES);
+        AudioSampleBuffer newResult(numChannels, NUM_SAMPLES);
+        AudioSampleBuffer channelBuffer(numChannels, NUM_SAMPLES);
+
+        ChannelRemapper remapper;
+        remapper.setSize(numChannels, NUM_SAMPLES);
+
+        for (int mapping = 0; mapping < NUM_MAPPINGS; mapping++)
+        {
+
+            Array<int> channelArray;
+            Array<int> referenceArray;
+            Array<int> referenceChannels;
+            Array<bool> enabledChannelArray;
+
+            for (int chan = 0; chan < numChannels; chan++)
+            {
+                if (mapping == PAIR_SWAP_WITH_REFERENCE)
+                    channelArray.add(chan ^ 1);
+                else if (mapping == REVERSAL_WITH_REFERENCE)
+                    channelArray.add(numChannels - 1 - chan);
+                else
+                    channelArray.add(chan);
+
+                referenceArray.add(mapping == IDENTITY ? -1 : 0);
+                enabledChannelArray.add(true);
+            }
+
+            referenceChannels.add(0);
+
+            for (int i = 1; i < NUM_REFERENCES; i++)
+                referenceChannels.add(-1);
+
+            int64 bestOld = 0, bestUpdate = 0, bestNew = 0;
+
+            for (int repeat = 0; repeat < NUM_REPEATS; repeat++)
+            {
+                // both paths work in place, so each starts from a fresh copy
+                oldResult = input;
+
+                const int64 startOld = Time::getHighResolutionTicks();
+
+                remapOld(oldResult, channelBuffer, NUM_SAMPLES, channelArray, referenceArray,
+                         referenceChannels, enabledChannelArray);
+
+                const int64 endOld = Time::getHighResolutionTicks();
+
+                newResult = input;
+
+                const int64 startUpdate = Time::getHighResolutionTicks();
+
+                remapper.updateRemapOperations(numChannels, channelArray, referenceArray,
+                                               referenceChannels, enabledChannelArray);
+
+                const int64 startNew = Time::getHighResolutionTicks();
+
+                remapper.process(newResult, NUM_SAMPLES);
+
+                const int64 endNew = Time::getHighResolutionTicks();
+
+                if (repeat == 0 || endOld - startOld < bestOld)
+                    bestOld = endOld - startOld;
+
+                if (repeat == 0 || startNew - startUpdate < bestUpdate)
+                    bestUpdate = startNew - startUpdate;
+
+                if (repeat == 0 || endNew - startNew < bestNew)
+                    bestNew = endNew - startNew;
+            }
+
+            int numMismatches = 0;
+
+            for (int chan = 0; chan < numChannels; chan++)
+            {
+                const float* oldSamples = oldResult.getSampleData(chan);
+                const float* newSamples = newResult.getSampleData(chan);
+
+                for (int n = 0; n < NUM_SAMPLES; n++)
+                {
+                    if (oldSamples[n] != newSamples[n])
+                        numMismatches++;
+                }
+            }
+
+            allMatch = allMatch && (numMismatches == 0);
+
+            std::cout << "   " << String(numChannels).paddedLeft(' ', 4) << " channels, "
+                      << String(mappingNames[mapping]).paddedRight(' ', 21) << ": old "
+                      << ticksToMicroseconds(bestOld) << ", new "
+                      << ticksToMicroseconds(bestNew) << " (" << remapper.getNumOperations()
+                      << " operations, updated in " << ticksToMicroseconds(bestUpdate) << "; "
+                      << numMismatches << " samples differ)" << std::endl;
+
+        }
+
+    }
+
+    return allMatch ? 0 : 1;
+
+}
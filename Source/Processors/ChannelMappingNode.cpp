@@ -25,10 +25,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "ChannelMappingNode.h"
 #include "Editors/ChannelMappingEditor.h"
 
-
-
 ChannelMappingNode::ChannelMappingNode()
-	: GenericProcessor("Channel Map"), previousChannelCount(0), channelBuffer(1,10000)
+	: GenericProcessor("Channel Map"), previousChannelCount(0), remapOperationsAreValid(false)
 {
 	referenceArray.resize(1024); // make room for 1024 channels
 	channelArray.resize(1024);
@@ -64,8 +62,10 @@ AudioProcessorEditor* ChannelMappingNode::createEditor()
 
 void ChannelMappingNode::updateSettings()
 {
-	if (getNumInputs() > 0)
-		channelBuffer.setSize(getNumInputs(), 10000);
+	// allocated here, so that process() never has to
+	remapper.setSize(getNumInputs(), 10000);
+
+	remapOperationsAreValid = false;
 
 	if (getNumInputs() != previousChannelCount)
 	{
@@ -111,59 +111,24 @@ void ChannelMappingNode::setParameter(int parameterIndex, float newValue)
 		channelArray.set(currentChannel, (int) newValue);
 	}
 
+	remapOperationsAreValid = false;
+
 }
 
 void ChannelMappingNode::process(AudioSampleBuffer& buffer,
 								 MidiBuffer& midiMessages,
 								 int& nSamples)
 {
-	int j=0;
-
-	// use copy constructor to set the data to refer to
-	channelBuffer = buffer;
+	const int numChannels = jmin(getNumInputs(), buffer.getNumChannels(), remapper.getMaxChannels());
 
-	// copy it back into the buffer according to the channel mapping
-	buffer.clear();
-
-	for (int i = 0; i < buffer.getNumChannels(); i++)
+	if (!remapOperationsAreValid || numChannels != remapper.getNumChannels())
 	{
-		if (enabledChannelArray[channelArray[i]])
-		{
-			buffer.addFrom(j, // destChannel
-				0, // destStartSample
-				channelBuffer, // source
-				channelArray[i], // sourceChannel
-				0, // sourceStartSample
-				nSamples, // numSamples
-				1.0f // gain to apply to source (positive for original signal)
-				);
-			j++;
-		}
-
+		// marked valid first, so that a change made while this runs is not lost
+		remapOperationsAreValid = true;
+		remapper.updateRemapOperations(numChannels, channelArray, referenceArray,
+									   referenceChannels, enabledChannelArray);
 	}
 
-	j=0;
-	// now do the referencing
-	for (int i = 0; i < buffer.getNumChannels(); i++)
-	{
-		int realChan = channelArray[i];
-		if (enabledChannelArray[realChan])
-		{
-			if ((referenceArray[realChan] > -1) && referenceChannels[referenceArray[realChan]] > -1)
-			{
-
-				buffer.addFrom(j, // destChannel
-					0, // destStartSample
-					channelBuffer, // source
-					referenceChannels[referenceArray[realChan]], // sourceChannel
-					0, // sourceStartSample
-					nSamples, // numSamples
-					-1.0f // gain to apply to source (negative for reference)
-					);
-			}
-			j++;
-		}
-	}
+	remapper.process(buffer, nSamples);
 
 }
-
@@ -29,6 +29,7 @@
 
 
 #include "GenericProcessor.h"
+#include "ChannelRemapper.h"
 
 
 /**
@@ -38,7 +39,11 @@
   Allows the user to select a subset of channels, remap their order, and reference them against
   any other channel.
 
-  @see GenericProcessor
+  Whenever the mapping changes, a ChannelRemapper turns it into a list of operations of the form
+  out[dest] = in[source] - in[reference], which process() then runs in place, in a single pass
+  over the data.
+
+  @see GenericProcessor, ChannelRemapper
 
 */
 
@@ -71,7 +76,10 @@ private:
 
 	int previousChannelCount;
 
-    AudioSampleBuffer channelBuffer;
+    /** False when the mapping has changed since the remapper was last updated.*/
+    bool remapOperationsAreValid;
+
+    ChannelRemapper remapper;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelMappingNode);
 
@@ -0,0 +1,261 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ChannelRemapper.h"
+
+#if defined(__AVX__)
+ #include <immintrin.h>
+ #define CHANNEL_MAPPING_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define CHANNEL_MAPPING_SSE2 1
+#endif
+
+ChannelRemapper::ChannelRemapper()
+    : numChannels(0), numSavedChannels(0), workspaceSize(0), channelBuffer(1, 1)
+{
+
+}
+
+ChannelRemapper::~ChannelRemapper()
+{
+
+}
+
+void ChannelRemapper::setSize(int maxChannels, int maxSamples)
+{
+    if (maxChannels > 0)
+        channelBuffer.setSize(maxChannels, maxSamples);
+
+    if (maxChannels > workspaceSize)
+    {
+        workspaceSize = maxChannels;
+
+        outputSource.malloc(workspaceSize);
+        outputReference.malloc(workspaceSize);
+        pendingReaders.malloc(workspaceSize);
+        channelLocation.malloc(workspaceSize);
+        readyOutputs.malloc(workspaceSize);
+        channelPointers.malloc(2 * workspaceSize);
+        remapOperations.ensureStorageAllocated(2 * workspaceSize);
+    }
+}
+
+void ChannelRemapper::remapChannel(float* dest, const float* source, const float* reference, int numSamples)
+{
+    if (reference == nullptr)
+    {
+        if (dest != source)
+            FloatVectorOperations::copy(dest, source, numSamples);
+
+        return;
+    }
+
+    int n = 0;
+
+#if CHANNEL_MAPPING_AVX
+
+    for (; n + 16 <= numSamples; n += 16)
+    {
+        __m256 a = _mm256_sub_ps(_mm256_loadu_ps(source + n), _mm256_loadu_ps(reference + n));
+        __m256 b = _mm256_sub_ps(_mm256_loadu_ps(source + n + 8), _mm256_loadu_ps(reference + n + 8));
+
+        _mm256_storeu_ps(dest + n, a);
+        _mm256_storeu_ps(dest + n + 8, b);
+    }
+
+#elif CHANNEL_MAPPING_SSE2
+
+    for (; n + 8 <= numSamples; n += 8)
+    {
+        __m128 a = _mm_sub_ps(_mm_loadu_ps(source + n), _mm_loadu_ps(reference + n));
+        __m128 b = _mm_sub_ps(_mm_loadu_ps(source + n + 4), _mm_loadu_ps(reference + n + 4));
+
+        _mm_storeu_ps(dest + n, a);
+        _mm_storeu_ps(dest + n + 4, b);
+    }
+
+#endif
+
+    for (; n < numSamples; n++)
+    {
+        dest[n] = source[n] - reference[n];
+    }
+}
+
+const char* ChannelRemapper::getInstructionSet()
+{
+#if CHANNEL_MAPPING_AVX
+    return "AVX";
+#elif CHANNEL_MAPPING_SSE2
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void ChannelRemapper::updateRemapOperations(int numChannels_,
+                                            const Array<int>& channelArray,
+                                            const Array<int>& referenceArray,
+                                            const Array<int>& referenceChannels,
+                                            const Array<bool>& enabledChannelArray)
+{
+    numChannels = jmin(numChannels_, workspaceSize);
+    numSavedChannels = 0;
+
+    remapOperations.clearQuick();
+
+    // output j is the j-th enabled channel in map order, minus its reference (if any)
+    int numOutputs = 0;
+
+    for (int i = 0; i < numChannels; i++)
+    {
+        int realChan = channelArray[i];
+
+        if (realChan < 0 || realChan >= numChannels || !enabledChannelArray[realChan])
+            continue;
+
+        int reference = -1;
+
+        if ((referenceArray[realChan] > -1) && referenceChannels[referenceArray[realChan]] > -1)
+            reference = referenceChannels[referenceArray[realChan]];
+
+        outputSource[numOutputs] = realChan;
+        outputReference[numOutputs] = (reference < numChannels) ? reference : -1;
+        numOutputs++;
+    }
+
+    // an output that is its own source and has no reference is left as it is;
+    // every other output j overwrites channel j, so the outputs that read channel j
+    // have to come first: pendingReaders[j] counts them, or is -1 once j is done
+    int numRemaining = 0;
+
+    for (int j = 0; j < numChannels; j++)
+    {
+        pendingReaders[j] = -1;
+        channelLocation[j] = j;
+    }
+
+    for (int j = 0; j < numOutputs; j++)
+    {
+        if (outputSource[j] != j || outputReference[j] > -1)
+        {
+            pendingReaders[j] = 0;
+            numRemaining++;
+        }
+    }
+
+    for (int j = 0; j < numOutputs; j++)
+    {
+        if (pendingReaders[j] < 0)
+            continue;
+
+        const int reads[2] = { outputSource[j], outputReference[j] };
+
+        for (int k = 0; k < 2; k++)
+        {
+            if (reads[k] > -1 && reads[k] != j && pendingReaders[reads[k]] > -1)
+                pendingReaders[reads[k]]++;
+        }
+    }
+
+    int numReady = 0;
+
+    for (int j = 0; j < numOutputs; j++)
+    {
+        if (pendingReaders[j] == 0)
+            readyOutputs[numReady++] = j;
+    }
+
+    int nextCandidate = 0;
+
+    while (numRemaining > 0)
+    {
+        if (numReady == 0)
+        {
+            // what is left reads itself in a circle: save one channel, so that
+            // its readers no longer depend on it
+            while (pendingReaders[nextCandidate] <= 0)
+                nextCandidate++;
+
+            RemapOperation save = { numChannels + numSavedChannels, nextCandidate, -1 };
+            remapOperations.add(save);
+
+            channelLocation[nextCandidate] = numChannels + numSavedChannels;
+            numSavedChannels++;
+
+            pendingReaders[nextCandidate] = 0;
+            readyOutputs[numReady++] = nextCandidate;
+        }
+
+        const int j = readyOutputs[--numReady];
+        const int source = outputSource[j];
+        const int reference = outputReference[j];
+
+        RemapOperation op = { j, channelLocation[source],
+                              (reference > -1) ? channelLocation[reference] : -1
+                            };
+        remapOperations.add(op);
+
+        pendingReaders[j] = -1;
+        numRemaining--;
+
+        const int reads[2] = { source, reference };
+
+        for (int k = 0; k < 2; k++)
+        {
+            if (reads[k] > -1 && reads[k] != j && pendingReaders[reads[k]] > 0)
+            {
+                if (--pendingReaders[reads[k]] == 0)
+                    readyOutputs[numReady++] = reads[k];
+            }
+        }
+    }
+
+    jassert(numSavedChannels <= channelBuffer.getNumChannels());
+
+}
+
+void ChannelRemapper::process(AudioSampleBuffer& buffer, int nSamples)
+{
+    if (remapOperations.size() == 0)
+        return;
+
+    for (int i = 0; i < numChannels; i++)
+        channelPointers[i] = buffer.getSampleData(i);
+
+    for (int i = 0; i < numSavedChannels; i++)
+        channelPointers[numChannels + i] = channelBuffer.getSampleData(i);
+
+    const int numSamples = jmin(nSamples, channelBuffer.getNumSamples());
+
+    for (int i = 0; i < remapOperations.size(); i++)
+    {
+        const RemapOperation& op = remapOperations.getReference(i);
+
+        remapChannel(channelPointers[op.dest],
+                     channelPointers[op.source],
+                     (op.reference > -1) ? channelPointers[op.reference] : nullptr,
+                     numSamples);
+    }
+}
@@ -0,0 +1,128 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __CHANNELREMAPPER_H_5E2B91D4__
+#define __CHANNELREMAPPER_H_5E2B91D4__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Remaps and references the channels of a buffer in place.
+
+  updateRemapOperations() turns a channel map into a list of operations of
+  the form out[dest] = in[source] - in[reference], ordered so that each
+  channel is read before it is overwritten; process() then runs them in a
+  single pass over the data. Channels that stay where they are and have no
+  reference are not touched at all, and only channels that are part of a
+  cycle of the mapping (e.g. two swapped channels) are saved to a separate
+  buffer first.
+
+  @see ChannelMappingNode
+
+*/
+
+class ChannelRemapper
+{
+public:
+
+    ChannelRemapper();
+    ~ChannelRemapper();
+
+    /** Allocates everything updateRemapOperations() and process() need for up
+        to maxChannels channels of maxSamples samples, so neither allocates.*/
+    void setSize(int maxChannels, int maxSamples);
+
+    /** Rebuilds the operations for the given number of input channels.
+
+        Output j is the j-th enabled channel in map order (channelArray), minus
+        its reference: referenceChannels[referenceArray[channel]], if both are
+        set (i.e. > -1).*/
+    void updateRemapOperations(int numChannels,
+                               const Array<int>& channelArray,
+                               const Array<int>& referenceArray,
+                               const Array<int>& referenceChannels,
+                               const Array<bool>& enabledChannelArray);
+
+    /** Applies the operations to the first getNumChannels() channels of the buffer.*/
+    void process(AudioSampleBuffer& buffer, int nSamples);
+
+    /** dest = source - reference, or a plain copy if reference is null; dest may be
+        the same as source or reference.*/
+    static void remapChannel(float* dest, const float* source, const float* reference, int numSamples);
+
+    /** Returns the name of the instruction set remapChannel() was compiled for.*/
+    static const char* getInstructionSet();
+
+    /** Returns the number of channels the operations were built for.*/
+    int getNumChannels()
+    {
+        return numChannels;
+    }
+
+    /** Returns the largest number of channels setSize() has allocated for.*/
+    int getMaxChannels()
+    {
+        return workspaceSize;
+    }
+
+    /** Returns the number of channel operations process() runs.*/
+    int getNumOperations()
+    {
+        return remapOperations.size();
+    }
+
+private:
+
+    struct RemapOperation
+    {
+        int dest;
+        int source;
+        int reference;
+    };
+
+    /** Channel indices refer to the buffer below numChannels, and to channelBuffer
+        (i.e. a saved input channel) from numChannels on; reference is -1 if there is none.*/
+    Array<RemapOperation> remapOperations;
+
+    int numChannels;
+    int numSavedChannels;
+
+    /** Work arrays of updateRemapOperations(), and the channel pointers used by process().*/
+    HeapBlock<int> outputSource;
+    HeapBlock<int> outputReference;
+    HeapBlock<int> pendingReaders;
+    HeapBlock<int> channelLocation;
+    HeapBlock<int> readyOutputs;
+    HeapBlock<float*> channelPointers;
+    int workspaceSize;
+
+    /** Holds the channels that are saved before being overwritten.*/
+    AudioSampleBuffer channelBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelRemapper);
+
+};
+
+
+#endif  // __CHANNELREMAPPER_H_5E2B91D4__
@@ -24,10 +24,9 @@
 #include "DataBuffer.h"
 
 DataBuffer::DataBuffer(int chans, int size)
-    : abstractFifo(size), buffer(chans, size), numChans(chans)
+    : abstractFifo(size), buffer(chans, size),
+      timestampBuffer(size), eventCodeBuffer(size), numChans(chans)
 {
-    timestampBuffer = new int64[size];
-    eventCodeBuffer = new int16[size];
 
 }
 
@@ -42,31 +41,91 @@ void DataBuffer::clear()
 void DataBuffer::resize(int chans, int size)
 {
     buffer.setSize(chans, size);
-    timestampBuffer = new int64[size];
-    eventCodeBuffer = new int16[size];
+    timestampBuffer.malloc(size);
+    eventCodeBuffer.malloc(size);
+
+    abstractFifo.setTotalSize(size);
 
     numChans = chans;
 }
 
-void DataBuffer::addToBuffer(float* data, int64* timestamps, int16* eventCodes, int numItems)
+void DataBuffer::copyTimestampsAndEvents(const int64* timestamps, const int16* eventCodes,
+                                         int startIndex1, int blockSize1,
+                                         int startIndex2, int blockSize2)
 {
-    // writes one sample for all channels
+    memcpy(timestampBuffer + startIndex1, timestamps, blockSize1*sizeof(int64));
+    memcpy(eventCodeBuffer + startIndex1, eventCodes, blockSize1*sizeof(int16));
+
+    if (blockSize2 > 0)
+    {
+        memcpy(timestampBuffer + startIndex2, timestamps + blockSize1, blockSize2*sizeof(int64));
+        memcpy(eventCodeBuffer + startIndex2, eventCodes + blockSize1, blockSize2*sizeof(int16));
+    }
+}
+
+int DataBuffer::addToBuffer(float* data, int64* timestamps, int16* eventCodes, int numItems)
+{
+    // writes numItems interleaved sample frames
     int startIndex1, blockSize1, startIndex2, blockSize2;
     abstractFifo.prepareToWrite(numItems, startIndex1, blockSize1, startIndex2, blockSize2);
 
+    // one channel at a time, so each channel of the ring buffer is written contiguously
     for (int chan = 0; chan < numChans; chan++)
     {
+        const float* source = data + chan;
+
+        float* dest = buffer.getSampleData(chan, startIndex1);
+
+        for (int n = 0; n < blockSize1; n++)
+        {
+            dest[n] = source[n*numChans];
+        }
+
+        if (blockSize2 > 0)
+        {
+            source += blockSize1*numChans;
+            dest = buffer.getSampleData(chan, startIndex2);
+
+            for (int n = 0; n < blockSize2; n++)
+            {
+                dest[n] = source[n*numChans];
+            }
+        }
+    }
 
+    copyTimestampsAndEvents(timestamps, eventCodes, startIndex1, blockSize1, startIndex2, blockSize2);
+
+    abstractFifo.finishedWrite(blockSize1 + blockSize2);
+
+    return blockSize1 + blockSize2;
+}
+
+int DataBuffer::addPlanarBlock(const float* const* data, const int64* timestamps, const int16* eventCodes, int numItems)
+{
+    int startIndex1, blockSize1, startIndex2, blockSize2;
+    abstractFifo.prepareToWrite(numItems, startIndex1, blockSize1, startIndex2, blockSize2);
+
+    for (int chan = 0; chan < numChans; chan++)
+    {
         buffer.copyFrom(chan, // int destChannel
                         startIndex1, // int destStartSample
-                        data + chan,  // const float* source
-                        1); // int num samples
+                        data[chan],  // const float* source
+                        blockSize1); // int num samples
+
+        if (blockSize2 > 0)
+        {
+            buffer.copyFrom(chan,
+                            startIndex2,
+                            data[chan] + blockSize1,
+                            blockSize2);
+        }
     }
 
-    *(timestampBuffer + startIndex1) = *timestamps;
-    *(eventCodeBuffer + startIndex1) = *eventCodes;
+    copyTimestampsAndEvents(timestamps, eventCodes, startIndex1, blockSize1, startIndex2, blockSize2);
+
+    abstractFifo.finishedWrite(blockSize1 + blockSize2);
 
-    abstractFifo.finishedWrite(numItems);
+    return blockSize1 + blockSize2;
 }
 
 int DataBuffer::getNumSamples()
@@ -97,13 +156,9 @@ int DataBuffer::readAllFromBuffer(AudioSampleBuffer& data, uint64* timestamp, in
                           blockSize1); // numSamples
         }
 
-        memcpy(timestamp, timestampBuffer+startIndex1, 8);
+        memcpy(timestamp, timestampBuffer+startIndex1, blockSize1*8);
         memcpy(eventCodes, eventCodeBuffer+startIndex1, blockSize1*2);
     }
-    else
-    {
-        memcpy(timestamp, timestampBuffer+startIndex2, 8);
-    }
 
     if (blockSize2 > 0)
     {
@@ -117,6 +172,7 @@ int DataBuffer::readAllFromBuffer(AudioSampleBuffer& data, uint64* timestamp, in
                           startIndex2,     // sourceStartSample
                           blockSize2); // numSamples
         }
+        memcpy(timestamp + blockSize1, timestampBuffer+startIndex2, blockSize2*8);
         memcpy(eventCodes + blockSize1, eventCodeBuffer+startIndex2, blockSize2*2);
     }
 
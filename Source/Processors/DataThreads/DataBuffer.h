@@ -44,13 +44,28 @@ public:
     /** Clears the buffer.*/
     void clear();
 
-    /** Add an array of floats to the buffer.*/
-    void addToBuffer(float* data, int64* ts, int16* eventCodes, int numItems);
+    /** Add an array of floats to the buffer.
+
+        data holds numItems sample frames interleaved sample-major (all channels of
+        the first sample, then all channels of the second, and so on); ts and
+        eventCodes hold one value per sample. Returns the number of samples
+        actually written, which is less than numItems if the buffer is full.*/
+    int addToBuffer(float* data, int64* ts, int16* eventCodes, int numItems);
+
+    /** Add a block of samples stored one channel after another.
+
+        data[chan] points to numItems samples of that channel; ts and eventCodes
+        hold one value per sample. The whole block is committed in a single fifo
+        transaction. Returns the number of samples actually written.*/
+    int addPlanarBlock(const float* const* data, const int64* ts, const int16* eventCodes, int numItems);
 
     /** Returns the number of samples currently available in the buffer.*/
     int getNumSamples();
 
-    /** Copies as many samples as possible from the DataBuffer to an AudioSampleBuffer.*/
+    /** Copies as many samples as possible from the DataBuffer to an AudioSampleBuffer.
+
+        ts and eventCodes receive one value per sample, so they must have room
+        for maxSize items.*/
     int readAllFromBuffer(AudioSampleBuffer& data, uint64* ts, int16* eventCodes, int maxSize);
 
     /** Resizes the data buffer */
@@ -60,8 +75,13 @@ private:
     AbstractFifo abstractFifo;
     AudioSampleBuffer buffer;
 
-    int64* timestampBuffer;
-    int16* eventCodeBuffer;
+    HeapBlock<int64> timestampBuffer;
+    HeapBlock<int16> eventCodeBuffer;
+
+    /** Copies the timestamps and event codes of a block that was just written.*/
+    void copyTimestampsAndEvents(const int64* ts, const int16* eventCodes,
+                                 int startIndex1, int blockSize1,
+                                 int startIndex2, int blockSize2);
 
     int numChans;
 
@@ -0,0 +1,224 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+
+  Measures how long it takes to write blocks of samples into a DataBuffer.
+  It compares three ways:
+  - The old one: one addToBuffer() call per sample frame.
+  - addToBuffer() with a whole block of interleaved frames.
+  - addPlanarBlock() with a whole block of per-channel arrays.
+  It prints the nanoseconds per value (one sample of one channel) for 64 to
+  1024 channels, in blocks of 300 samples (one Rhythm data block).
+
+  This is a standalone program; it is not part of the GUI build. To build it
+  from this directory:
+
+    g++ -O3 -march=native -DLINUX=1 -DNDEBUG=1 -I../../../JuceLibraryCode -I/usr/include/freetype2 \
+        DataBufferBenchmark.cpp DataBuffer.cpp \
+        ../../../JuceLibraryCode/modules/juce_core/juce_core.cpp \
+        ../../../JuceLibraryCode/modules/juce_audio_basics/juce_audio_basics.cpp \
+        -o DataBufferBenchmark -lpthread -ldl -lrt
+
+  Only the writes are timed; the buffer is read back after each block. The
+  data, timestamps and event codes read back from the block writes are
+  checked, including blocks that wrap around the end of the buffer. The exit
+  code is non-zero if they are wrong.
+
+*/
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "DataBuffer.h"
+
+#define BLOCK_SIZE 300
+#define NUM_BLOCKS 100
+#define BUFFER_SIZE 10000
+
+/** The DataBuffer write path before block writes were added, which copied
+    a single sample frame per call.*/
+class OldDataBuffer
+{
+public:
+    OldDataBuffer(int chans, int size)
+        : abstractFifo(size), buffer(chans, size),
+          timestampBuffer(size), eventCodeBuffer(size), numChans(chans)
+    {
+
+    }
+
+    void addToBuffer(float* data, int64* timestamps, int16* eventCodes, int numItems)
+    {
+        // writes one sample for all channels
+        int startIndex1, blockSize1, startIndex2, blockSize2;
+        abstractFifo.prepareToWrite(numItems, startIndex1, blockSize1, startIndex2, blockSize2);
+
+        for (int chan = 0; chan < numChans; chan++)
+        {
+            buffer.copyFrom(chan, startIndex1, data + chan, 1);
+        }
+
+        *(timestampBuffer + startIndex1) = *timestamps;
+        *(eventCodeBuffer + startIndex1) = *eventCodes;
+
+        abstractFifo.finishedWrite(numItems);
+    }
+
+    void discardAll()
+    {
+        abstractFifo.finishedRead(abstractFifo.getNumReady());
+    }
+
+private:
+    AbstractFifo abstractFifo;
+    AudioSampleBuffer buffer;
+
+    HeapBlock<int64> timestampBuffer;
+    HeapBlock<int16> eventCodeBuffer;
+
+    int numChans;
+};
+
+/** Checks the samples, timestamps and event codes read back from a block
+    written at sample offset firstSample.*/
+static bool checkBlock(AudioSampleBuffer& data, const uint64* timestamps, const int16* eventCodes,
+                       int numRead, int firstSample)
+{
+    if (numRead != BLOCK_SIZE)
+        return false;
+
+    for (int n = 0; n < BLOCK_SIZE; n++)
+    {
+        const int sample = firstSample + n;
+
+        if (timestamps[n] != (uint64) sample || eventCodes[n] != (int16) (sample & 0xff))
+            return false;
+
+        for (int chan = 0; chan < data.getNumChannels(); chan++)
+        {
+            if (*data.getSampleData(chan, n) != float(chan * BLOCK_SIZE * NUM_BLOCKS + sample))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+int main()
+{
+
+    bool allCorrect = true;
+
+    std::cout << "DataBuffer writes, " << BLOCK_SIZE << "-sample blocks, ns per value:" << std::endl;
+
+    for (int numChannels = 64; numChannels <= 1024; numChannels *= 2)
+    {
+
+        const int numSamples = BLOCK_SIZE * NUM_BLOCKS;
+
+        // the same values, sample-major and channel-major
+        HeapBlock<float> interleaved(numSamples * numChannels);
+        HeapBlock<float> planar(numSamples * numChannels);
+        HeapBlock<int64> timestamps(numSamples);
+        HeapBlock<int16> eventCodes(numSamples);
+
+        for (int n = 0; n < numSamples; n++)
+        {
+            for (int chan = 0; chan < numChannels; chan++)
+            {
+                const float value = float(chan * numSamples + n);
+
+                interleaved[n * numChannels + chan] = value;
+                planar[chan * numSamples + n] = value;
+            }
+
+            timestamps[n] = n;
+            eventCodes[n] = (int16) (n & 0xff);
+        }
+
+        OldDataBuffer oldBuffer(numChannels, BUFFER_SIZE);
+        DataBuffer interleavedBuffer(numChannels, BUFFER_SIZE);
+        DataBuffer planarBuffer(numChannels, BUFFER_SIZE);
+
+        AudioSampleBuffer readData(numChannels, BLOCK_SIZE);
+        HeapBlock<uint64> readTimestamps(BLOCK_SIZE);
+        HeapBlock<int16> readEventCodes(BLOCK_SIZE);
+
+        Array<const float*> blockPointers;
+        blockPointers.resize(numChannels);
+
+        int64 oldTicks = 0, interleavedTicks = 0, planarTicks = 0;
+
+        for (int block = 0; block < NUM_BLOCKS; block++)
+        {
+            const int offset = block * BLOCK_SIZE;
+
+            int64 start = Time::getHighResolutionTicks();
+
+            for (int n = offset; n < offset + BLOCK_SIZE; n++)
+                oldBuffer.addToBuffer(interleaved + n * numChannels, timestamps + n, eventCodes + n, 1);
+
+            oldTicks += Time::getHighResolutionTicks() - start;
+
+            oldBuffer.discardAll();
+
+            start = Time::getHighResolutionTicks();
+
+            interleavedBuffer.addToBuffer(interleaved + offset * numChannels,
+                                          timestamps + offset, eventCodes + offset, BLOCK_SIZE);
+
+            interleavedTicks += Time::getHighResolutionTicks() - start;
+
+            int numRead = interleavedBuffer.readAllFromBuffer(readData, readTimestamps, readEventCodes, BLOCK_SIZE);
+
+            allCorrect = allCorrect && checkBlock(readData, readTimestamps, readEventCodes, numRead, offset);
+
+            for (int chan = 0; chan < numChannels; chan++)
+                blockPointers.set(chan, planar + chan * numSamples + offset);
+
+            start = Time::getHighResolutionTicks();
+
+            planarBuffer.addPlanarBlock(blockPointers.getRawDataPointer(),
+                                        timestamps + offset, eventCodes + offset, BLOCK_SIZE);
+
+            planarTicks += Time::getHighResolutionTicks() - start;
+
+            numRead = planarBuffer.readAllFromBuffer(readData, readTimestamps, readEventCodes, BLOCK_SIZE);
+
+            allCorrect = allCorrect && checkBlock(readData, readTimestamps, readEventCodes, numRead, offset);
+        }
+
+        const double nsPerTick = 1.0e9 / Time::getHighResolutionTicksPerSecond();
+        const double numValues = double(numSamples) * numChannels;
+
+        std::cout << "   " << String(numChannels).paddedLeft(' ', 4) << " channels: per frame "
+                  << oldTicks * nsPerTick / numValues << ", interleaved block "
+                  << interleavedTicks * nsPerTick / numValues << ", planar block "
+                  << planarTicks * nsPerTick / numValues << std::endl;
+
+    }
+
+    std::cout << (allCorrect ? "Data read back correctly." : "Data read back INCORRECTLY.") << std::endl;
+
+    return allCorrect ? 0 : 1;
+
+}
@@ -96,6 +96,14 @@ public:
     /** Changes the names of channels, if the thread needs custom names. */
     virtual void updateChannelNames() { }
 
+    /** Returns true if the timestamps are sample numbers that increase by one for
+    every sample, so that the SourceNode can detect dropped samples. Sources that
+    use a clock for their timestamps should return false.*/
+    virtual bool hasContinuousTimestamps()
+    {
+        return true;
+    }
+
     SourceNode* sn;
 
     int16 eventCode;
@@ -25,11 +25,15 @@
 #include "FileReaderThread.h"
 
 FileReaderThread::FileReaderThread(SourceNode* sn) :
-    DataThread(sn), lengthOfInputFile(0), input(0), bufferSize(0)
+    DataThread(sn), thisBlock(16, 100), bufferSize(0),
+    startTicks(0), samplesSent(0)
 {
 
-    bufferSize = 1600;
-    dataBuffer = new DataBuffer(16, bufferSize*3);
+    // samples per channel in each block
+    bufferSize = 100;
+    dataBuffer = new DataBuffer(16, bufferSize*48);
+
+    reader.setRawFormat(16, 28000.0f, 0.0305f);
 
     eventCode = 0;
 
@@ -39,8 +43,7 @@ FileReaderThread::FileReaderThread(SourceNode* sn) :
 
 FileReaderThread::~FileReaderThread()
 {
-    if (input)
-        fclose(input);
+
 }
 
 void FileReaderThread::setFile(String fullpath)
@@ -48,26 +51,21 @@ void FileReaderThread::setFile(String fullpath)
 
     filePath = fullpath;
 
-    const char* path = filePath.getCharPointer();
-
-    if (input)
-        fclose(input);
-
-    input = fopen(path, "r");
-
     // Avoid a segfault if file isn't found
-    if (!input)
+    if (!File(filePath).existsAsFile())
     {
         std::cout << "Can't find data file "
-                  << '"' << path << "\""
+                  << '"' << filePath << "\""
                   << std::endl;
+        reader.close();
         return;
     }
 
-    fseek(input, 0, SEEK_END);
-    lengthOfInputFile = ftell(input);
-    rewind(input);
+    if (!reader.open(File(filePath)))
+        return;
 
+    dataBuffer->resize(reader.getNumChannels(), bufferSize*48);
+    thisBlock.setSize(reader.getNumChannels(), bufferSize);
 
     sn->tryEnablingEditor();
 
@@ -80,29 +78,43 @@ String FileReaderThread::getFile()
 
 bool FileReaderThread::foundInputSource()
 {
-    return input != 0;
+    return reader.isOpen();
 }
 
 int FileReaderThread::getNumChannels()
 {
-    return 16;
+    if (reader.isOpen())
+        return reader.getNumChannels();
+    else
+        return 16;
 }
 
 float FileReaderThread::getSampleRate()
 {
-    return 28000.0f;
+    if (reader.isOpen())
+        return reader.getSampleRate();
+    else
+        return 28000.0f;
 }
 
 float FileReaderThread::getBitVolts()
 {
-    return 0.0305f;
+    if (reader.isOpen())
+        return reader.getBitVolts(0);
+    else
+        return 0.0305f;
 }
 
 bool FileReaderThread::startAcquisition()
 {
-    if (!input)
+    if (!reader.isOpen())
         return false;
 
+    reader.seek(0);
+
+    startTicks = Time::getHighResolutionTicks();
+    samplesSent = 0;
+
     startThread();
     return true;
 }
@@ -120,48 +132,38 @@ bool FileReaderThread::stopAcquisition()
 
 bool FileReaderThread::updateBuffer()
 {
-    if (!input)
+    if (!reader.isOpen())
         return false;
-    if (dataBuffer->getNumSamples() < bufferSize)
-    {
-        //       // std::cout << dataBuffer->getNumSamples() << std::endl;
 
-        if (ftell(input) >= lengthOfInputFile - bufferSize)
-        {
-            rewind(input);
-        }
+    // replay at the recorded rate: add the blocks that are due by now
+    const double elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+    const int64 samplesDue = int64(elapsed * reader.getSampleRate());
+
+    // if the buffer is full, the rest is sent once it has been read
+    const int capacity = bufferSize*48;
 
-        fread(readBuffer, 2, bufferSize, input);
+    while (samplesSent + bufferSize <= samplesDue &&
+           dataBuffer->getNumSamples() + bufferSize <= capacity)
+    {
+        int64 firstTimestamp = reader.getTimestamp();
 
-        int chan = 0;
+        reader.read(thisBlock, bufferSize);
 
         for (int n = 0; n < bufferSize; n++)
         {
-            thisSample[chan] = float(-readBuffer[n]) * 0.0305; // previously 0.035
-
-            if (chan == 15)
-            {
-
-                timestamp++; // = (0 << 0) + (0 << 8) + (0 << 16) + (0 << 24); // +
-                //(4 << 32); // + (3 << 40) + (2 << 48) + (1 << 56);
-
-                //timestamp++; // = timer.getHighResolutionTicks();
-                dataBuffer->addToBuffer(thisSample, &timestamp, &eventCode, 1);
-                chan = 0;
-            }
-            else
-            {
-                chan++;
-            }
-
-
+            blockTimestamps[n] = firstTimestamp + n;
+            blockEventCodes[n] = eventCode;
         }
 
+        // the reader fills one channel after the other, so the block is
+        // added without interleaving it first
+        dataBuffer->addPlanarBlock(thisBlock.getArrayOfChannels(), blockTimestamps,
+                                   blockEventCodes, bufferSize);
+
+        samplesSent += bufferSize;
     }
-    else
-    {
-        wait(50); // pause for 50 ms to decrease sample rate
-    }
+
+    wait(1);
 
     return true;
 }
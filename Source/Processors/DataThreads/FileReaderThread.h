@@ -26,9 +26,8 @@
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
 
-#include <stdio.h>
-#include <time.h>
 #include "DataThread.h"
+#include "../RecordingReader.h"
 
 class SourceNode;
 
@@ -36,9 +35,12 @@ class SourceNode;
 
   Fills a buffer with data from a file.
 
-  Has issues with setting the correct sampling rate.
+  The file is read through a RecordingReader, so the number of channels, the
+  sample rate and the bitVolts are those of the recording (raw files are read
+  as 16 channels at 28 kHz). Blocks are added as they become due according
+  to the high-resolution clock, so the data arrive at the recorded rate.
 
-  @see DataThread
+  @see DataThread, RecordingReader
 
 */
 
@@ -60,14 +62,18 @@ public:
     String getFile();
 
 private:
-    int lengthOfInputFile;
-    FILE* input;
+    RecordingReader reader;
 
-    float thisSample[16];
-    int16 readBuffer[1600];
+    AudioSampleBuffer thisBlock;
+    int64 blockTimestamps[100];
+    int16 blockEventCodes[100];
 
     int bufferSize;
 
+    /** When the acquisition started, and how many samples were added since.*/
+    int64 startTicks;
+    int64 samplesSent;
+
     String filePath;
 
     bool updateBuffer();
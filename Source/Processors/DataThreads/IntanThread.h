@@ -52,6 +52,11 @@ public:
     float getBitVolts();
     int getNumEventChannels();
 
+    bool hasContinuousTimestamps()
+    {
+        return false;   // timestamps come from the high-resolution timer
+    }
+
 private:
 
     struct ftdi_context ftdic;
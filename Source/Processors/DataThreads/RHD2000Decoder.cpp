@@ -0,0 +1,170 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RHD2000Decoder.h"
+
+// words before the auxiliary results: 4 header words and 2 timestamp words
+#define FRAME_HEADER_WORDS 6
+
+static inline int readWord(const uint8* frame, int wordIndex)
+{
+    return ByteOrder::littleEndianShort(frame + 2*wordIndex);
+}
+
+RHD2000Decoder::RHD2000Decoder()
+    : numChannels(0), numAmplifierChannels(0), numAuxChannels(0),
+      frameBytes(0), ttlInIndex(0)
+{
+
+}
+
+RHD2000Decoder::~RHD2000Decoder()
+{
+
+}
+
+void RHD2000Decoder::setLayout(const Array<int>& numChannelsPerStream, bool includeAdcs)
+{
+
+    const int numStreams = numChannelsPerStream.size();
+
+    wordIndex.clear();
+    scale.clear();
+    offset.clear();
+
+    // amplifier channels: (value - 32768) * 0.195 uV
+    for (int stream = 0; stream < numStreams; stream++)
+    {
+        for (int chan = 0; chan < numChannelsPerStream[stream]; chan++)
+        {
+            wordIndex.add(FRAME_HEADER_WORDS + (3 + chan)*numStreams + stream);
+            scale.add(0.195f);
+            offset.add(-32768.0f * 0.195f);
+        }
+    }
+
+    numAmplifierChannels = wordIndex.size();
+
+    // auxiliary inputs: the three results are all read from aux command slot 1,
+    // in consecutive samples; the constant offset keeps the values visible in the LFP Viewer
+    for (int stream = 0; stream < numStreams; stream++)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            wordIndex.add(FRAME_HEADER_WORDS + numStreams + stream);
+            scale.add(0.0374f);
+            offset.add(-45000.0f * 0.0374f);
+        }
+    }
+
+    numAuxChannels = wordIndex.size() - numAmplifierChannels;
+
+    // board ADCs come after the amplifier results and one filler word per stream
+    const int adcIndex = FRAME_HEADER_WORDS + 36*numStreams;
+
+    if (includeAdcs)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            wordIndex.add(adcIndex + i);
+            scale.add(0.050354f);
+            offset.add(0.0f);
+        }
+    }
+
+    numChannels = wordIndex.size();
+
+    ttlInIndex = adcIndex + 8;
+    frameBytes = 2 * (ttlInIndex + 2);
+
+    auxValues.clear();
+    auxValues.insertMultiple(0, 0.0f, numAuxChannels);
+
+}
+
+void RHD2000Decoder::decodeChannel(const uint8* usbBuffer, int numSamples, int chan, float* dest)
+{
+
+    const uint8* source = usbBuffer + 2*wordIndex.getUnchecked(chan);
+    const float channelScale = scale.getUnchecked(chan);
+    const float channelOffset = offset.getUnchecked(chan);
+
+    for (int samp = 0; samp < numSamples; samp++)
+    {
+        dest[samp] = float(ByteOrder::littleEndianShort(source + samp*frameBytes)) * channelScale + channelOffset;
+    }
+
+}
+
+void RHD2000Decoder::decode(const uint8* usbBuffer, int numSamples,
+                            float* const* dest, int64* timestamps, int16* eventCodes)
+{
+
+    for (int samp = 0; samp < numSamples; samp++)
+    {
+        const uint8* frame = usbBuffer + samp*frameBytes;
+
+        timestamps[samp] = (int64) ByteOrder::littleEndianInt(frame + 8);
+        eventCodes[samp] = (int16) readWord(frame, ttlInIndex);
+    }
+
+    // one channel at a time, so that each output array is written contiguously;
+    // this is about three times faster than walking the frames in order
+    for (int chan = 0; chan < numAmplifierChannels; chan++)
+    {
+        decodeChannel(usbBuffer, numSamples, chan, dest[chan]);
+    }
+
+    const int auxEnd = numAmplifierChannels + numAuxChannels;
+
+    for (int chan = auxEnd; chan < numChannels; chan++)
+    {
+        decodeChannel(usbBuffer, numSamples, chan, dest[chan]);
+    }
+
+    // every 4th sample has new auxiliary input data, spread over that frame and the next two
+    for (int chan = numAmplifierChannels; chan < auxEnd; chan += 3)
+    {
+        float* aux = auxValues.getRawDataPointer() + chan - numAmplifierChannels;
+        const uint8* source = usbBuffer + 2*wordIndex.getUnchecked(chan);
+        const float auxScale = scale.getUnchecked(chan);
+        const float auxOffset = offset.getUnchecked(chan);
+
+        for (int samp = 0; samp < numSamples; samp++)
+        {
+            if (samp % 4 == 1 && samp + 2 < numSamples)
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    aux[i] = float(ByteOrder::littleEndianShort(source + (samp + i)*frameBytes))
+                             * auxScale + auxOffset;
+                }
+            }
+
+            dest[chan][samp] = aux[0];
+            dest[chan + 1][samp] = aux[1];
+            dest[chan + 2][samp] = aux[2];
+        }
+    }
+
+}
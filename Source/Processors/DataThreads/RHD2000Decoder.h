@@ -0,0 +1,102 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __RHD2000DECODER_H_5B0E7A3C__
+#define __RHD2000DECODER_H_5B0E7A3C__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Decodes the raw bytes read from the Rhythm FPGA's USB pipe.
+
+  Each sample frame holds a header, a timestamp, the auxiliary and amplifier
+  results (channel-major, interleaved across data streams), the board ADCs and
+  the TTL inputs, all as little-endian 16-bit words. The decoder reads these
+  words straight from the USB buffer and writes one contiguous float array per
+  output channel, in the order used by RHD2000Thread: the amplifier channels of
+  every enabled stream, then three auxiliary channels per stream, then the eight
+  board ADCs (if enabled).
+
+  The channel layout is worked out once, by setLayout(), as a table of word
+  offsets and scale factors, so decoding is a single pass over each channel
+  without any intermediate arrays.
+
+  @see RHD2000Thread, Rhd2000DataBlock
+
+*/
+
+class RHD2000Decoder
+{
+public:
+    RHD2000Decoder();
+    ~RHD2000Decoder();
+
+    /** Sets up the channel table. numChannelsPerStream holds the number of
+        amplifier channels for each stream in the USB data (at most 32).*/
+    void setLayout(const Array<int>& numChannelsPerStream, bool includeAdcs);
+
+    /** Returns the number of output channels for the current layout.*/
+    int getNumChannels()
+    {
+        return numChannels;
+    }
+
+    /** Returns the number of bytes in one sample frame.*/
+    int getFrameSizeInBytes()
+    {
+        return frameBytes;
+    }
+
+    /** Decodes numSamples frames from usbBuffer, which must start at the
+        beginning of a data block. dest[chan] receives numSamples values for
+        each output channel; timestamps and eventCodes receive one value per sample.*/
+    void decode(const uint8* usbBuffer, int numSamples,
+                float* const* dest, int64* timestamps, int16* eventCodes);
+
+private:
+
+    /** Decodes all samples of one amplifier or ADC channel.*/
+    void decodeChannel(const uint8* usbBuffer, int numSamples, int chan, float* dest);
+
+    /** Word offset within the frame, scale and offset of each output channel.*/
+    Array<int> wordIndex;
+    Array<float> scale;
+    Array<float> offset;
+
+    /** Aux inputs are only sampled every 4th sample, so their last values are held here.*/
+    Array<float> auxValues;
+
+    int numChannels;
+    int numAmplifierChannels;
+    int numAuxChannels;
+
+    int frameBytes;
+    int ttlInIndex;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RHD2000Decoder);
+
+};
+
+
+#endif  // __RHD2000DECODER_H_5B0E7A3C__
@@ -0,0 +1,297 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+
+  Replays Rhythm USB data through the RHD2000Decoder and through the code
+  RHD2000Thread used before it (Rhd2000DataBlock::fillFromUsbBuffer() followed
+  by a per-sample loop), and prints the time each one needs.
+
+  This is a standalone program; it is not part of the GUI build. To build it
+  from this directory:
+
+    g++ -O3 -march=native -DLINUX=1 -DNDEBUG=1 -I../../../JuceLibraryCode -I/usr/include/freetype2 \
+        RHD2000DecoderBenchmark.cpp RHD2000Decoder.cpp rhythm-api/rhd2000datablock.cpp \
+        ../../../JuceLibraryCode/modules/juce_core/juce_core.cpp \
+        -o RHD2000DecoderBenchmark -lpthread -ldl -lrt
+
+  Usage:
+
+    RHD2000DecoderBenchmark [numDataStreams [captureFile]]
+
+  A capture file holds the raw bytes returned by
+  Rhd2000EvalBoard::readRawDataBlocks(), one read after another, with
+  numDataStreams streams of 32 channels each. Only whole data blocks are
+  used. Without a capture file, one second of data is generated with valid
+  headers and timestamps and random sample values; the same data are
+  generated on every run.
+
+  Both paths decode all 32 amplifier channels of each stream, three aux
+  channels per stream and the eight board ADCs. The outputs are compared, so
+  the program also checks that the decoder gives the same values.
+
+*/
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+#include "RHD2000Decoder.h"
+#include "rhythm-api/rhd2000datablock.h"
+
+#define NUM_REPEATS 10
+
+/** Decodes one data block the way RHD2000Thread::updateBuffer() used to,
+    into sample-major frames of numChannels values.*/
+static void decodeBlockWithDataBlock(Rhd2000DataBlock& dataBlock, uint8* usbBuffer,
+                                     int numDataStreams, int numChannels,
+                                     float* frames, float* auxBuffer,
+                                     int64* timestamps, int16* eventCodes)
+{
+
+    dataBlock.fillFromUsbBuffer(usbBuffer, 0, numDataStreams);
+
+    for (int samp = 0; samp < SAMPLES_PER_DATA_BLOCK; samp++)
+    {
+        int channel = -1;
+
+        float* thisSample = frames + samp * numChannels;
+
+        // do the neural data channels first
+        for (int stream = 0; stream < numDataStreams; stream++)
+        {
+            for (int chan = 0; chan < 32; chan++)
+            {
+                channel++;
+                thisSample[channel] = float(dataBlock.amplifierData[stream][chan][samp] - 32768) * 0.195f;
+            }
+        }
+
+        // then do the Intan ADC channels
+        for (int stream = 0; stream < numDataStreams; stream++)
+        {
+            if (samp % 4 == 1)   // every 4th sample should have auxiliary input data
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    channel++;
+                    thisSample[channel] = 0.0374 *
+                                          float(dataBlock.auxiliaryData[stream][1][samp+i] - 45000.0f);
+                    auxBuffer[channel] = thisSample[channel];
+                }
+            }
+            else    // repeat last values from buffer
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    channel++;
+                    thisSample[channel] = auxBuffer[channel];
+                }
+            }
+        }
+
+        // finally, the acquisition board ADC channels
+        for (int adcChan = 0; adcChan < 8; ++adcChan)
+        {
+            channel++;
+            thisSample[channel] = 0.050354 * float(dataBlock.boardAdcData[adcChan][samp]);
+        }
+
+        timestamps[samp] = dataBlock.timeStamp[samp];
+        eventCodes[samp] = dataBlock.ttlIn[samp];
+    }
+
+}
+
+/** Fills usbBuffer with numBlocks data blocks of random samples.*/
+static void generateUsbData(uint8* usbBuffer, int numDataStreams, int numBlocks)
+{
+
+    Random random(1);
+
+    const int frameWords = Rhd2000DataBlock::calculateDataBlockSizeInWords(numDataStreams)
+                           / SAMPLES_PER_DATA_BLOCK;
+
+    for (int frame = 0; frame < numBlocks * SAMPLES_PER_DATA_BLOCK; frame++)
+    {
+        uint8* f = usbBuffer + frame * frameWords * 2;
+
+        // all words are little-endian
+        const uint64 header = RHD2000_HEADER_MAGIC_NUMBER;
+
+        for (int i = 0; i < 8; i++)
+            f[i] = uint8(header >> (8 * i));
+
+        for (int i = 0; i < 4; i++)
+            f[8 + i] = uint8(frame >> (8 * i));
+
+        for (int i = 12; i < frameWords * 2; i++)
+            f[i] = uint8(random.nextInt(256));
+    }
+
+}
+
+int main(int argc, char* argv[])
+{
+
+    const int numDataStreams = (argc > 1) ? jlimit(1, 8, atoi(argv[1])) : 8;
+
+    const int blockBytes = 2 * Rhd2000DataBlock::calculateDataBlockSizeInWords(numDataStreams);
+
+    MemoryBlock usbData;
+    int numBlocks;
+
+    if (argc > 2)
+    {
+        File captureFile = File::getCurrentWorkingDirectory().getChildFile(argv[2]);
+
+        if (!captureFile.loadFileAsData(usbData))
+        {
+            std::cout << "Could not read " << captureFile.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        numBlocks = int(usbData.getSize() / blockBytes);
+
+        std::cout << "Replaying " << numBlocks << " data blocks from "
+                  << captureFile.getFullPathName() << std::endl;
+    }
+    else
+    {
+        numBlocks = 100; // one second at 30 kHz
+        usbData.setSize(numBlocks * blockBytes);
+        generateUsbData(static_cast<uint8*>(usbData.getData()), numDataStreams, numBlocks);
+
+        std::cout << "Replaying " << numBlocks << " generated data blocks" << std::endl;
+    }
+
+    if (numBlocks == 0)
+    {
+        std::cout << "Not enough data for one block." << std::endl;
+        return 1;
+    }
+
+    uint8* usbBuffer = static_cast<uint8*>(usbData.getData());
+
+    const int numSamples = numBlocks * SAMPLES_PER_DATA_BLOCK;
+
+    // old path
+    Rhd2000DataBlock dataBlock(numDataStreams);
+
+    const int numChannels = numDataStreams * 32 + numDataStreams * 3 + 8;
+
+    HeapBlock<float> frames(numSamples * numChannels);
+    HeapBlock<float> auxBuffer(numChannels, true);
+    HeapBlock<int64> oldTimestamps(numSamples);
+    HeapBlock<int16> oldEventCodes(numSamples);
+
+    // new path
+    RHD2000Decoder decoder;
+
+    Array<int> channelsPerStream;
+
+    for (int stream = 0; stream < numDataStreams; stream++)
+        channelsPerStream.add(32);
+
+    decoder.setLayout(channelsPerStream, true);
+
+    jassert(decoder.getNumChannels() == numChannels);
+
+    HeapBlock<float> planar(numSamples * numChannels);
+    HeapBlock<int64> newTimestamps(numSamples);
+    HeapBlock<int16> newEventCodes(numSamples);
+
+    Array<float*> blockPointers;
+    blockPointers.resize(numChannels);
+
+    double oldTime = 0.0, newTime = 0.0;
+
+    for (int repeat = 0; repeat < NUM_REPEATS; repeat++)
+    {
+
+        int64 start = Time::getHighResolutionTicks();
+
+        for (int block = 0; block < numBlocks; block++)
+        {
+            const int offset = block * SAMPLES_PER_DATA_BLOCK;
+
+            decodeBlockWithDataBlock(dataBlock, usbBuffer + block * blockBytes,
+                                     numDataStreams, numChannels,
+                                     frames + offset * numChannels, auxBuffer,
+                                     oldTimestamps + offset, oldEventCodes + offset);
+        }
+
+        int64 middle = Time::getHighResolutionTicks();
+
+        for (int block = 0; block < numBlocks; block++)
+        {
+            const int offset = block * SAMPLES_PER_DATA_BLOCK;
+
+            for (int chan = 0; chan < numChannels; chan++)
+                blockPointers.set(chan, planar + chan * numSamples + offset);
+
+            decoder.decode(usbBuffer + block * blockBytes, SAMPLES_PER_DATA_BLOCK,
+                           blockPointers.getRawDataPointer(),
+                           newTimestamps + offset, newEventCodes + offset);
+        }
+
+        int64 end = Time::getHighResolutionTicks();
+
+        // keep the fastest run of each
+        const double oldMs = Time::highResolutionTicksToSeconds(middle - start) * 1000.0;
+        const double newMs = Time::highResolutionTicksToSeconds(end - middle) * 1000.0;
+
+        oldTime = (repeat == 0) ? oldMs : jmin(oldTime, oldMs);
+        newTime = (repeat == 0) ? newMs : jmin(newTime, newMs);
+
+    }
+
+    // compare the outputs
+    double maxDifference = 0.0;
+    int numMismatches = 0;
+
+    for (int samp = 0; samp < numSamples; samp++)
+    {
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            const double difference = std::abs(frames[samp * numChannels + chan]
+                                               - planar[chan * numSamples + samp]);
+            maxDifference = jmax(maxDifference, difference);
+        }
+
+        if (oldTimestamps[samp] != newTimestamps[samp] || oldEventCodes[samp] != newEventCodes[samp])
+            numMismatches++;
+    }
+
+    const double dataMs = numSamples / 30.0; // at 30 kHz
+    const double nsPerValue = 1.0e6 / (double(numSamples) * numChannels);
+
+    std::cout << numDataStreams << " streams, " << numChannels << " channels, "
+              << dataMs << " ms of data at 30 kHz:" << std::endl;
+    std::cout << "   Rhd2000DataBlock + per-sample loop: " << oldTime << " ms ("
+              << oldTime * nsPerValue << " ns per value)" << std::endl;
+    std::cout << "   RHD2000Decoder:                     " << newTime << " ms ("
+              << newTime * nsPerValue << " ns per value)" << std::endl;
+    std::cout << "   Largest difference " << maxDifference << ", "
+              << numMismatches << " samples with different timestamps or TTL inputs" << std::endl;
+
+    return (maxDifference < 1.0e-3 && numMismatches == 0) ? 0 : 1;
+
+}
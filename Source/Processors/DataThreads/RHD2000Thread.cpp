@@ -35,10 +35,30 @@
 #define okLIB_EXTENSION "*.so"
 #endif
 
+class RHD2000Thread::DecodeThread : public Thread
+{
+public:
+    DecodeThread(RHD2000Thread* t) : Thread("RHD2000 Decode Thread"), owner(t) {}
+
+    void run()
+    {
+        while (!threadShouldExit())
+        {
+            owner->decodeNextBuffer();
+        }
+    }
+
+private:
+    RHD2000Thread* owner;
+
+};
+
 RHD2000Thread::RHD2000Thread(SourceNode* sn) : DataThread(sn),
     chipRegisters(30000.0f),
     numChannels(0),
     deviceFound(false),
+    numUsbBlocksToRead(16), numBlocksPerRead(1), usbBufferSize(0),
+    writeSlot(0), readSlot(0),
     isTransmitting(false),
     dacOutputShouldChange(false),
     acquireAdcChannels(false),
@@ -56,6 +76,7 @@ RHD2000Thread::RHD2000Thread(SourceNode* sn) : DataThread(sn),
     evalBoard = new Rhd2000EvalBoard;
     dataBlock = new Rhd2000DataBlock(1);
     dataBuffer = new DataBuffer(2, 10000); // start with 2 channels and automatically resize
+    decodeThread = new DecodeThread(this);
 
     // Open Opal Kelly XEM6010 board.
 	// Returns 1 if successful, -1 if FrontPanel cannot be loaded, and -2 if XEM6010 can't be found.
@@ -95,6 +116,8 @@ RHD2000Thread::~RHD2000Thread()
 
     std::cout << "RHD2000 interface destroyed." << std::endl;
 
+    decodeThread->stopThread(500);
+
     if (deviceFound)
     {
         int ledArray[8] = {0, 0, 0, 0, 0, 0, 0, 0};
@@ -736,8 +759,6 @@ void RHD2000Thread::setSampleRate(int sampleRateIndex, bool isTemporary)
         savedSampleRateIndex = sampleRateIndex;
     }
 
-    int numUsbBlocksToRead = 0; // placeholder - make this change the number of blocks that are read in RHD2000Thread::updateBuffer()
-
     Rhd2000EvalBoard::AmplifierSampleRate sampleRate; // just for local use
 
     switch (sampleRateIndex)
@@ -972,6 +993,14 @@ bool RHD2000Thread::startAcquisition()
 
     blockSize = dataBlock->calculateDataBlockSizeInWords(evalBoard->getNumEnabledDataStreams());
 
+    allocateBlockBuffers();
+
+    numFilledBuffers = 0;
+    writeSlot = 0;
+    readSlot = 0;
+    bufferFilled.reset();
+
+    decodeThread->startThread();
     startThread();
 
 
@@ -1001,6 +1030,11 @@ bool RHD2000Thread::stopAcquisition()
         std::cout << "Thread failed to exit, continuing anyway..." << std::endl;
     }
 
+    // any reads that are still waiting are discarded
+    decodeThread->signalThreadShouldExit();
+    bufferFilled.signal();
+    decodeThread->stopThread(500);
+
     evalBoard->setContinuousRunMode(false);
     evalBoard->setMaxTimeStep(0);
     std::cout << "Flushing FIFO." << std::endl;
@@ -1019,122 +1053,94 @@ bool RHD2000Thread::stopAcquisition()
     return true;
 }
 
-bool RHD2000Thread::updateBuffer()
+void RHD2000Thread::allocateBlockBuffers()
 {
 
-    //cout << "Number of 16-bit words in FIFO: " << evalBoard->numWordsInFifo() << endl;
-    //cout << "Block size: " << blockSize << endl;
-
-    bool return_code;
+    Array<int> channelsPerStream;
 
-    if (evalBoard->numWordsInFifo() >= blockSize)
+    for (int dataStream = 0; dataStream < MAX_NUM_DATA_STREAMS; dataStream++)
     {
-        return_code = evalBoard->readDataBlock(dataBlock);
-
-        for (int samp = 0; samp < dataBlock->getSamplesPerDataBlock(); samp++)
-        {
-            int streamNumber = -1;
-            int channel = -1;
-
-            // do the neural data channels first
-            for (int dataStream = 0; dataStream < MAX_NUM_DATA_STREAMS; dataStream++)
-            {
-                if (numChannelsPerDataStream[dataStream] > 0)
-                {
-                    streamNumber++;
-
-                    for (int chan = 0; chan < numChannelsPerDataStream[dataStream]; chan++)
-                    {
-                        
-                      //  std::cout << "reading sample stream " << streamNumber << " chan " << chan << " sample "<< samp << std::endl;
-                        
-                        channel++;
-
-                        int value = dataBlock->amplifierData[streamNumber][chan][samp];
-
-                        thisSample[channel] = float(value-32768)*0.195f;
-                    }
-
-                }
+        if (numChannelsPerDataStream[dataStream] > 0)
+            channelsPerStream.add(numChannelsPerDataStream[dataStream]);
+    }
 
-            }
+    decoder.setLayout(channelsPerStream, acquireAdcChannels);
 
-            streamNumber = -1;
+    // read several data blocks at once to cut the per-transfer overhead, as long as
+    // the read fits in the USB buffer (which depends on the number of data streams)
+    // and doesn't hold back more than MAX_READ_LATENCY_MS of data
+    const int maxBlocksForLatency = int(boardSampleRate * MAX_READ_LATENCY_MS / 1000.0f) / SAMPLES_PER_DATA_BLOCK;
+    const int maxBlocksForBuffer = USB_BUFFER_SIZE / (2 * blockSize);
 
-            // then do the Intan ADC channels
-            for (int dataStream = 0; dataStream < MAX_NUM_DATA_STREAMS; dataStream++)
-            {
-                if (numChannelsPerDataStream[dataStream] > 0)
-                {
-                    streamNumber++;
+    numBlocksPerRead = jmax(1, jmin(numUsbBlocksToRead, maxBlocksForLatency, maxBlocksForBuffer));
 
-                    if (samp % 4 == 1)   // every 4th sample should have auxiliary input data
-                    {
+    std::cout << "Reading " << numBlocksPerRead << " data blocks per USB transfer." << std::endl;
 
-                       // std::cout << "reading sample stream " << streamNumber << " aux ADCs " << std::endl;
+    const int numSamples = numBlocksPerRead * SAMPLES_PER_DATA_BLOCK;
 
-                        channel++;
-                        thisSample[channel] = 0.0374 *
-                                              float(dataBlock->auxiliaryData[streamNumber][1][samp+0] - 45000.0f) ;
-                                              // constant offset keeps the values visible in the LFP Viewer
+    // the DataBuffer always has at least one channel
+    const int numChans = jmax(decoder.getNumChannels(), 1);
 
-                        auxBuffer[channel] = thisSample[channel];
+    usbBufferSize = 2 * blockSize * numBlocksPerRead;
+    usbBuffer.malloc(NUM_USB_BUFFERS * usbBufferSize);
 
-                        channel++;
-                        thisSample[channel] = 0.0374 *
-                                              float(dataBlock->auxiliaryData[streamNumber][1][samp+1] - 45000.0f) ;
-                                              // constant offset keeps the values visible in the LFP Viewer
+    blockBuffer.calloc(numChans * numSamples);
+    blockTimestamps.malloc(numSamples);
+    blockEventCodes.malloc(numSamples);
 
-                        auxBuffer[channel] = thisSample[channel];
+    channelPointers.clear();
 
+    for (int chan = 0; chan < numChans; chan++)
+    {
+        channelPointers.add(blockBuffer + chan * numSamples);
+    }
 
-                        channel++;
-                        thisSample[channel] = 0.0374 *
-                                              float(dataBlock->auxiliaryData[streamNumber][1][samp+2] - 45000.0f) ;
-                                              // constant offset keeps the values visible in the LFP Viewer
+}
 
-                        auxBuffer[channel] = thisSample[channel];
+void RHD2000Thread::decodeNextBuffer()
+{
 
-                    }
-                    else    // repeat last values from buffer
-                    {
+    if (numFilledBuffers.get() == 0)
+    {
+        bufferFilled.wait(100);
+        return;
+    }
 
-                        //std::cout << "reading sample stream " << streamNumber << " aux ADCs " << std::endl;
+    const int numSamples = numBlocksPerRead * SAMPLES_PER_DATA_BLOCK;
 
-                        channel++;
-                        thisSample[channel] = auxBuffer[channel];
-                        channel++;
-                        thisSample[channel] = auxBuffer[channel];
-                        channel++;
-                        thisSample[channel] = auxBuffer[channel];
-                    }
-                }
+    // go straight from the USB bytes to one array per channel
+    decoder.decode(usbBuffer + readSlot * usbBufferSize, numSamples,
+                   channelPointers.getRawDataPointer(),
+                   blockTimestamps, blockEventCodes);
 
-            }
+    readSlot = (readSlot + 1) % NUM_USB_BUFFERS;
+    --numFilledBuffers;
+    bufferFreed.signal();
 
-            // finally, loop through acquisition board ADC channels if necessary
-            if (acquireAdcChannels)
-            {
-                for (int adcChan = 0; adcChan < 8; ++adcChan)
-                {
+    dataBuffer->addPlanarBlock(channelPointers.getRawDataPointer(),
+                               blockTimestamps, blockEventCodes,
+                               numSamples);
 
-                    channel++;
-                    // ADC waveform units = volts
-                    thisSample[channel] =
-                        //0.000050354 * float(dataBlock->boardAdcData[adcChan][samp]);
-                        0.050354 * float(dataBlock->boardAdcData[adcChan][samp]);
-                }
-            }
-            // std::cout << channel << std::endl;
+}
 
-            timestamp = dataBlock->timeStamp[samp];
-            timestamp = timestamp;
-            eventCode = dataBlock->ttlIn[samp];
+bool RHD2000Thread::updateBuffer()
+{
 
-            dataBuffer->addToBuffer(thisSample, &timestamp, &eventCode, 1);
+    //cout << "Number of 16-bit words in FIFO: " << evalBoard->numWordsInFifo() << endl;
+    //cout << "Block size: " << blockSize << endl;
 
-        }
+    if (numFilledBuffers.get() == NUM_USB_BUFFERS)
+    {
+        // the decode thread hasn't caught up yet
+        bufferFreed.wait(100);
+    }
+    else if (evalBoard->numWordsInFifo() >= (unsigned int) (blockSize * numBlocksPerRead))
+    {
+        evalBoard->readRawDataBlocks(numBlocksPerRead, usbBuffer + writeSlot * usbBufferSize);
 
+        writeSlot = (writeSlot + 1) % NUM_USB_BUFFERS;
+        ++numFilledBuffers;
+        bufferFilled.signal();
     }
 
 
@@ -37,9 +37,16 @@
 #include "rhythm-api/okFrontPanelDLL.h"
 
 #include "DataThread.h"
+#include "RHD2000Decoder.h"
 
 #define MAX_NUM_DATA_STREAMS 8
 
+// number of USB reads that can be waiting to be decoded
+#define NUM_USB_BUFFERS 2
+
+// upper limit on the amount of data in one USB read
+#define MAX_READ_LATENCY_MS 50
+
 class SourceNode;
 
 /**
@@ -98,8 +105,38 @@ private:
     int numChannels;
     bool deviceFound;
 
-    float thisSample[256];
-    float auxBuffer[256]; // aux inputs are only sampled every 4th sample, so use this to buffer the samples so they can be handles just like the regular neural channels later
+    /** Number of data blocks per USB read suggested for the current sample rate.*/
+    int numUsbBlocksToRead;
+
+    /** Number of data blocks actually read at once, which is also limited by
+        the number of data streams.*/
+    int numBlocksPerRead;
+
+    // raw bytes of NUM_USB_BUFFERS reads, and the decoded samples of each channel
+    RHD2000Decoder decoder;
+    HeapBlock<uint8> usbBuffer;
+    int usbBufferSize;
+    HeapBlock<float> blockBuffer;
+    Array<float*> channelPointers;
+    HeapBlock<int64> blockTimestamps;
+    HeapBlock<int16> blockEventCodes;
+
+    /** Sets up the decoder and its buffers for the enabled data streams.*/
+    void allocateBlockBuffers();
+
+    // the data thread fills the USB buffers in turn and the decode thread empties
+    // them, so decoding one read overlaps the USB transfer of the next
+    class DecodeThread;
+    ScopedPointer<DecodeThread> decodeThread;
+
+    WaitableEvent bufferFilled;
+    WaitableEvent bufferFreed;
+    Atomic<int> numFilledBuffers;
+    int writeSlot;
+    int readSlot;
+
+    /** Decodes the oldest USB read, or waits for one. Called by the decode thread.*/
+    void decodeNextBuffer();
 
     int blockSize;
 
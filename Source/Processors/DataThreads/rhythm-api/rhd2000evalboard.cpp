@@ -1266,6 +1266,27 @@ bool Rhd2000EvalBoard::readDataBlocks(int numBlocks, queue<Rhd2000DataBlock> &da
     return true;
 }
 
+// Reads a certain number of USB data blocks into buffer without unpacking them, so they
+// can be decoded directly from the raw bytes.  The caller should check that the data blocks
+// are available first.  Returns false if the read would exceed USB_BUFFER_SIZE.
+bool Rhd2000EvalBoard::readRawDataBlocks(int numBlocks, unsigned char* buffer)
+{
+    unsigned int numBytesToRead;
+
+    numBytesToRead = 2 * numBlocks * Rhd2000DataBlock::calculateDataBlockSizeInWords(numDataStreams);
+
+    if (numBytesToRead > USB_BUFFER_SIZE)
+    {
+        cerr << "Error in Rhd2000EvalBoard::readRawDataBlocks: USB buffer size exceeded.  " <<
+             "Increase value of USB_BUFFER_SIZE." << endl;
+        return false;
+    }
+
+    dev->ReadFromPipeOut(PipeOutData, numBytesToRead, buffer);
+
+    return true;
+}
+
 // Writes the contents of a data block queue (dataQueue) to a binary output stream (saveOut).
 // Returns the number of data blocks written.
 int Rhd2000EvalBoard::queueToFile(queue<Rhd2000DataBlock> &dataQueue, ofstream& saveOut)
@@ -152,6 +152,7 @@ public:
     void flush();
     bool readDataBlock(Rhd2000DataBlock* dataBlock);
     bool readDataBlocks(int numBlocks, queue<Rhd2000DataBlock> &dataQueue);
+    bool readRawDataBlocks(int numBlocks, unsigned char* buffer);
     int queueToFile(queue<Rhd2000DataBlock> &dataQueue, std::ofstream& saveOut);
 
 	void resetFpga();
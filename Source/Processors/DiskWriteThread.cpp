@@ -0,0 +1,324 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "DiskWriteThread.h"
+#include "RecordNode.h"
+
+#define MAX_QUEUED_BLOCKS 1024
+#define MAX_QUEUED_EVENTS 4096
+
+DiskWriteThread::DiskWriteThread(RecordNode* parent)
+    : Thread("Disk Write Thread"), recordNode(parent),
+      dataFifo(1), dataBuffer(1, 1),
+      blockFifo(MAX_QUEUED_BLOCKS), blockInfo(MAX_QUEUED_BLOCKS),
+      eventFifo(MAX_QUEUED_EVENTS), eventInfo(MAX_QUEUED_EVENTS),
+      warnedAboutQueueDepth(false), blockWasDropped(false)
+{
+
+}
+
+DiskWriteThread::~DiskWriteThread()
+{
+    stopThread(-1);
+}
+
+void DiskWriteThread::resize(int numChannels, int bufferSize)
+{
+    const ScopedLock sl(*recordNode->getLock());
+
+    dataBuffer.setSize(jmax(numChannels, 1), bufferSize + 1);
+    dataBuffer.clear();
+    dataFifo.setTotalSize(bufferSize + 1);
+
+    blockFifo.reset();
+    eventFifo.reset();
+
+    blockWasDropped = false;
+
+    resetCounters();
+}
+
+bool DiskWriteThread::addContinuousBlock(AudioSampleBuffer& buffer, int nSamples, int64 timestamp)
+{
+
+    if (nSamples <= 0)
+        return true;
+
+    if (dataFifo.getFreeSpace() < nSamples || blockFifo.getFreeSpace() < 1)
+    {
+        ++numDroppedBlocks;
+        blockWasDropped = true;
+        return false;
+    }
+
+    int startIndex1, blockSize1, startIndex2, blockSize2;
+    dataFifo.prepareToWrite(nSamples, startIndex1, blockSize1, startIndex2, blockSize2);
+
+    int numChans = jmin(buffer.getNumChannels(), dataBuffer.getNumChannels());
+
+    for (int chan = 0; chan < numChans; chan++)
+    {
+        dataBuffer.copyFrom(chan,          // destChannel
+                            startIndex1,   // destStartSample
+                            buffer,        // source
+                            chan,          // sourceChannel
+                            0,             // sourceStartSample
+                            blockSize1);   // numSamples
+
+        if (blockSize2 > 0)
+        {
+            dataBuffer.copyFrom(chan,
+                                startIndex2,
+                                buffer,
+                                chan,
+                                blockSize1,
+                                blockSize2);
+        }
+    }
+
+    dataFifo.finishedWrite(nSamples);
+
+    // the block info is only made visible once the data is in place
+    blockFifo.prepareToWrite(1, startIndex1, blockSize1, startIndex2, blockSize2);
+
+    BlockInfo& info = blockInfo[startIndex1];
+    info.timestamp = timestamp;
+    info.numSamples = nSamples;
+    info.followsDroppedBlock = blockWasDropped;
+
+    blockWasDropped = false;
+
+    blockFifo.finishedWrite(1);
+
+    int depth = dataFifo.getNumReady();
+
+    if (depth > highWaterMark.get())
+        highWaterMark.set(depth);
+
+    notify();
+
+    return true;
+
+}
+
+bool DiskWriteThread::addEvent(const uint8* eventData, int samplePosition, int64 timestamp)
+{
+
+    if (eventFifo.getFreeSpace() < 1)
+    {
+        ++numDroppedEvents;
+        return false;
+    }
+
+    int startIndex1, blockSize1, startIndex2, blockSize2;
+    eventFifo.prepareToWrite(1, startIndex1, blockSize1, startIndex2, blockSize2);
+
+    EventInfo& info = eventInfo[startIndex1];
+    info.timestamp = timestamp;
+    info.samplePosition = samplePosition;
+    memcpy(info.data, eventData, 4);
+
+    eventFifo.finishedWrite(1);
+
+    return true;
+}
+
+void DiskWriteThread::signalFilesShouldClose()
+{
+    closeRequested.set(1);
+    notify();
+}
+
+void DiskWriteThread::waitForFilesToClose()
+{
+    while (closeRequested.get() != 0 && isThreadRunning())
+    {
+        Thread::sleep(1);
+    }
+}
+
+int DiskWriteThread::getQueueDepth()
+{
+    return dataFifo.getNumReady();
+}
+
+int DiskWriteThread::getQueueCapacity()
+{
+    return dataFifo.getTotalSize() - 1;
+}
+
+int DiskWriteThread::getHighWaterMark()
+{
+    return highWaterMark.get();
+}
+
+int DiskWriteThread::getNumDroppedBlocks()
+{
+    return numDroppedBlocks.get();
+}
+
+int DiskWriteThread::getNumDroppedEvents()
+{
+    return numDroppedEvents.get();
+}
+
+int DiskWriteThread::getNumUnwrittenSamples()
+{
+    return numUnwrittenSamples.get();
+}
+
+void DiskWriteThread::resetCounters()
+{
+    highWaterMark.set(0);
+    numDroppedBlocks.set(0);
+    numDroppedEvents.set(0);
+    numUnwrittenSamples.set(0);
+    warnedAboutQueueDepth = false;
+}
+
+void DiskWriteThread::run()
+{
+
+    while (!threadShouldExit())
+    {
+
+        if (!writeAvailableData())
+        {
+            if (closeRequested.get() != 0)
+            {
+                recordNode->closeAllFiles();
+                closeRequested.set(0);
+            }
+            else
+            {
+                wait(10);
+            }
+        }
+
+    }
+
+    // make sure nothing is lost when acquisition stops
+    while (writeAvailableData()) { }
+
+    if (closeRequested.get() != 0)
+    {
+        recordNode->closeAllFiles();
+        closeRequested.set(0);
+    }
+
+}
+
+void DiskWriteThread::writeAvailableEvents()
+{
+
+    int numEvents = eventFifo.getNumReady();
+
+    if (numEvents == 0)
+        return;
+
+    int startIndex1, blockSize1, startIndex2, blockSize2;
+    eventFifo.prepareToRead(numEvents, startIndex1, blockSize1, startIndex2, blockSize2);
+
+    for (int i = 0; i < numEvents; i++)
+    {
+        EventInfo& info = (i < blockSize1) ? eventInfo[startIndex1 + i]
+                          : eventInfo[startIndex2 + i - blockSize1];
+
+        recordNode->writeEventBuffer(info.data, info.samplePosition, info.timestamp);
+    }
+
+    eventFifo.finishedRead(numEvents);
+
+}
+
+bool DiskWriteThread::writeAvailableData()
+{
+
+    bool hadEvents = eventFifo.getNumReady() > 0;
+
+    writeAvailableEvents();
+
+    int numBlocks = blockFifo.getNumReady();
+
+    if (numBlocks == 0)
+        return hadEvents;
+
+    int depth = dataFifo.getNumReady();
+
+    if (!warnedAboutQueueDepth && depth > getQueueCapacity() * 3 / 4)
+    {
+        std::cout << "WARNING: disk write queue is " << depth << " of "
+                  << getQueueCapacity() << " samples deep." << std::endl;
+        warnedAboutQueueDepth = true;
+    }
+
+    int blockStart1, blockCount1, blockStart2, blockCount2;
+    blockFifo.prepareToRead(numBlocks, blockStart1, blockCount1, blockStart2, blockCount2);
+
+    for (int b = 0; b < numBlocks; b++)
+    {
+        const BlockInfo& info = (b < blockCount1) ? blockInfo[blockStart1 + b]
+                                : blockInfo[blockStart2 + b - blockCount1];
+
+        // the samples that were dropped must not end up in the middle of
+        // a record, so finish the current one and start anew at this block
+        if (info.followsDroppedBlock && recordNode->sampleCount > 0)
+            recordNode->finishCurrentRecord();
+
+        int samplesWritten = 0;
+
+        while (samplesWritten < info.numSamples)
+        {
+            // never cross a record boundary within one write
+            int numSamplesToWrite = jmin(info.numSamples - samplesWritten,
+                                         BLOCK_LENGTH - recordNode->sampleCount);
+
+            int startIndex1, blockSize1, startIndex2, blockSize2;
+            dataFifo.prepareToRead(numSamplesToWrite, startIndex1, blockSize1, startIndex2, blockSize2);
+
+            if (recordNode->sampleCount == 0)
+                recordNode->recordTimestamp = info.timestamp + samplesWritten;
+
+            int64 segmentTimestamp = info.timestamp + samplesWritten;
+
+            int samplesNotWritten = recordNode->writeContinuousSegment(dataBuffer, startIndex1, blockSize1,
+                                                                        segmentTimestamp);
+
+            if (blockSize2 > 0)
+                samplesNotWritten += recordNode->writeContinuousSegment(dataBuffer, startIndex2, blockSize2,
+                                                                         segmentTimestamp + blockSize1);
+
+            if (samplesNotWritten > 0)
+                numUnwrittenSamples += samplesNotWritten;
+
+            dataFifo.finishedRead(numSamplesToWrite);
+
+            samplesWritten += numSamplesToWrite;
+        }
+    }
+
+    blockFifo.finishedRead(numBlocks);
+
+    return true;
+
+}
@@ -0,0 +1,158 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __DISKWRITETHREAD_H_3F0A7C21__
+#define __DISKWRITETHREAD_H_3F0A7C21__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+class RecordNode;
+
+/**
+
+  Moves disk access for the RecordNode off of the audio thread.
+
+  The RecordNode copies each incoming block into a lock-free circular
+  buffer (one ring per channel, sharing a single AbstractFifo so that
+  all channels stay aligned) and returns immediately. The DiskWriteThread
+  drains the buffer, splits the data into records of BLOCK_LENGTH samples,
+  converts them to int16 and writes them to the channel files.
+
+  TTL events are queued in the same way and written by this thread.
+
+  If the buffer fills up (e.g., because the disk stalls), incoming blocks
+  are dropped rather than blocking the audio thread. The next block that
+  is queued is marked, so that the current record is padded and closed and
+  a new one starts at that block's timestamp. The number of dropped
+  blocks, the number of samples that could not be written to disk (e.g.,
+  because it is full), the current queue depth and its high-water mark can
+  be queried at any time.
+
+  @see RecordNode
+
+*/
+
+class DiskWriteThread : public Thread
+{
+public:
+
+    DiskWriteThread(RecordNode* parent);
+    ~DiskWriteThread();
+
+    /** Writes queued data to disk until the thread is asked to exit.*/
+    void run();
+
+    /** Allocates the circular buffers. Must not be called while recording.*/
+    void resize(int numChannels, int bufferSize);
+
+    /** Queues one block of continuous data. Called from the audio thread.
+
+        Returns false if there was not enough space, in which case the
+        whole block is dropped for all channels.*/
+    bool addContinuousBlock(AudioSampleBuffer& buffer, int nSamples, int64 timestamp);
+
+    /** Queues a single TTL event, given by its first four bytes. Called from
+        the audio thread.*/
+    bool addEvent(const uint8* eventData, int samplePosition, int64 timestamp);
+
+    /** Asks the thread to write out all remaining data and then close the files.*/
+    void signalFilesShouldClose();
+
+    /** Blocks until any pending request to close the files has been handled.*/
+    void waitForFilesToClose();
+
+    /** Returns the number of samples per channel waiting to be written.*/
+    int getQueueDepth();
+
+    /** Returns the total number of samples per channel the buffer can hold.*/
+    int getQueueCapacity();
+
+    /** Returns the largest queue depth observed since the last reset.*/
+    int getHighWaterMark();
+
+    /** Returns the number of continuous blocks dropped since the last reset.*/
+    int getNumDroppedBlocks();
+
+    /** Returns the number of events dropped since the last reset.*/
+    int getNumDroppedEvents();
+
+    /** Returns the number of samples per channel that were taken from the
+        queue but could not be written to disk since the last reset.*/
+    int getNumUnwrittenSamples();
+
+    /** Resets the high-water mark and the dropped-block counters.*/
+    void resetCounters();
+
+private:
+
+    /** Writes all data currently in the queues. Returns true if anything was written.*/
+    bool writeAvailableData();
+
+    /** Writes all of the events currently in the event queue.*/
+    void writeAvailableEvents();
+
+    RecordNode* recordNode;
+
+    AbstractFifo dataFifo;
+    AudioSampleBuffer dataBuffer;
+
+    /** Holds the size and starting timestamp of each queued block.*/
+    struct BlockInfo
+    {
+        int64 timestamp;
+        int numSamples;
+        /** True if one or more blocks were dropped just before this one.*/
+        bool followsDroppedBlock;
+    };
+
+    AbstractFifo blockFifo;
+    HeapBlock<BlockInfo> blockInfo;
+
+    /** Holds a single queued TTL event.*/
+    struct EventInfo
+    {
+        int64 timestamp;
+        int samplePosition;
+        uint8 data[4];
+    };
+
+    AbstractFifo eventFifo;
+    HeapBlock<EventInfo> eventInfo;
+
+    Atomic<int> highWaterMark;
+    Atomic<int> numDroppedBlocks;
+    Atomic<int> numDroppedEvents;
+    Atomic<int> numUnwrittenSamples;
+    Atomic<int> closeRequested;
+
+    bool warnedAboutQueueDepth;
+
+    /** Set when a block is dropped, until the next block is queued (audio thread only).*/
+    bool blockWasDropped;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DiskWriteThread);
+
+};
+
+
+#endif  // __DISKWRITETHREAD_H_3F0A7C21__
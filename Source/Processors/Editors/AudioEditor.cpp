@@ -23,6 +23,8 @@
 
 #include "AudioEditor.h"
 #include "../../Audio/AudioComponent.h"
+#include "../ProcessorGraph.h"
+#include "../AudioResamplingNode.h"
 
 
 MuteButton::MuteButton()
@@ -111,6 +113,7 @@ AudioEditor::AudioEditor(AudioNode* owner)
 
 AudioEditor::~AudioEditor()
 {
+    stopTimer();
     deleteAllChildren();
     deleteAndZero(acw);
 }
@@ -134,8 +137,27 @@ void AudioEditor::updateBufferSizeText()
     
     String t = String(getAudioComponent()->getBufferSizeMs());
     t += " ms";
+
+    // from the arrival of a sample to the speakers
+    float latency = getProcessorGraph()->getAudioResamplingNode()->getLatencyMs();
+
+    if (latency > 0)
+    {
+        latency += getAudioComponent()->getOutputLatencyMs();
+        t += " / " + String(roundToInt(latency)) + " ms latency";
+    }
     
     audioWindowButton->setText(t);
+
+    // the pointers are valid once this has been called
+    if (!isTimerRunning())
+        startTimer(500);
+}
+
+void AudioEditor::timerCallback()
+{
+    if (acw == 0 || !acw->isVisible())
+        updateBufferSizeText();
 }
 
 void AudioEditor::buttonClicked(Button* button)
@@ -99,7 +99,8 @@ private:
 class AudioEditor : public AudioProcessorEditor,
     public Button::Listener,
     public Slider::Listener,
-    public AccessClass
+    public AccessClass,
+    public Timer
 
 {
 public:
@@ -112,10 +113,14 @@ public:
 
     void resized();
     
+    /** Shows the buffer size and, while audio is playing, the measured
+        monitoring latency.*/
     void updateBufferSizeText();
 
 private:
 
+    void timerCallback();
+
     void buttonClicked(Button* button);
     void sliderValueChanged(Slider* slider);
 
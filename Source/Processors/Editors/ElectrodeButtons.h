@@ -74,7 +74,8 @@ public:
     ElectrodeEditorButton(const String& name_, Font font_) : Button("Electrode Editor"),
         name(name_), font(font_)
     {
-        if (name.equalsIgnoreCase("edit") || name.equalsIgnoreCase("monitor"))
+        if (name.equalsIgnoreCase("edit") || name.equalsIgnoreCase("monitor") ||
+            name.equalsIgnoreCase("auto"))
             setClickingTogglesState(true);
     }
     ~ElectrodeEditorButton() {}
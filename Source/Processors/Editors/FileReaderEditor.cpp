@@ -24,6 +24,7 @@
 #include "FileReaderEditor.h"
 
 #include "../FileReader.h"
+#include "../../UI/EditorViewport.h"
 
 #include <stdio.h>
 
@@ -42,9 +43,22 @@ FileReaderEditor::FileReaderEditor(GenericProcessor* parentNode, bool useDefault
     addAndMakeVisible(fileButton);
 
     fileNameLabel = new Label("FileNameLabel", "No file selected.");
-    fileNameLabel->setBounds(20,80,140,25);
+    fileNameLabel->setBounds(20,75,140,20);
     addAndMakeVisible(fileNameLabel);
 
+    fileInfoLabel = new Label("FileInfoLabel", "");
+    fileInfoLabel->setFont(Font("Small Text", 10, Font::plain));
+    fileInfoLabel->setBounds(20,92,140,16);
+    addAndMakeVisible(fileInfoLabel);
+
+    playbackButton = new UtilityButton("real time",Font("Small Text", 10, Font::plain));
+    playbackButton->addListener(this);
+    playbackButton->setClickingTogglesState(true);
+    playbackButton->setToggleState(true,false);
+    playbackButton->setTooltip("Replay at the recorded sample rate, or as fast as possible when off");
+    playbackButton->setBounds(50,110,80,16);
+    addAndMakeVisible(playbackButton);
+
     desiredWidth = 180;
 
     setEnabledState(false);
@@ -64,11 +78,36 @@ void FileReaderEditor::setFile(String file)
     fileReader->setFile(fileToRead.getFullPathName());
     fileNameLabel->setText(fileToRead.getFileName(), dontSendNotification);
 
+    if (fileReader->getLengthInSeconds() > 0)
+    {
+        fileInfoLabel->setText(String(fileReader->getDefaultNumOutputs()) + " ch, "
+                               + String(fileReader->getDefaultSampleRate() / 1000.0f, 1) + " kHz, "
+                               + String(fileReader->getLengthInSeconds(), 1) + " s",
+                               dontSendNotification);
+    }
+    else
+    {
+        fileInfoLabel->setText("Can't read file.", dontSendNotification);
+    }
+
     setEnabledState(true);
 
+    // the number of channels and the sample rate come from the file
+    getEditorViewport()->makeEditorVisible(this, false, true);
+
     repaint();
 }
 
+void FileReaderEditor::setRealTime(bool shouldBeRealTime)
+{
+
+    fileReader->setRealTime(shouldBeRealTime);
+
+    playbackButton->setToggleState(shouldBeRealTime,false);
+    playbackButton->setLabel(shouldBeRealTime ? "real time" : "fast");
+
+}
+
 void FileReaderEditor::buttonEvent(Button* button)
 {
 
@@ -94,6 +133,10 @@ void FileReaderEditor::buttonEvent(Button* button)
                 // fileNameLabel->setText(fileToRead.getFileName(),false);
             }
         }
+        else if (button == playbackButton)
+        {
+            setRealTime(playbackButton->getToggleState());
+        }
 
     }
 }
@@ -50,6 +50,9 @@ public:
 
     void setFile(String file);
 
+    /** Sets the playback mode and updates the button.*/
+    void setRealTime(bool shouldBeRealTime);
+
     void saveEditorParameters(XmlElement*);
 
     void loadEditorParameters(XmlElement*);
@@ -58,6 +61,8 @@ private:
 
     ScopedPointer<UtilityButton> fileButton;
     ScopedPointer<Label> fileNameLabel;
+    ScopedPointer<Label> fileInfoLabel;
+    ScopedPointer<UtilityButton> playbackButton;
 
     FileReader* fileReader;
 
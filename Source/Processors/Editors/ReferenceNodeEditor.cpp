@@ -26,6 +26,10 @@
 #include "../ReferenceNode.h"
 #include <stdio.h>
 
+// number of channels per group for each item of the group selector (0 for all channels)
+static const int groupSizes[] = { 0, 8, 16, 32, 64, 128 };
+static const int numGroupSizes = sizeof(groupSizes) / sizeof(groupSizes[0]);
+
 
 ReferenceNodeEditor::ReferenceNodeEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors=true)
     : GenericEditor(parentNode, useDefaultParameterEditors), previousChannelCount(0)
@@ -33,13 +37,33 @@ ReferenceNodeEditor::ReferenceNodeEditor(GenericProcessor* parentNode, bool useD
 {
     desiredWidth = 180;
 
+    modeSelector = new ComboBox();
+    modeSelector->setBounds(15,35,150,25);
+    modeSelector->addListener(this);
+    modeSelector->addItem("Single channel", 1);
+    modeSelector->addItem("Common average", 2);
+    modeSelector->addItem("Common median", 3);
+    modeSelector->setSelectedId(1, false);
+    addAndMakeVisible(modeSelector);
+
     referenceSelector = new ComboBox();
-    referenceSelector->setBounds(15,50,150,25);
+    referenceSelector->setBounds(15,70,150,25);
     referenceSelector->addListener(this);
     referenceSelector->addItem("None", 1);
     referenceSelector->setSelectedId(1, false);
     addAndMakeVisible(referenceSelector);
 
+    groupSelector = new ComboBox();
+    groupSelector->setBounds(15,70,150,25);
+    groupSelector->addListener(this);
+    groupSelector->addItem("All channels", 1);
+
+    for (int i = 1; i < numGroupSizes; i++)
+        groupSelector->addItem("Groups of " + String(groupSizes[i]), i+1);
+
+    groupSelector->setSelectedId(1, false);
+    addChildComponent(groupSelector);
+
 }
 
 ReferenceNodeEditor::~ReferenceNodeEditor()
@@ -71,8 +95,29 @@ void ReferenceNodeEditor::updateSettings()
     getProcessor()->setParameter(1,-1.0f);
 }
 
+void ReferenceNodeEditor::updateSelectorVisibility()
+{
+    bool singleChannel = (modeSelector->getSelectedId() == 1);
+
+    referenceSelector->setVisible(singleChannel);
+    groupSelector->setVisible(!singleChannel);
+}
+
 void ReferenceNodeEditor::comboBoxChanged(ComboBox* c)
 {
+    if (c == modeSelector)
+    {
+        getProcessor()->setParameter(2, float(c->getSelectedId() - 1));
+        updateSelectorVisibility();
+        return;
+    }
+    else if (c == groupSelector)
+    {
+        int index = jlimit(0, numGroupSizes - 1, c->getSelectedId() - 1);
+        getProcessor()->setParameter(3, float(groupSizes[index]));
+        return;
+    }
+
     float channel;
 
     int id = c->getSelectedId();
@@ -105,6 +150,14 @@ void ReferenceNodeEditor::saveEditorParameters(XmlElement* xml)
 
     selectedChannel->setAttribute("ID",referenceSelector->getSelectedId());
 
+    XmlElement* selectedMode = xml->createNewChildElement("MODE");
+
+    selectedMode->setAttribute("ID",modeSelector->getSelectedId());
+
+    XmlElement* selectedGroup = xml->createNewChildElement("GROUP");
+
+    selectedGroup->setAttribute("ID",groupSelector->getSelectedId());
+
 }
 
 void ReferenceNodeEditor::loadEditorParameters(XmlElement* xml)
@@ -120,5 +173,13 @@ void ReferenceNodeEditor::loadEditorParameters(XmlElement* xml)
             referenceSelector->setSelectedId(id);
 
         }
+        else if (xmlNode->hasTagName("MODE"))
+        {
+            modeSelector->setSelectedId(xmlNode->getIntAttribute("ID", 1));
+        }
+        else if (xmlNode->hasTagName("GROUP"))
+        {
+            groupSelector->setSelectedId(xmlNode->getIntAttribute("ID", 1));
+        }
     }
 }
\ No newline at end of file
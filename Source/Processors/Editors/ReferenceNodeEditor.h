@@ -53,7 +53,13 @@ public:
 
 private:
 
+    /** Shows the channel selector for a single reference channel, and the
+        group selector otherwise.*/
+    void updateSelectorVisibility();
+
+    ScopedPointer<ComboBox> modeSelector;
     ScopedPointer<ComboBox> referenceSelector;
+    ScopedPointer<ComboBox> groupSelector;
 
     int previousChannelCount;
 
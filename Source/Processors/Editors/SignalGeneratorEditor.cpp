@@ -88,6 +88,19 @@ SignalGeneratorEditor::SignalGeneratorEditor(GenericProcessor* parentNode, bool
     downButton->setBounds(200,75,20,15);
     addAndMakeVisible(downButton);
 
+    sampleRateSelection = new ComboBox("Sample Rate");
+    sampleRateSelection->addItem("1000", 1);
+    sampleRateSelection->addItem("10000", 2);
+    sampleRateSelection->addItem("20000", 3);
+    sampleRateSelection->addItem("25000", 4);
+    sampleRateSelection->addItem("30000", 5);
+    sampleRateSelection->addItem("40000", 6);
+    sampleRateSelection->addItem("44100", 7);
+    sampleRateSelection->setSelectedId(7, true);
+    sampleRateSelection->addListener(this);
+    sampleRateSelection->setBounds(185,100,60,20);
+    addAndMakeVisible(sampleRateSelection);
+
 }
 
 SignalGeneratorEditor::~SignalGeneratorEditor()
@@ -148,18 +161,26 @@ void SignalGeneratorEditor::buttonEvent(Button* button)
 
     if (button == upButton)
     {
-        numChannelsLabel->setText(String(++num), dontSendNotification);
+        numChannelsLabel->setText(String(++num), sendNotification);
 
     }
     else if (button == downButton)
     {
 
         if (num > 1)
-            numChannelsLabel->setText(String(--num), dontSendNotification);
+            numChannelsLabel->setText(String(--num), sendNotification);
 
     }
 }
 
+void SignalGeneratorEditor::comboBoxChanged(ComboBox* comboBox)
+{
+
+    SignalGenerator* sg = (SignalGenerator*) getProcessor();
+    sg->setSampleRate(comboBox->getText().getFloatValue());
+    getEditorViewport()->makeEditorVisible(this);
+}
+
 void SignalGeneratorEditor::sliderEvent(Slider* slider)
 {
 
@@ -197,7 +218,7 @@ void SignalGeneratorEditor::labelTextChanged(Label* label)
 {
 
     SignalGenerator* sg = (SignalGenerator*) getProcessor();
-    sg->nOut = numChannelsLabel->getText().getIntValue();
+    sg->nOut = jmax(1, numChannelsLabel->getText().getIntValue());
     getEditorViewport()->makeEditorVisible(this);
 }
 
@@ -41,7 +41,8 @@ class WaveformSelector;
 */
 
 class SignalGeneratorEditor : public GenericEditor,
-    public Label::Listener
+    public Label::Listener,
+    public ComboBox::Listener
 {
 public:
     SignalGeneratorEditor(GenericProcessor* parentNode, bool useDefaultParameters);
@@ -49,10 +50,12 @@ public:
     void sliderEvent(Slider* slider);
     void buttonEvent(Button* button);
     void labelTextChanged(Label* label);
+    void comboBoxChanged(ComboBox* comboBox);
 
 private:
 
     Label* numChannelsLabel;
+    ComboBox* sampleRateSelection;
     TriangleButton* upButton;
     TriangleButton* downButton;
 
@@ -105,6 +105,11 @@ SpikeDetectorEditor::SpikeDetectorEditor(GenericProcessor* parentNode, bool useD
     e3->setBounds(130,110,70,10);
     electrodeEditorButtons.add(e3);
 
+    adaptiveButton = new ElectrodeEditorButton("AUTO",font);
+    adaptiveButton->addListener(this);
+    addAndMakeVisible(adaptiveButton);
+    adaptiveButton->setBounds(235,25,40,10);
+
     thresholdSlider = new ThresholdSlider(font);
     thresholdSlider->setBounds(200,35,75,75);
     addAndMakeVisible(thresholdSlider);
@@ -194,6 +199,9 @@ void SpikeDetectorEditor::buttonEvent(Button* button)
             thresholdSlider->setActive(true);
             thresholdSlider->setValue(processor->getChannelThreshold(electrodeList->getSelectedItemIndex(),
                                                                      electrodeButtons.indexOf((ElectrodeButton*) button)));
+
+            showNoiseLevel(electrodeList->getSelectedItemIndex(),
+                           electrodeButtons.indexOf((ElectrodeButton*) button));
         }
         else
         {
@@ -219,7 +227,17 @@ void SpikeDetectorEditor::buttonEvent(Button* button)
 
     int num = numElectrodes->getText().getIntValue();
 
-    if (button == upButton)
+    if (button == adaptiveButton)
+    {
+        SpikeDetector* processor = (SpikeDetector*) getProcessor();
+        processor->setAdaptiveThresholds(button->getToggleState());
+
+        // thresholds are set by the processor while this is on
+        thresholdSlider->setEnabled(!button->getToggleState());
+
+        return;
+    }
+    else if (button == upButton)
     {
         numElectrodes->setText(String(++num), sendNotification);
 
@@ -299,6 +317,7 @@ void SpikeDetectorEditor::buttonEvent(Button* button)
         if (!button->getToggleState())
         {
             thresholdSlider->setActive(false);
+            showNoiseLevel(-1, -1);
 
             // This will be -1 with nothing selected
             int selectedItemIndex = electrodeList->getSelectedItemIndex();
@@ -477,11 +496,37 @@ void SpikeDetectorEditor::comboBoxChanged(ComboBox* comboBox)
     }
 
     thresholdSlider->setActive(false);
+    showNoiseLevel(-1, -1);
 }
 
 void SpikeDetectorEditor::checkSettings()
 {
     electrodeList->setSelectedItemIndex(0);
+
+    SpikeDetector* processor = (SpikeDetector*) getProcessor();
+
+    adaptiveButton->setToggleState(processor->hasAdaptiveThresholds(), false);
+    thresholdSlider->setEnabled(!processor->hasAdaptiveThresholds());
+}
+
+void SpikeDetectorEditor::showNoiseLevel(int electrodeNum, int channelNum)
+{
+
+    if (electrodeNum < 0 || channelNum < 0)
+    {
+        thresholdLabel->setText("Threshold", dontSendNotification);
+        return;
+    }
+
+    SpikeDetector* processor = (SpikeDetector*) getProcessor();
+
+    double noise = processor->getChannelNoiseLevel(electrodeNum, channelNum);
+
+    if (noise > 0)
+        thresholdLabel->setText("Noise " + String(noise, 1) + " uV", dontSendNotification);
+    else
+        thresholdLabel->setText("Noise --", dontSendNotification);
+
 }
 
 void SpikeDetectorEditor::drawElectrodeButtons(int ID)
@@ -116,6 +116,12 @@ private:
     OwnedArray<ElectrodeButton> electrodeButtons;
     Array<ElectrodeEditorButton*> electrodeEditorButtons;
 
+    /** Toggles thresholds that follow the noise level of each channel. */
+    ElectrodeEditorButton* adaptiveButton;
+
+    /** Shows the noise level of the channel being edited under the slider. */
+    void showNoiseLevel(int electrodeNum, int channelNum);
+
 
     void removeElectrode(int index);
     void editElectrode(int index, int chan, int newChan);
@@ -0,0 +1,204 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "EventArena.h"
+#include "GenericProcessor.h"
+#include "Visualization/SpikeObject.h"
+
+EventArena::EventArena(int maxNumEvents_, int maxNumBytes_)
+    : maxNumEvents(maxNumEvents_), numEvents(0),
+      maxNumBytes(maxNumBytes_), numBytesUsed(0), numDroppedEvents(0),
+      numDroppedInBlock(0)
+{
+
+    events.malloc(maxNumEvents);
+    bytes.malloc(maxNumBytes);
+
+    for (int i = 0; i < numTypes; i++)
+    {
+        typeIndices[i].malloc(maxNumEvents);
+        numTypeEvents[i] = 0;
+    }
+
+}
+
+EventArena::~EventArena()
+{
+
+}
+
+void EventArena::clear()
+{
+
+    numEvents = 0;
+    numBytesUsed = 0;
+    numDroppedInBlock = 0;
+
+    for (int i = 0; i < numTypes; i++)
+        numTypeEvents[i] = 0;
+
+}
+
+int EventArena::readFrom(const MidiBuffer& buffer)
+{
+
+    clear();
+
+    int numSamples = 0;
+
+    MidiBuffer::Iterator i(buffer);
+
+    const uint8* data;
+    int numBytes;
+    int samplePosition;
+
+    // this form of getNextEvent() does not create a MidiMessage
+    while (i.getNextEvent(data, numBytes, samplePosition))
+    {
+        if (numBytes < 1)
+            continue;
+
+        if (*data == GenericProcessor::BUFFER_SIZE)
+            numSamples = samplePosition;
+
+        addEvent(data, numBytes, samplePosition);
+    }
+
+    return numSamples;
+
+}
+
+bool EventArena::addEvent(const uint8* data, int numBytes, int sampleNum)
+{
+
+    if (numEvents == maxNumEvents || numBytesUsed + numBytes > maxNumBytes)
+    {
+        numDroppedEvents++;
+        numDroppedInBlock++;
+        return false;
+    }
+
+    uint8* dest = bytes + numBytesUsed;
+    memcpy(dest, data, numBytes);
+    numBytesUsed += numBytes;
+
+    Event& event = events[numEvents];
+    event.type = (numBytes > 0) ? data[0] : -1;
+    event.sampleNum = sampleNum;
+    event.numBytes = numBytes;
+    event.data = dest;
+
+    if (event.type >= 0 && event.type < numTypes)
+    {
+        typeIndices[event.type][numTypeEvents[event.type]++] = numEvents;
+    }
+
+    numEvents++;
+
+    return true;
+
+}
+
+int EventArena::getNumEvents(int type)
+{
+    if (type < 0 || type >= numTypes)
+        return 0;
+
+    return numTypeEvents[type];
+}
+
+const EventArena::Event& EventArena::getEvent(int type, int index)
+{
+    return events[typeIndices[type][index]];
+}
+
+EventArena::Reader::Reader(EventArena& arena_, const MidiBuffer& buffer, int type_)
+    : arena(arena_), iterator(buffer), type(type_), index(0),
+      useArena(arena_.isComplete())
+{
+
+}
+
+bool EventArena::Reader::getNextEvent(Event& event)
+{
+
+    if (useArena)
+    {
+        if (type < 0)
+        {
+            if (index >= arena.getNumEvents())
+                return false;
+
+            event = arena.getEvent(index++);
+        }
+        else
+        {
+            if (index >= arena.getNumEvents(type))
+                return false;
+
+            event = arena.getEvent(type, index++);
+        }
+
+        return true;
+    }
+
+    // some events did not fit into the arena, so they are read from the
+    // MidiBuffer one after another
+    const uint8* data;
+    int numBytes;
+    int samplePosition;
+
+    while (iterator.getNextEvent(data, numBytes, samplePosition))
+    {
+        if (numBytes < 1 || (type >= 0 && data[0] != type))
+            continue;
+
+        event.type = data[0];
+        event.sampleNum = samplePosition;
+        event.numBytes = numBytes;
+        event.data = data;
+
+        return true;
+    }
+
+    return false;
+
+}
+
+int64 EventArena::getTimestamp(const Event& event)
+{
+    int64 timestamp = 0;
+
+    if (event.numBytes >= 12)
+        memcpy(&timestamp, event.data + 4, 8); // skip the first four bytes
+
+    return timestamp;
+}
+
+bool EventArena::getSpike(const Event& event, SpikeObject& spike)
+{
+    if (event.numBytes <= 0)
+        return false;
+
+    return unpackSpike(&spike, event.data, event.numBytes);
+}
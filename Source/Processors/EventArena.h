@@ -0,0 +1,191 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __EVENTARENA_H_7D2E94B1__
+#define __EVENTARENA_H_7D2E94B1__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+struct SpikeObject;
+
+/**
+
+  Holds the events of one block, sorted by type, in preallocated storage.
+
+  GenericProcessor::processBlock() copies the incoming MidiBuffer into its
+  arena once per block, without allocating any memory. A processor can then
+  go through the events of the types it cares about (e.g. only the spikes,
+  or only the timestamps) with getNumEvents(type) and getEvent(type, i),
+  instead of scanning the whole MidiBuffer and building a MidiMessage for
+  every event, as checkForEvents() does.
+
+  The number of events and bytes per block is fixed when the arena is
+  created; events that do not fit are counted and left out of the arena
+  (they are still in the MidiBuffer). Processors should therefore go through
+  the events with an EventArena::Reader, which falls back to the MidiBuffer
+  for blocks that did not fit.
+
+  @see GenericProcessor
+
+*/
+
+class EventArena
+{
+public:
+
+    /** One event; data points to its raw bytes, whose first byte is the type.*/
+    struct Event
+    {
+        int type;
+        int sampleNum;
+        int numBytes;
+        const uint8* data;
+    };
+
+    EventArena(int maxNumEvents = 2048, int maxNumBytes = 256 * 1024);
+    ~EventArena();
+
+    /** Removes all events.*/
+    void clear();
+
+    /** Replaces the contents of the arena with the events of a MidiBuffer.
+        Returns the number of samples given by the last BUFFER_SIZE event, or
+        0 if there is none.*/
+    int readFrom(const MidiBuffer& buffer);
+
+    /** Copies one event into the arena. Returns false if it is full.*/
+    bool addEvent(const uint8* data, int numBytes, int sampleNum);
+
+    /** Returns the number of events of all types, in the order they were added.*/
+    int getNumEvents()
+    {
+        return numEvents;
+    }
+
+    const Event& getEvent(int index)
+    {
+        return events[index];
+    }
+
+    /** Returns the number of events of one type (see GenericProcessor::eventTypes).*/
+    int getNumEvents(int type);
+
+    const Event& getEvent(int type, int index);
+
+    /** Returns true if no event has been left out since the last clear().*/
+    bool isComplete()
+    {
+        return numDroppedInBlock == 0;
+    }
+
+    /** Returns the number of events left out since the last clear().*/
+    int getNumDroppedEventsInBlock()
+    {
+        return numDroppedInBlock;
+    }
+
+    /** Returns the number of events left out since the arena was created.*/
+    int getNumDroppedEvents()
+    {
+        return numDroppedEvents;
+    }
+
+    /**
+        Goes through the events of one type (or of all types) that were in
+        the MidiBuffer when the block started.
+
+        They are taken from the arena if all of them fit into it; otherwise
+        they are read from the MidiBuffer itself, which must then not be
+        changed while the Reader is in use.
+    */
+    class Reader
+    {
+    public:
+
+        /** A type of -1 selects the events of all types.*/
+        Reader(EventArena& arena, const MidiBuffer& buffer, int type = -1);
+
+        /** Fills in the next event; returns false when there are no more.*/
+        bool getNextEvent(Event& event);
+
+    private:
+        EventArena& arena;
+        MidiBuffer::Iterator iterator;
+        int type;
+        int index;
+        bool useArena;
+
+        JUCE_DECLARE_NON_COPYABLE(Reader);
+    };
+
+    // helpers for the events created by GenericProcessor::addEvent()
+
+    static int getNodeId(const Event& event)
+    {
+        return event.data[1];
+    }
+
+    static int getEventId(const Event& event)
+    {
+        return event.data[2];
+    }
+
+    static int getEventChannel(const Event& event)
+    {
+        return event.data[3];
+    }
+
+    /** Returns the timestamp held by a TIMESTAMP event.*/
+    static int64 getTimestamp(const Event& event);
+
+    /** Unpacks a SPIKE event; returns false if it is not valid.*/
+    static bool getSpike(const Event& event, SpikeObject& spike);
+
+private:
+
+    enum
+    {
+        numTypes = 8
+    };
+
+    HeapBlock<Event> events;
+    int maxNumEvents;
+    int numEvents;
+
+    /** Indices in events of the events of each type.*/
+    HeapBlock<int> typeIndices[numTypes];
+    int numTypeEvents[numTypes];
+
+    HeapBlock<uint8> bytes;
+    int maxNumBytes;
+    int numBytesUsed;
+
+    int numDroppedEvents;
+    int numDroppedInBlock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EventArena);
+
+};
+
+
+#endif  // __EVENTARENA_H_7D2E94B1__
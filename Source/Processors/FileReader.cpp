@@ -23,14 +23,16 @@
 
 #include "FileReader.h"
 #include "Editors/FileReaderEditor.h"
-#include <stdio.h>
+#include "../AccessClass.h"
+#include "../Audio/AudioComponent.h"
 
 FileReader::FileReader()
-    : GenericProcessor("File Reader")
+    : GenericProcessor("File Reader"),
+      realTime(true), startTime(0.0), samplesOwed(0.0), switchedToInternalClock(false),
+      rawNumChannels(16), rawSampleRate(40000.0f), rawBitVolts(0.05f)
 {
 
-    input = 0;
-    timestamp = 0;
+    reader.setRawFormat(rawNumChannels, rawSampleRate, rawBitVolts);
 
     enabledState(false);
 
@@ -38,8 +40,7 @@ FileReader::FileReader()
 
 FileReader::~FileReader()
 {
-    if (input)
-        fclose(input);
+
 }
 
 AudioProcessorEditor* FileReader::createEditor()
@@ -52,7 +53,7 @@ AudioProcessorEditor* FileReader::createEditor()
 
 bool FileReader::isReady()
 {
-    if (input == 0)
+    if (!reader.isOpen())
     {
         sendActionMessage("No file selected in File Reader.");
         return false;
@@ -66,17 +67,26 @@ bool FileReader::isReady()
 
 float FileReader::getDefaultSampleRate()
 {
-    return 40000.0f;
+    if (reader.isOpen())
+        return reader.getSampleRate();
+    else
+        return rawSampleRate;
 }
 
 int FileReader::getDefaultNumOutputs()
 {
-    return 16;
+    if (reader.isOpen())
+        return reader.getNumChannels();
+    else
+        return rawNumChannels;
 }
 
 float FileReader::getDefaultBitVolts()
 {
-    return 0.05f;
+    if (reader.isOpen())
+        return reader.getBitVolts(0);
+    else
+        return rawBitVolts;
 }
 
 void FileReader::enabledState(bool t)
@@ -92,25 +102,25 @@ void FileReader::setFile(String fullpath)
 
     filePath = fullpath;
 
-    const char* path = filePath.getCharPointer();
-
-    if (input)
-        fclose(input);
-
-    input = fopen(path, "rb");
+    File file(filePath);
 
-    // Avoid a segfault if file isn't found
-    if (!input)
+    if (!file.existsAsFile())
     {
         std::cout << "Can't find data file "
-                  << '"' << path << "\""
+                  << '"' << filePath << "\""
                   << std::endl;
+        reader.close();
         return;
     }
 
-    fseek(input, 0, SEEK_END);
-    lengthOfInputFile = ftell(input);
-    rewind(input);
+    reader.open(file);
+
+    if (reader.isOpen())
+    {
+        std::cout << "File Reader: " << reader.getNumChannels() << " channels at "
+                  << reader.getSampleRate() << " Hz, "
+                  << getLengthInSeconds() << " s" << std::endl;
+    }
 
 }
 
@@ -120,66 +130,137 @@ String FileReader::getFile()
     return filePath;
 }
 
-void FileReader::updateSettings()
+void FileReader::setRawFormat(int numChannels, float sampleRate, float bitVolts)
 {
 
-}
+    rawNumChannels = numChannels;
+    rawSampleRate = sampleRate;
+    rawBitVolts = bitVolts;
 
+    reader.setRawFormat(numChannels, sampleRate, bitVolts);
 
+    if (filePath.isNotEmpty())
+        setFile(filePath);
 
-void FileReader::process(AudioSampleBuffer& buffer, MidiBuffer& events, int& nSamples)
+}
+
+void FileReader::setRealTime(bool shouldBeRealTime)
 {
+    realTime = shouldBeRealTime;
+}
 
-    uint8 data[8];
-    memcpy(data, &timestamp, 8);
+void FileReader::setStartTime(double seconds)
+{
+    startTime = jmax(0.0, seconds);
+}
 
-    // generate timestamp
-    addEvent(events,    // MidiBuffer
-             TIMESTAMP, // eventType
-             0,         // sampleNum
-             nodeId,    // eventID
-             0,		 // eventChannel
-             8,         // numBytes
-             data   // data
-            );
+double FileReader::getLengthInSeconds()
+{
+    if (reader.isOpen())
+        return double(reader.getNumSamples()) / reader.getSampleRate();
+    else
+        return 0.0;
+}
+
+void FileReader::updateSettings()
+{
 
-    // FIXME: needs to account for the fact that the ratio might not be an exact
-    //        integer value
-    int samplesNeeded = (int) float(buffer.getNumSamples()) * (getDefaultSampleRate()/44100.0f);
+    if (!reader.isOpen())
+        return;
 
-    if (ftell(input) >= lengthOfInputFile - samplesNeeded)
+    for (int i = 0; i < channels.size() && i < reader.getNumChannels(); i++)
     {
-        rewind(input);
+        channels[i]->bitVolts = reader.getBitVolts(i);
+        channels[i]->setName(reader.getChannelName(i));
     }
 
-    size_t numRead = fread(readBuffer, 2, samplesNeeded*buffer.getNumChannels(), input);
+}
+
+bool FileReader::enable()
+{
 
-    int chan = 0;
-    int samp = 0;
+    if (!reader.isOpen())
+        return false;
 
-    for (size_t n = 0; n < numRead; n++)
-    {
+    reader.seek(int64(startTime * reader.getSampleRate()));
+    samplesOwed = 0.0;
 
-        if (chan == buffer.getNumChannels())
+    // only the internal clock can run faster than real time, so switch to it
+    // for the duration of the acquisition if the audio device is in use
+    switchedToInternalClock = false;
+
+    if (!realTime)
+    {
+        if (!getAudioComponent()->isUsingInternalClock())
         {
-            samp++;
-            timestamp++;
-            chan = 0;
+            std::cout << "File Reader switching to the internal clock for fast replay." << std::endl;
+            getAudioComponent()->setUseInternalClock(true);
+            switchedToInternalClock = true;
         }
 
-        int16 sample = readBuffer[n];
+        getAudioComponent()->setFreeRunning(true);
+    }
+
+    return true;
+
+}
+
+bool FileReader::disable()
+{
+
+    getAudioComponent()->setFreeRunning(false);
+
+    if (switchedToInternalClock)
+    {
+        // go back to the audio device, which is closed while not acquiring
+        getAudioComponent()->setUseInternalClock(false);
+        getAudioComponent()->stopDevice();
+        switchedToInternalClock = false;
+    }
+
+    return true;
+
+}
 
-#ifdef JUCE_WINDOWS //-- big-endian format
-            // reverse the byte order
-	//	float sample_f;
-	//	AudioDataConverters::convertInt16BEToFloat(&readBuffer[n], &sample_f, 1);
 
-#endif
+void FileReader::process(AudioSampleBuffer& buffer, MidiBuffer& events, int& nSamples)
+{
 
-        *buffer.getSampleData(chan++, samp) = -sample * getDefaultBitVolts();
+    int samplesNeeded;
 
+    if (realTime)
+    {
+        // the device runs at 44.1 kHz; carry the fraction of a sample that
+        // doesn't fit into this block over to the next one
+        samplesOwed += double(buffer.getNumSamples()) * (reader.getSampleRate() / 44100.0);
+
+        samplesNeeded = jmin((int) samplesOwed, buffer.getNumSamples());
+        samplesOwed = jmin(samplesOwed - samplesNeeded, 1.0);
+    }
+    else
+    {
+        samplesNeeded = buffer.getNumSamples();
     }
 
+    int64 timestamp = reader.getTimestamp();
+
+    uint8 data[8];
+    memcpy(data, &timestamp, 8);
+
+    // generate timestamp
+    addEvent(events,    // MidiBuffer
+             TIMESTAMP, // eventType
+             0,         // sampleNum
+             nodeId,    // eventID
+             0,		 // eventChannel
+             8,         // numBytes
+             data   // data
+            );
+
+    reader.read(buffer.getArrayOfChannels(),
+                jmin(buffer.getNumChannels(), getNumOutputs()),
+                samplesNeeded);
+
     nSamples = samplesNeeded;
 
 }
@@ -198,6 +279,15 @@ void FileReader::saveCustomParametersToXml(XmlElement* parentElement)
     XmlElement* childNode = parentElement->createNewChildElement("FILENAME");
     childNode->setAttribute("path", getFile());
 
+    XmlElement* playbackNode = parentElement->createNewChildElement("PLAYBACK");
+    playbackNode->setAttribute("realTime", realTime);
+    playbackNode->setAttribute("startTime", startTime);
+
+    XmlElement* rawNode = parentElement->createNewChildElement("RAWFORMAT");
+    rawNode->setAttribute("numChannels", rawNumChannels);
+    rawNode->setAttribute("sampleRate", rawSampleRate);
+    rawNode->setAttribute("bitVolts", rawBitVolts);
+
 }
 
 void FileReader::loadCustomParametersFromXml()
@@ -207,6 +297,19 @@ void FileReader::loadCustomParametersFromXml()
     {
         // use parametersAsXml to restore state
 
+        // the raw format has to be known before the file is opened
+        forEachXmlChildElement(*parametersAsXml, xmlNode)
+        {
+            if (xmlNode->hasTagName("RAWFORMAT"))
+            {
+                rawNumChannels = xmlNode->getIntAttribute("numChannels", rawNumChannels);
+                rawSampleRate = (float) xmlNode->getDoubleAttribute("sampleRate", rawSampleRate);
+                rawBitVolts = (float) xmlNode->getDoubleAttribute("bitVolts", rawBitVolts);
+
+                reader.setRawFormat(rawNumChannels, rawSampleRate, rawBitVolts);
+            }
+        }
+
         forEachXmlChildElement(*parametersAsXml, xmlNode)
         {
             if (xmlNode->hasTagName("FILENAME"))
@@ -216,7 +319,13 @@ void FileReader::loadCustomParametersFromXml()
                 fre->setFile(filepath);
 
             }
+            else if (xmlNode->hasTagName("PLAYBACK"))
+            {
+                FileReaderEditor* fre = (FileReaderEditor*) getEditor();
+                fre->setRealTime(xmlNode->getBoolAttribute("realTime", true));
+                setStartTime(xmlNode->getDoubleAttribute("startTime", 0.0));
+            }
         }
     }
 
-}
\ No newline at end of file
+}
@@ -29,14 +29,24 @@
 #include "../../JuceLibraryCode/JuceHeader.h"
 
 #include "GenericProcessor.h"
-
-#define BUFFER_SIZE 102400
+#include "RecordingReader.h"
 
 /**
 
-  Reads data from a file.
+  Replays recorded data from a file.
+
+  Reads Open Ephys .continuous recordings, the interleaved .dat files of
+  InterleavedFileWriter, and raw interleaved int16 files (whose layout is set
+  with setRawFormat()), through a memory-mapped RecordingReader. The
+  recorded timestamps are sent with each block.
+
+  In real time, each block holds as many samples as the file's sample rate
+  gives for the duration of the block. Otherwise every block is filled, and
+  the internal clock is asked to start blocks as soon as the previous one is
+  done, so the signal chain runs as fast as it can. If the audio device was
+  in use, the internal clock replaces it until acquisition stops.
 
-  @see GenericProcessor
+  @see GenericProcessor, RecordingReader, FileReaderEditor
 
 */
 
@@ -67,6 +77,9 @@ public:
         return true;
     }
 
+    bool enable();
+    bool disable();
+
     void enabledState(bool t);
 
     float getDefaultSampleRate();
@@ -76,21 +89,49 @@ public:
     void setFile(String fullpath);
     String getFile();
 
+    /** Sets the layout of raw files; reopens the current file.*/
+    void setRawFormat(int numChannels, float sampleRate, float bitVolts);
+
+    /** Chooses between replay in real time and as fast as possible.*/
+    void setRealTime(bool shouldBeRealTime);
+
+    bool isRealTime()
+    {
+        return realTime;
+    }
+
+    /** Sets the time from which the next acquisition starts.*/
+    void setStartTime(double seconds);
+
+    double getStartTime()
+    {
+        return startTime;
+    }
+
+    /** Returns the length of the file, in seconds.*/
+    double getLengthInSeconds();
+
     void saveCustomParametersToXml(XmlElement* parentElement);
     void loadCustomParametersFromXml();
 
 private:
 
-    int64 timestamp;
+    RecordingReader reader;
+
+    String filePath;
 
-    int lengthOfInputFile;
-    FILE* input;
+    bool realTime;
+    double startTime;
 
-    int16 readBuffer[BUFFER_SIZE];
+    /** Fraction of a sample that was not read in the last block.*/
+    double samplesOwed;
 
-    int bufferSize;
+    /** True if enable() replaced the audio device with the internal clock.*/
+    bool switchedToInternalClock;
 
-    String filePath;
+    int rawNumChannels;
+    float rawSampleRate;
+    float rawBitVolts;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FileReader);
 
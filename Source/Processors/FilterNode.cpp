@@ -25,6 +25,9 @@
 #include "FilterNode.h"
 #include "Editors/FilterEditor.h"
 
+// the bandpass has twice as many poles, i.e. one biquad per order
+#define FILTER_ORDER 2
+
 FilterNode::FilterNode()
     : GenericProcessor("Bandpass Filter"), defaultLowCut(300.0f), defaultHighCut(6000.0f)
 
@@ -127,26 +130,16 @@ AudioProcessorEditor* FilterNode::createEditor()
 void FilterNode::updateSettings()
 {
 
-    if (getNumInputs() < 1024 && getNumInputs() != filters.size())
+    if (getNumInputs() < 1024 && getNumInputs() != filterBank.getNumChannels())
     {
 
-        filters.clear();
+        filterBank.setSize(getNumInputs(), FILTER_ORDER);
         lowCuts.clear();
         highCuts.clear();
 
         for (int n = 0; n < getNumInputs(); n++)
         {
 
-            // std::cout << "Creating filter number " << n << std::endl;
-
-            filters.add(new Dsp::SmoothedFilterDesign
-                        <Dsp::Butterworth::Design::BandPass 	// design type
-                        <3>,								 	// order
-                        1,										// number of channels (must be const)
-                        Dsp::DirectFormII>						// realization
-                        (1));
-
-
             //Parameter& p1 =  parameters.getReference(0);
             //p1.setValue(600.0f, n);
             //Parameter& p2 =  parameters.getReference(1);
@@ -188,14 +181,15 @@ double FilterNode::getHighCutValueForChannel(int chan)
 void FilterNode::setFilterParameters(double lowCut, double highCut, int chan)
 {
 
-    Dsp::Params params;
-    params[0] = getSampleRate(); // sample rate
-    params[1] = 2; // order
-    params[2] = (highCut + lowCut)/2; // center frequency
-    params[3] = highCut - lowCut; // bandwidth
+    Dsp::Butterworth::BandPass<FILTER_ORDER> design;
 
-    if (filters.size() > chan)
-        filters[chan]->setParams(params);
+    design.setup(FILTER_ORDER,
+                 getSampleRate(), // sample rate
+                 (highCut + lowCut)/2, // center frequency
+                 highCut - lowCut); // bandwidth
+
+    if (filterBank.getNumChannels() > chan)
+        filterBank.setCoefficients(chan, design);
 
 }
 
@@ -255,11 +249,7 @@ void FilterNode::process(AudioSampleBuffer& buffer,
                          int& nSamples)
 {
 
-    for (int n = 0; n < getNumOutputs(); n++)
-    {
-        float* ptr = buffer.getSampleData(n);
-        filters[n]->process(nSamples, &ptr);
-    }
+    filterBank.process(buffer.getArrayOfChannels(), nSamples);
 
 }
 
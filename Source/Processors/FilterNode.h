@@ -27,6 +27,7 @@
 #include "../../JuceLibraryCode/JuceHeader.h"
 #include "../Dsp/Dsp.h"
 #include "GenericProcessor.h"
+#include "MultichannelIIRFilter.h"
 
 /**
 
@@ -34,6 +35,14 @@
 
   The user can select the low- and high-frequency cutoffs.
 
+  Every channel gets a 2nd-order Butterworth bandpass; the coefficients are
+  designed with the DSP library, and all channels are filtered together by
+  a MultichannelIIRFilter.
+
+  New cutoffs take effect at the start of the next block; the filter of
+  that channel starts again from rest, without ramping between the old and
+  the new band.
+
   @see GenericProcessor, FilterEditor
 
 */
@@ -68,7 +77,7 @@ public:
 private:
 
     Array<double> lowCuts, highCuts;
-    OwnedArray<Dsp::Filter> filters;
+    MultichannelIIRFilter<double> filterBank;
 
     double defaultLowCut;
     double defaultHighCut;
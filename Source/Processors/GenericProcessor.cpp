@@ -27,7 +27,7 @@
 GenericProcessor::GenericProcessor(const String& name_) : AccessClass(),
     sourceNode(0), destNode(0), isEnabled(true), wasConnected(false),
     nextAvailableChannel(0), saveOrder(-1), loadOrder(-1), currentChannel(-1),
-     parametersAsXml(nullptr),  name(name_), paramsWereLoaded(false)
+     parametersAsXml(nullptr),  name(name_), incomingEventBuffer(nullptr), paramsWereLoaded(false)
 {
 }
 
@@ -148,37 +148,6 @@ void GenericProcessor::setNumSamples(MidiBuffer& events, int sampleIndex)
 
 }
 
-int GenericProcessor::getNumSamples(MidiBuffer& events)
-{
-
-    int numRead = 0;
-
-    if (events.getNumEvents() > 0)
-    {
-
-        // int m = events.getNumEvents();
-
-        //std::cout << getName() << " received " << m << " events." << std::endl;
-
-        MidiBuffer::Iterator i(events);
-        MidiMessage message(0xf4);
-
-        int samplePosition = -5;
-
-        while (i.getNextEvent(message, samplePosition))
-        {
-
-            const uint8* dataptr = message.getRawData();
-
-            if (*dataptr == BUFFER_SIZE)
-            {
-                numRead = message.getTimeStamp();
-            }
-        }
-    }
-
-    return numRead;
-}
 
 void GenericProcessor::setSourceNode(GenericProcessor* sn)
 {
@@ -448,7 +417,23 @@ void GenericProcessor::disableEditor()
 int GenericProcessor::checkForEvents(MidiBuffer& midiMessages)
 {
 
-    if (midiMessages.getNumEvents() > 0)
+    if (&midiMessages == incomingEventBuffer && incomingEvents.isComplete())
+    {
+        // the events have already been read at the start of the block
+        for (int i = 0; i < incomingEvents.getNumEvents(); i++)
+        {
+            const EventArena::Event& event = incomingEvents.getEvent(i);
+
+            if (event.sampleNum < 0)
+                continue;
+
+            MidiMessage message(event.data, event.numBytes, event.sampleNum);
+
+            handleEvent(event.type, message, event.sampleNum);
+        }
+
+    }
+    else if (midiMessages.getNumEvents() > 0)
     {
 
         // int m = midiMessages.getNumEvents();
@@ -483,7 +468,8 @@ void GenericProcessor::addEvent(MidiBuffer& eventBuffer,
                                 uint8 numBytes,
                                 uint8* eventData)
 {
-    uint8* data = new uint8[4+numBytes];
+    // MidiBuffer::addEvent() copies the data
+    uint8 data[4+256];
 
     data[0] = type;    // event type
     data[1] = nodeId;  // processor ID automatically added
@@ -513,10 +499,22 @@ void GenericProcessor::addEvent(MidiBuffer& eventBuffer,
 void GenericProcessor::processBlock(AudioSampleBuffer& buffer, MidiBuffer& eventBuffer)
 {
 
-    int nSamples = getNumSamples(eventBuffer); // removes first value from midimessages
+    // reads all incoming events once, including the number of samples
+    int nSamples = incomingEvents.readFrom(eventBuffer);
+    incomingEventBuffer = &eventBuffer;
+
+    const int numEventsBefore = eventBuffer.getNumEvents();
+    const int64 startTicks = Time::getHighResolutionTicks();
 
     process(buffer, eventBuffer, nSamples);
 
+    const int64 ticks = Time::getHighResolutionTicks() - startTicks;
+
+    stats.addBlock(ticks, nSamples, jmax(0, eventBuffer.getNumEvents() - numEventsBefore),
+                   incomingEvents.getNumDroppedEventsInBlock(), getSampleRate());
+
+    incomingEventBuffer = nullptr;
+
     setNumSamples(eventBuffer, nSamples); // adds it back,
     // even if it's unchanged
 
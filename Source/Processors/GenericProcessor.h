@@ -28,6 +28,8 @@
 #include "../../JuceLibraryCode/JuceHeader.h"
 #include "Editors/GenericEditor.h"
 #include "Parameter.h"
+#include "EventArena.h"
+#include "ProcessorStats.h"
 #include "../AccessClass.h"
 
 #include <time.h>
@@ -447,9 +449,28 @@ public:
 
     int nextAvailableChannel;
 
-    /** Can be called by processors that need to respond to incoming events. */
+    /** Can be called by processors that need to respond to incoming events.
+
+    Calls handleEvent() for each event that was in the buffer when the block
+    started, in order. Processors that only need some types of events can use
+    getIncomingEvents() instead, which creates no MidiMessage. */
     virtual int checkForEvents(MidiBuffer& mb);
 
+    /** Returns the time spent in process(), and the samples and events handled,
+    since the start of acquisition. */
+    ProcessorStats& getStats()
+    {
+        return stats;
+    }
+
+    /** Returns the events that were in the event buffer when the current block
+    started, sorted by type. Read them with an EventArena::Reader, which falls
+    back to the event buffer if they did not all fit into the arena. */
+    EventArena& getIncomingEvents()
+    {
+        return incomingEvents;
+    }
+
     /** Makes it easier for processors to add events to the MidiBuffer. */
     virtual void addEvent(MidiBuffer& mb,
                           uint8 type,
@@ -472,7 +493,8 @@ public:
         TTL = 3,
         SPIKE = 4,
         EEG = 5,
-        CONTINUOUS = 6
+        CONTINUOUS = 6,
+        DATA_GAP = 7
     };
 
     enum eventChannelTypes
@@ -591,9 +613,14 @@ private:
     /** Saves the record status of individual channels, even when other parameters are updated. */
     Array<bool> recordStatus;
 
-    /** Returns the number of samples for the current continuous buffer (assumed to be
-    the same for all channels).*/
-    int getNumSamples(MidiBuffer&);
+    /** The incoming events of the current block. */
+    EventArena incomingEvents;
+
+    /** The event buffer that incomingEvents was read from. */
+    MidiBuffer* incomingEventBuffer;
+
+    /** Filled in by processBlock(). */
+    ProcessorStats stats;
 
     /** Updates the number of samples for the current continuous buffer (assumed to be
     the same for all channels).*/
@@ -0,0 +1,139 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Int16Converter.h"
+
+#if defined(__AVX2__)
+ #include <immintrin.h>
+ #define INT16_CONVERTER_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define INT16_CONVERTER_SSE2 1
+#endif
+
+static inline int16 convertSample(float sample, float scale, bool swapBytes)
+{
+    float scaled = jlimit(-32767.0f, 32767.0f, sample * scale);
+    uint16 value = (uint16) (int16) roundToInt(scaled);
+
+    return (int16) (swapBytes ? ByteOrder::swap(value) : value);
+}
+
+static void convert(const float* source, int16* dest, int numSamples, float bitVolts, bool swapBytes)
+{
+
+    const float scale = 1.0f / bitVolts;
+    int n = 0;
+
+#if INT16_CONVERTER_AVX2
+
+    const __m256 scaleVec = _mm256_set1_ps(scale);
+    const __m256 maxVec = _mm256_set1_ps(32767.0f);
+    const __m256 minVec = _mm256_set1_ps(-32767.0f);
+
+    for (; n + 16 <= numSamples; n += 16)
+    {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(source + n), scaleVec);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(source + n + 8), scaleVec);
+
+        a = _mm256_max_ps(_mm256_min_ps(a, maxVec), minVec);
+        b = _mm256_max_ps(_mm256_min_ps(b, maxVec), minVec);
+
+        // packs works within 128-bit lanes, so the quadwords need reordering
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+
+        if (swapBytes)
+            packed = _mm256_or_si256(_mm256_slli_epi16(packed, 8), _mm256_srli_epi16(packed, 8));
+
+        _mm256_storeu_si256((__m256i*) (dest + n), packed);
+    }
+
+#elif INT16_CONVERTER_SSE2
+
+    const __m128 scaleVec = _mm_set1_ps(scale);
+    const __m128 maxVec = _mm_set1_ps(32767.0f);
+    const __m128 minVec = _mm_set1_ps(-32767.0f);
+
+    for (; n + 8 <= numSamples; n += 8)
+    {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(source + n), scaleVec);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(source + n + 4), scaleVec);
+
+        a = _mm_max_ps(_mm_min_ps(a, maxVec), minVec);
+        b = _mm_max_ps(_mm_min_ps(b, maxVec), minVec);
+
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+
+        if (swapBytes)
+            packed = _mm_or_si128(_mm_slli_epi16(packed, 8), _mm_srli_epi16(packed, 8));
+
+        _mm_storeu_si128((__m128i*) (dest + n), packed);
+    }
+
+#endif
+
+    for (; n < numSamples; n++)
+    {
+        dest[n] = convertSample(source[n], scale, swapBytes);
+    }
+
+}
+
+void Int16Converter::convertFloatToInt16BE(const float* source, int16* dest, int numSamples, float bitVolts)
+{
+#if JUCE_LITTLE_ENDIAN
+    convert(source, dest, numSamples, bitVolts, true);
+#else
+    convert(source, dest, numSamples, bitVolts, false);
+#endif
+}
+
+void Int16Converter::convertFloatToInt16LE(const float* source, int16* dest, int numSamples, float bitVolts)
+{
+#if JUCE_LITTLE_ENDIAN
+    convert(source, dest, numSamples, bitVolts, false);
+#else
+    convert(source, dest, numSamples, bitVolts, true);
+#endif
+}
+
+void Int16Converter::convertBlockToInt16BE(const float* const* source, int16* const* dest,
+                                           const float* bitVolts, int numChannels, int numSamples)
+{
+    for (int i = 0; i < numChannels; i++)
+    {
+        convertFloatToInt16BE(source[i], dest[i], numSamples, bitVolts[i]);
+    }
+}
+
+const char* Int16Converter::getInstructionSet()
+{
+#if INT16_CONVERTER_AVX2
+    return "AVX2";
+#elif INT16_CONVERTER_SSE2
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,70 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __INT16CONVERTER_H_94C1E0B7__
+#define __INT16CONVERTER_H_94C1E0B7__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Converts continuous data (in microvolts) back to the int16 values
+  that are saved to disk.
+
+  Each sample is divided by the channel's bitVolts, rounded to the nearest
+  integer and clipped to +/-32767, and (for the big-endian variants) byte-
+  swapped, all in a single pass. This matches the result of scaling by
+  1/(0x7fff * bitVolts) and calling AudioDataConverters::convertFloatToInt16BE,
+  which is what the RecordNode used to do.
+
+  The kernels use AVX2 or SSE2 when the compiler targets them (the Linux
+  build uses -march=native), and fall back to scalar code otherwise.
+
+  @see RecordNode, InterleavedFileWriter
+
+*/
+
+class Int16Converter
+{
+public:
+
+    /** Converts one channel to big-endian int16 (the .continuous format).*/
+    static void convertFloatToInt16BE(const float* source, int16* dest, int numSamples, float bitVolts);
+
+    /** Converts one channel to little-endian int16.*/
+    static void convertFloatToInt16LE(const float* source, int16* dest, int numSamples, float bitVolts);
+
+    /** Converts the same number of samples for several channels in one call.
+
+        dest[i] receives numSamples big-endian values converted from source[i]
+        using bitVolts[i].*/
+    static void convertBlockToInt16BE(const float* const* source, int16* const* dest,
+                                      const float* bitVolts, int numChannels, int numSamples);
+
+    /** Returns the name of the instruction set the kernels were compiled for.*/
+    static const char* getInstructionSet();
+
+};
+
+
+#endif  // __INT16CONVERTER_H_94C1E0B7__
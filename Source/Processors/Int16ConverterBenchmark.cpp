@@ -0,0 +1,176 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+
+  Measures how long it takes to convert continuous data to the int16 values
+  saved by the RecordNode. It compares three ways:
+  - The old one: scale into a float buffer, then
+    AudioDataConverters::convertFloatToInt16BE().
+  - Int16Converter, one channel at a time.
+  - Int16Converter::convertBlockToInt16BE() for all channels at once.
+  It prints the nanoseconds per sample for 64 to 1024 channels.
+
+  This is a standalone program; it is not part of the GUI build. To build it
+  from this directory:
+
+    g++ -O3 -march=native -DLINUX=1 -DNDEBUG=1 -I../../JuceLibraryCode -I/usr/include/freetype2 \
+        Int16ConverterBenchmark.cpp Int16Converter.cpp \
+        ../../JuceLibraryCode/modules/juce_core/juce_core.cpp \
+        ../../JuceLibraryCode/modules/juce_audio_basics/juce_audio_basics.cpp \
+        -o Int16ConverterBenchmark -lpthread -ldl -lrt
+
+  The program also compares the results. Both Int16Converter paths must give
+  the same values. They may differ from the old one by 1 on values that lie
+  right on a rounding boundary, because the old path rounds a rescaled float.
+  The exit code is non-zero if the results differ by more than that.
+
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "Int16Converter.h"
+
+// samples per channel in each call, as in a full record
+#define NUM_SAMPLES 1024
+#define NUM_REPEATS 200
+
+int main()
+{
+
+    Random random(1);
+
+    const float bitVolts = 0.195f;
+
+    bool allMatch = true;
+
+    std::cout << "Int16Converter (" << Int16Converter::getInstructionSet() << "), "
+              << NUM_SAMPLES << " samples per channel, ns per sample:" << std::endl;
+
+    for (int numChannels = 64; numChannels <= 1024; numChannels *= 2)
+    {
+
+        AudioSampleBuffer data(numChannels, NUM_SAMPLES);
+
+        // mostly within range, with some channels that clip
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            float* samples = data.getSampleData(chan);
+            const float range = (chan % 7 == 0) ? 16000.0f : 8000.0f;
+
+            for (int n = 0; n < NUM_SAMPLES; n++)
+                samples[n] = (random.nextFloat() * 2.0f - 1.0f) * range;
+        }
+
+        HeapBlock<float> scaled(NUM_SAMPLES);
+        HeapBlock<int16> oldResult(numChannels * NUM_SAMPLES);
+        HeapBlock<int16> channelResult(numChannels * NUM_SAMPLES);
+        HeapBlock<int16> blockResult(numChannels * NUM_SAMPLES);
+
+        Array<const float*> sources;
+        Array<int16*> destinations;
+        Array<float> bitVoltsArray;
+
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            sources.add(data.getSampleData(chan));
+            destinations.add(blockResult + chan * NUM_SAMPLES);
+            bitVoltsArray.add(bitVolts);
+        }
+
+        const int64 start = Time::getHighResolutionTicks();
+
+        for (int repeat = 0; repeat < NUM_REPEATS; repeat++)
+        {
+            for (int chan = 0; chan < numChannels; chan++)
+            {
+                // what RecordNode::writeContinuousBuffer() used to do
+                const float scaleFactor = float(0x7fff) * bitVolts;
+                const float* samples = data.getSampleData(chan);
+
+                for (int n = 0; n < NUM_SAMPLES; n++)
+                    scaled[n] = samples[n] / scaleFactor;
+
+                AudioDataConverters::convertFloatToInt16BE(scaled, oldResult + chan * NUM_SAMPLES, NUM_SAMPLES);
+            }
+        }
+
+        const int64 afterOld = Time::getHighResolutionTicks();
+
+        for (int repeat = 0; repeat < NUM_REPEATS; repeat++)
+        {
+            for (int chan = 0; chan < numChannels; chan++)
+            {
+                Int16Converter::convertFloatToInt16BE(data.getSampleData(chan),
+                                                      channelResult + chan * NUM_SAMPLES,
+                                                      NUM_SAMPLES, bitVolts);
+            }
+        }
+
+        const int64 afterChannels = Time::getHighResolutionTicks();
+
+        for (int repeat = 0; repeat < NUM_REPEATS; repeat++)
+        {
+            Int16Converter::convertBlockToInt16BE(sources.getRawDataPointer(),
+                                                  destinations.getRawDataPointer(),
+                                                  bitVoltsArray.getRawDataPointer(),
+                                                  numChannels, NUM_SAMPLES);
+        }
+
+        const int64 afterBlock = Time::getHighResolutionTicks();
+
+        int numMismatches = 0;
+        int maxDifference = 0;
+
+        for (int i = 0; i < numChannels * NUM_SAMPLES; i++)
+        {
+            if (channelResult[i] != blockResult[i])
+                allMatch = false;
+
+            // the results are big-endian
+            const int oldValue = (int16) ByteOrder::swapIfLittleEndian((uint16) oldResult[i]);
+            const int newValue = (int16) ByteOrder::swapIfLittleEndian((uint16) channelResult[i]);
+
+            if (oldValue != newValue)
+            {
+                numMismatches++;
+                maxDifference = jmax(maxDifference, std::abs(oldValue - newValue));
+            }
+        }
+
+        allMatch = allMatch && (maxDifference <= 1);
+
+        const double nsPerTick = 1.0e9 / Time::getHighResolutionTicksPerSecond();
+        const double numConverted = double(NUM_REPEATS) * numChannels * NUM_SAMPLES;
+
+        std::cout << "   " << String(numChannels).paddedLeft(' ', 4) << " channels: old "
+                  << (afterOld - start) * nsPerTick / numConverted << ", per channel "
+                  << (afterChannels - afterOld) * nsPerTick / numConverted << ", block "
+                  << (afterBlock - afterChannels) * nsPerTick / numConverted << " ("
+                  << numMismatches << " values differ from the old path, by at most "
+                  << maxDifference << ")" << std::endl;
+
+    }
+
+    return allMatch ? 0 : 1;
+
+}
@@ -0,0 +1,302 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "InterleavedFileWriter.h"
+#include "Channel.h"
+#include "Int16Converter.h"
+
+#if JUCE_LINUX || JUCE_MAC
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// a multiple of the page size (and of the Windows allocation
+// granularity) for any number of channels
+#define FRAMES_PER_CHUNK 65536
+
+#define CONVERTED_BUFFER_SIZE 1024
+
+// size of each write when the space has to be reserved by writing zeros
+#define ZERO_WRITE_SIZE 65536
+
+/** Allocates disk blocks for bytes [start, start + numBytes) of the file, and
+    extends the file to the end of that range, without writing any data.
+    Returns false if the file system can't do this.*/
+static bool allocateFileSpace(FileOutputStream& stream, const File& file, int64 start, int64 numBytes)
+{
+
+    stream.flush();
+
+#if JUCE_LINUX
+
+    const int fd = ::open(file.getFullPathName().toUTF8(), O_WRONLY);
+
+    if (fd == -1)
+        return false;
+
+    const int result = posix_fallocate(fd, (off_t) start, (off_t) numBytes);
+
+    ::close(fd);
+
+    return result == 0;
+
+#elif JUCE_MAC
+
+    const int fd = ::open(file.getFullPathName().toUTF8(), O_WRONLY);
+
+    if (fd == -1)
+        return false;
+
+    // allocates past the end of the blocks already in use, which is
+    // where the previous chunk ends
+    fstore_t store = { F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, (off_t) numBytes, 0 };
+
+    int result = fcntl(fd, F_PREALLOCATE, &store);
+
+    if (result == -1)
+    {
+        store.fst_flags = F_ALLOCATEALL;
+        result = fcntl(fd, F_PREALLOCATE, &store);
+    }
+
+    ::close(fd);
+
+    if (result == -1)
+        return false;
+
+    // F_PREALLOCATE doesn't change the size of the file
+    stream.setPosition(start + numBytes);
+    return stream.truncate().wasOk();
+
+#elif JUCE_WINDOWS
+
+    // NTFS allocates the clusters when a file that isn't sparse is extended
+    stream.setPosition(start + numBytes);
+    return stream.truncate().wasOk();
+
+#else
+
+    return false;
+
+#endif
+
+}
+
+InterleavedFileWriter::InterleavedFileWriter(const String& basename,
+                                             const Array<Channel*>& channels_,
+                                             const Array<int>& channelIndices_)
+    : dataFile(basename + ".dat"), timestampFile(basename + ".timestamps"),
+      channels(channels_), channelIndices(channelIndices_),
+      convertedBuffer(CONVERTED_BUFFER_SIZE),
+      framesInChunk(0), numChunks(0), framesWritten(0), expectedTimestamp(0),
+      writeFailed(false), numDroppedSamples(0)
+{
+    frameBytes = 2 * jmax(channels.size(), 1);
+}
+
+InterleavedFileWriter::~InterleavedFileWriter()
+{
+    close();
+}
+
+bool InterleavedFileWriter::open(const String& header)
+{
+
+    std::cout << "OPENING FILE: " << dataFile.getFullPathName() << std::endl;
+
+    dataFile.deleteFile();
+    timestampFile.deleteFile();
+
+    dataStream = new FileOutputStream(dataFile);
+    timestampStream = new FileOutputStream(timestampFile);
+
+    if (dataStream->failedToOpen() || timestampStream->failedToOpen())
+    {
+        std::cout << "Could not open " << dataFile.getFullPathName() << std::endl;
+        dataStream = nullptr;
+        timestampStream = nullptr;
+        return false;
+    }
+
+    timestampStream->write(header.toUTF8(), header.getNumBytesAsUTF8());
+
+    framesInChunk = 0;
+    numChunks = 0;
+    framesWritten = 0;
+    writeFailed = false;
+    numDroppedSamples = 0;
+
+    return mapNextChunk();
+
+}
+
+bool InterleavedFileWriter::mapNextChunk()
+{
+
+    mappedChunk = nullptr;
+
+    const int64 chunkBytes = int64(FRAMES_PER_CHUNK) * frameBytes;
+    const int64 chunkStart = numChunks * chunkBytes;
+
+    // allocate the disk space for the new region before mapping it, so the
+    // file system doesn't have to find blocks while the pages are written
+    if (!allocateFileSpace(*dataStream, dataFile, chunkStart, chunkBytes))
+    {
+        // writing zeros allocates the space on any file system
+        HeapBlock<char> zeros(ZERO_WRITE_SIZE, true);
+
+        dataStream->setPosition(chunkStart);
+
+        for (int64 bytesWritten = 0; bytesWritten < chunkBytes; bytesWritten += ZERO_WRITE_SIZE)
+        {
+            if (!dataStream->write(zeros, (size_t) jmin(int64(ZERO_WRITE_SIZE), chunkBytes - bytesWritten)))
+            {
+                std::cout << "Could not extend " << dataFile.getFullPathName() << std::endl;
+                return false;
+            }
+        }
+
+        dataStream->flush();
+    }
+
+    mappedChunk = new MemoryMappedFile(dataFile,
+                                       Range<int64>(chunkStart, chunkStart + chunkBytes),
+                                       MemoryMappedFile::readWrite);
+
+    if (mappedChunk->getData() == nullptr)
+    {
+        std::cout << "Could not map " << dataFile.getFullPathName() << std::endl;
+        mappedChunk = nullptr;
+        return false;
+    }
+
+    numChunks++;
+    framesInChunk = 0;
+
+    return true;
+
+}
+
+int InterleavedFileWriter::writeSamples(AudioSampleBuffer& data, int startSample, int nSamples, int64 timestamp)
+{
+
+    if (dataStream == nullptr)
+        return 0;
+
+    if (writeFailed)
+    {
+        numDroppedSamples += nSamples;
+        return 0;
+    }
+
+    if (framesWritten == 0 || timestamp != expectedTimestamp)
+    {
+        timestampStream->writeInt64(timestamp);
+        timestampStream->writeInt64(framesWritten);
+    }
+
+    expectedTimestamp = timestamp + nSamples;
+
+    int samplesWritten = 0;
+
+    while (samplesWritten < nSamples)
+    {
+
+        if (framesInChunk == FRAMES_PER_CHUNK || mappedChunk == nullptr)
+        {
+            if (!mapNextChunk())
+            {
+                // keep the stream, so close() can still truncate the file
+                std::cout << "WARNING: recording to " << dataFile.getFullPathName()
+                          << " stopped after " << framesWritten << " samples." << std::endl;
+
+                writeFailed = true;
+                numDroppedSamples += nSamples - samplesWritten;
+                return samplesWritten;
+            }
+        }
+
+        int numFrames = jmin(nSamples - samplesWritten,
+                             FRAMES_PER_CHUNK - framesInChunk,
+                             CONVERTED_BUFFER_SIZE);
+
+        const int numChannels = channels.size();
+        int16* dest = static_cast<int16*>(mappedChunk->getData()) + framesInChunk * numChannels;
+
+        for (int i = 0; i < numChannels; i++)
+        {
+            int16* channelDest = dest + i;
+
+            if (channels[i]->getRecordState())
+            {
+                // scale the data back into the range of int16
+                Int16Converter::convertFloatToInt16LE(data.getSampleData(channelIndices[i], startSample + samplesWritten),
+                                                      convertedBuffer,
+                                                      numFrames,
+                                                      channels[i]->bitVolts);
+
+                for (int n = 0; n < numFrames; n++)
+                {
+                    channelDest[n * numChannels] = convertedBuffer[n];
+                }
+            }
+            else
+            {
+                for (int n = 0; n < numFrames; n++)
+                {
+                    channelDest[n * numChannels] = 0;
+                }
+            }
+        }
+
+        framesInChunk += numFrames;
+        framesWritten += numFrames;
+        samplesWritten += numFrames;
+
+    }
+
+    return samplesWritten;
+
+}
+
+void InterleavedFileWriter::close()
+{
+
+    if (dataStream == nullptr)
+        return;
+
+    std::cout << "CLOSING FILE: " << dataFile.getFullPathName() << std::endl;
+
+    if (writeFailed)
+        std::cout << numDroppedSamples << " samples could not be written." << std::endl;
+
+    mappedChunk = nullptr;
+
+    // remove the unused part of the last chunk
+    dataStream->setPosition(framesWritten * frameBytes);
+    dataStream->truncate();
+
+    dataStream = nullptr;
+    timestampStream = nullptr;
+
+}
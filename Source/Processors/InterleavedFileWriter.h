@@ -0,0 +1,144 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __INTERLEAVEDFILEWRITER_H_6D2E81B4__
+#define __INTERLEAVEDFILEWRITER_H_6D2E81B4__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+class Channel;
+
+/**
+
+  Writes all recorded channels of one source into a single file.
+
+  Samples are stored as little-endian int16, interleaved sample-major
+  (all channels of sample 0, then all channels of sample 1, and so on),
+  without any header or record markers, so the .dat file can be
+  memory-mapped directly by offline tools.
+
+  The file is grown in pre-allocated chunks of 65536 samples, each of which
+  is memory-mapped while it is being filled; it is truncated to the number
+  of samples actually written when it is closed.
+
+  If a chunk can't be allocated or mapped (e.g., because the disk is full),
+  the writer stops writing samples but keeps the file open, so that close()
+  still truncates it to the samples that were written. The samples that
+  were not written are counted.
+
+  A sidecar .timestamps file starts with a text header (in the same style as
+  the .continuous header, padded to a multiple of 1024 bytes) followed by
+  pairs of int64 values: a timestamp and the sample number at which it applies.
+  An entry is only written at the first sample and whenever the timestamps
+  are not contiguous, e.g. after dropped blocks.
+
+  @see RecordNode
+
+*/
+
+class InterleavedFileWriter
+{
+public:
+
+    /** Creates a writer for the given channels; channelIndices are the
+        corresponding channel numbers in the RecordNode's buffer.*/
+    InterleavedFileWriter(const String& basename,
+                          const Array<Channel*>& channels,
+                          const Array<int>& channelIndices);
+    ~InterleavedFileWriter();
+
+    /** Creates both files and writes the header to the .timestamps file.*/
+    bool open(const String& header);
+
+    /** Appends nSamples samples of all channels. Channels whose record
+        state is off are written as zeros, so the layout never changes.
+
+        Returns the number of samples that were written, which is less than
+        nSamples once the file could not be extended.*/
+    int writeSamples(AudioSampleBuffer& data, int startSample, int nSamples, int64 timestamp);
+
+    /** Unmaps the data file and truncates it to its final size.*/
+    void close();
+
+    /** Returns the number of channels stored in each sample frame.*/
+    int getNumChannels()
+    {
+        return channels.size();
+    }
+
+    /** Returns true if the file could not be extended and samples were lost.*/
+    bool hasFailed()
+    {
+        return writeFailed;
+    }
+
+    /** Returns the number of samples that could not be written.*/
+    int64 getNumDroppedSamples()
+    {
+        return numDroppedSamples;
+    }
+
+    /** Returns the name of the data file. */
+    String getFilename()
+    {
+        return dataFile.getFullPathName();
+    }
+
+private:
+
+    /** Allocates the disk space for one more chunk and maps it into memory.*/
+    bool mapNextChunk();
+
+    File dataFile;
+    File timestampFile;
+
+    Array<Channel*> channels;
+    Array<int> channelIndices;
+
+    ScopedPointer<FileOutputStream> dataStream;
+    ScopedPointer<FileOutputStream> timestampStream;
+    ScopedPointer<MemoryMappedFile> mappedChunk;
+
+    HeapBlock<int16> convertedBuffer;
+
+    /** Number of bytes per sample frame (2 x number of channels).*/
+    int frameBytes;
+
+    /** Number of frames written to the current chunk.*/
+    int framesInChunk;
+
+    int64 numChunks;
+    int64 framesWritten;
+
+    /** Timestamp the next sample would have if there were no gap.*/
+    int64 expectedTimestamp;
+
+    bool writeFailed;
+    int64 numDroppedSamples;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InterleavedFileWriter);
+
+};
+
+
+#endif  // __INTERLEAVEDFILEWRITER_H_6D2E81B4__
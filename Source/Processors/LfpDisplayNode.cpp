@@ -27,7 +27,7 @@
 
 LfpDisplayNode::LfpDisplayNode()
     : GenericProcessor("LFP Viewer"),
-      displayBufferIndex(0), displayGain(1), bufferLength(5.0f),
+      numSamplesWritten(0), displayBufferIndex(0), displayGain(1), bufferLength(5.0f),
       abstractFifo(100), ttlState(0)
 {
     std::cout << " LFPDisplayNodeConstructor" << std::endl;
@@ -72,6 +72,11 @@ bool LfpDisplayNode::resizeBuffer()
     {
         abstractFifo.setTotalSize(nSamples);
         displayBuffer->setSize(nInputs+1, nSamples); // add an extra channel for TTLs
+        envelope.setBuffer(displayBuffer, nInputs);
+
+        numSamplesWritten = 0;
+        displayBufferIndex = 0;
+
         return true;
     }
     else
@@ -272,6 +277,8 @@ void LfpDisplayNode::process(AudioSampleBuffer& buffer, MidiBuffer& events, int&
     totalSamples = nSamples;
     displayBufferIndexEvents = displayBufferIndex;
 
+    const int blockStart = displayBufferIndex;
+
     initializeEventChannel();
 
     checkForEvents(events); // update timestamp, see if we got any TTL events
@@ -319,6 +326,21 @@ void LfpDisplayNode::process(AudioSampleBuffer& buffer, MidiBuffer& events, int&
         displayBufferIndex = extraSamples;
     }
 
+    // 2. update the envelope of the new samples, including the events
+    const int firstPart = jmin(nSamples, displayBuffer->getNumSamples() - blockStart);
+
+    envelope.update(blockStart, firstPart);
+    envelope.update(0, nSamples - firstPart);
+
+    // 3. let the canvas know it can read up to here
+    numSamplesWritten += nSamples;
+
+    DisplayBlock block;
+    block.sampleNumber = numSamplesWritten;
+    block.bufferIndex = displayBufferIndex;
+
+    displayChannel.push(block);
+
 
 
 }
@@ -28,6 +28,8 @@
 #include "Editors/LfpDisplayEditor.h"
 #include "Editors/VisualizerEditor.h"
 #include "GenericProcessor.h"
+#include "Visualization/EnvelopePyramid.h"
+#include "Visualization/SnapshotChannel.h"
 
 class DataViewport;
 
@@ -36,6 +38,10 @@ class DataViewport;
   Holds data in a displayBuffer to be used by the LfpDisplayCanvas
   for rendering continuous data streams.
 
+  After each block, the write position is published through a
+  SnapshotChannel; the canvas only reads samples behind the last position
+  it received, so it never touches the part being written.
+
   @see GenericProcessor, LfpDisplayEditor, LfpDisplayCanvas
 
 */
@@ -66,13 +72,30 @@ public:
 
     void handleEvent(int, MidiMessage&, int);
 
+    /** Where the next block will be written, published after each block.*/
+    struct DisplayBlock
+    {
+        int64 sampleNumber; // samples written since the buffer was resized
+        int bufferIndex;    // position in the displayBuffer
+    };
+
     AudioSampleBuffer* getDisplayBufferAddress()
     {
         return displayBuffer;
     }
-    int getDisplayBufferIndex()
+
+    /** Returns the channel through which the write position is passed to
+        the canvas.*/
+    SnapshotChannel<DisplayBlock>* getDisplayChannel()
     {
-        return displayBufferIndex;
+        return &displayChannel;
+    }
+
+    /** Returns the min/max envelope of the displayBuffer, which is kept up to
+        date by process(). */
+    EnvelopePyramid* getEnvelopeAddress()
+    {
+        return &envelope;
     }
 
 private:
@@ -82,6 +105,11 @@ private:
     ScopedPointer<AudioSampleBuffer> displayBuffer;
     ScopedPointer<MidiBuffer> eventBuffer;
 
+    EnvelopePyramid envelope;
+
+    SnapshotChannel<DisplayBlock> displayChannel;
+    int64 numSamplesWritten;
+
     int displayBufferIndex;
     int displayBufferIndexEvents;
 
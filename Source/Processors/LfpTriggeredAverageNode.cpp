@@ -25,22 +25,24 @@
 #include "Visualization/LfpTriggeredAverageCanvas.h"
 #include <stdio.h>
 
+// triggers that can wait for the end of their window at the same time
+static const int maxPendingTriggers = 256;
+
 LfpTriggeredAverageNode::LfpTriggeredAverageNode()
     : GenericProcessor("LFP Trig. Avg."),
-      displayBufferIndex(0), displayGain(1), bufferLength(5.0f),
-      abstractFifo(100), ttlState(0)
+      historyBuffer(1, 1), historyIndex(0), numSamplesReceived(0),
+      triggerMask(1), preWindowMs(100.0f), postWindowMs(400.0f),
+      preWindowSamples(0), postWindowSamples(0), numDroppedTriggers(0)
 {
     std::cout << " LfpTriggeredAverageNode Constructor" << std::endl;
-    displayBuffer = new AudioSampleBuffer(8, 100);
-    eventBuffer = new MidiBuffer();
-
-    arrayOfOnes = new float[5000];
 
-    for (int n = 0; n < 5000; n++)
+    for (int i = 0; i < 8; i++)
     {
-        arrayOfOnes[n] = 1;
+        averages.add(nullptr);
     }
 
+    pendingTriggers.ensureStorageAllocated(maxPendingTriggers);
+
 }
 
 LfpTriggeredAverageNode::~LfpTriggeredAverageNode()
@@ -61,44 +63,50 @@ void LfpTriggeredAverageNode::updateSettings()
     std::cout << "Setting num inputs on LfpTriggeredAverageNode to " << getNumInputs() << std::endl;
 }
 
-bool LfpTriggeredAverageNode::resizeBuffer()
+bool LfpTriggeredAverageNode::enable()
 {
-    int nSamples = (int) getSampleRate()*bufferLength;
+
     int nInputs = getNumInputs();
+    int historySize = (int) (getSampleRate() * (maxPreWindowMs + maxPostWindowMs + 1000) / 1000.0f);
 
-    std::cout << "Resizing buffer. Samples: " << nSamples << ", Inputs: " << nInputs << std::endl;
+    std::cout << "Resizing history buffer. Samples: " << historySize << ", Inputs: " << nInputs << std::endl;
 
-    if (nSamples > 0 && nInputs > 0)
-    {
-        abstractFifo.setTotalSize(nSamples);
-        displayBuffer->setSize(nInputs+1, nSamples); // add an extra channel for TTLs
-        return true;
-    }
-    else
-    {
+    if (historySize <= 0 || nInputs <= 0)
         return false;
-    }
 
-}
+    historyBuffer.setSize(nInputs, historySize);
+    historyBuffer.clear();
+    historyIndex = 0;
+    numSamplesReceived = 0;
 
-bool LfpTriggeredAverageNode::enable()
-{
+    pendingTriggers.clearQuick();
+    numDroppedTriggers = 0;
 
-    if (resizeBuffer())
-    {
-        LfpTriggeredAverageEditor* editor = (LfpTriggeredAverageEditor*) getEditor();
-        editor->enable();
-        return true;
-    }
-    else
     {
-        return false;
+        const ScopedLock sl(averageLock);
+
+        updateAverages();
+
+        for (int i = 0; i < averages.size(); i++)
+        {
+            if (averages[i] != nullptr)
+                averages[i]->reset();
+        }
     }
 
+    std::cout << "Averaging with " << TriggeredAverage::getInstructionSet() << std::endl;
+
+    LfpTriggeredAverageEditor* editor = (LfpTriggeredAverageEditor*) getEditor();
+    editor->enable();
+    return true;
+
 }
 
 bool LfpTriggeredAverageNode::disable()
 {
+    if (numDroppedTriggers > 0)
+        std::cout << numDroppedTriggers << " triggers could not be averaged." << std::endl;
+
     LfpTriggeredAverageEditor* editor = (LfpTriggeredAverageEditor*) getEditor();
     editor->disable();
     return true;
@@ -119,207 +127,202 @@ void LfpTriggeredAverageNode::setParameter(int parameterIndex, float newValue)
         ed->canvas->setParameter(parameterIndex, newValue);
 }
 
-void LfpTriggeredAverageNode::handleEvent(int eventType, MidiMessage& event, int sampleNum)
+void LfpTriggeredAverageNode::updateAverages()
 {
-    if (eventType == TTL)
-    {
-        const uint8* dataptr = event.getRawData();
-
-        // int eventNodeId = *(dataptr+1);
-        int eventId = *(dataptr+2);
-        int eventChannel = *(dataptr+3);
-        int eventTime = event.getTimeStamp();
-
-        int samplesLeft = totalSamples - eventTime;
+    preWindowSamples = roundFloatToInt(preWindowMs / 1000.0f * getSampleRate());
+    postWindowSamples = roundFloatToInt(postWindowMs / 1000.0f * getSampleRate());
 
-        //	std::cout << "Received event from " << eventNodeId << ", channel "
-        //	          << eventChannel << ", with ID " << eventId << std::endl;
-        //
-        int bufferIndex = (displayBufferIndex + eventTime);// % displayBuffer->getNumSamples();
-
-        if (eventId == 1)
-        {
-            ttlState |= (1L << eventChannel);
-        }
-        else
-        {
-            ttlState &= ~(1L << eventChannel);
-        }
+    const int windowLength = preWindowSamples + postWindowSamples;
 
-        if (samplesLeft + bufferIndex < displayBuffer->getNumSamples())
+    for (int i = 0; i < averages.size(); i++)
+    {
+        if (triggerMask & (1 << i))
         {
+            if (averages[i] == nullptr)
+                averages.set(i, new TriggeredAverage());
 
-            //	std::cout << bufferIndex << " " << samplesLeft << " " << ttlState << std::endl;
-
-            displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                    bufferIndex,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    samplesLeft, 		// numSamples
-                                    float(ttlState));   // gain
+            if (averages[i]->getNumChannels() != getNumInputs() ||
+                averages[i]->getNumSamples() != windowLength)
+                averages[i]->setSize(getNumInputs(), windowLength);
         }
         else
         {
+            averages.set(i, nullptr);
+        }
+    }
+}
 
-            int block2Size = (samplesLeft + bufferIndex) % displayBuffer->getNumSamples();
-            int block1Size = samplesLeft - block2Size;
-
-            //std::cout << "OVERFLOW." << std::endl;
-
-            //std::cout << bufferIndex << " " << block1Size << " " << ttlState << std::endl;
+void LfpTriggeredAverageNode::setWindow(float preMs, float postMs)
+{
+    const ScopedLock sl(averageLock);
 
-            displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                    bufferIndex,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    block1Size, 		// numSamples
-                                    float(ttlState));   // gain
+    preWindowMs = jlimit(0.0f, (float) maxPreWindowMs, preMs);
+    postWindowMs = jlimit(1.0f, (float) maxPostWindowMs, postMs);
 
-            //std::cout << 0 << " " << block2Size << " " << ttlState << std::endl;
+    updateAverages();
 
-            displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                    0,		// destStartSample
-                                    arrayOfOnes, 		// source
-                                    block2Size, 		// numSamples
-                                    float(ttlState));   // gain
+    for (int i = 0; i < averages.size(); i++)
+    {
+        if (averages[i] != nullptr)
+            averages[i]->reset();
+    }
+}
 
+void LfpTriggeredAverageNode::setTriggerChannel(int channel, bool isTrigger)
+{
+    if (channel < 0 || channel >= 8)
+        return;
 
-        }
+    const ScopedLock sl(averageLock);
 
+    if (isTrigger)
+        triggerMask |= (1 << channel);
+    else
+        triggerMask &= ~(1 << channel);
 
-        // 	std::cout << "ttlState: " << ttlState << std::endl;
+    updateAverages();
+}
 
-        // std::cout << "Received event from " << eventNodeId <<
-        //              " on channel " << eventChannel <<
-        //             " with value " << eventId <<
-        //             " at timestamp " << event.getTimeStamp() << std::endl;
+bool LfpTriggeredAverageNode::isTriggerChannel(int channel)
+{
+    return channel >= 0 && channel < 8 && (triggerMask & (1 << channel));
+}
 
+void LfpTriggeredAverageNode::resetAverages()
+{
+    const ScopedLock sl(averageLock);
 
-    }
-    else if (eventType == TIMESTAMP)
+    for (int i = 0; i < averages.size(); i++)
     {
+        if (averages[i] != nullptr)
+            averages[i]->reset();
+    }
+}
 
-        const uint8* dataptr = event.getRawData();
-
-        // int eventNodeId = *(dataptr+1);
-        // int eventId = *(dataptr+2);
-        // int eventChannel = *(dataptr+3);
+int LfpTriggeredAverageNode::getAverage(int triggerChannel, int numPoints,
+                                        AudioSampleBuffer& mean, AudioSampleBuffer& error)
+{
+    const ScopedLock sl(averageLock);
 
-        // update the timestamp for the current buffer:
-        memcpy(&bufferTimestamp, dataptr+4, 4);
+    TriggeredAverage* average = averages[triggerChannel];
 
+    if (average == nullptr || average->getNumTrials() == 0)
+        return 0;
 
+    const int numChannels = jmin(average->getNumChannels(), mean.getNumChannels(), error.getNumChannels());
+    const int windowLength = average->getNumSamples();
 
-        //   	double timeInSeconds = double(ts)/Time::getHighResolutionTicksPerSecond();
-        //   	//int64 timestamp = ts[0] << 32 +
-        //   	//				  ts[1] << 16 +
-        //   	//				  ts[2] << 8 +
-        //   	//				  ts[3];
-        //   	//memcpy(ts, dataptr+4, 1);
+    numPoints = jmin(numPoints, mean.getNumSamples(), error.getNumSamples());
 
-        //   	std::cout << "Time in seconds is " << timeInSeconds << std::endl;
+    for (int ch = 0; ch < numChannels; ch++)
+    {
+        for (int i = 0; i < numPoints; i++)
+        {
+            // each point covers its share of the window
+            const int start = (int) ((int64) i * windowLength / numPoints);
+            const int end = (int) ((int64) (i + 1) * windowLength / numPoints);
 
-        // // std::cout << "Received event from " << eventNodeId <<
-        //    	//              " on channel " << eventChannel <<
-        //    	 //             " with value " << eventId <<
-        //    	 //             " for time: " << ts << std::endl;
+            average->getMeanAndError(ch, start, jmax(1, end - start),
+                                     *mean.getSampleData(ch, i),
+                                     *error.getSampleData(ch, i));
+        }
     }
+
+    return average->getNumTrials();
 }
 
-void LfpTriggeredAverageNode::initializeEventChannel()
+int LfpTriggeredAverageNode::getNumTrials(int triggerChannel)
 {
-    if (displayBufferIndex + totalSamples < displayBuffer->getNumSamples())
-    {
+    // averages are only created and deleted on the message thread
+    TriggeredAverage* average = averages[triggerChannel];
 
-        //	std::cout << getNumInputs()+1 << " " << displayBufferIndex << " " << totalSamples << " " << ttlState << std::endl;
-        //
-        displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                displayBufferIndex,		// destStartSample
-                                arrayOfOnes, 		// source
-                                totalSamples, 		// numSamples
-                                float(ttlState));   // gain
-    }
-    else
-    {
-
-        int block2Size = (displayBufferIndex + totalSamples) % displayBuffer->getNumSamples();
-        int block1Size = totalSamples - block2Size;
+    return average != nullptr ? average->getNumTrials() : 0;
+}
 
-        // std::cout << "OVERFLOW." << std::endl;
+void LfpTriggeredAverageNode::addPendingTriggers()
+{
+    const ScopedTryLock stl(averageLock);
 
-        // std::cout << bufferIndex << " " << block1Size << " " << ttlState << std::endl;
+    if (!stl.isLocked())
+        return; // the canvas is reading the averages; try again next block
 
-        displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                displayBufferIndex,		// destStartSample
-                                arrayOfOnes, 		// source
-                                block1Size, 		// numSamples
-                                float(ttlState));   // gain
-        // std::cout << 0 << " " << block2Size << " " << ttlState << std::endl;
+    const int historySize = historyBuffer.getNumSamples();
+    int numWaiting = 0;
 
-        displayBuffer->copyFrom(displayBuffer->getNumChannels()-1,  // destChannel
-                                0,		// destStartSample
-                                arrayOfOnes, 		// source
-                                block2Size, 		// numSamples
-                                float(ttlState));   // gain
+    for (int i = 0; i < pendingTriggers.size(); i++)
+    {
+        const PendingTrigger trigger = pendingTriggers.getUnchecked(i);
+        TriggeredAverage* average = averages[trigger.channel];
 
+        const int64 windowStart = trigger.sampleNumber - preWindowSamples;
+        const int64 windowEnd = trigger.sampleNumber + postWindowSamples;
 
+        if (average == nullptr)
+        {
+            continue; // no longer a trigger channel
+        }
+        else if (windowEnd > numSamplesReceived)
+        {
+            pendingTriggers.setUnchecked(numWaiting++, trigger); // keep waiting
+        }
+        else if (windowStart < 0 || windowStart < numSamplesReceived - historySize)
+        {
+            numDroppedTriggers++; // starts before acquisition, or overwritten
+        }
+        else
+        {
+            average->addTrial(historyBuffer,
+                              historyIndex - (int) (numSamplesReceived - windowStart));
+        }
     }
+
+    pendingTriggers.removeRange(numWaiting, pendingTriggers.size() - numWaiting);
 }
 
 void LfpTriggeredAverageNode::process(AudioSampleBuffer& buffer, MidiBuffer& events, int& nSamples)
 {
-    // 1. place any new samples into the displayBuffer
-    //std::cout << "Display node sample count: " << nSamples << std::endl; ///buffer.getNumSamples() << std::endl;
-
-    totalSamples = nSamples;
-    displayBufferIndexEvents = displayBufferIndex;
+    // 1. note the rising edges on the trigger channels
+    EventArena::Reader ttls(getIncomingEvents(), events, TTL);
+    EventArena::Event event;
 
-    initializeEventChannel();
-
-    checkForEvents(events); // update timestamp, see if we got any TTL events
-
-    int samplesLeft = displayBuffer->getNumSamples() - displayBufferIndex;
-
-    if (nSamples < samplesLeft)
+    while (ttls.getNextEvent(event))
     {
+        const int eventChannel = EventArena::getEventChannel(event);
 
-        for (int chan = 0; chan < buffer.getNumChannels(); chan++)
+        if (EventArena::getEventId(event) == 1 && isTriggerChannel(eventChannel))
         {
-            displayBuffer->copyFrom(chan,  			// destChannel
-                                    displayBufferIndex, // destStartSample
-                                    buffer, 			// source
-                                    chan, 				// source channel
-                                    0,					// source start sample
-                                    nSamples); 			// numSamples
-
+            if (pendingTriggers.size() < maxPendingTriggers)
+            {
+                PendingTrigger trigger;
+                trigger.sampleNumber = numSamplesReceived + event.sampleNum;
+                trigger.channel = eventChannel;
+
+                pendingTriggers.add(trigger);
+            }
+            else
+            {
+                numDroppedTriggers++;
+            }
         }
-        displayBufferIndex += (nSamples);
-
     }
-    else
-    {
 
-        int extraSamples = nSamples - samplesLeft;
+    // 2. place the new samples into the history buffer
+    const int historySize = historyBuffer.getNumSamples();
+    const int firstPart = jmin(nSamples, historySize - historyIndex);
 
-        for (int chan = 0; chan < buffer.getNumChannels(); chan++)
-        {
-            displayBuffer->copyFrom(chan,  				// destChannel
-                                    displayBufferIndex, // destStartSample
-                                    buffer, 			// source
-                                    chan, 				// source channel
-                                    0,					// source start sample
-                                    samplesLeft); 		// numSamples
-
-            displayBuffer->copyFrom(chan,
-                                    0,
-                                    buffer,
-                                    chan,
-                                    samplesLeft,
-                                    extraSamples);
-        }
+    for (int chan = 0; chan < jmin(buffer.getNumChannels(), historyBuffer.getNumChannels()); chan++)
+    {
+        historyBuffer.copyFrom(chan, historyIndex, buffer, chan, 0, firstPart);
 
-        displayBufferIndex = extraSamples;
+        if (firstPart < nSamples)
+            historyBuffer.copyFrom(chan, 0, buffer, chan, firstPart, nSamples - firstPart);
     }
 
+    historyIndex = (historyIndex + nSamples) % historySize;
+    numSamplesReceived += nSamples;
 
+    // 3. average the triggers whose window is complete
+    if (pendingTriggers.size() > 0)
+        addPendingTriggers();
 
 }
-
@@ -1,26 +1,3 @@
-/*
-    ------------------------------------------------------------------
-
-    This file is part of the Open Ephys GUI
-    Copyright (C) 2013 Open Ephys
-
-    ------------------------------------------------------------------
-
-    This program is free software: you can redistribute it and/or modify
-    it under the terms of the GNU General Public License as published by
-    the Free Software Foundation, either version 3 of the License, or
-    (at your option) any later version.
-
-    This program is distributed in the hope that it will be useful,
-    but WITHOUT ANY WARRANTY; without even the implied warranty of
-    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-    GNU General Public License for more details.
-
-    You should have received a copy of the GNU General Public License
-    along with this program.  If not, see <http://www.gnu.org/licenses/>.
-
-*/
-
 #ifndef __LFPTRIGAVGNODE_H_D969A379__
 #define __LFPTRIGAVGNODE_H_D969A379__
 
@@ -28,6 +5,7 @@
 #include "Editors/LfpTriggeredAverageEditor.h"
 #include "Editors/VisualizerEditor.h"
 #include "GenericProcessor.h"
+#include "TriggeredAverage.h"
 
 class DataViewport;
 
@@ -35,7 +13,17 @@ class DataViewport;
 
   Displays the average of a continuous signal, triggered on a certain event channel.
 
-  @see GenericProcessor, LfpTriggeredAverageEditor, LfpDisplayCanvas
+  For each selected TTL channel, a TriggeredAverage of all inputs is kept
+  over a window from getPreWindowMs() before to getPostWindowMs() after the
+  rising edges. Incoming samples go into a circular history buffer; a
+  trigger is added to its average as soon as the end of its window has
+  arrived, so the average is updated while acquisition is running.
+
+  The averages are guarded by a lock that the canvas holds while it copies
+  them; process() only tries to take it, and keeps the triggers that could
+  not be added for the next block.
+
+  @see GenericProcessor, LfpTriggeredAverageEditor, LfpTriggeredAverageCanvas
 
 */
 
@@ -63,40 +51,84 @@ public:
     bool enable();
     bool disable();
 
-    void handleEvent(int, MidiMessage&, int);
+    /** Sets the part of the signal that is averaged around each trigger.
+        Clears the averages.*/
+    void setWindow(float preMs, float postMs);
+
+    float getPreWindowMs()
+    {
+        return preWindowMs;
+    }
 
-    AudioSampleBuffer* getDisplayBufferAddress()
+    float getPostWindowMs()
     {
-        return displayBuffer;
+        return postWindowMs;
     }
-    int getDisplayBufferIndex()
+
+    /** Starts or stops averaging on one of the 8 TTL channels.*/
+    void setTriggerChannel(int channel, bool isTrigger);
+
+    bool isTriggerChannel(int channel);
+
+    /** Forgets all trials of all channels.*/
+    void resetAverages();
+
+    /** Fills mean and error (the SEM) with numPoints values across the
+        window for every input, from the average triggered on a TTL channel.
+        Returns the number of trials, or 0 if there is no such average.*/
+    int getAverage(int triggerChannel, int numPoints,
+                   AudioSampleBuffer& mean, AudioSampleBuffer& error);
+
+    /** Returns the number of trials averaged on a TTL channel so far, so the
+        display knows when to call getAverage() again.*/
+    int getNumTrials(int triggerChannel);
+
+    /** Returns the number of triggers that could not be averaged, because
+        too many were waiting or their samples had been overwritten.*/
+    int getNumDroppedTriggers()
     {
-        return displayBufferIndex;
+        return numDroppedTriggers;
     }
 
+    static const int maxPreWindowMs = 500;
+    static const int maxPostWindowMs = 1000;
+
 private:
 
-    void initializeEventChannel();
+    struct PendingTrigger
+    {
+        int64 sampleNumber;
+        int channel;
+    };
+
+    /** Resizes the averages for the current window and inputs; the lock
+        must be held.*/
+    void updateAverages();
 
-    ScopedPointer<AudioSampleBuffer> displayBuffer;
-    ScopedPointer<MidiBuffer> eventBuffer;
+    /** Adds the triggers whose window has arrived to their averages.*/
+    void addPendingTriggers();
 
-    int displayBufferIndex;
-    int displayBufferIndexEvents;
+    /** Inputs of the last few seconds, long enough for the largest window
+        plus a second for triggers that have to wait.*/
+    AudioSampleBuffer historyBuffer;
+    int historyIndex;
+    int64 numSamplesReceived;
 
-    float displayGain; //
-    float bufferLength; // s
+    /** One average per TTL channel, or 0 if the channel is not a trigger.*/
+    OwnedArray<TriggeredAverage> averages;
 
-    AbstractFifo abstractFifo;
+    /** Bit i is set if TTL channel i is a trigger; read by process(). */
+    int triggerMask;
 
-    int64 bufferTimestamp;
-    int ttlState;
-    float* arrayOfOnes;
-    int totalSamples;
+    float preWindowMs;
+    float postWindowMs;
+    int preWindowSamples;
+    int postWindowSamples;
 
-    //Time timer;
+    Array<PendingTrigger> pendingTriggers;
+    int numDroppedTriggers;
 
-    bool resizeBuffer();
+    CriticalSection averageLock;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LfpTriggeredAverageNode);
 
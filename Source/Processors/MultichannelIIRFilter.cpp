@@ -0,0 +1,616 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "MultichannelIIRFilter.h"
+
+#if defined(__AVX__)
+ #include <immintrin.h>
+ #define IIR_FILTER_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define IIR_FILTER_SSE2 1
+#endif
+
+// samples of one group that are filtered in one pass
+#define CHUNK_SIZE 128
+
+// registers per group; two independent recursions hide the latency
+// of the feedback path
+#define VECTORS_PER_GROUP 2
+
+#define NUM_COEFFICIENTS 5
+
+namespace
+{
+
+/** The handful of vector operations the kernel needs, for each sample type.
+
+    transposeIn() copies a tile of width channels x width samples from the
+    channel arrays into width rows of the group buffer (row n holding sample
+    n of each channel); transposeOut() copies it back.*/
+template <typename SampleType>
+struct SimdOps
+{
+    typedef SampleType Vec;
+    enum { width = 1 };
+
+    static Vec load(const SampleType* p) { return *p; }
+    static void store(SampleType* p, Vec v) { *p = v; }
+    static Vec set1(SampleType x) { return x; }
+    static Vec add(Vec a, Vec b) { return a + b; }
+    static Vec sub(Vec a, Vec b) { return a - b; }
+    static Vec mul(Vec a, Vec b) { return a * b; }
+
+    static void transposeIn(const float* const* source, int offset, SampleType* dest, int stride)
+    {
+        *dest = (SampleType) source[0][offset];
+    }
+
+    static void transposeOut(const SampleType* source, int stride, float* const* dest, int offset)
+    {
+        dest[0][offset] = (float) *source;
+    }
+};
+
+#if IIR_FILTER_AVX
+
+static inline void transpose8x8(__m256* r)
+{
+    __m256 t[8], u[8];
+
+    for (int i = 0; i < 8; i += 2)
+    {
+        t[i] = _mm256_unpacklo_ps(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_ps(r[i], r[i + 1]);
+    }
+
+    for (int i = 0; i < 8; i += 4)
+    {
+        u[i] = _mm256_shuffle_ps(t[i], t[i + 2], 0x44);
+        u[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], 0xEE);
+        u[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], 0x44);
+        u[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], 0xEE);
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        r[i] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x20);
+        r[i + 4] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x31);
+    }
+}
+
+static inline void transpose4x4(__m256d* r)
+{
+    __m256d t0 = _mm256_unpacklo_pd(r[0], r[1]);
+    __m256d t1 = _mm256_unpackhi_pd(r[0], r[1]);
+    __m256d t2 = _mm256_unpacklo_pd(r[2], r[3]);
+    __m256d t3 = _mm256_unpackhi_pd(r[2], r[3]);
+
+    r[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+    r[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+    r[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+    r[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+template <>
+struct SimdOps<float>
+{
+    typedef __m256 Vec;
+    enum { width = 8 };
+
+    static Vec load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+    static Vec set1(float x) { return _mm256_set1_ps(x); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+
+    static void transposeIn(const float* const* source, int offset, float* dest, int stride)
+    {
+        __m256 r[8];
+
+        for (int i = 0; i < 8; i++)
+            r[i] = _mm256_loadu_ps(source[i] + offset);
+
+        transpose8x8(r);
+
+        for (int i = 0; i < 8; i++)
+            _mm256_storeu_ps(dest + i * stride, r[i]);
+    }
+
+    static void transposeOut(const float* source, int stride, float* const* dest, int offset)
+    {
+        __m256 r[8];
+
+        for (int i = 0; i < 8; i++)
+            r[i] = _mm256_loadu_ps(source + i * stride);
+
+        transpose8x8(r);
+
+        for (int i = 0; i < 8; i++)
+            _mm256_storeu_ps(dest[i] + offset, r[i]);
+    }
+};
+
+template <>
+struct SimdOps<double>
+{
+    typedef __m256d Vec;
+    enum { width = 4 };
+
+    static Vec load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, Vec v) { _mm256_storeu_pd(p, v); }
+    static Vec set1(double x) { return _mm256_set1_pd(x); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+
+    static void transposeIn(const float* const* source, int offset, double* dest, int stride)
+    {
+        __m256d r[4];
+
+        for (int i = 0; i < 4; i++)
+            r[i] = _mm256_cvtps_pd(_mm_loadu_ps(source[i] + offset));
+
+        transpose4x4(r);
+
+        for (int i = 0; i < 4; i++)
+            _mm256_storeu_pd(dest + i * stride, r[i]);
+    }
+
+    static void transposeOut(const double* source, int stride, float* const* dest, int offset)
+    {
+        __m256d r[4];
+
+        for (int i = 0; i < 4; i++)
+            r[i] = _mm256_loadu_pd(source + i * stride);
+
+        transpose4x4(r);
+
+        for (int i = 0; i < 4; i++)
+            _mm_storeu_ps(dest[i] + offset, _mm256_cvtpd_ps(r[i]));
+    }
+};
+
+#elif IIR_FILTER_SSE2
+
+template <>
+struct SimdOps<float>
+{
+    typedef __m128 Vec;
+    enum { width = 4 };
+
+    static Vec load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+    static Vec set1(float x) { return _mm_set1_ps(x); }
+    static Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+
+    static void transposeIn(const float* const* source, int offset, float* dest, int stride)
+    {
+        __m128 r0 = _mm_loadu_ps(source[0] + offset);
+        __m128 r1 = _mm_loadu_ps(source[1] + offset);
+        __m128 r2 = _mm_loadu_ps(source[2] + offset);
+        __m128 r3 = _mm_loadu_ps(source[3] + offset);
+
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        _mm_storeu_ps(dest, r0);
+        _mm_storeu_ps(dest + stride, r1);
+        _mm_storeu_ps(dest + 2 * stride, r2);
+        _mm_storeu_ps(dest + 3 * stride, r3);
+    }
+
+    static void transposeOut(const float* source, int stride, float* const* dest, int offset)
+    {
+        __m128 r0 = _mm_loadu_ps(source);
+        __m128 r1 = _mm_loadu_ps(source + stride);
+        __m128 r2 = _mm_loadu_ps(source + 2 * stride);
+        __m128 r3 = _mm_loadu_ps(source + 3 * stride);
+
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        _mm_storeu_ps(dest[0] + offset, r0);
+        _mm_storeu_ps(dest[1] + offset, r1);
+        _mm_storeu_ps(dest[2] + offset, r2);
+        _mm_storeu_ps(dest[3] + offset, r3);
+    }
+};
+
+template <>
+struct SimdOps<double>
+{
+    typedef __m128d Vec;
+    enum { width = 2 };
+
+    static Vec load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, Vec v) { _mm_storeu_pd(p, v); }
+    static Vec set1(double x) { return _mm_set1_pd(x); }
+    static Vec add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm_sub_pd(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+
+    static void transposeIn(const float* const* source, int offset, double* dest, int stride)
+    {
+        dest[0] = source[0][offset];
+        dest[1] = source[1][offset];
+        dest[stride] = source[0][offset + 1];
+        dest[stride + 1] = source[1][offset + 1];
+    }
+
+    static void transposeOut(const double* source, int stride, float* const* dest, int offset)
+    {
+        dest[0][offset] = (float) source[0];
+        dest[1][offset] = (float) source[1];
+        dest[0][offset + 1] = (float) source[stride];
+        dest[1][offset + 1] = (float) source[stride + 1];
+    }
+};
+
+#endif
+
+/** Copies numSamples samples of numChannels channels, starting at sample
+    start, into the rows of a group buffer.*/
+template <typename SampleType>
+void copyToGroup(const float* const* source, int numChannels, int start, int numSamples,
+                 SampleType* dest, int groupSize)
+{
+    typedef SimdOps<SampleType> Ops;
+    const int width = Ops::width;
+
+    int i = 0;
+
+    for (; i + width <= numChannels; i += width)
+    {
+        int n = 0;
+
+        for (; n + width <= numSamples; n += width)
+            Ops::transposeIn(source + i, start + n, dest + n * groupSize + i, groupSize);
+
+        for (; n < numSamples; n++)
+            for (int k = 0; k < width; k++)
+                dest[n * groupSize + i + k] = (SampleType) source[i + k][start + n];
+    }
+
+    for (; i < numChannels; i++)
+        for (int n = 0; n < numSamples; n++)
+            dest[n * groupSize + i] = (SampleType) source[i][start + n];
+}
+
+/** The reverse of copyToGroup().*/
+template <typename SampleType>
+void copyFromGroup(const SampleType* source, int groupSize,
+                   float* const* dest, int numChannels, int start, int numSamples)
+{
+    typedef SimdOps<SampleType> Ops;
+    const int width = Ops::width;
+
+    int i = 0;
+
+    for (; i + width <= numChannels; i += width)
+    {
+        int n = 0;
+
+        for (; n + width <= numSamples; n += width)
+            Ops::transposeOut(source + n * groupSize + i, groupSize, dest + i, start + n);
+
+        for (; n < numSamples; n++)
+            for (int k = 0; k < width; k++)
+                dest[i + k][start + n] = (float) source[n * groupSize + i + k];
+    }
+
+    for (; i < numChannels; i++)
+        for (int n = 0; n < numSamples; n++)
+            dest[i][start + n] = (float) source[n * groupSize + i];
+}
+
+/** Runs one biquad stage over a chunk of one group.
+
+    data holds numSamples rows of groupSize samples, coefficients holds the
+    rows b0, b1, b2, a1, a2 and state the rows v[-1], v[-2].*/
+template <typename SampleType>
+void processStage(SampleType* data, int numSamples,
+                  const SampleType* coefficients, SampleType* state,
+                  SampleType antiDenormal)
+{
+    typedef SimdOps<SampleType> Ops;
+    typedef typename Ops::Vec Vec;
+
+    const int width = Ops::width;
+    const int groupSize = width * VECTORS_PER_GROUP;
+
+    Vec b0[VECTORS_PER_GROUP], b1[VECTORS_PER_GROUP], b2[VECTORS_PER_GROUP];
+    Vec a1[VECTORS_PER_GROUP], a2[VECTORS_PER_GROUP];
+    Vec v1[VECTORS_PER_GROUP], v2[VECTORS_PER_GROUP];
+
+    for (int v = 0; v < VECTORS_PER_GROUP; v++)
+    {
+        b0[v] = Ops::load(coefficients + v * width);
+        b1[v] = Ops::load(coefficients + groupSize + v * width);
+        b2[v] = Ops::load(coefficients + 2 * groupSize + v * width);
+        a1[v] = Ops::load(coefficients + 3 * groupSize + v * width);
+        a2[v] = Ops::load(coefficients + 4 * groupSize + v * width);
+        v1[v] = Ops::load(state + v * width);
+        v2[v] = Ops::load(state + groupSize + v * width);
+    }
+
+    Vec offset = Ops::set1(antiDenormal);
+    const Vec zero = Ops::set1(0);
+
+    for (int n = 0; n < numSamples; n++)
+    {
+        SampleType* row = data + n * groupSize;
+
+        offset = Ops::sub(zero, offset);
+
+        for (int v = 0; v < VECTORS_PER_GROUP; v++)
+        {
+            Vec w = Ops::sub(Ops::load(row + v * width), Ops::mul(a1[v], v1[v]));
+            w = Ops::add(Ops::sub(w, Ops::mul(a2[v], v2[v])), offset);
+
+            Vec out = Ops::add(Ops::mul(b0[v], w),
+                               Ops::add(Ops::mul(b1[v], v1[v]), Ops::mul(b2[v], v2[v])));
+
+            v2[v] = v1[v];
+            v1[v] = w;
+
+            Ops::store(row + v * width, out);
+        }
+    }
+
+    for (int v = 0; v < VECTORS_PER_GROUP; v++)
+    {
+        Ops::store(state + v * width, v1[v]);
+        Ops::store(state + groupSize + v * width, v2[v]);
+    }
+}
+
+}
+
+template <typename SampleType>
+MultichannelIIRFilter<SampleType>::MultichannelIIRFilter()
+    : numChannels(0), numStages(0), numGroups(0),
+      antiDenormal((SampleType) Dsp::anti_denormal_vsa)
+{
+    scratch.calloc(CHUNK_SIZE * getGroupSize());
+}
+
+template <typename SampleType>
+MultichannelIIRFilter<SampleType>::~MultichannelIIRFilter()
+{
+
+}
+
+template <typename SampleType>
+int MultichannelIIRFilter<SampleType>::getGroupSize()
+{
+    return SimdOps<SampleType>::width * VECTORS_PER_GROUP;
+}
+
+template <typename SampleType>
+const char* MultichannelIIRFilter<SampleType>::getInstructionSet()
+{
+#if IIR_FILTER_AVX
+    return "AVX";
+#elif IIR_FILTER_SSE2
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+template <typename SampleType>
+SampleType* MultichannelIIRFilter<SampleType>::getGroupCoefficients(int group, int stage)
+{
+    return coefficients + (group * numStages + stage) * NUM_COEFFICIENTS * getGroupSize();
+}
+
+template <typename SampleType>
+SampleType* MultichannelIIRFilter<SampleType>::getGroupState(int group, int stage)
+{
+    return state + (group * numStages + stage) * 2 * getGroupSize();
+}
+
+template <typename SampleType>
+void MultichannelIIRFilter<SampleType>::setSize(int numChannels_, int numStages_)
+{
+
+    numChannels = jmax(0, numChannels_);
+    numStages = jmax(0, numStages_);
+    numGroups = (numChannels + getGroupSize() - 1) / getGroupSize();
+
+    const int numRows = numGroups * numStages;
+
+    coefficients.calloc(jmax(1, numRows * NUM_COEFFICIENTS * getGroupSize()));
+    state.calloc(jmax(1, numRows * 2 * getGroupSize()));
+
+    const ScopedLock sl(pendingLock);
+
+    pendingCoefficients.calloc(jmax(1, numChannels * numStages * NUM_COEFFICIENTS));
+    channelIsPending.calloc(jmax(1, numChannels));
+    hasPendingCoefficients.set(0);
+
+    // unused lanes of the last group stay at b0 = 1 as well
+    for (int g = 0; g < numGroups; g++)
+    {
+        for (int s = 0; s < numStages; s++)
+        {
+            SampleType* b0 = getGroupCoefficients(g, s);
+
+            for (int i = 0; i < getGroupSize(); i++)
+                b0[i] = 1;
+        }
+    }
+
+}
+
+template <typename SampleType>
+void MultichannelIIRFilter<SampleType>::setStageCoefficients(int channel, int stage,
+                                                             double b0, double b1, double b2,
+                                                             double a1, double a2)
+{
+
+    if (channel < 0 || channel >= numChannels || stage < 0 || stage >= numStages)
+        return;
+
+    const int groupSize = getGroupSize();
+    const int lane = channel % groupSize;
+
+    SampleType* c = getGroupCoefficients(channel / groupSize, stage) + lane;
+
+    c[0] = (SampleType) b0;
+    c[groupSize] = (SampleType) b1;
+    c[2 * groupSize] = (SampleType) b2;
+    c[3 * groupSize] = (SampleType) a1;
+    c[4 * groupSize] = (SampleType) a2;
+
+}
+
+template <typename SampleType>
+void MultichannelIIRFilter<SampleType>::setCoefficients(int channel, Dsp::Cascade& cascade)
+{
+
+    if (channel < 0 || channel >= numChannels)
+        return;
+
+    const ScopedLock sl(pendingLock);
+
+    double* c = pendingCoefficients + channel * numStages * NUM_COEFFICIENTS;
+
+    for (int s = 0; s < numStages; s++, c += NUM_COEFFICIENTS)
+    {
+        if (s < cascade.getNumStages())
+        {
+            const Dsp::Cascade::Stage& stage = cascade[s];
+            const double a0 = stage.getA0();
+
+            c[0] = stage.getB0() / a0;
+            c[1] = stage.getB1() / a0;
+            c[2] = stage.getB2() / a0;
+            c[3] = stage.getA1() / a0;
+            c[4] = stage.getA2() / a0;
+        }
+        else
+        {
+            c[0] = 1;
+            c[1] = c[2] = c[3] = c[4] = 0;
+        }
+    }
+
+    channelIsPending[channel] = true;
+    hasPendingCoefficients.set(1);
+
+}
+
+template <typename SampleType>
+void MultichannelIIRFilter<SampleType>::applyPendingCoefficients()
+{
+
+    if (hasPendingCoefficients.get() == 0)
+        return;
+
+    const ScopedTryLock stl(pendingLock);
+
+    if (!stl.isLocked())
+        return; // the coefficients are being changed; apply them next block
+
+    const int groupSize = getGroupSize();
+
+    for (int channel = 0; channel < numChannels; channel++)
+    {
+        if (!channelIsPending[channel])
+            continue;
+
+        const double* c = pendingCoefficients + channel * numStages * NUM_COEFFICIENTS;
+
+        for (int s = 0; s < numStages; s++, c += NUM_COEFFICIENTS)
+        {
+            setStageCoefficients(channel, s, c[0], c[1], c[2], c[3], c[4]);
+
+            // the old state doesn't match the new filter, so start from rest
+            SampleType* v = getGroupState(channel / groupSize, s) + channel % groupSize;
+            v[0] = 0;
+            v[groupSize] = 0;
+        }
+
+        channelIsPending[channel] = false;
+    }
+
+    hasPendingCoefficients.set(0);
+
+}
+
+template <typename SampleType>
+void MultichannelIIRFilter<SampleType>::reset()
+{
+    state.clear(jmax(1, numGroups * numStages * 2 * getGroupSize()));
+}
+
+template <typename SampleType>
+void MultichannelIIRFilter<SampleType>::process(float* const* channelData, int numSamples)
+{
+
+    applyPendingCoefficients();
+
+    const int groupSize = getGroupSize();
+
+    for (int g = 0; g < numGroups; g++)
+    {
+        const int firstChannel = g * groupSize;
+        const int channelsInGroup = jmin(groupSize, numChannels - firstChannel);
+
+        // unused lanes of the last group keep filtering zeros
+        if (channelsInGroup < groupSize)
+            scratch.clear(CHUNK_SIZE * groupSize);
+
+        for (int start = 0; start < numSamples; start += CHUNK_SIZE)
+        {
+            const int chunkSize = jmin(CHUNK_SIZE, numSamples - start);
+
+            copyToGroup<SampleType>(channelData + firstChannel, channelsInGroup, start, chunkSize,
+                                    scratch, groupSize);
+
+            // the offset alternates every sample, continuing across chunks
+            const SampleType offset = (start % 2 == 0) ? antiDenormal : -antiDenormal;
+
+            for (int s = 0; s < numStages; s++)
+            {
+                processStage<SampleType>(scratch, chunkSize,
+                                         getGroupCoefficients(g, s),
+                                         getGroupState(g, s),
+                                         s == 0 ? offset : 0);
+            }
+
+            copyFromGroup<SampleType>(scratch, groupSize,
+                                      channelData + firstChannel, channelsInGroup, start, chunkSize);
+        }
+    }
+
+    if (numSamples % 2 != 0)
+        antiDenormal = -antiDenormal;
+
+}
+
+template class MultichannelIIRFilter<float>;
+template class MultichannelIIRFilter<double>;
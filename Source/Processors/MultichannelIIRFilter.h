@@ -0,0 +1,140 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __MULTICHANNELIIRFILTER_H_4B7F20C9__
+#define __MULTICHANNELIIRFILTER_H_4B7F20C9__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../Dsp/Dsp.h"
+
+/**
+
+  Runs the same cascade of biquad sections on many channels at once.
+
+  Coefficients and filter state are stored structure-of-arrays: channels
+  are split into groups of getGroupSize() channels, and each coefficient of
+  each stage is held as one contiguous row per group, so a group is filtered
+  with a few SIMD registers (16 channels for float and 8 for double with AVX,
+  half that with SSE2). Each channel may have its own coefficients.
+
+  process() copies up to 128 samples of one group into a small interleaved
+  buffer, runs it through the stages one after the other (Direct Form II,
+  like Dsp::DirectFormII), and copies the result back.
+
+  SampleType (float or double) sets the precision of the coefficients, state
+  and arithmetic; the data passed to process() are always float.
+
+  setCoefficients() may be called from another thread while process() runs.
+  The new coefficients are queued and applied at the start of the next call
+  to process(), which also clears the state of that channel, so a channel
+  never runs with half of an old and half of a new set.
+
+  @see FilterNode
+
+*/
+
+template <typename SampleType>
+class MultichannelIIRFilter
+{
+public:
+
+    MultichannelIIRFilter();
+    ~MultichannelIIRFilter();
+
+    /** Allocates coefficients and state for the given number of channels and
+        biquad stages. All stages are set to pass the signal unchanged.*/
+    void setSize(int numChannels, int numStages);
+
+    /** Sets one stage of one channel. The coefficients must already be
+        divided by a0. Must not be called while process() runs.*/
+    void setStageCoefficients(int channel, int stage,
+                              double b0, double b1, double b2,
+                              double a1, double a2);
+
+    /** Queues all stages of a filter designed with the DSP library
+        (e.g. Dsp::Butterworth::BandPass) for one channel; they are applied
+        at the start of the next call to process().*/
+    void setCoefficients(int channel, Dsp::Cascade& cascade);
+
+    /** Clears the state of all channels.*/
+    void reset();
+
+    /** Filters numSamples samples of every channel in place.*/
+    void process(float* const* channelData, int numSamples);
+
+    int getNumChannels()
+    {
+        return numChannels;
+    }
+
+    int getNumStages()
+    {
+        return numStages;
+    }
+
+    /** Returns the number of channels that are filtered together.*/
+    static int getGroupSize();
+
+    /** Returns the name of the instruction set the kernels were compiled for.*/
+    static const char* getInstructionSet();
+
+private:
+
+    SampleType* getGroupCoefficients(int group, int stage);
+    SampleType* getGroupState(int group, int stage);
+
+    /** Applies the coefficients queued by setCoefficients(), unless it is
+        being called right now, in which case they wait for the next block.*/
+    void applyPendingCoefficients();
+
+    int numChannels;
+    int numStages;
+    int numGroups;
+
+    /** b0, b1, b2, a1, a2 for each group and stage, one row of getGroupSize() each.*/
+    HeapBlock<SampleType> coefficients;
+
+    /** v[-1] and v[-2] for each group and stage.*/
+    HeapBlock<SampleType> state;
+
+    /** One chunk of one group, sample-major.*/
+    HeapBlock<SampleType> scratch;
+
+    /** Small alternating offset added to the first stage to avoid denormals.*/
+    SampleType antiDenormal;
+
+    /** b0, b1, b2, a1, a2 of each stage of each channel, as queued by setCoefficients().*/
+    HeapBlock<double> pendingCoefficients;
+
+    /** True for each channel whose queued coefficients have not been applied.*/
+    HeapBlock<bool> channelIsPending;
+
+    Atomic<int> hasPendingCoefficients;
+    CriticalSection pendingLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MultichannelIIRFilter);
+
+};
+
+
+#endif  // __MULTICHANNELIIRFILTER_H_4B7F20C9__
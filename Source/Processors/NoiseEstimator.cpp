@@ -0,0 +1,160 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "NoiseEstimator.h"
+
+// decimated samples per second, and seconds in the window
+#define NOISE_ESTIMATOR_RATE 1000
+#define NOISE_ESTIMATOR_WINDOW 2
+
+// width of a histogram bin, in microvolts; larger values go into the last bin
+#define NOISE_ESTIMATOR_BIN_WIDTH 0.25
+#define NOISE_ESTIMATOR_NUM_BINS 2048
+
+NoiseEstimator::NoiseEstimator()
+    : decimation(1), nextSample(0), windowSize(0), numValues(0), minNumValues(1),
+      writeIndex(0), medianBin(0), numValuesBelow(0), noiseLevel(0.0)
+{
+    histogram.calloc(NOISE_ESTIMATOR_NUM_BINS);
+    setSampleRate(30000.0f);
+}
+
+NoiseEstimator::~NoiseEstimator()
+{
+
+}
+
+void NoiseEstimator::setSampleRate(float sampleRate)
+{
+    decimation = jmax(1, roundToInt(sampleRate / NOISE_ESTIMATOR_RATE));
+
+    windowSize = NOISE_ESTIMATOR_RATE * NOISE_ESTIMATOR_WINDOW;
+    minNumValues = windowSize / 4;
+    window.malloc(windowSize);
+
+    reset();
+}
+
+void NoiseEstimator::reset()
+{
+    resetRequested = 0;
+
+    histogram.clear(NOISE_ESTIMATOR_NUM_BINS);
+
+    nextSample = 0;
+    numValues = 0;
+    writeIndex = 0;
+    medianBin = 0;
+    numValuesBelow = 0;
+}
+
+void NoiseEstimator::requestReset()
+{
+    resetRequested = 1;
+}
+
+void NoiseEstimator::addSamples(const float* data, int numSamples)
+{
+
+    if (resetRequested.get() != 0)
+        reset();
+
+    int n;
+
+    for (n = nextSample; n < numSamples; n += decimation)
+    {
+        int bin = (int)(std::abs(data[n]) * (1.0 / NOISE_ESTIMATOR_BIN_WIDTH));
+
+        if (bin >= NOISE_ESTIMATOR_NUM_BINS)
+            bin = NOISE_ESTIMATOR_NUM_BINS - 1;
+
+        if (numValues == windowSize)
+        {
+            // drop the oldest value
+            const int oldBin = window[writeIndex];
+
+            histogram[oldBin]--;
+
+            if (oldBin < medianBin)
+                numValuesBelow--;
+        }
+        else
+        {
+            numValues++;
+        }
+
+        window[writeIndex] = (uint16) bin;
+        histogram[bin]++;
+
+        if (bin < medianBin)
+            numValuesBelow++;
+
+        if (++writeIndex == windowSize)
+            writeIndex = 0;
+    }
+
+    nextSample = n - numSamples;
+
+    if (numValues > 0)
+        updateMedian();
+
+}
+
+void NoiseEstimator::updateMedian()
+{
+    // the median is the value of rank numValues/2; move medianBin
+    // until that rank falls inside it
+    const int rank = numValues / 2;
+
+    while (numValuesBelow > rank)
+    {
+        medianBin--;
+        numValuesBelow -= histogram[medianBin];
+    }
+
+    while (numValuesBelow + histogram[medianBin] <= rank)
+    {
+        numValuesBelow += histogram[medianBin];
+        medianBin++;
+    }
+
+    if (hasEstimate())
+    {
+        // place the median inside its bin, assuming the values in it are
+        // evenly spread
+        const double position = (rank - numValuesBelow + 0.5) / histogram[medianBin];
+        const double median = (medianBin + position) * NOISE_ESTIMATOR_BIN_WIDTH;
+
+        noiseLevel = median / 0.6745;
+    }
+}
+
+double NoiseEstimator::getNoiseLevel()
+{
+    return noiseLevel;
+}
+
+void NoiseEstimator::setNoiseLevel(double level)
+{
+    noiseLevel = level;
+}
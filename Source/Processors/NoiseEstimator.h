@@ -0,0 +1,121 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __NOISEESTIMATOR_H_9C3A61E4__
+#define __NOISEESTIMATOR_H_9C3A61E4__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Keeps a running estimate of the noise level of one continuous channel.
+
+  The noise is estimated as median(|x|) / 0.6745, the standard deviation of
+  Gaussian noise that would have the same median absolute value (Quiroga et
+  al., 2004). Because the data reaching the SpikeDetector are band-pass
+  filtered, their median is taken to be zero; unlike the standard deviation,
+  this estimate is hardly affected by the spikes themselves.
+
+  Only one sample in every getDecimation() is used, about 1000 per second,
+  and the median is taken over a sliding window of the last two seconds of
+  those samples. The absolute values are counted in a histogram, so adding a
+  sample and dropping the oldest one cost a few operations, whatever the
+  length of the window.
+
+  @see SpikeDetector
+
+*/
+
+class NoiseEstimator
+{
+public:
+
+    NoiseEstimator();
+    ~NoiseEstimator();
+
+    /** Sets the decimation for a new sample rate and clears the window.*/
+    void setSampleRate(float sampleRate);
+
+    /** Clears the window. The last estimate is kept until enough new samples
+        have been added. Must not be called while samples are being added;
+        use requestReset() then.*/
+    void reset();
+
+    /** Makes the processing thread clear the window before it adds the next
+        block of samples.*/
+    void requestReset();
+
+    /** Adds a block of samples to the window.*/
+    void addSamples(const float* data, int numSamples);
+
+    /** Returns the current estimate, in the units of the data.*/
+    double getNoiseLevel();
+
+    /** Sets the value returned until enough samples have been added, e.g. an
+        estimate saved with the settings.*/
+    void setNoiseLevel(double level);
+
+    /** Returns true if the estimate comes from the data added since the
+        last reset.*/
+    bool hasEstimate()
+    {
+        return numValues >= minNumValues;
+    }
+
+    int getDecimation()
+    {
+        return decimation;
+    }
+
+private:
+
+    void updateMedian();
+
+    int decimation;
+
+    /** Index in the next block of the next sample to use.*/
+    int nextSample;
+
+    /** Histogram bin of each sample in the window, oldest first from writeIndex.*/
+    HeapBlock<uint16> window;
+    int windowSize;
+    int numValues;
+    int minNumValues;
+    int writeIndex;
+
+    HeapBlock<int> histogram;
+
+    /** Bin holding the median, and number of values in the bins below it.*/
+    int medianBin;
+    int numValuesBelow;
+
+    double noiseLevel;
+
+    Atomic<int> resetRequested;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NoiseEstimator);
+
+};
+
+
+#endif  // __NOISEESTIMATOR_H_9C3A61E4__
@@ -0,0 +1,194 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#include "OutputDispatcher.h"
+
+// upper edges of the latency bins, in microseconds
+static const int latencyBinEdges[] = {50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000};
+static const int numLatencyBins = sizeof(latencyBinEdges) / sizeof(latencyBinEdges[0]) + 1;
+
+OutputDispatcher::OutputDispatcher(const String& name, Device* device_, int capacity)
+    : Thread(name), device(device_), fifo(capacity),
+      numWritten(0), totalLatencyTicks(0), maxLatencyTicks(0)
+{
+    commands.malloc(capacity);
+    latencyCounts.calloc(numLatencyBins);
+}
+
+OutputDispatcher::~OutputDispatcher()
+{
+    stopThread(1000);
+}
+
+void OutputDispatcher::start()
+{
+    if (isThreadRunning())
+        return;
+
+    fifo.reset();
+
+    numDropped.set(0);
+    numWritten = 0;
+    totalLatencyTicks = 0;
+    maxLatencyTicks = 0;
+    latencyCounts.clear(numLatencyBins);
+
+    startThread(8); // above the GUI, so outputs are not held up by painting
+}
+
+void OutputDispatcher::stop()
+{
+    if (!isThreadRunning())
+        return;
+
+    stopThread(1000);
+
+    printLatencyHistogram();
+}
+
+bool OutputDispatcher::push(int channel, int value, int64 timestamp)
+{
+    int start1, size1, start2, size2;
+
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 < 1)
+    {
+        ++numDropped;
+        return false;
+    }
+
+    Command& c = commands[size1 > 0 ? start1 : start2];
+    c.channel = channel;
+    c.value = value;
+    c.timestamp = timestamp;
+    c.pushTicks = Time::getHighResolutionTicks();
+
+    fifo.finishedWrite(1);
+
+    // always signal: the dispatch thread may have found the FIFO empty
+    // just before this write and be about to wait
+    notify();
+
+    return true;
+}
+
+void OutputDispatcher::run()
+{
+    while (!threadShouldExit())
+    {
+        dispatchPending();
+
+        // the event is only reset by wait(), so a notify() from push()
+        // after the check still ends the wait
+        if (fifo.getNumReady() == 0)
+            wait(100);
+    }
+
+    // don't lose outputs that were pushed just before stopping
+    dispatchPending();
+}
+
+void OutputDispatcher::dispatchPending()
+{
+    int start1, size1, start2, size2;
+
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1 + size2; i++)
+    {
+        const Command& c = commands[i < size1 ? start1 + i : start2 + i - size1];
+
+        device->writeOutput(c.channel, c.value);
+
+        const int64 latency = Time::getHighResolutionTicks() - c.pushTicks;
+        const double latencyUs = Time::highResolutionTicksToSeconds(latency) * 1.0e6;
+
+        int bin = 0;
+
+        while (bin < numLatencyBins - 1 && latencyUs > latencyBinEdges[bin])
+            bin++;
+
+        latencyCounts[bin]++;
+        totalLatencyTicks += latency;
+        maxLatencyTicks = jmax(maxLatencyTicks, latency);
+        numWritten++;
+    }
+
+    fifo.finishedRead(size1 + size2);
+}
+
+double OutputDispatcher::getMeanLatencyMs()
+{
+    if (numWritten == 0)
+        return 0;
+
+    return Time::highResolutionTicksToSeconds(totalLatencyTicks) * 1000.0 / numWritten;
+}
+
+double OutputDispatcher::getMaxLatencyMs()
+{
+    return Time::highResolutionTicksToSeconds(maxLatencyTicks) * 1000.0;
+}
+
+int OutputDispatcher::getNumLatencyBins()
+{
+    return numLatencyBins;
+}
+
+int OutputDispatcher::getLatencyBinEdge(int bin)
+{
+    if (bin < 0 || bin >= numLatencyBins - 1)
+        return -1;
+
+    return latencyBinEdges[bin];
+}
+
+int64 OutputDispatcher::getLatencyCount(int bin)
+{
+    if (bin < 0 || bin >= numLatencyBins)
+        return 0;
+
+    return latencyCounts[bin];
+}
+
+void OutputDispatcher::printLatencyHistogram()
+{
+
+    std::cout << getThreadName() << ": " << numWritten << " outputs written, "
+              << getNumDropped() << " dropped, latency mean " << getMeanLatencyMs()
+              << " ms, max " << getMaxLatencyMs() << " ms" << std::endl;
+
+    if (numWritten == 0)
+        return;
+
+    for (int i = 0; i < numLatencyBins; i++)
+    {
+        if (i < numLatencyBins - 1)
+            std::cout << "   <= " << latencyBinEdges[i] << " us: ";
+        else
+            std::cout << "    > " << latencyBinEdges[i-1] << " us: ";
+
+        std::cout << latencyCounts[i] << std::endl;
+    }
+
+}
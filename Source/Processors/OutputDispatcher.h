@@ -0,0 +1,136 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef __OUTPUTDISPATCHER_H_3C9E5F12__
+#define __OUTPUTDISPATCHER_H_3C9E5F12__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Moves the serial I/O of output processors off the audio thread.
+
+  process() calls push() with the channel and value to be sent and the
+  timestamp of the event that caused it. push() only writes into a
+  lock-free FIFO and signals the dispatch thread, which passes the outputs
+  to the Device (e.g. an ofArduino or a PulsePal) in the order they were
+  pushed, so the audio thread never waits for a serial port.
+
+  The time from push() until the Device has written an output is recorded
+  in a histogram, which is printed when the thread is stopped.
+
+  @see ArduinoOutput, PulsePalOutput
+
+*/
+
+class OutputDispatcher : public Thread
+{
+public:
+
+    /** Something that can be written to, from the dispatch thread only.*/
+    class Device
+    {
+    public:
+        virtual ~Device() {}
+
+        /** Performs one output; may block until it has been written.*/
+        virtual void writeOutput(int channel, int value) = 0;
+    };
+
+    OutputDispatcher(const String& name, Device* device, int capacity = 256);
+    ~OutputDispatcher();
+
+    /** Clears the FIFO and the statistics, and starts the dispatch thread.*/
+    void start();
+
+    /** Writes the outputs still in the FIFO, stops the dispatch thread
+        and prints the latency histogram.*/
+    void stop();
+
+    /** Queues an output without waiting for any I/O. Returns false, and
+        counts the output as dropped, if the FIFO is full.*/
+    bool push(int channel, int value, int64 timestamp);
+
+    void run();
+
+    /** Returns the number of outputs written since start().*/
+    int64 getNumWritten()
+    {
+        return numWritten;
+    }
+
+    /** Returns the number of outputs that did not fit in the FIFO.*/
+    int getNumDropped()
+    {
+        return numDropped.get();
+    }
+
+    /** Returns the mean and maximum time from push() until an output was
+        written, in milliseconds.*/
+    double getMeanLatencyMs();
+    double getMaxLatencyMs();
+
+    /** Returns the number of bins of the latency histogram.*/
+    static int getNumLatencyBins();
+
+    /** Returns the upper edge of a bin in microseconds, or -1 for the last
+        bin, which has no upper edge.*/
+    static int getLatencyBinEdge(int bin);
+
+    /** Returns the number of outputs whose latency fell in a bin.*/
+    int64 getLatencyCount(int bin);
+
+    /** Prints the latency histogram to std::cout.*/
+    void printLatencyHistogram();
+
+private:
+
+    struct Command
+    {
+        int channel;
+        int value;
+        int64 timestamp;
+        int64 pushTicks;
+    };
+
+    /** Writes all the outputs in the FIFO.*/
+    void dispatchPending();
+
+    Device* device;
+
+    AbstractFifo fifo;
+    HeapBlock<Command> commands;
+
+    Atomic<int> numDropped;
+
+    // only touched by the dispatch thread while it is running
+    int64 numWritten;
+    int64 totalLatencyTicks;
+    int64 maxLatencyTicks;
+    HeapBlock<int64> latencyCounts;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OutputDispatcher);
+
+};
+
+
+#endif  // __OUTPUTDISPATCHER_H_3C9E5F12__
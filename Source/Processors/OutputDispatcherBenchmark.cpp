@@ -0,0 +1,282 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+
+  Measures how long outputs take to pass through an OutputDispatcher to a
+  serial device. The device is a pseudo-terminal: each output is written as
+  the 2-byte trigger command of a Pulse Pal to the slave side, followed by
+  a pause for the time 2 bytes take at 115200 baud. A second thread reads
+  the master side, as the device would.
+
+  The program pushes one timestamped event per 1 ms block, plus a burst of
+  BURST_SIZE events every 100 blocks, from a thread that stands in for the
+  audio thread. It prints how long push() took, and then the latency
+  histogram of the dispatcher, i.e. the time from push() until the write
+  returned.
+
+  This is a standalone program; it is not part of the GUI build, and it
+  only runs on Linux and Mac OS X. To build it from this directory:
+
+    g++ -O3 -march=native -DLINUX=1 -DNDEBUG=1 -I../../JuceLibraryCode -I/usr/include/freetype2 \
+        OutputDispatcherBenchmark.cpp OutputDispatcher.cpp \
+        ../../JuceLibraryCode/modules/juce_core/juce_core.cpp \
+        -o OutputDispatcherBenchmark -lpthread -ldl -lrt -lutil
+
+  The reader checks that every command arrives, in the order it was pushed.
+  The exit code is non-zero if a command was dropped, lost or reordered.
+
+*/
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "OutputDispatcher.h"
+
+#if JUCE_LINUX || JUCE_MAC
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#if JUCE_LINUX
+#include <pty.h>
+#else
+#include <util.h>
+#endif
+
+#define NUM_BLOCKS 5000
+#define BURST_SIZE 4
+#define SAMPLES_PER_BLOCK 30
+
+// the time 2 bytes (20 bits with start and stop bits) take at 115200 baud
+#define WRITE_TIME_US 174
+
+/**
+  Writes Pulse Pal trigger commands to the slave side of a pseudo-terminal.
+*/
+class PseudoTerminalDevice : public OutputDispatcher::Device
+{
+public:
+
+    PseudoTerminalDevice() : masterFd(-1), slaveFd(-1)
+    {
+        if (openpty(&masterFd, &slaveFd, 0, 0, 0) != 0)
+        {
+            masterFd = slaveFd = -1;
+            return;
+        }
+
+        // pass the bytes through unchanged, as a serial port does
+        struct termios settings;
+        tcgetattr(slaveFd, &settings);
+        cfmakeraw(&settings);
+        tcsetattr(slaveFd, TCSANOW, &settings);
+    }
+
+    ~PseudoTerminalDevice()
+    {
+        if (masterFd != -1)
+            close(masterFd);
+
+        if (slaveFd != -1)
+            close(slaveFd);
+    }
+
+    bool isOpen()
+    {
+        return masterFd != -1;
+    }
+
+    /** The side the device reads from.*/
+    int getMasterFd()
+    {
+        return masterFd;
+    }
+
+    void writeOutput(int channel, int value)
+    {
+        const uint8 bytes[2] = { 84, uint8(1 << (channel - 1)) };
+
+        if (write(slaveFd, bytes, 2) != 2)
+            std::cout << "Could not write to the pseudo-terminal." << std::endl;
+
+        tcdrain(slaveFd);
+
+        // a real port is only done once the bytes have been sent
+        const int64 end = Time::getHighResolutionTicks()
+                          + Time::secondsToHighResolutionTicks(WRITE_TIME_US * 1.0e-6);
+
+        while (Time::getHighResolutionTicks() < end) { }
+    }
+
+private:
+
+    int masterFd;
+    int slaveFd;
+
+};
+
+/**
+  Reads the commands from the master side and checks their order.
+*/
+class CommandReader : public Thread
+{
+public:
+
+    CommandReader(int fd_) : Thread("Command Reader"), fd(fd_),
+        numReceived(0), numOutOfOrder(0), bytesInCommand(0)
+    {
+    }
+
+    void run()
+    {
+        struct pollfd p;
+        p.fd = fd;
+        p.events = POLLIN;
+
+        while (!threadShouldExit())
+        {
+            if (poll(&p, 1, 10) <= 0)
+                continue;
+
+            uint8 buffer[256];
+            const ssize_t numBytes = read(fd, buffer, sizeof(buffer));
+
+            for (ssize_t i = 0; i < numBytes; i++)
+            {
+                command[bytesInCommand++] = buffer[i];
+
+                if (bytesInCommand < 2)
+                    continue;
+
+                bytesInCommand = 0;
+
+                if (command[0] != 84 || command[1] != uint8(1 << (getChannel(numReceived) - 1)))
+                    numOutOfOrder++;
+
+                numReceived++;
+            }
+        }
+    }
+
+    /** Returns the channel of the nth command that is pushed.*/
+    static int getChannel(int64 n)
+    {
+        return int(n % 4) + 1;
+    }
+
+    int64 getNumReceived()
+    {
+        return numReceived;
+    }
+
+    int64 getNumOutOfOrder()
+    {
+        return numOutOfOrder;
+    }
+
+private:
+
+    int fd;
+
+    int64 numReceived;
+    int64 numOutOfOrder;
+
+    uint8 command[2];
+    int bytesInCommand;
+
+};
+
+int main()
+{
+
+    PseudoTerminalDevice device;
+
+    if (!device.isOpen())
+    {
+        std::cout << "Could not open a pseudo-terminal." << std::endl;
+        return 1;
+    }
+
+    CommandReader reader(device.getMasterFd());
+    reader.startThread();
+
+    OutputDispatcher dispatcher("Pseudo-terminal", &device);
+    dispatcher.start();
+
+    Array<double> pushTimes;
+    int64 numPushed = 0;
+
+    for (int block = 0; block < NUM_BLOCKS; block++)
+    {
+        const int numEvents = (block % 100 == 99) ? BURST_SIZE : 1;
+
+        for (int i = 0; i < numEvents; i++)
+        {
+            const int64 timestamp = int64(block) * SAMPLES_PER_BLOCK + i;
+            const int64 start = Time::getHighResolutionTicks();
+
+            dispatcher.push(CommandReader::getChannel(numPushed), 1, timestamp);
+
+            pushTimes.add(Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1.0e6);
+            numPushed++;
+        }
+
+        Thread::sleep(1);
+    }
+
+    dispatcher.stop();
+
+    // let the reader catch up with the last commands
+    for (int i = 0; i < 100 && reader.getNumReceived() < dispatcher.getNumWritten(); i++)
+        Thread::sleep(10);
+
+    reader.stopThread(1000);
+
+    DefaultElementComparator<double> comparator;
+    pushTimes.sort(comparator);
+
+    std::cout << "push(): median " << pushTimes[pushTimes.size() / 2]
+              << " us, 99th percentile " << pushTimes[pushTimes.size() * 99 / 100]
+              << " us, max " << pushTimes.getLast() << " us" << std::endl;
+
+    std::cout << numPushed << " pushed, " << reader.getNumReceived() << " received, "
+              << reader.getNumOutOfOrder() << " out of order" << std::endl;
+
+    const bool allReceived = dispatcher.getNumDropped() == 0
+                             && reader.getNumReceived() == numPushed
+                             && reader.getNumOutOfOrder() == 0;
+
+    return allReceived ? 0 : 1;
+
+}
+
+#else
+
+int main()
+{
+    std::cout << "This program needs openpty(), i.e. Linux or Mac OS X." << std::endl;
+    return 1;
+}
+
+#endif
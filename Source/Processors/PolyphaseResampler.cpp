@@ -0,0 +1,865 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "PolyphaseResampler.h"
+
+#include <algorithm>
+
+#if defined(__AVX__)
+ #include <immintrin.h>
+ #define POLYPHASE_RESAMPLER_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define POLYPHASE_RESAMPLER_SSE2 1
+#endif
+
+// input samples of one group that are resampled in one pass
+#define CHUNK_SIZE 256
+
+// registers per group
+#define VECTORS_PER_GROUP 2
+
+// stopband attenuation of every stage, in dB
+#define ATTENUATION 80.0
+
+// largest upsampling factor, and largest prime factor of the downsampling
+// factor, that are used without approximating the ratio
+#define MAX_FACTOR 256
+
+namespace
+{
+
+/** The vector operations the kernels need.
+
+    transposeIn() copies a tile of width channels x width samples from the
+    channel arrays into width rows of the group buffer (row n holding sample
+    n of each channel); transposeOut() copies it back.*/
+struct SimdOps
+{
+#if POLYPHASE_RESAMPLER_AVX
+
+    typedef __m256 Vec;
+    enum { width = 8 };
+
+    static Vec load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+    static Vec set1(float x) { return _mm256_set1_ps(x); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+
+    static void transpose(__m256* r)
+    {
+        __m256 t[8], u[8];
+
+        for (int i = 0; i < 8; i += 2)
+        {
+            t[i] = _mm256_unpacklo_ps(r[i], r[i + 1]);
+            t[i + 1] = _mm256_unpackhi_ps(r[i], r[i + 1]);
+        }
+
+        for (int i = 0; i < 8; i += 4)
+        {
+            u[i] = _mm256_shuffle_ps(t[i], t[i + 2], 0x44);
+            u[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], 0xEE);
+            u[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], 0x44);
+            u[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], 0xEE);
+        }
+
+        for (int i = 0; i < 4; i++)
+        {
+            r[i] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x20);
+            r[i + 4] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x31);
+        }
+    }
+
+    static void transposeIn(const float* const* source, int offset, float* dest, int stride)
+    {
+        __m256 r[8];
+
+        for (int i = 0; i < 8; i++)
+            r[i] = _mm256_loadu_ps(source[i] + offset);
+
+        transpose(r);
+
+        for (int i = 0; i < 8; i++)
+            _mm256_storeu_ps(dest + i * stride, r[i]);
+    }
+
+    static void transposeOut(const float* source, int stride, float* const* dest, int offset)
+    {
+        __m256 r[8];
+
+        for (int i = 0; i < 8; i++)
+            r[i] = _mm256_loadu_ps(source + i * stride);
+
+        transpose(r);
+
+        for (int i = 0; i < 8; i++)
+            _mm256_storeu_ps(dest[i] + offset, r[i]);
+    }
+
+#elif POLYPHASE_RESAMPLER_SSE2
+
+    typedef __m128 Vec;
+    enum { width = 4 };
+
+    static Vec load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+    static Vec set1(float x) { return _mm_set1_ps(x); }
+    static Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+
+    static void transposeIn(const float* const* source, int offset, float* dest, int stride)
+    {
+        __m128 r0 = _mm_loadu_ps(source[0] + offset);
+        __m128 r1 = _mm_loadu_ps(source[1] + offset);
+        __m128 r2 = _mm_loadu_ps(source[2] + offset);
+        __m128 r3 = _mm_loadu_ps(source[3] + offset);
+
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        _mm_storeu_ps(dest, r0);
+        _mm_storeu_ps(dest + stride, r1);
+        _mm_storeu_ps(dest + 2 * stride, r2);
+        _mm_storeu_ps(dest + 3 * stride, r3);
+    }
+
+    static void transposeOut(const float* source, int stride, float* const* dest, int offset)
+    {
+        __m128 r0 = _mm_loadu_ps(source);
+        __m128 r1 = _mm_loadu_ps(source + stride);
+        __m128 r2 = _mm_loadu_ps(source + 2 * stride);
+        __m128 r3 = _mm_loadu_ps(source + 3 * stride);
+
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        _mm_storeu_ps(dest[0] + offset, r0);
+        _mm_storeu_ps(dest[1] + offset, r1);
+        _mm_storeu_ps(dest[2] + offset, r2);
+        _mm_storeu_ps(dest[3] + offset, r3);
+    }
+
+#else
+
+    typedef float Vec;
+    enum { width = 1 };
+
+    static Vec load(const float* p) { return *p; }
+    static void store(float* p, Vec v) { *p = v; }
+    static Vec set1(float x) { return x; }
+    static Vec add(Vec a, Vec b) { return a + b; }
+    static Vec mul(Vec a, Vec b) { return a * b; }
+
+    static void transposeIn(const float* const* source, int offset, float* dest, int stride)
+    {
+        *dest = source[0][offset];
+    }
+
+    static void transposeOut(const float* source, int stride, float* const* dest, int offset)
+    {
+        dest[0][offset] = *source;
+    }
+
+#endif
+};
+
+typedef SimdOps::Vec Vec;
+
+const int groupSize = SimdOps::width * VECTORS_PER_GROUP;
+
+/** Copies numSamples samples of numChannels channels, starting at sample
+    start, into the rows of a group buffer.*/
+void copyToGroup(const float* const* source, int numChannels, int start, int numSamples,
+                 float* dest)
+{
+    const int width = SimdOps::width;
+
+    int i = 0;
+
+    for (; i + width <= numChannels; i += width)
+    {
+        int n = 0;
+
+        for (; n + width <= numSamples; n += width)
+            SimdOps::transposeIn(source + i, start + n, dest + n * groupSize + i, groupSize);
+
+        for (; n < numSamples; n++)
+            for (int k = 0; k < width; k++)
+                dest[n * groupSize + i + k] = source[i + k][start + n];
+    }
+
+    for (; i < numChannels; i++)
+        for (int n = 0; n < numSamples; n++)
+            dest[n * groupSize + i] = source[i][start + n];
+}
+
+/** The reverse of copyToGroup().*/
+void copyFromGroup(const float* source, float* const* dest, int numChannels,
+                   int start, int numSamples)
+{
+    const int width = SimdOps::width;
+
+    int i = 0;
+
+    for (; i + width <= numChannels; i += width)
+    {
+        int n = 0;
+
+        for (; n + width <= numSamples; n += width)
+            SimdOps::transposeOut(source + n * groupSize + i, groupSize, dest + i, start + n);
+
+        for (; n < numSamples; n++)
+            for (int k = 0; k < width; k++)
+                dest[i + k][start + n] = source[n * groupSize + i + k];
+    }
+
+    for (; i < numChannels; i++)
+        for (int n = 0; n < numSamples; n++)
+            dest[i][start + n] = source[n * groupSize + i];
+}
+
+/** Decimates the rows of one group with a symmetric filter of numTaps taps
+    (an odd number), of which only the centre tap and the non-zero pairs
+    (offset, numTaps - 1 - offset) are given. Windows start at row start,
+    which is left at the first window that doesn't fit.*/
+int decimate(const float* input, int numRows, int& start, int factor, int numTaps,
+             float centre, const int* pairOffsets, const float* pairCoefficients, int numPairs,
+             float* output)
+{
+    const int width = SimdOps::width;
+    const int centreOffset = (numTaps - 1) / 2;
+
+    int numOutput = 0;
+
+    for (; start + numTaps <= numRows; start += factor)
+    {
+        const float* x = input + start * groupSize;
+
+        Vec acc[VECTORS_PER_GROUP];
+
+        const Vec c = SimdOps::set1(centre);
+
+        for (int v = 0; v < VECTORS_PER_GROUP; v++)
+            acc[v] = SimdOps::mul(c, SimdOps::load(x + centreOffset * groupSize + v * width));
+
+        for (int i = 0; i < numPairs; i++)
+        {
+            const Vec h = SimdOps::set1(pairCoefficients[i]);
+            const float* a = x + pairOffsets[i] * groupSize;
+            const float* b = x + (numTaps - 1 - pairOffsets[i]) * groupSize;
+
+            for (int v = 0; v < VECTORS_PER_GROUP; v++)
+            {
+                Vec sum = SimdOps::add(SimdOps::load(a + v * width), SimdOps::load(b + v * width));
+                acc[v] = SimdOps::add(acc[v], SimdOps::mul(h, sum));
+            }
+        }
+
+        for (int v = 0; v < VECTORS_PER_GROUP; v++)
+            SimdOps::store(output + numOutput * groupSize + v * width, acc[v]);
+
+        numOutput++;
+    }
+
+    return numOutput;
+}
+
+/** Resamples the rows of one group by up / down with a polyphase filter of
+    up phases of numTaps taps each, stored in reverse order so that phase p
+    is applied to the rows start ... start + numTaps - 1.*/
+int resample(const float* input, int numRows, int& start, int& phase, int up, int down,
+             int numTaps, const float* coefficients, float* output)
+{
+    const int width = SimdOps::width;
+
+    int numOutput = 0;
+
+    while (start + numTaps <= numRows)
+    {
+        const float* x = input + start * groupSize;
+        const float* h = coefficients + phase * numTaps;
+
+        Vec acc[VECTORS_PER_GROUP];
+
+        for (int v = 0; v < VECTORS_PER_GROUP; v++)
+            acc[v] = SimdOps::set1(0.0f);
+
+        for (int k = 0; k < numTaps; k++)
+        {
+            const Vec c = SimdOps::set1(h[k]);
+
+            for (int v = 0; v < VECTORS_PER_GROUP; v++)
+                acc[v] = SimdOps::add(acc[v], SimdOps::mul(c, SimdOps::load(x + k * groupSize + v * width)));
+        }
+
+        for (int v = 0; v < VECTORS_PER_GROUP; v++)
+            SimdOps::store(output + numOutput * groupSize + v * width, acc[v]);
+
+        numOutput++;
+
+        phase += down;
+        start += phase / up;
+        phase %= up;
+    }
+
+    return numOutput;
+}
+
+/** Returns the prime factors of n, from the smallest to the largest.*/
+Array<int> getFactors(int n)
+{
+    Array<int> factors;
+
+    for (int p = 2; p * p <= n; p++)
+    {
+        while (n % p == 0)
+        {
+            factors.add(p);
+            n /= p;
+        }
+    }
+
+    if (n > 1)
+        factors.add(n);
+
+    return factors;
+}
+
+/** Returns Kaiser's estimate of the length of a stage, rounded up to an odd
+    length with at least one window per output for decimators, or to a
+    whole number of taps per phase otherwise.*/
+int getNumTaps(int up, int down, double inputRate, double passEdge, double stopEdge)
+{
+    const double transition = (stopEdge - passEdge) / (inputRate * up);
+
+    int numTaps = (int) std::ceil((ATTENUATION - 7.95) / (14.36 * transition)) + 1;
+
+    if (up == 1)
+        return jmax(numTaps, 2 * down + 1) | 1;
+
+    const int tapsPerPhase = jmax((numTaps + up - 1) / up, down / up + 2);
+    return tapsPerPhase * up;
+}
+
+/** Returns the stopband edge of one stage of a decimator: intermediate
+    stages only keep aliases out of the final passband.*/
+double getStopEdge(double outputRate, double passEdge, bool isLast)
+{
+    return isLast ? 0.5 * outputRate : outputRate - passEdge;
+}
+
+/** Estimates the multiplications per second of decimating by the factors
+    in the given order.*/
+double getDecimationCost(const Array<int>& factors, double rate, double passEdge)
+{
+    double cost = 0;
+
+    for (int i = 0; i < factors.size(); i++)
+    {
+        const bool isLast = (i == factors.size() - 1);
+        const double outputRate = rate / factors[i];
+
+        const int numTaps = getNumTaps(1, factors[i], rate, passEdge,
+                                       getStopEdge(outputRate, passEdge, isLast));
+
+        // symmetric taps are folded, and half of the taps of intermediate
+        // half-band stages are zero
+        const int numProducts = (factors[i] == 2 && !isLast) ? numTaps / 4 + 1 : numTaps / 2 + 1;
+
+        cost += numProducts * outputRate;
+        rate = outputRate;
+    }
+
+    return cost;
+}
+
+int getLargestFactor(int n)
+{
+    Array<int> factors = getFactors(n);
+
+    int largest = 1;
+
+    for (int i = 0; i < factors.size(); i++)
+        largest = jmax(largest, factors[i]);
+
+    return largest;
+}
+
+}
+
+// =======================================================
+
+/** One decimating (up == 1) or polyphase (up > 1) FIR stage, with the
+    history and phase of every group.*/
+class PolyphaseResampler::Stage
+{
+public:
+
+    Stage(int up_, int down_, const double* taps, int totalTaps, int numGroups_, int maxInputRows)
+        : up(up_), down(down_), numGroups(numGroups_), numPairs(0), centre(0)
+    {
+
+        if (up == 1)
+        {
+            numTaps = totalTaps;
+
+            const int centreOffset = (numTaps - 1) / 2;
+            centre = (float) taps[centreOffset];
+
+            double largest = 0;
+
+            for (int k = 0; k < numTaps; k++)
+                largest = jmax(largest, std::abs(taps[k]));
+
+            pairOffsets.malloc(centreOffset + 1);
+            coefficients.malloc(centreOffset + 1);
+
+            // the zero taps of half-band filters are left out
+            for (int k = 0; k < centreOffset; k++)
+            {
+                if (std::abs(taps[k]) > 1e-9 * largest)
+                {
+                    pairOffsets[numPairs] = k;
+                    coefficients[numPairs] = (float) taps[k];
+                    numPairs++;
+                }
+            }
+        }
+        else
+        {
+            // phase p holds taps p, p + up, p + 2 up, ..., reversed
+            numTaps = totalTaps / up;
+
+            coefficients.malloc(up * numTaps);
+
+            for (int p = 0; p < up; p++)
+                for (int k = 0; k < numTaps; k++)
+                    coefficients[p * numTaps + numTaps - 1 - k] = (float) taps[p + k * up];
+        }
+
+        capacity = numTaps + maxInputRows;
+
+        history.malloc(numGroups * capacity * groupSize);
+        numHistory.malloc(numGroups);
+        phase.malloc(numGroups);
+
+        reset();
+
+    }
+
+    void reset()
+    {
+        history.clear(numGroups * capacity * groupSize);
+
+        // the filters start from a signal of zeros
+        for (int g = 0; g < numGroups; g++)
+        {
+            numHistory[g] = numTaps - 1;
+            phase[g] = 0;
+        }
+    }
+
+    int getMaxNumOutputRows(int numInputRows)
+    {
+        return int((int64(numInputRows) * up) / down) + 1;
+    }
+
+    int getUp()
+    {
+        return up;
+    }
+
+    int getDown()
+    {
+        return down;
+    }
+
+    /** Delay of the filter, in samples at the input rate.*/
+    double getLatency()
+    {
+        return (numTaps * up - 1) / (2.0 * up);
+    }
+
+    /** Returns where the next input rows of a group have to be written, so
+        the previous stage can write its output there directly.*/
+    float* getInputRows(int group)
+    {
+        return history + (group * capacity + numHistory[group]) * groupSize;
+    }
+
+    /** Filters numInputRows rows that were written to getInputRows(group).*/
+    int process(int group, int numInputRows, float* output)
+    {
+
+        float* rows = history + group * capacity * groupSize;
+
+        const int numRows = numHistory[group] + numInputRows;
+
+        int start = 0;
+        int numOutput;
+
+        if (up == 1)
+            numOutput = decimate(rows, numRows, start, down, numTaps,
+                                 centre, pairOffsets, coefficients, numPairs, output);
+        else
+            numOutput = resample(rows, numRows, start, phase[group], up, down,
+                                 numTaps, coefficients, output);
+
+        // keep the rows that the next windows still need
+        numHistory[group] = numRows - start;
+        memmove(rows, rows + start * groupSize, numHistory[group] * groupSize * sizeof(float));
+
+        return numOutput;
+
+    }
+
+private:
+
+    int up;
+    int down;
+    int numGroups;
+
+    /** Taps of the whole filter if up == 1, of each phase otherwise.*/
+    int numTaps;
+
+    HeapBlock<float> coefficients;
+    HeapBlock<int> pairOffsets;
+    int numPairs;
+    float centre;
+
+    HeapBlock<float> history;
+    int capacity;
+    HeapBlock<int> numHistory;
+    HeapBlock<int> phase;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Stage);
+
+};
+
+// =======================================================
+
+PolyphaseResampler::PolyphaseResampler()
+    : numChannels(0), numGroups(0), up(1), down(1),
+      sourceRate(1.0), targetRate(1.0)
+{
+
+}
+
+PolyphaseResampler::~PolyphaseResampler()
+{
+
+}
+
+int PolyphaseResampler::getGroupSize()
+{
+    return groupSize;
+}
+
+const char* PolyphaseResampler::getInstructionSet()
+{
+#if POLYPHASE_RESAMPLER_AVX
+    return "AVX";
+#elif POLYPHASE_RESAMPLER_SSE2
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+double PolyphaseResampler::besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+
+    for (int k = 1; k < 100; k++)
+    {
+        const double t = x / (2.0 * k);
+        term *= t * t;
+        sum += term;
+
+        if (term < 1e-12 * sum)
+            break;
+    }
+
+    return sum;
+}
+
+double PolyphaseResampler::kaiserWindow(double r, double beta)
+{
+    return besselI0(beta * std::sqrt(jmax(0.0, 1.0 - r * r))) / besselI0(beta);
+}
+
+void PolyphaseResampler::setRates(int numChannels_, double sourceRate_, double targetRate_)
+{
+
+    numChannels = jmax(0, numChannels_);
+    numGroups = (numChannels + groupSize - 1) / groupSize;
+
+    const int source = jmax(1, roundToInt(sourceRate_));
+    const int target = jmax(1, roundToInt(targetRate_));
+
+    int a = source, b = target;
+
+    while (b != 0)
+    {
+        const int t = a % b;
+        a = b;
+        b = t;
+    }
+
+    up = target / a;
+    down = source / a;
+
+    if (up > MAX_FACTOR || getLargestFactor(down) > MAX_FACTOR)
+    {
+        // use the last continued-fraction convergent of target / source
+        // whose factors are still small enough
+        double x = double(target) / double(source);
+        int64 p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+
+        up = jmax(1, roundToInt(x));
+        down = 1;
+
+        for (int i = 0; i < 32; i++)
+        {
+            const int64 n = (int64) std::floor(x);
+            const int64 p2 = n * p1 + p0;
+            const int64 q2 = n * q1 + q0;
+
+            if (p2 > MAX_FACTOR || q2 > MAX_FACTOR * MAX_FACTOR
+                || getLargestFactor((int) q2) > MAX_FACTOR)
+                break;
+
+            if (p2 > 0)
+            {
+                up = (int) p2;
+                down = (int) q2;
+            }
+
+            p0 = p1; q0 = q1;
+            p1 = p2; q1 = q2;
+
+            if (x - n < 1e-9)
+                break;
+
+            x = 1.0 / (x - n);
+        }
+
+        std::cout << "Resampling " << source << " Hz by " << up << "/" << down
+                  << " instead of to " << target << " Hz." << std::endl;
+    }
+
+    sourceRate = source;
+    targetRate = sourceRate * up / down;
+
+    stages.clear();
+
+    // everything up to 80% of the lower Nyquist frequency is kept
+    const double passEdge = 0.4 * jmin(sourceRate, targetRate);
+
+    double rate = sourceRate;
+    int remaining = down;
+
+    Array<int> factors = getFactors(down);
+
+    if (up == 1 && factors.size() <= 8)
+    {
+        // try every order of the factors, and keep the cheapest
+        Array<int> order(factors);
+        double lowestCost = getDecimationCost(factors, sourceRate, passEdge);
+
+        while (std::next_permutation(order.begin(), order.end()))
+        {
+            const double cost = getDecimationCost(order, sourceRate, passEdge);
+
+            if (cost < lowestCost)
+            {
+                lowestCost = cost;
+                factors = order;
+            }
+        }
+    }
+
+    for (int i = 0; i < factors.size(); i++)
+    {
+        const int factor = factors[i];
+        const double outputRate = rate / factor;
+
+        if (up == 1)
+        {
+            const bool isLast = (i == factors.size() - 1);
+            addStage(1, factor, rate, passEdge, getStopEdge(outputRate, passEdge, isLast));
+        }
+        else if (outputRate >= 2.0 * targetRate)
+        {
+            // decimate by the small factors first, while the rate stays
+            // well above the target
+            addStage(1, factor, rate, passEdge, getStopEdge(outputRate, passEdge, false));
+        }
+        else
+        {
+            continue;
+        }
+
+        rate = outputRate;
+        remaining /= factor;
+    }
+
+    if (up > 1)
+        addStage(up, remaining, rate, passEdge, 0.5 * jmin(rate, targetRate));
+
+    int rows = CHUNK_SIZE;
+
+    for (int s = 0; s < stages.size(); s++)
+        rows = stages[s]->getMaxNumOutputRows(rows);
+
+    output.calloc(rows * groupSize);
+
+}
+
+void PolyphaseResampler::addStage(int stageUp, int stageDown, double inputRate,
+                                  double passEdge, double stopEdge)
+{
+
+    const double designRate = inputRate * stageUp;
+    const double cutoff = (passEdge + stopEdge) / (2.0 * designRate);
+
+    const int numTaps = getNumTaps(stageUp, stageDown, inputRate, passEdge, stopEdge);
+
+    const double beta = 0.1102 * (ATTENUATION - 8.7);
+    const double centre = (numTaps - 1) / 2.0;
+
+    HeapBlock<double> taps(numTaps);
+    double sum = 0;
+
+    for (int k = 0; k < numTaps; k++)
+    {
+        const double t = k - centre;
+        const double x = 2.0 * double_Pi * cutoff * t;
+        const double sinc = (t == 0) ? 1.0 : std::sin(x) / x;
+
+        const double r = (centre > 0) ? t / centre : 0.0;
+        const double window = kaiserWindow(r, beta);
+
+        taps[k] = 2.0 * cutoff * sinc * window;
+        sum += taps[k];
+    }
+
+    // unity gain at DC for every phase
+    for (int k = 0; k < numTaps; k++)
+        taps[k] *= stageUp / sum;
+
+    int maxInputRows = CHUNK_SIZE;
+
+    for (int s = 0; s < stages.size(); s++)
+        maxInputRows = stages[s]->getMaxNumOutputRows(maxInputRows);
+
+    stages.add(new Stage(stageUp, stageDown, taps, numTaps, numGroups, maxInputRows));
+
+}
+
+void PolyphaseResampler::reset()
+{
+    for (int s = 0; s < stages.size(); s++)
+        stages[s]->reset();
+}
+
+double PolyphaseResampler::getLatency()
+{
+
+    double latency = 0;
+    double rate = sourceRate;
+
+    for (int s = 0; s < stages.size(); s++)
+    {
+        latency += stages[s]->getLatency() * sourceRate / rate;
+        rate = rate * stages[s]->getUp() / stages[s]->getDown();
+    }
+
+    return latency;
+
+}
+
+int PolyphaseResampler::getMaxNumOutputSamples(int numInputSamples)
+{
+    return int((int64(numInputSamples) * up) / down) + stages.size() + 1;
+}
+
+int PolyphaseResampler::process(const float* const* source, int numInputSamples,
+                                float* const* dest, int destStartSample)
+{
+
+    if (stages.size() == 0)
+    {
+        for (int i = 0; i < numChannels; i++)
+        {
+            if (dest[i] + destStartSample != source[i])
+                memmove(dest[i] + destStartSample, source[i], numInputSamples * sizeof(float));
+        }
+
+        return numInputSamples;
+    }
+
+    int numOutput = 0;
+
+    for (int g = 0; g < numGroups; g++)
+    {
+        const int firstChannel = g * groupSize;
+        const int channelsInGroup = jmin(groupSize, numChannels - firstChannel);
+
+        int outputPos = destStartSample;
+
+        for (int start = 0; start < numInputSamples; start += CHUNK_SIZE)
+        {
+            const int chunkSize = jmin(CHUNK_SIZE, numInputSamples - start);
+
+            float* input = stages[0]->getInputRows(g);
+
+            // unused lanes of the last group resample zeros
+            if (channelsInGroup < groupSize)
+                zeromem(input, chunkSize * groupSize * sizeof(float));
+
+            copyToGroup(source + firstChannel, channelsInGroup, start, chunkSize, input);
+
+            int numRows = chunkSize;
+
+            // each stage writes straight into the history of the next one
+            for (int s = 0; s < stages.size(); s++)
+            {
+                float* stageOutput = (s + 1 < stages.size()) ? stages[s + 1]->getInputRows(g)
+                                     : output.getData();
+
+                numRows = stages[s]->process(g, numRows, stageOutput);
+            }
+
+            copyFromGroup(output, dest + firstChannel, channelsInGroup, outputPos, numRows);
+
+            outputPos += numRows;
+        }
+
+        numOutput = outputPos - destStartSample;
+    }
+
+    return numOutput;
+
+}
@@ -0,0 +1,144 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __POLYPHASERESAMPLER_H_AFC56C23__
+#define __POLYPHASERESAMPLER_H_AFC56C23__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Changes the sample rate of many channels by a rational factor.
+
+  The ratio of the two rates is reduced to up / down (e.g. 30 kHz to 1 kHz
+  is 1 / 30). Decimation is split into stages of the prime factors of down,
+  in the order that needs the fewest multiplications, so the early stages
+  run at high rates with short filters and only the last one needs a sharp
+  cut-off. Each stage is a linear-phase FIR low-pass with a Kaiser window
+  and 80 dB of stopband attenuation; intermediate stages only protect the
+  final passband, so factor-of-two stages are half-band filters whose zero
+  taps are skipped.
+  Ratios with up > 1 finish with one polyphase stage that computes only the
+  output samples that are needed.
+
+  Channels are processed in groups of getGroupSize(), with the samples of
+  one group interleaved so every tap is one SIMD multiply-add for the whole
+  group, as in MultichannelIIRFilter. The filter state and the phase of
+  every stage persist across calls, so a signal split into blocks of any
+  size gives the same output as one long block.
+
+  @see ResamplingNode, MultichannelIIRFilter
+
+*/
+
+class PolyphaseResampler
+{
+public:
+
+    PolyphaseResampler();
+    ~PolyphaseResampler();
+
+    /** Designs the stages that convert sourceRate to targetRate, and clears
+        the state. Rates are rounded to whole Hz; if the reduced ratio needs
+        a factor larger than 256 it is approximated, and getTargetRate()
+        returns the rate that is actually produced.*/
+    void setRates(int numChannels, double sourceRate, double targetRate);
+
+    /** Clears the state of all stages.*/
+    void reset();
+
+    /** Resamples numInputSamples samples of each channel and writes the
+        output to dest, starting at sample destStartSample; returns the
+        number of samples written. dest may be source if up <= down and
+        destStartSample is 0.*/
+    int process(const float* const* source, int numInputSamples,
+                float* const* dest, int destStartSample = 0);
+
+    /** Returns the largest number of samples that process() can write for
+        numInputSamples input samples.*/
+    int getMaxNumOutputSamples(int numInputSamples);
+
+    double getTargetRate()
+    {
+        return targetRate;
+    }
+
+    int getUpsamplingFactor()
+    {
+        return up;
+    }
+
+    int getDownsamplingFactor()
+    {
+        return down;
+    }
+
+    int getNumStages()
+    {
+        return stages.size();
+    }
+
+    /** Returns the delay of the filters, in input samples.*/
+    double getLatency();
+
+    /** Returns the number of channels that are filtered together.*/
+    static int getGroupSize();
+
+    /** Returns the name of the instruction set the kernels were compiled for.*/
+    static const char* getInstructionSet();
+
+    /** Modified Bessel function of the first kind, order zero.*/
+    static double besselI0(double x);
+
+    /** Returns the Kaiser window with the given beta at r, the distance from
+        its centre as a fraction of its half-length (-1 to 1).*/
+    static double kaiserWindow(double r, double beta);
+
+private:
+
+    class Stage;
+
+    /** Adds a stage that resamples by stageUp / stageDown and passes
+        frequencies up to passEdge, attenuating everything above stopEdge.*/
+    void addStage(int stageUp, int stageDown, double inputRate,
+                  double passEdge, double stopEdge);
+
+    OwnedArray<Stage> stages;
+
+    int numChannels;
+    int numGroups;
+
+    int up;
+    int down;
+    double sourceRate;
+    double targetRate;
+
+    /** Output rows of the last stage, for one chunk of one group.*/
+    HeapBlock<float> output;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PolyphaseResampler);
+
+};
+
+
+#endif  // __POLYPHASERESAMPLER_H_AFC56C23__
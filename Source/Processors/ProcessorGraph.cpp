@@ -24,6 +24,7 @@
 #include <stdio.h>
 
 #include "ProcessorGraph.h"
+#include "ProcessorGraphScheduler.h"
 
 #include "AudioNode.h"
 #include "LfpDisplayNode.h"
@@ -65,6 +66,8 @@ ProcessorGraph::ProcessorGraph() : currentNodeId(100)
 
     createDefaultNodes();
 
+    scheduler = new ProcessorGraphScheduler(*this, OUTPUT_NODE_ID);
+
 }
 
 ProcessorGraph::~ProcessorGraph() { }
@@ -684,6 +687,8 @@ bool ProcessorGraph::disableProcessors()
 
     std::cout << "Disabling processors..." << std::endl;
 
+    scheduler->printProcessingTimes();
+
     bool allClear;
 
     for (int i = 0; i < getNumNodes(); i++)
@@ -746,6 +751,48 @@ void ProcessorGraph::setRecordState(bool isRecording)
 }
 
 
+void ProcessorGraph::prepareToPlay(double sampleRate, int estimatedSamplesPerBlock)
+{
+
+    AudioProcessorGraph::prepareToPlay(sampleRate, estimatedSamplesPerBlock);
+
+    // no block is being processed yet
+    for (int i = 0; i < getNumNodes(); i++)
+    {
+        Node* node = getNode(i);
+
+        if (node->nodeId != OUTPUT_NODE_ID)
+            ((GenericProcessor*) node->getProcessor())->getStats().reset();
+    }
+
+    scheduler->prepare(sampleRate, estimatedSamplesPerBlock);
+
+}
+
+void ProcessorGraph::releaseResources()
+{
+
+    scheduler->release();
+
+    AudioProcessorGraph::releaseResources();
+
+}
+
+void ProcessorGraph::processBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+
+    if (scheduler->isPrepared())
+        scheduler->process(buffer, midiMessages);
+    else
+        AudioProcessorGraph::processBlock(buffer, midiMessages);
+
+}
+
+ProcessorGraphScheduler* ProcessorGraph::getScheduler()
+{
+    return scheduler;
+}
+
 AudioNode* ProcessorGraph::getAudioNode()
 {
 
@@ -754,6 +801,14 @@ AudioNode* ProcessorGraph::getAudioNode()
 
 }
 
+AudioResamplingNode* ProcessorGraph::getAudioResamplingNode()
+{
+
+    Node* node = getNodeForId(RESAMPLING_NODE_ID);
+    return (AudioResamplingNode*) node->getProcessor();
+
+}
+
 RecordNode* ProcessorGraph::getRecordNode()
 {
 
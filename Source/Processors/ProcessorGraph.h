@@ -31,7 +31,9 @@
 class GenericProcessor;
 class RecordNode;
 class AudioNode;
+class AudioResamplingNode;
 class SignalChainTabButton;
+class ProcessorGraphScheduler;
 
 /**
 
@@ -69,6 +71,7 @@ public:
 
     RecordNode* getRecordNode();
     AudioNode* getAudioNode();
+    AudioResamplingNode* getAudioResamplingNode();
 
     void updateConnections(Array<SignalChainTabButton*, CriticalSection>);
 
@@ -83,10 +86,24 @@ public:
     
     void setRecordState(bool);
 
+    /** Prepares the nodes and the scheduler that runs them in parallel.*/
+    void prepareToPlay(double sampleRate, int estimatedSamplesPerBlock);
+
+    /** Stops the scheduler's threads.*/
+    void releaseResources();
+
+    /** Processes one block, using the scheduler if it could be prepared.*/
+    void processBlock(AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
+
+    /** Returns the object that runs the processors and measures their processing times.*/
+    ProcessorGraphScheduler* getScheduler();
+
 private:
 
     int currentNodeId;
 
+    ScopedPointer<ProcessorGraphScheduler> scheduler;
+
     enum nodeIds
     {
         RECORD_NODE_ID = 900,
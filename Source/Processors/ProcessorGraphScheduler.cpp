@@ -0,0 +1,551 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ProcessorGraphScheduler.h"
+#include "GenericProcessor.h"
+
+/** One node of the graph, with its own buffers and the nodes it depends on.*/
+class ProcessorGraphScheduler::Task
+{
+public:
+
+    Task(AudioProcessorGraph::Node* node_, bool isOutput_)
+        : processor(node_->getProcessor()), isOutput(isOutput_),
+          buffer(1, 1), numChannels(1), isSerialized(false), numDependencies(0),
+          stats(nullptr)
+    {
+        name = isOutput ? String("Audio Output") : processor->getName();
+
+        GenericProcessor* p = isOutput ? nullptr : dynamic_cast<GenericProcessor*>(processor);
+
+        if (p != nullptr)
+            stats = &p->getStats();
+    }
+
+    /** Copies or adds the inputs of this node into its buffers.*/
+    void gatherInputs(int numSamples)
+    {
+
+        for (int chan = 0; chan < numInputChannels; chan++)
+        {
+            bool isFirst = true;
+
+            for (int i = 0; i < audioSources.size(); i++)
+            {
+                if (audioDestChannels[i] != chan)
+                    continue;
+
+                if (isFirst)
+                    buffer.copyFrom(chan, 0, audioSources[i]->buffer, audioSourceChannels[i], 0, numSamples);
+                else
+                    buffer.addFrom(chan, 0, audioSources[i]->buffer, audioSourceChannels[i], 0, numSamples);
+
+                isFirst = false;
+            }
+
+            if (isFirst)
+                buffer.clear(chan, 0, numSamples);
+        }
+
+        // events are merged in the order of midiSources, like
+        // AudioProcessorGraph does
+        events.clear();
+
+        for (int i = 0; i < midiSources.size(); i++)
+        {
+            events.addEvents(midiSources[i]->events, 0, numSamples, 0);
+        }
+
+    }
+
+    AudioProcessor* processor;
+    String name;
+    bool isOutput;
+
+    AudioSampleBuffer buffer;
+    MidiBuffer events;
+    int numChannels;
+    int numInputChannels;
+
+    /** For each audio connection: the source, its channel, and our channel.*/
+    Array<Task*> audioSources;
+    Array<int> audioSourceChannels;
+    Array<int> audioDestChannels;
+
+    /** Nodes whose events are merged into ours, in order.*/
+    Array<Task*> midiSources;
+
+    /** Nodes that depend on this one.*/
+    Array<Task*> successors;
+
+    bool isSerialized;
+    int numDependencies;
+    Atomic<int> numPendingDependencies;
+
+    /** Timing kept by the processor itself; null for the audio output.*/
+    ProcessorStats* stats;
+
+};
+
+/** Helps the audio thread with the tasks of each block.*/
+class ProcessorGraphScheduler::WorkerThread : public Thread
+{
+public:
+
+    WorkerThread(ProcessorGraphScheduler* scheduler_, int index)
+        : Thread("Processor Graph Worker " + String(index)), scheduler(scheduler_)
+    {
+    }
+
+    void run()
+    {
+        while (!threadShouldExit())
+        {
+            blockStarted.wait(100);
+
+            if (!threadShouldExit())
+                scheduler->runTasks(false);
+        }
+    }
+
+    WaitableEvent blockStarted;
+
+private:
+
+    ProcessorGraphScheduler* scheduler;
+
+};
+
+ProcessorGraphScheduler::ProcessorGraphScheduler(AudioProcessorGraph& graph_, uint32 outputNodeId_)
+    : graph(graph_), outputNodeId(outputNodeId_), prepared(false),
+      numReadyTasks(0), outputBuffer(nullptr),
+      numSamples(0), blockSize(0), sampleRate(44100.0),
+      numBlocks(0), totalBlockTicks(0), totalSamples(0)
+{
+    maxNumWorkers = jmax(0, SystemStats::getNumCpus() - 1);
+}
+
+ProcessorGraphScheduler::~ProcessorGraphScheduler()
+{
+    release();
+}
+
+void ProcessorGraphScheduler::setNumWorkerThreads(int numThreads)
+{
+    maxNumWorkers = jmax(0, numThreads);
+}
+
+bool ProcessorGraphScheduler::prepare(double sampleRate_, int maxBlockSize)
+{
+
+    release();
+
+    tasks.clear();
+
+    sampleRate = sampleRate_;
+    blockSize = jmax(1, maxBlockSize);
+
+    const int numNodes = graph.getNumNodes();
+
+    HashMap<int, Task*> tasksById;
+
+    for (int i = 0; i < numNodes; i++)
+    {
+        AudioProcessorGraph::Node* node = graph.getNode(i);
+        Task* task = new Task(node, node->nodeId == outputNodeId);
+
+        task->numInputChannels = node->getProcessor()->getNumInputChannels();
+        task->numChannels = jmax(1, task->numInputChannels, node->getProcessor()->getNumOutputChannels());
+        task->buffer.setSize(task->numChannels, blockSize);
+        task->buffer.clear();
+
+        tasks.add(task);
+        tasksById.set((int) node->nodeId, task);
+    }
+
+    // connections are scanned from the end, like AudioProcessorGraph does,
+    // so events are merged in the same order
+    for (int i = graph.getNumConnections(); --i >= 0;)
+    {
+        const AudioProcessorGraph::Connection* c = graph.getConnection(i);
+
+        Task* source = tasksById[(int) c->sourceNodeId];
+        Task* dest = tasksById[(int) c->destNodeId];
+
+        if (source == nullptr || dest == nullptr || source == dest)
+            continue;
+
+        if (c->destChannelIndex == AudioProcessorGraph::midiChannelIndex)
+        {
+            dest->midiSources.add(source);
+        }
+        else if (c->destChannelIndex < dest->numInputChannels &&
+                 c->sourceChannelIndex < source->numChannels)
+        {
+            dest->audioSources.add(source);
+            dest->audioSourceChannels.add(c->sourceChannelIndex);
+            dest->audioDestChannels.add(c->destChannelIndex);
+        }
+        else
+        {
+            continue;
+        }
+
+        source->successors.addIfNotAlreadyThere(dest);
+    }
+
+    // work out which nodes feed which, directly or not
+    Array<BigInteger> reachable;
+
+    for (int i = 0; i < numNodes; i++)
+    {
+        BigInteger r;
+        Array<Task*> stack(tasks[i]->successors);
+
+        while (stack.size() > 0)
+        {
+            Task* t = stack.getLast();
+            stack.removeLast();
+            const int index = tasks.indexOf(t);
+
+            if (!r[index])
+            {
+                r.setBit(index);
+                stack.addArray(t->successors);
+            }
+        }
+
+        if (r[i])
+        {
+            std::cout << "The processor graph contains a cycle; it will be processed serially." << std::endl;
+            tasks.clear();
+            return false;
+        }
+
+        reachable.add(r);
+    }
+
+    // the order in which AudioProcessorGraph would run the nodes
+    Array<int> serialOrder;
+
+    for (int i = 0; i < numNodes; i++)
+    {
+        int j = 0;
+
+        while (j < serialOrder.size() && !reachable.getReference(i)[serialOrder[j]])
+            j++;
+
+        serialOrder.insert(j, i);
+    }
+
+    // sinks and utilities may use each other's state, so they keep that order
+    Task* previousSerialized = nullptr;
+
+    for (int i = 0; i < serialOrder.size(); i++)
+    {
+        Task* task = tasks[serialOrder[i]];
+        GenericProcessor* p = dynamic_cast<GenericProcessor*>(task->processor);
+
+        task->isSerialized = task->successors.size() == 0 ||
+                             (p != nullptr && (p->isSink() || p->isUtility()));
+
+        if (task->isSerialized)
+        {
+            if (previousSerialized != nullptr)
+                previousSerialized->successors.addIfNotAlreadyThere(task);
+
+            previousSerialized = task;
+        }
+    }
+
+    for (int i = 0; i < numNodes; i++)
+    {
+        for (int j = 0; j < tasks[i]->successors.size(); j++)
+            tasks[i]->successors[j]->numDependencies++;
+    }
+
+    readyTasks.calloc(jmax(1, numNodes));
+    numReadyTasks = 0;
+
+    // if the tasks can only run one after the other (e.g. a single chain),
+    // workers would only wait, so none are started
+    bool hasParallelBranches = false;
+
+    {
+        Array<int> pending;
+        Array<Task*> ready;
+
+        for (int i = 0; i < numNodes; i++)
+        {
+            pending.add(tasks[i]->numDependencies);
+
+            if (tasks[i]->numDependencies == 0)
+                ready.add(tasks[i]);
+        }
+
+        while (ready.size() > 0 && !hasParallelBranches)
+        {
+            hasParallelBranches = ready.size() > 1;
+
+            Task* task = ready.getLast();
+            ready.removeLast();
+
+            for (int j = 0; j < task->successors.size(); j++)
+            {
+                const int index = tasks.indexOf(task->successors[j]);
+                pending.set(index, pending[index] - 1);
+
+                if (pending[index] == 0)
+                    ready.add(task->successors[j]);
+            }
+        }
+    }
+
+    const int numWorkers = hasParallelBranches ? jmin(maxNumWorkers, numNodes - 1) : 0;
+
+    for (int i = 0; i < numWorkers; i++)
+    {
+        WorkerThread* worker = new WorkerThread(this, i);
+        workers.add(worker);
+        worker->startThread(9);
+    }
+
+    numBlocks = 0;
+    totalBlockTicks = 0;
+    totalSamples = 0;
+
+    prepared = true;
+
+    std::cout << "Scheduling " << numNodes << " processors on "
+              << numWorkers + 1 << " threads." << std::endl;
+
+    return true;
+
+}
+
+void ProcessorGraphScheduler::release()
+{
+
+    prepared = false;
+
+    for (int i = 0; i < workers.size(); i++)
+        workers[i]->signalThreadShouldExit();
+
+    for (int i = 0; i < workers.size(); i++)
+    {
+        workers[i]->blockStarted.signal();
+        workers[i]->stopThread(1000);
+    }
+
+    workers.clear();
+    numReadyTasks = 0;
+
+}
+
+void ProcessorGraphScheduler::process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages)
+{
+
+    const int64 startTicks = Time::getHighResolutionTicks();
+
+    outputBuffer = &buffer;
+    numSamples = buffer.getNumSamples();
+
+    if (numSamples > blockSize)
+    {
+        blockSize = numSamples;
+
+        for (int i = 0; i < tasks.size(); i++)
+            tasks[i]->buffer.setSize(tasks[i]->numChannels, blockSize);
+    }
+
+    buffer.clear();
+
+    // a worker may still be in runTasks() from the previous block, and will
+    // start running tasks as soon as numTasksRemaining is set, so every count
+    // must be reset before that
+    for (int i = 0; i < tasks.size(); i++)
+    {
+        Task* task = tasks.getUnchecked(i);
+        task->numPendingDependencies.set(task->numDependencies);
+    }
+
+    numTasksRemaining.set(tasks.size());
+
+    for (int i = 0; i < tasks.size(); i++)
+    {
+        Task* task = tasks.getUnchecked(i);
+
+        if (task->numDependencies == 0)
+            pushReadyTask(task);
+    }
+
+    for (int i = 0; i < workers.size(); i++)
+        workers[i]->blockStarted.signal();
+
+    runTasks(true);
+
+    midiMessages.clear();
+
+    numBlocks++;
+    totalSamples += numSamples;
+    totalBlockTicks += Time::getHighResolutionTicks() - startTicks;
+
+}
+
+void ProcessorGraphScheduler::runTasks(bool isAudioThread)
+{
+
+    while (numTasksRemaining.get() > 0)
+    {
+        Task* task = popReadyTask();
+
+        if (task != nullptr)
+            runTask(task);
+        else if (isAudioThread)
+            Thread::yield();
+        else
+            taskAvailable.wait(1); // signalled by pushReadyTask()
+    }
+
+}
+
+void ProcessorGraphScheduler::runTask(Task* task)
+{
+
+    task->gatherInputs(numSamples);
+
+    if (task->isOutput)
+    {
+        for (int i = jmin(outputBuffer->getNumChannels(), task->numInputChannels); --i >= 0;)
+            outputBuffer->addFrom(i, 0, task->buffer, i, 0, numSamples);
+    }
+    else
+    {
+        AudioSampleBuffer block(task->buffer.getArrayOfChannels(), task->numChannels, numSamples);
+        task->processor->processBlock(block, task->events);
+    }
+
+    for (int i = 0; i < task->successors.size(); i++)
+    {
+        Task* successor = task->successors.getUnchecked(i);
+
+        if (--(successor->numPendingDependencies) == 0)
+            pushReadyTask(successor);
+    }
+
+    --numTasksRemaining;
+
+}
+
+void ProcessorGraphScheduler::pushReadyTask(Task* task)
+{
+    {
+        const SpinLock::ScopedLockType lock(readyLock);
+        readyTasks[numReadyTasks++] = task;
+    }
+
+    if (workers.size() > 0)
+        taskAvailable.signal();
+}
+
+ProcessorGraphScheduler::Task* ProcessorGraphScheduler::popReadyTask()
+{
+    const SpinLock::ScopedLockType lock(readyLock);
+
+    if (numReadyTasks == 0)
+        return nullptr;
+
+    return readyTasks[--numReadyTasks];
+}
+
+String ProcessorGraphScheduler::getNodeName(int index)
+{
+    if (tasks[index] == nullptr)
+        return String::empty;
+
+    return tasks[index]->name;
+}
+
+double ProcessorGraphScheduler::getMeanProcessingTimeMs(int index)
+{
+    Task* task = tasks[index];
+
+    if (task == nullptr || task->stats == nullptr)
+        return 0.0;
+
+    return task->stats->getSnapshot().meanTimeMs;
+}
+
+double ProcessorGraphScheduler::getMaxProcessingTimeMs(int index)
+{
+    Task* task = tasks[index];
+
+    if (task == nullptr || task->stats == nullptr)
+        return 0.0;
+
+    return task->stats->getSnapshot().maxTimeMs;
+}
+
+double ProcessorGraphScheduler::getMeanBlockTimeMs()
+{
+    if (numBlocks == 0)
+        return 0.0;
+
+    return Time::highResolutionTicksToSeconds(totalBlockTicks) * 1000.0 / numBlocks;
+}
+
+double ProcessorGraphScheduler::getMeanBlockDurationMs()
+{
+    if (numBlocks == 0)
+        return 0.0;
+
+    return double(totalSamples) / sampleRate * 1000.0 / numBlocks;
+}
+
+void ProcessorGraphScheduler::printProcessingTimes()
+{
+
+    if (numBlocks == 0)
+        return;
+
+    std::cout << "Processing times over " << numBlocks << " blocks of "
+              << getMeanBlockDurationMs() << " ms (" << workers.size() + 1 << " threads):" << std::endl;
+
+    for (int i = 0; i < tasks.size(); i++)
+    {
+        if (tasks[i]->stats == nullptr)
+            continue;
+
+        const ProcessorStats::Snapshot s = tasks[i]->stats->getSnapshot();
+
+        std::cout << "   " << getNodeName(i) << ": mean " << s.meanTimeMs
+                  << " ms, p99 " << s.p99TimeMs << " ms, max " << s.maxTimeMs << " ms" << std::endl;
+
+        if (s.numDroppedEvents > 0)
+            std::cout << "   WARNING: " << s.numDroppedEvents << " incoming events did not fit into the "
+                      << getNodeName(i) << "'s event arena and were read from the MidiBuffer." << std::endl;
+    }
+
+    std::cout << "   Whole graph: mean " << getMeanBlockTimeMs() << " ms" << std::endl;
+
+}
@@ -0,0 +1,163 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PROCESSORGRAPHSCHEDULER_H_5E21B0D7__
+#define __PROCESSORGRAPHSCHEDULER_H_5E21B0D7__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Runs the nodes of an AudioProcessorGraph on several threads.
+
+  prepare() turns the graph's nodes and connections into a dependency graph
+  in which every node owns its own AudioSampleBuffer and MidiBuffer. Before
+  a node is processed, its input channels and events are gathered from the
+  nodes it is connected to, in the same way (and, for events, in the same
+  order) as AudioProcessorGraph does it.
+
+  For each block, the nodes whose inputs are ready are put into a shared
+  queue, from which the audio thread and a few worker threads take them, so
+  independent branches (e.g. the two sides of a Splitter) run at the same
+  time. Idle workers sleep until a node is queued, and no workers are
+  started at all if the nodes can only run one after the other. Sinks (RecordNode, AudioNode, displays) and utilities, which may
+  talk to each other, still run one after the other, in the order that
+  AudioProcessorGraph would have used.
+
+  Each processor measures its own processBlock() (see ProcessorStats); the
+  scheduler only times whole blocks, so they can be compared with the
+  duration of a block.
+
+  @see ProcessorGraph, ProcessorStats
+
+*/
+
+class ProcessorGraphScheduler
+{
+public:
+
+    ProcessorGraphScheduler(AudioProcessorGraph& graph, uint32 outputNodeId);
+    ~ProcessorGraphScheduler();
+
+    /** Builds the schedule from the graph's current nodes and connections.
+        Returns false if the graph contains a cycle, in which case it must be
+        processed by AudioProcessorGraph instead.*/
+    bool prepare(double sampleRate, int maxBlockSize);
+
+    /** Stops the worker threads. The processing times remain available
+        until the next call to prepare().*/
+    void release();
+
+    /** Returns true if prepare() succeeded and release() has not been called.*/
+    bool isPrepared()
+    {
+        return prepared;
+    }
+
+    /** Processes one block of the whole graph; the output node's inputs are
+        written to buffer, and midiMessages is cleared.*/
+    void process(AudioSampleBuffer& buffer, MidiBuffer& midiMessages);
+
+    /** Sets the maximum number of threads used in addition to the audio thread.
+        Takes effect at the next prepare(); the default is one less than the
+        number of CPUs.*/
+    void setNumWorkerThreads(int numThreads);
+
+    int getNumWorkerThreads()
+    {
+        return workers.size();
+    }
+
+    /** Returns the number of nodes being scheduled.*/
+    int getNumNodes()
+    {
+        return tasks.size();
+    }
+
+    /** Returns the name of the processor of a node.*/
+    String getNodeName(int index);
+
+    /** Returns the mean and the maximum time spent in processBlock() by a
+        node, in milliseconds, as kept by its ProcessorStats. Returns 0 for
+        the audio output.*/
+    double getMeanProcessingTimeMs(int index);
+    double getMaxProcessingTimeMs(int index);
+
+    /** Returns the mean time needed for a whole block, in milliseconds.*/
+    double getMeanBlockTimeMs();
+
+    /** Returns the mean duration of the blocks, in milliseconds.*/
+    double getMeanBlockDurationMs();
+
+    /** Prints a table of the processing times to std::cout.*/
+    void printProcessingTimes();
+
+private:
+
+    class Task;
+    class WorkerThread;
+
+    /** Runs tasks from the ready queue until all tasks of the block are done.
+        The audio thread yields while no task is ready; workers wait for
+        taskAvailable instead.*/
+    void runTasks(bool isAudioThread);
+
+    void runTask(Task* task);
+
+    void pushReadyTask(Task* task);
+    Task* popReadyTask();
+
+    AudioProcessorGraph& graph;
+    uint32 outputNodeId;
+
+    OwnedArray<Task> tasks;
+    OwnedArray<WorkerThread> workers;
+
+    int maxNumWorkers;
+    bool prepared;
+
+    /** Stack of tasks whose inputs are ready; it has room for all tasks.*/
+    HeapBlock<Task*> readyTasks;
+    int numReadyTasks;
+    SpinLock readyLock;
+
+    /** Signalled whenever a task is pushed, to wake one idle worker.*/
+    WaitableEvent taskAvailable;
+
+    Atomic<int> numTasksRemaining;
+
+    AudioSampleBuffer* outputBuffer;
+    int numSamples;
+    int blockSize;
+    double sampleRate;
+
+    int64 numBlocks;
+    int64 totalBlockTicks;
+    int64 totalSamples;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessorGraphScheduler);
+
+};
+
+
+#endif  // __PROCESSORGRAPHSCHEDULER_H_5E21B0D7__
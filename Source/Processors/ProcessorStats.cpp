@@ -0,0 +1,124 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ProcessorStats.h"
+
+#include <math.h>
+
+ProcessorStats::ProcessorStats()
+{
+    reset();
+}
+
+ProcessorStats::~ProcessorStats()
+{
+
+}
+
+void ProcessorStats::reset()
+{
+    resetRequested = 0;
+
+    numBlocks = 0;
+    numSamples = 0;
+    numEvents = 0;
+    numDroppedEvents = 0;
+    numOverruns = 0;
+    totalTicks = 0;
+    maxTicks = 0;
+    totalDurationUs = 0;
+
+    for (int i = 0; i < numBins; i++)
+        histogram[i] = 0;
+}
+
+void ProcessorStats::requestReset()
+{
+    resetRequested = 1;
+}
+
+void ProcessorStats::addBlock(int64 ticks, int samples, int events, int droppedEvents, double sampleRate)
+{
+    if (resetRequested.get() != 0)
+        reset();
+
+    const double us = Time::highResolutionTicksToSeconds(ticks) * 1.0e6;
+    const double durationUs = (sampleRate > 0) ? samples * 1.0e6 / sampleRate : 0.0;
+
+    ++numBlocks;
+    numSamples += samples;
+    numEvents += events;
+    totalTicks += ticks;
+    totalDurationUs += (int64) durationUs;
+
+    if (droppedEvents > 0)
+        numDroppedEvents += droppedEvents;
+
+    if (durationUs > 0 && us > durationUs)
+        ++numOverruns;
+
+    if (ticks > maxTicks.get())
+        maxTicks = ticks;
+
+    int bin = (us > 1.0) ? (int) (binsPerOctave * log(us) / log(2.0)) : 0;
+
+    ++histogram[jlimit(0, numBins - 1, bin)];
+}
+
+ProcessorStats::Snapshot ProcessorStats::getSnapshot()
+{
+    Snapshot s;
+
+    s.numBlocks = numBlocks.get();
+    s.numSamples = numSamples.get();
+    s.numEvents = numEvents.get();
+    s.numDroppedEvents = numDroppedEvents.get();
+    s.numOverruns = numOverruns.get();
+
+    const double n = (s.numBlocks > 0) ? double(s.numBlocks) : 1.0;
+
+    s.meanTimeMs = Time::highResolutionTicksToSeconds(totalTicks.get()) * 1.0e3 / n;
+    s.maxTimeMs = Time::highResolutionTicksToSeconds(maxTicks.get()) * 1.0e3;
+    s.meanBlockDurationMs = totalDurationUs.get() * 1.0e-3 / n;
+
+    // upper edge of the bin that holds the 99th percentile
+    int64 count = 0;
+    int64 target = (int64) ceil(0.99 * s.numBlocks);
+    int bin = 0;
+
+    for (int i = 0; i < numBins; i++)
+    {
+        count += histogram[i].get();
+
+        if (count >= target)
+        {
+            bin = i;
+            break;
+        }
+    }
+
+    s.p99TimeMs = (s.numBlocks > 0) ? jmin(s.maxTimeMs, pow(2.0, double(bin + 1) / binsPerOctave) * 1.0e-3)
+                                    : 0.0;
+
+    return s;
+}
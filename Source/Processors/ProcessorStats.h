@@ -0,0 +1,117 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PROCESSORSTATS_H_3C91E6A2__
+#define __PROCESSORSTATS_H_3C91E6A2__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Collects the processing times of one processor.
+
+  GenericProcessor::processBlock() calls addBlock() once per block with the
+  time spent in process(), the number of samples and the number of events
+  the processor added. Only that one thread writes (blocks never overlap),
+  and every value is an Atomic, so the message thread can call getSnapshot()
+  at any time without locking; the values of a snapshot may be up to one
+  block apart from each other.
+
+  Times are also counted in a histogram with eight bins per octave, from
+  1 us to about 2 s, from which the 99th percentile is estimated to within
+  about 9%.
+
+  @see GenericProcessor, PerformancePanel
+
+*/
+
+class ProcessorStats
+{
+public:
+
+    ProcessorStats();
+    ~ProcessorStats();
+
+    /** Adds one block; called by the processing thread only. droppedEvents is
+        the number of incoming events that did not fit into the EventArena.*/
+    void addBlock(int64 ticks, int samples, int events, int droppedEvents, double sampleRate);
+
+    /** Clears all values. Must not be called while blocks are being processed;
+        use requestReset() then.*/
+    void reset();
+
+    /** Makes the processing thread clear all values before it adds the next block.*/
+    void requestReset();
+
+    struct Snapshot
+    {
+        int64 numBlocks;
+        int64 numSamples;
+        int64 numEvents;
+
+        /** Incoming events that did not fit into the EventArena, and were
+            read from the MidiBuffer instead.*/
+        int64 numDroppedEvents;
+
+        /** Blocks that took longer than their own duration.*/
+        int64 numOverruns;
+
+        double meanTimeMs;
+        double p99TimeMs;
+        double maxTimeMs;
+
+        /** Mean duration of a block, i.e. the time available to process it.*/
+        double meanBlockDurationMs;
+    };
+
+    Snapshot getSnapshot();
+
+private:
+
+    enum
+    {
+        binsPerOctave = 8,
+        numBins = 168
+    };
+
+    Atomic<int> resetRequested;
+
+    Atomic<int64> numBlocks;
+    Atomic<int64> numSamples;
+    Atomic<int64> numEvents;
+    Atomic<int64> numDroppedEvents;
+    Atomic<int64> numOverruns;
+    Atomic<int64> totalTicks;
+    Atomic<int64> maxTicks;
+
+    /** Sum of the durations of the blocks, in microseconds.*/
+    Atomic<int64> totalDurationUs;
+
+    Atomic<int> histogram[numBins];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessorStats);
+
+};
+
+
+#endif  // __PROCESSORSTATS_H_3C91E6A2__
@@ -28,7 +28,8 @@
 
 
 PulsePalOutput::PulsePalOutput()
-    : GenericProcessor("Pulse Pal"), channelToChange(0)
+    : GenericProcessor("Pulse Pal"), channelToChange(0),
+      dispatcher("Pulse Pal", this), timestamp(0)
 {
 
     pulsePal.initialize();
@@ -72,7 +73,7 @@ void PulsePalOutput::handleEvent(int eventType, MidiMessage& event, int sampleNu
         {
             if (eventId == 1 && eventChannel == channelTtlTrigger[i] && channelState[i])
             {
-                pulsePal.triggerChannel(i+1);
+                dispatcher.push(i+1, 1, timestamp + sampleNum);
             }
 
             if (eventChannel == channelTtlGate[i])
@@ -88,6 +89,25 @@ void PulsePalOutput::handleEvent(int eventType, MidiMessage& event, int sampleNu
 
 }
 
+void PulsePalOutput::writeOutput(int channel, int value)
+{
+    pulsePal.triggerChannel(channel);
+}
+
+bool PulsePalOutput::enable()
+{
+    if (isEnabled)
+        dispatcher.start();
+
+    return isEnabled;
+}
+
+bool PulsePalOutput::disable()
+{
+    dispatcher.stop();
+    return true;
+}
+
 void PulsePalOutput::setParameter(int parameterIndex, float newValue)
 {
     editor->updateParameterButtons(parameterIndex);
@@ -125,6 +145,14 @@ void PulsePalOutput::process(AudioSampleBuffer& buffer,
                              int& nSamples)
 {
 
+    EventArena::Reader timestamps(getIncomingEvents(), events, TIMESTAMP);
+    EventArena::Event event;
+
+    while (timestamps.getNextEvent(event))
+    {
+        timestamp = EventArena::getTimestamp(event);
+    }
+
     checkForEvents(events);
 
 }
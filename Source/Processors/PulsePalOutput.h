@@ -28,17 +28,22 @@
 #include "GenericProcessor.h"
 #include "Editors/PulsePalOutputEditor.h"
 #include "Serial/PulsePal.h"
+#include "OutputDispatcher.h"
 
 /**
 
   Allows the signal chain to send outputs to the Pulse Pal
   from Lucid Biosystems (www.lucidbiosystems.com)
 
-  @see GenericProcessor, PulsePalOutputEditor, PulsePal
+  Triggers are sent by an OutputDispatcher thread, so process()
+  never waits for the serial port.
+
+  @see GenericProcessor, PulsePalOutputEditor, PulsePal, OutputDispatcher
 
 */
 
-class PulsePalOutput : public GenericProcessor
+class PulsePalOutput : public GenericProcessor,
+    public OutputDispatcher::Device
 
 {
 public:
@@ -51,6 +56,12 @@ public:
 
     void handleEvent(int eventType, MidiMessage& event, int sampleNum);
 
+    bool enable();
+    bool disable();
+
+    /** Triggers a channel (1-4); called on the dispatch thread. */
+    void writeOutput(int channel, int value);
+
     AudioProcessorEditor* createEditor();
 
     bool isSink()
@@ -68,6 +79,10 @@ private:
 
     PulsePal pulsePal;
 
+    OutputDispatcher dispatcher;
+
+    int64 timestamp;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PulsePalOutput);
 
 };
@@ -31,6 +31,8 @@
 RecordNode::RecordNode()
     : GenericProcessor("Record Node"),
       newDirectoryNeeded(true),  zeroBuffer(1, 50000),  timestamp(0),
+      recordTimestamp(0),
+      recordingFormat(OPEN_EPHYS_FORMAT), activeRecordingFormat(OPEN_EPHYS_FORMAT),
       appendTrialNum(false), trialNum(0)
 {
 
@@ -39,8 +41,7 @@ RecordNode::RecordNode()
     sampleCount = 0;
     signalFilesShouldClose = false;
 
-    continuousDataIntegerBuffer = new int16[10000];
-    continuousDataFloatBuffer = new float[10000];
+    continuousDataIntegerBuffer.malloc(BLOCK_LENGTH);
     signalFilesShouldClose = false;
 
     settings.numInputs = 2048;
@@ -61,6 +62,8 @@ RecordNode::RecordNode()
 
     zeroBuffer.clear();
 
+    diskWriteThread = new DiskWriteThread(this);
+
 }
 
 
@@ -343,9 +346,11 @@ void RecordNode::setParameter(int parameterIndex, float newValue)
     if (parameterIndex == 1)
     {
 
-        isRecording = true;
         std::cout << "START RECORDING." << std::endl;
 
+        // files from the previous recording may still be closing
+        diskWriteThread->waitForFilesToClose();
+
         if (newDirectoryNeeded)
             createNewDirectory();
 
@@ -362,17 +367,38 @@ void RecordNode::setParameter(int parameterIndex, float newValue)
 
         sampleCount = 0; // reset sample count
 
-        // create / open necessary files
-        for (int i = 0; i < channelPointers.size(); i++)
-        {
-            std::cout << "Checking channel " << i << std::endl;
+        activeRecordingFormat = recordingFormat;
 
-            if (channelPointers[i]->getRecordState())
+        if (activeRecordingFormat == INTERLEAVED_FORMAT)
+        {
+            openInterleavedFiles();
+        }
+        else
+        {
+            // create / open necessary files
+            for (int i = 0; i < channelPointers.size(); i++)
             {
-                openFile(channelPointers[i]);
+                std::cout << "Checking channel " << i << std::endl;
+
+                if (channelPointers[i]->getRecordState())
+                {
+                    openFile(channelPointers[i]);
+                }
             }
         }
 
+        // queue up to one second of data in case the disk stalls
+        int queueSize = 44100;
+
+        if (channelPointers.size() > 0)
+            queueSize = jmax(int(channelPointers[0]->sampleRate), 8192);
+
+        diskWriteThread->resize(channelPointers.size(), queueSize);
+
+        allocateConversionBuffers();
+
+        isRecording = true;
+
     }
     else if (parameterIndex == 0)
     {
@@ -400,7 +426,16 @@ void RecordNode::setParameter(int parameterIndex, float newValue)
 
             std::cout << "Toggling channel " << currentChannel << std::endl;
 
-            if (newValue == 0.0f)
+            // keep the DiskWriteThread from writing while the file changes
+            const ScopedLock sl(diskWriteLock);
+
+            if (isRecording && activeRecordingFormat == INTERLEAVED_FORMAT)
+            {
+                // the interleaved layout is fixed for the whole recording;
+                // channels that are switched off are written as zeros
+                channelPointers[currentChannel]->setRecordState(newValue != 0.0f);
+            }
+            else if (newValue == 0.0f)
             {
                 channelPointers[currentChannel]->setRecordState(false);
 
@@ -487,6 +522,8 @@ void RecordNode::closeFile(Channel* ch)
     std::cout << "CLOSING FILE: " << ch->filename << std::endl;
     if (ch->file != NULL)
         fclose(ch->file);
+
+    ch->file = NULL;
     
     diskWriteLock.exit();
 }
@@ -553,12 +590,138 @@ String RecordNode::generateHeader(Channel* ch)
 
 }
 
-void RecordNode::closeAllFiles()
+void RecordNode::setRecordingFormat(int format)
+{
+    recordingFormat = format;
+}
+
+void RecordNode::openInterleavedFiles()
 {
 
+    const ScopedLock sl(diskWriteLock);
+
+    interleavedWriters.clear();
+
+    // group the recorded channels by the processor they come from
+    Array<int> sourceIds;
+
     for (int i = 0; i < channelPointers.size(); i++)
     {
         if (channelPointers[i]->getRecordState())
+            sourceIds.addIfNotAlreadyThere(channelPointers[i]->nodeId);
+    }
+
+    for (int s = 0; s < sourceIds.size(); s++)
+    {
+        Array<Channel*> channels;
+        Array<int> channelIndices;
+
+        for (int i = 0; i < channelPointers.size(); i++)
+        {
+            if (channelPointers[i]->getRecordState() && channelPointers[i]->nodeId == sourceIds[s])
+            {
+                channels.add(channelPointers[i]);
+                channelIndices.add(i);
+            }
+        }
+
+        String basename = rootFolder.getFullPathName();
+        basename += rootFolder.separatorString;
+        basename += sourceIds[s];
+        basename += "_interleaved";
+
+        if (appendTrialNum)
+        {
+            basename += "_";
+            basename += trialNum;
+        }
+
+        InterleavedFileWriter* writer = new InterleavedFileWriter(basename, channels, channelIndices);
+
+        if (writer->open(generateInterleavedHeader(writer, channels)))
+            interleavedWriters.add(writer);
+        else
+            delete writer;
+    }
+
+}
+
+String RecordNode::generateInterleavedHeader(InterleavedFileWriter* writer, const Array<Channel*>& channels)
+{
+
+    String header = "header.format = 'Open Ephys Interleaved Binary Format'; \n";
+
+    header += "header.version = 0.1;\n";
+    header += "header.header_bytes = ";
+    header += "XXXXXXXX";
+    header += ";\n";
+
+    header += "header.description = 'the .dat file contains numChannels interleaved little-endian int16 samples per sample number; after the header, this file contains pairs of int64 timestamps and the int64 sample numbers they apply to'; \n";
+
+    header += "header.date_created = '";
+    header += generateDateString();
+    header += "';\n";
+
+    header += "header.dataFile = '";
+    header += File(writer->getFilename()).getFileName();
+    header += "';\n";
+
+    header += "header.channelType = 'Continuous';\n";
+
+    header += "header.sampleRate = ";
+    header += String(channels[0]->sampleRate);
+    header += ";\n";
+
+    header += "header.numChannels = ";
+    header += channels.size();
+    header += ";\n";
+
+    header += "header.channels = {";
+
+    for (int i = 0; i < channels.size(); i++)
+    {
+        header += "'";
+        header += channels[i]->name;
+        header += (i < channels.size() - 1) ? "', " : "'";
+    }
+
+    header += "};\n";
+
+    header += "header.bitVolts = [";
+
+    for (int i = 0; i < channels.size(); i++)
+    {
+        header += String(channels[i]->bitVolts);
+        header += (i < channels.size() - 1) ? ", " : "";
+    }
+
+    header += "];\n";
+
+    // the header grows with the number of channels, so it is padded
+    // to the next multiple of HEADER_SIZE
+    int headerBytes = (header.getNumBytesAsUTF8() / HEADER_SIZE + 1) * HEADER_SIZE;
+
+    header = header.replace("XXXXXXXX", String(headerBytes).paddedLeft(' ', 8));
+
+    return header.paddedRight(' ', headerBytes);
+
+}
+
+void RecordNode::closeAllFiles()
+{
+
+    const ScopedLock sl(diskWriteLock);
+
+    for (int i = 0; i < interleavedWriters.size(); i++)
+    {
+        interleavedWriters[i]->close();
+    }
+
+    interleavedWriters.clear();
+
+    for (int i = 0; i < channelPointers.size(); i++)
+    {
+        if (channelPointers[i]->getRecordState() && activeRecordingFormat == OPEN_EPHYS_FORMAT)
         {
 
             if (sampleCount < BLOCK_LENGTH)
@@ -572,6 +735,15 @@ void RecordNode::closeAllFiles()
     }
 
     closeFile(eventChannel);
+
+    std::cout << "Disk write queue high-water mark: " << diskWriteThread->getHighWaterMark()
+              << " of " << diskWriteThread->getQueueCapacity() << " samples, "
+              << diskWriteThread->getNumDroppedBlocks() << " blocks and "
+              << diskWriteThread->getNumDroppedEvents() << " events dropped." << std::endl;
+
+    if (diskWriteThread->getNumUnwrittenSamples() > 0)
+        std::cout << "WARNING: " << diskWriteThread->getNumUnwrittenSamples()
+                  << " samples could not be written to disk." << std::endl;
 }
 
 bool RecordNode::enable()
@@ -579,6 +751,8 @@ bool RecordNode::enable()
 
     //updateFileName(eventChannel);
 
+    diskWriteThread->startThread();
+
     isProcessing = true;
     return true;
 }
@@ -589,6 +763,15 @@ bool RecordNode::disable()
     // close files if necessary
     setParameter(0, 10.0f);
 
+    if (signalFilesShouldClose)
+    {
+        diskWriteThread->signalFilesShouldClose();
+        signalFilesShouldClose = false;
+    }
+
+    // writes out everything that is still queued before returning
+    diskWriteThread->stopThread(-1);
+
     isProcessing = false;
 
     return true;
@@ -599,6 +782,22 @@ float RecordNode::getFreeSpace()
     return 1.0f - float(dataDirectory.getBytesFreeOnVolume())/float(dataDirectory.getVolumeTotalSize());
 }
 
+void RecordNode::allocateConversionBuffers()
+{
+
+    const ScopedLock sl(diskWriteLock);
+
+    int numChans = jmax(channelPointers.size(), 1);
+
+    continuousDataIntegerBuffer.malloc(numChans * BLOCK_LENGTH);
+
+    segmentSources.ensureStorageAllocated(numChans);
+    segmentDestinations.ensureStorageAllocated(numChans);
+    segmentBitVolts.ensureStorageAllocated(numChans);
+    segmentChannels.ensureStorageAllocated(numChans);
+
+}
+
 void RecordNode::writeContinuousBuffer(float* data, int nSamples, int channel)
 {
 
@@ -607,15 +806,17 @@ void RecordNode::writeContinuousBuffer(float* data, int nSamples, int channel)
         return;
 
     // scale the data back into the range of int16
-    float scaleFactor =  float(0x7fff) * channelPointers[channel]->bitVolts;
-    for (int n = 0; n < nSamples; n++)
-    {
-        *(continuousDataFloatBuffer+n) = *(data+n) / scaleFactor;
-    }
-    AudioDataConverters::convertFloatToInt16BE(continuousDataFloatBuffer, continuousDataIntegerBuffer, nSamples);
+    Int16Converter::convertFloatToInt16BE(data,
+                                          continuousDataIntegerBuffer,
+                                          nSamples,
+                                          channelPointers[channel]->bitVolts);
+
+    writeIntegerBuffer(continuousDataIntegerBuffer, nSamples, channel);
 
-    //
-    //int16 samps = (int16) nSamples;
+}
+
+void RecordNode::writeIntegerBuffer(int16* data, int nSamples, int channel)
+{
 
     if (sampleCount == 0)
     {
@@ -625,7 +826,7 @@ void RecordNode::writeContinuousBuffer(float* data, int nSamples, int channel)
     diskWriteLock.enter();
     // FIXME: ensure fwrite returns equal "count"; otherwise,
     // there was an error.
-    fwrite(continuousDataIntegerBuffer,     // ptr
+    fwrite(data,                            // ptr
            2,                               // size of each element
            nSamples,                        // count
            channelPointers[channel]->file); // ptr to FILE object
@@ -639,6 +840,87 @@ void RecordNode::writeContinuousBuffer(float* data, int nSamples, int channel)
 
 }
 
+int RecordNode::writeContinuousSegment(AudioSampleBuffer& data, int startSample, int nSamples, int64 firstTimestamp)
+{
+
+    // the lock is held per segment, so that other users of the
+    // lock (e.g. the SpikeDisplayNode) never wait for a whole batch
+    const ScopedLock sl(diskWriteLock);
+
+    int samplesNotWritten = 0;
+
+    if (activeRecordingFormat == INTERLEAVED_FORMAT)
+    {
+        for (int i = 0; i < interleavedWriters.size(); i++)
+        {
+            int samplesWritten = interleavedWriters[i]->writeSamples(data, startSample, nSamples, firstTimestamp);
+
+            samplesNotWritten = jmax(samplesNotWritten, nSamples - samplesWritten);
+        }
+    }
+    else
+    {
+        int numChans = jmin(data.getNumChannels(), channelPointers.size());
+
+        segmentSources.clearQuick();
+        segmentDestinations.clearQuick();
+        segmentBitVolts.clearQuick();
+        segmentChannels.clearQuick();
+
+        for (int i = 0; i < numChans; i++)
+        {
+            if (channelPointers[i]->getRecordState() && channelPointers[i]->file != NULL)
+            {
+                segmentSources.add(data.getSampleData(i, startSample));
+                segmentDestinations.add(continuousDataIntegerBuffer + segmentChannels.size() * BLOCK_LENGTH);
+                segmentBitVolts.add(channelPointers[i]->bitVolts);
+                segmentChannels.add(i);
+            }
+        }
+
+        // convert all channels first, then write them out one after another
+        Int16Converter::convertBlockToInt16BE(segmentSources.getRawDataPointer(),
+                                              segmentDestinations.getRawDataPointer(),
+                                              segmentBitVolts.getRawDataPointer(),
+                                              segmentChannels.size(),
+                                              nSamples);
+
+        for (int i = 0; i < segmentChannels.size(); i++)
+        {
+            writeIntegerBuffer(segmentDestinations[i], nSamples, segmentChannels[i]);
+        }
+    }
+
+    sampleCount += nSamples;
+
+    if (sampleCount == BLOCK_LENGTH)
+        sampleCount = 0;
+
+    return samplesNotWritten;
+
+}
+
+void RecordNode::finishCurrentRecord()
+{
+
+    const ScopedLock sl(diskWriteLock);
+
+    if (sampleCount == 0)
+        return;
+
+    if (activeRecordingFormat == OPEN_EPHYS_FORMAT)
+    {
+        for (int i = 0; i < channelPointers.size(); i++)
+        {
+            if (channelPointers[i]->getRecordState())
+                writeContinuousBuffer(zeroBuffer.getSampleData(0), BLOCK_LENGTH - sampleCount, i);
+        }
+    }
+
+    sampleCount = 0;
+
+}
+
 void RecordNode::writeTimestampAndSampleCount(FILE* file)
 {
 
@@ -646,7 +928,7 @@ void RecordNode::writeTimestampAndSampleCount(FILE* file)
     
     uint16 samps = BLOCK_LENGTH;
 
-    fwrite(&timestamp,                       // ptr
+    fwrite(&recordTimestamp,                 // ptr
            8,                               // size of each element
            1,                               // count
            file); // ptr to FILE object
@@ -672,15 +954,17 @@ void RecordNode::writeRecordMarker(FILE* file)
     diskWriteLock.exit();
 }
 
-void RecordNode::writeEventBuffer(MidiMessage& event, int samplePosition) //, int node, int channel)
+void RecordNode::writeEventBuffer(const uint8* dataptr, int samplePosition, int64 bufferTimestamp)
 {
     // find file and write samples to disk
     //std::cout << "Received event!" << std::endl;
 
-    const uint8* dataptr = event.getRawData();
+    if (eventChannel->file == NULL)
+        return;
+
     uint64 samplePos = (uint64) samplePosition;
 
-    int64 eventTimestamp = timestamp + samplePos;
+    int64 eventTimestamp = bufferTimestamp + samplePos;
 
     diskWriteLock.enter();
     // write timestamp (for buffer only, not the actual event timestamp!!!!!)
@@ -700,31 +984,6 @@ void RecordNode::writeEventBuffer(MidiMessage& event, int samplePosition) //, in
 
 }
 
-void RecordNode::handleEvent(int eventType, MidiMessage& event, int samplePosition)
-{
-    if (eventType == TTL)
-    {
-        writeEventBuffer(event, samplePosition);
-    }
-    else if (eventType == TIMESTAMP)
-    {
-        const uint8* dataptr = event.getRawData();
-
-        // std::cout << (int) *(dataptr + 11) << " " <<
-        //             (int) *(dataptr + 10) << " " <<
-        //             (int) *(dataptr + 9) << " " <<
-        //             (int) *(dataptr + 8) << " " <<
-        //             (int) *(dataptr + 7) << " " <<
-        //             (int) *(dataptr + 6) << " " <<
-        //             (int) *(dataptr + 5) << " " <<
-        //             (int) *(dataptr + 4) << std::endl;
-
-
-        memcpy(&timestamp, dataptr + 4, 8); // remember to skip first four bytes
-    }
-
-}
-
 void RecordNode::process(AudioSampleBuffer& buffer,
                          MidiBuffer& events,
                          int& nSamples)
@@ -743,69 +1002,30 @@ void RecordNode::process(AudioSampleBuffer& buffer,
         //buffer.applyGain(0, nSamples, 5.2438f);
 
         // cycle through events -- extract the TTLs and the timestamps
-        checkForEvents(events);
+        EventArena::Reader incoming(getIncomingEvents(), events);
+        EventArena::Event event;
 
-        // cycle through buffer channels
-
-        int samplesWritten = 0;
-
-        if (channelPointers.size() > 0)
+        while (incoming.getNextEvent(event))
         {
-
-            while (samplesWritten < nSamples)
+            if (event.type == TTL && event.numBytes >= 4 && event.sampleNum >= 0)
             {
-
-                int numSamplesToWrite = nSamples - samplesWritten;
-
-                if (sampleCount + numSamplesToWrite < BLOCK_LENGTH)
-                {
-
-                    for (int i = 0; i < buffer.getNumChannels(); i++)
-                    {
-
-                        if (channelPointers[i]->getRecordState())
-                        {
-                            // write buffer to disk!
-                            writeContinuousBuffer(buffer.getSampleData(i,samplesWritten),
-                                                  numSamplesToWrite,
-                                                  i);
-
-                            //std::cout << "Record channel " << i << std::endl;
-                        }
-                    }
-
-                    samplesWritten += numSamplesToWrite;
-                    sampleCount += numSamplesToWrite;
-
-                }
-                else
-                {
-
-                    numSamplesToWrite = BLOCK_LENGTH - sampleCount;
-
-                    for (int i = 0; i < buffer.getNumChannels(); i++)
-                    {
-
-                        if (channelPointers[i]->getRecordState())
-                        {
-                            // write buffer to disk!
-                            writeContinuousBuffer(buffer.getSampleData(i,samplesWritten),
-                                                  numSamplesToWrite,
-                                                  i);
-
-                            //std::cout << "Record channel " << i << std::endl;
-                        }
-                    }
-
-                    timestamp += numSamplesToWrite;
-                    samplesWritten += numSamplesToWrite;
-                    sampleCount = 0;
-
-                }
+                diskWriteThread->addEvent(event.data, event.sampleNum, timestamp);
             }
+            else if (event.type == TIMESTAMP)
+            {
+                timestamp = EventArena::getTimestamp(event);
+            }
+        }
+
+        // hand the buffer to the DiskWriteThread; nothing is written
+        // to disk from the audio thread
+        if (channelPointers.size() > 0)
+        {
+            diskWriteThread->addContinuousBlock(buffer, nSamples, timestamp);
         }
 
-        //  std::cout << nSamples << " " << samplesWritten << " " << sampleCount << std::endl;
+        // sources without timestamps still get increasing values
+        timestamp += nSamples;
 
         return;
 
@@ -815,7 +1035,7 @@ void RecordNode::process(AudioSampleBuffer& buffer,
     // before recording stops
     if (signalFilesShouldClose)
     {
-        closeAllFiles();
+        diskWriteThread->signalFilesShouldClose();
         signalFilesShouldClose = false;
     }
 
@@ -32,6 +32,9 @@
 
 #include "GenericProcessor.h"
 #include "Channel.h"
+#include "DiskWriteThread.h"
+#include "InterleavedFileWriter.h"
+#include "Int16Converter.h"
 
 #define HEADER_SIZE 1024
 #define BLOCK_LENGTH 1024
@@ -41,9 +44,17 @@
   Receives inputs from all processors that want to save their data.
   Writes data to disk using fwrite.
 
+  The audio thread only copies incoming data into the DiskWriteThread's
+  queue; all disk access happens on that thread.
+
+  Continuous data can be saved in one of two formats: the Open Ephys format
+  (one .continuous file per channel) or an interleaved binary format
+  (one .dat file per source, see InterleavedFileWriter). Events are
+  always written to all_channels.events.
+
   Receives a signal from the ControlPanel to begin recording.
 
-  @see GenericProcessor, ControlPanel
+  @see GenericProcessor, ControlPanel, DiskWriteThread, InterleavedFileWriter
 
 */
 
@@ -127,6 +138,25 @@ public:
     
     CriticalSection* getLock() {return &diskWriteLock;}
 
+    /** Returns the thread that writes data to disk, e.g. to query its queue depth
+        and the number of dropped blocks.
+    */
+    DiskWriteThread* getDiskWriteThread() {return diskWriteThread;}
+
+    enum recordingFormats
+    {
+        OPEN_EPHYS_FORMAT = 0,
+        INTERLEAVED_FORMAT = 1
+    };
+
+    /** Selects the format used for continuous data. Takes effect the next
+        time recording starts.
+    */
+    void setRecordingFormat(int format);
+
+    /** Returns the format used for continuous data. */
+    int getRecordingFormat() {return recordingFormat;}
+
 
 private:
 
@@ -144,14 +174,21 @@ private:
     File rootFolder;
 
     /** Holds data that has been converted from float to int16 before
-        saving.
+        saving (BLOCK_LENGTH samples for each channel).
     */
-    int16* continuousDataIntegerBuffer;
+    HeapBlock<int16> continuousDataIntegerBuffer;
 
-    /** Holds data that has been converted from float to int16 before
-        saving.
+    /** Source, destination, bitVolts and channel index of each channel
+        converted by writeContinuousSegment(); preallocated when recording starts.
+    */
+    Array<const float*> segmentSources;
+    Array<int16*> segmentDestinations;
+    Array<float> segmentBitVolts;
+    Array<int> segmentChannels;
+
+    /** Allocates the conversion buffers for the current number of channels.
     */
-    float* continuousDataFloatBuffer;
+    void allocateConversionBuffers();
 
     AudioSampleBuffer zeroBuffer;
 
@@ -159,6 +196,10 @@ private:
     */
     int64 timestamp;
 
+    /** Timestamp of the first sample in the current record (DiskWriteThread only).
+    */
+    int64 recordTimestamp;
+
     /** Integer to keep track of the number samples written in each buffer */
     int sampleCount;
 
@@ -192,9 +233,6 @@ private:
     /** Generate filename for a given channel */
     void updateFileName(Channel* ch);
 
-    /** Cycle through the event buffer, looking for data to save */
-    void handleEvent(int eventType, MidiMessage& event, int samplePos);
-
     /** Object for holding information about the events file */
     Channel* eventChannel;
 
@@ -202,9 +240,33 @@ private:
     */
     void writeContinuousBuffer(float* data, int nSamples, int channel);
 
+    /** Writes samples that have already been converted to int16, adding the
+        record header and marker where needed.
+    */
+    void writeIntegerBuffer(int16* data, int nSamples, int channel);
+
+    /** Writes the same range of samples for all recorded channels. The range
+        must not cross a record boundary.
+
+        Returns the number of samples that could not be written to disk.
+    */
+    int writeContinuousSegment(AudioSampleBuffer& data, int startSample, int nSamples, int64 firstTimestamp);
+
+    /** Pads the current record of each recorded channel with zeros and closes
+        it, so that the next samples start a new record (DiskWriteThread only).
+    */
+    void finishCurrentRecord();
+
+    /** Creates one InterleavedFileWriter for each source with recorded channels.
+    */
+    void openInterleavedFiles();
+
+    /** Generates the header for an interleaved file */
+    String generateInterleavedHeader(InterleavedFileWriter* writer, const Array<Channel*>& channels);
+
     /** Method for writing event buffers to disk.
     */
-    void writeEventBuffer(MidiMessage& event, int samplePos);
+    void writeEventBuffer(const uint8* dataptr, int samplePos, int64 bufferTimestamp);
 
     void writeRecordMarker(FILE*);
     void writeTimestampAndSampleCount(FILE*);
@@ -213,6 +275,20 @@ private:
     char* recordMarker;
     
     CriticalSection diskWriteLock;
+
+    /** Performs all disk writes during recording. */
+    ScopedPointer<DiskWriteThread> diskWriteThread;
+
+    friend class DiskWriteThread;
+
+    /** Format used for continuous data (see recordingFormats). */
+    int recordingFormat;
+
+    /** The format the current recording was started with. */
+    int activeRecordingFormat;
+
+    /** One writer per source for the interleaved format. */
+    OwnedArray<InterleavedFileWriter> interleavedWriters;
     
     bool appendTrialNum;
     int trialNum;
@@ -0,0 +1,425 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RecordingReader.h"
+
+// size of the header of a .continuous file, if it doesn't give one
+#define DEFAULT_HEADER_BYTES 1024
+
+// timestamp, sample count and record marker around the samples of a record
+#define RECORD_OVERHEAD_BYTES 20
+
+/** Orders .continuous files by channel: "CH2" comes before "CH10".*/
+class ContinuousFileSorter
+{
+public:
+    static int compareElements(const File& first, const File& second)
+    {
+        const String a = first.getFileNameWithoutExtension();
+        const String b = second.getFileNameWithoutExtension();
+
+        const int byName = a.trimCharactersAtEnd("0123456789")
+                           .compare(b.trimCharactersAtEnd("0123456789"));
+
+        if (byName != 0)
+            return byName;
+
+        return a.getTrailingIntValue() - b.getTrailingIntValue();
+    }
+};
+
+static void convertBigEndian(const char* source, int stride, float* dest, int numSamples, float bitVolts)
+{
+    for (int i = 0; i < numSamples; i++)
+    {
+        dest[i] = bitVolts * (int16) ByteOrder::bigEndianShort(source + i * stride);
+    }
+}
+
+static void convertLittleEndian(const char* source, int stride, float* dest, int numSamples, float bitVolts)
+{
+    for (int i = 0; i < numSamples; i++)
+    {
+        dest[i] = bitVolts * (int16) ByteOrder::littleEndianShort(source + i * stride);
+    }
+}
+
+/** Reads the text header at the start of a file.*/
+static String readHeaderText(const File& file, int numBytes)
+{
+    FileInputStream stream(file);
+
+    if (stream.failedToOpen())
+        return String::empty;
+
+    MemoryBlock block;
+    stream.readIntoMemoryBlock(block, numBytes);
+
+    return String::createStringFromData(block.getData(), (int) block.getSize());
+}
+
+RecordingReader::RecordingReader()
+    : format(CONTINUOUS), numChannels(0), sampleRate(0.0f),
+      numSamples(0), position(0),
+      headerBytes(DEFAULT_HEADER_BYTES), samplesPerRecord(1024), recordBytes(0),
+      rawNumChannels(16), rawSampleRate(30000.0f), rawBitVolts(0.195f)
+{
+}
+
+RecordingReader::~RecordingReader()
+{
+    close();
+}
+
+void RecordingReader::setRawFormat(int numChannels_, float sampleRate_, float bitVolts_)
+{
+    rawNumChannels = jmax(numChannels_, 1);
+    rawSampleRate = sampleRate_;
+    rawBitVolts = bitVolts_;
+}
+
+void RecordingReader::close()
+{
+    files.clear();
+    bitVolts.clear();
+    channelNames.clear();
+    timestampEntries.clear();
+
+    numChannels = 0;
+    numSamples = 0;
+    position = 0;
+}
+
+bool RecordingReader::open(const File& file)
+{
+    close();
+
+    if (!file.existsAsFile())
+    {
+        std::cout << "Can't find data file \"" << file.getFullPathName() << "\"" << std::endl;
+        return false;
+    }
+
+    const bool opened = file.hasFileExtension("continuous") ? openContinuous(file)
+                                                            : openInterleaved(file);
+
+    if (!opened)
+    {
+        close();
+        return false;
+    }
+
+    std::cout << "Opened " << file.getFileName() << ": " << numChannels << " channels, "
+              << numSamples << " samples at " << sampleRate << " Hz." << std::endl;
+
+    return true;
+}
+
+bool RecordingReader::openContinuous(const File& file)
+{
+    format = CONTINUOUS;
+
+    StringPairArray header = parseHeader(readHeaderText(file, DEFAULT_HEADER_BYTES));
+
+    headerBytes = header.getValue("header_bytes", String(DEFAULT_HEADER_BYTES)).getIntValue();
+    samplesPerRecord = header.getValue("blockLength", "1024").getIntValue();
+    recordBytes = RECORD_OVERHEAD_BYTES + 2 * samplesPerRecord;
+    sampleRate = header["sampleRate"].getFloatValue();
+
+    if (headerBytes <= 0 || samplesPerRecord <= 0 || sampleRate <= 0.0f)
+    {
+        std::cout << file.getFileName() << " is not an Open Ephys .continuous file." << std::endl;
+        return false;
+    }
+
+    // RecordNode names the files <processor id>_<channel>[_<trial>].continuous;
+    // the channels of one recording have the same id, trial and length
+    const String name = file.getFileNameWithoutExtension();
+    const String prefix = name.upToFirstOccurrenceOf("_", true, false);
+    const int numParts = StringArray::fromTokens(name, "_", "").size();
+
+    Array<File> siblings;
+    file.getParentDirectory().findChildFiles(siblings, File::findFiles, false, prefix + "*.continuous");
+
+    Array<File> channelFiles;
+
+    for (int i = 0; i < siblings.size(); i++)
+    {
+        if (siblings[i].getSize() == file.getSize()
+            && StringArray::fromTokens(siblings[i].getFileNameWithoutExtension(), "_", "").size() == numParts)
+        {
+            channelFiles.add(siblings[i]);
+        }
+    }
+
+    ContinuousFileSorter sorter;
+    channelFiles.sort(sorter);
+
+    const int64 numRecords = (file.getSize() - headerBytes) / recordBytes;
+
+    for (int i = 0; i < channelFiles.size(); i++)
+    {
+        StringPairArray channelHeader = parseHeader(readHeaderText(channelFiles[i], headerBytes));
+
+        MemoryMappedFile* mappedFile = new MemoryMappedFile(channelFiles[i], MemoryMappedFile::readOnly);
+
+        if (mappedFile->getData() == nullptr)
+        {
+            std::cout << "Could not map " << channelFiles[i].getFullPathName() << std::endl;
+            delete mappedFile;
+            return false;
+        }
+
+        files.add(mappedFile);
+        bitVolts.add(channelHeader.getValue("bitVolts", "1").getFloatValue());
+        channelNames.add(channelHeader.getValue("channel", channelFiles[i].getFileNameWithoutExtension()));
+    }
+
+    numChannels = files.size();
+    numSamples = numRecords * samplesPerRecord;
+
+    return true;
+}
+
+bool RecordingReader::openInterleaved(const File& file)
+{
+    format = INTERLEAVED;
+
+    const File timestampFile = file.withFileExtension("timestamps");
+
+    if (timestampFile.existsAsFile())
+    {
+        String headerText = readHeaderText(timestampFile, DEFAULT_HEADER_BYTES);
+        headerBytes = parseHeader(headerText).getValue("header_bytes", String(DEFAULT_HEADER_BYTES)).getIntValue();
+
+        // the header grows with the number of channels
+        if (headerBytes > DEFAULT_HEADER_BYTES)
+            headerText = readHeaderText(timestampFile, headerBytes);
+
+        StringPairArray header = parseHeader(headerText);
+
+        numChannels = header["numChannels"].getIntValue();
+        sampleRate = header["sampleRate"].getFloatValue();
+        channelNames = parseList(header["channels"]);
+
+        StringArray channelBitVolts = parseList(header["bitVolts"]);
+
+        for (int i = 0; i < numChannels; i++)
+        {
+            bitVolts.add(channelBitVolts[i].getFloatValue());
+        }
+
+        FileInputStream stream(timestampFile);
+        stream.setPosition(headerBytes);
+
+        while (stream.getNumBytesRemaining() >= 16)
+        {
+            timestampEntries.add(stream.readInt64());
+            timestampEntries.add(stream.readInt64());
+        }
+    }
+    else
+    {
+        numChannels = rawNumChannels;
+        sampleRate = rawSampleRate;
+
+        for (int i = 0; i < numChannels; i++)
+        {
+            bitVolts.add(rawBitVolts);
+        }
+    }
+
+    if (numChannels <= 0 || sampleRate <= 0.0f)
+    {
+        std::cout << "Can't read the header of " << timestampFile.getFileName() << std::endl;
+        numChannels = 0;
+        return false;
+    }
+
+    for (int i = channelNames.size(); i < numChannels; i++)
+    {
+        channelNames.add("CH" + String(i + 1));
+    }
+
+    MemoryMappedFile* mappedFile = new MemoryMappedFile(file, MemoryMappedFile::readOnly);
+
+    if (mappedFile->getData() == nullptr)
+    {
+        std::cout << "Could not map " << file.getFullPathName() << std::endl;
+        delete mappedFile;
+        numChannels = 0;
+        return false;
+    }
+
+    files.add(mappedFile);
+
+    numSamples = (int64) mappedFile->getSize() / (2 * numChannels);
+
+    return true;
+}
+
+StringPairArray RecordingReader::parseHeader(const String& header)
+{
+    StringPairArray values;
+
+    StringArray statements;
+    statements.addTokens(header, ";", "'");
+
+    for (int i = 0; i < statements.size(); i++)
+    {
+        const String statement = statements[i].trim();
+
+        if (statement.startsWith("header.") && statement.containsChar('='))
+        {
+            const String key = statement.fromFirstOccurrenceOf("header.", false, false)
+                               .upToFirstOccurrenceOf("=", false, false).trim();
+            const String value = statement.fromFirstOccurrenceOf("=", false, false).trim();
+
+            values.set(key, value.unquoted());
+        }
+    }
+
+    return values;
+}
+
+StringArray RecordingReader::parseList(const String& value)
+{
+    StringArray items;
+    items.addTokens(value.removeCharacters("{}[]"), ",", "'");
+    items.trim();
+
+    for (int i = 0; i < items.size(); i++)
+    {
+        items.set(i, items[i].unquoted());
+    }
+
+    items.removeEmptyStrings();
+
+    return items;
+}
+
+void RecordingReader::seek(int64 sample)
+{
+    if (numSamples > 0)
+        position = ((sample % numSamples) + numSamples) % numSamples;
+}
+
+int64 RecordingReader::getTimestamp()
+{
+    if (!isOpen())
+        return 0;
+
+    if (format == CONTINUOUS)
+    {
+        const int64 record = position / samplesPerRecord;
+        const char* recordStart = static_cast<const char*>(files[0]->getData()) + headerBytes + record * recordBytes;
+
+        uint64 timestamp;
+        memcpy(&timestamp, recordStart, sizeof(timestamp));
+
+        return (int64) ByteOrder::swapIfBigEndian(timestamp) + position % samplesPerRecord;
+    }
+
+    // the last entry at or before the current sample
+    for (int i = timestampEntries.size() - 2; i >= 0; i -= 2)
+    {
+        if (timestampEntries[i + 1] <= position)
+            return timestampEntries[i] + position - timestampEntries[i + 1];
+    }
+
+    return position;
+}
+
+void RecordingReader::read(AudioSampleBuffer& buffer, int numSamplesToRead)
+{
+    read(buffer.getArrayOfChannels(), buffer.getNumChannels(), numSamplesToRead);
+}
+
+void RecordingReader::read(float* const* channelData, int numDestChannels, int numSamplesToRead)
+{
+    if (numSamples == 0)
+    {
+        for (int ch = 0; ch < numDestChannels; ch++)
+            FloatVectorOperations::clear(channelData[ch], numSamplesToRead);
+
+        return;
+    }
+
+    int samplesRead = 0;
+
+    while (samplesRead < numSamplesToRead)
+    {
+        const int count = (int) jmin((int64) (numSamplesToRead - samplesRead), numSamples - position);
+
+        readSection(channelData, numDestChannels, samplesRead, position, count);
+
+        samplesRead += count;
+        position += count;
+
+        if (position == numSamples)
+            position = 0; // play it again
+    }
+
+    for (int ch = numChannels; ch < numDestChannels; ch++)
+        FloatVectorOperations::clear(channelData[ch], numSamplesToRead);
+}
+
+void RecordingReader::readSection(float* const* channelData, int numDestChannels, int destOffset,
+                                  int64 startSample, int count)
+{
+    const int numChannelsToRead = jmin(numChannels, numDestChannels);
+
+    if (format == CONTINUOUS)
+    {
+        while (count > 0)
+        {
+            const int64 record = startSample / samplesPerRecord;
+            const int offset = (int) (startSample % samplesPerRecord);
+            const int numInRecord = jmin(count, samplesPerRecord - offset);
+
+            // skip the timestamp and sample count at the start of the record
+            const int64 byteOffset = headerBytes + record * recordBytes + 10 + 2 * offset;
+
+            for (int ch = 0; ch < numChannelsToRead; ch++)
+            {
+                convertBigEndian(static_cast<const char*>(files[ch]->getData()) + byteOffset, 2,
+                                 channelData[ch] + destOffset, numInRecord, bitVolts.getUnchecked(ch));
+            }
+
+            startSample += numInRecord;
+            destOffset += numInRecord;
+            count -= numInRecord;
+        }
+    }
+    else
+    {
+        const int frameBytes = 2 * numChannels;
+        const char* frames = static_cast<const char*>(files[0]->getData()) + startSample * frameBytes;
+
+        for (int ch = 0; ch < numChannelsToRead; ch++)
+        {
+            convertLittleEndian(frames + 2 * ch, frameBytes,
+                                channelData[ch] + destOffset, count, bitVolts.getUnchecked(ch));
+        }
+    }
+}
@@ -0,0 +1,169 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __RECORDINGREADER_H_2C9E47A1__
+#define __RECORDINGREADER_H_2C9E47A1__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Reads recorded data from memory-mapped files, for replay.
+
+  Two layouts are understood:
+
+  - Open Ephys .continuous files, as written by RecordNode: one file per
+    channel, a text header of HEADER_SIZE bytes, then records of one int64
+    timestamp, one uint16 sample count, that many big-endian int16 samples and
+    a 10-byte marker. Opening one .continuous file opens all files of the same
+    processor and recording in its folder, one channel each.
+
+  - Interleaved little-endian int16 files, such as the .dat files written by
+    InterleavedFileWriter. If there is a .timestamps file next to it, its
+    header gives the number of channels, the sample rate and the bitVolts,
+    and its entries give the timestamps; otherwise the layout set with
+    setRawFormat() is used and the timestamps are the sample numbers.
+
+  Samples are converted straight from the mapped files, so nothing is copied
+  or read ahead. read() wraps around to the start at the end of the recording.
+
+  @see FileReader, FileReaderThread, RecordNode, InterleavedFileWriter
+
+*/
+
+class RecordingReader
+{
+public:
+
+    RecordingReader();
+    ~RecordingReader();
+
+    /** Opens a recording; prints the reason and returns false if it can't.*/
+    bool open(const File& file);
+
+    void close();
+
+    bool isOpen()
+    {
+        return numChannels > 0;
+    }
+
+    /** Sets the layout of interleaved files that have no .timestamps header.
+        Takes effect at the next open().*/
+    void setRawFormat(int numChannels, float sampleRate, float bitVolts);
+
+    int getNumChannels()
+    {
+        return numChannels;
+    }
+
+    float getSampleRate()
+    {
+        return sampleRate;
+    }
+
+    float getBitVolts(int channel)
+    {
+        return bitVolts[channel];
+    }
+
+    String getChannelName(int channel)
+    {
+        return channelNames[channel];
+    }
+
+    /** Returns the length of the recording, in samples per channel.*/
+    int64 getNumSamples()
+    {
+        return numSamples;
+    }
+
+    /** Returns the next sample that read() will return.*/
+    int64 getPosition()
+    {
+        return position;
+    }
+
+    /** Moves to a sample; positions past the end wrap around.*/
+    void seek(int64 sample);
+
+    /** Returns the recorded timestamp of the sample at the current position.*/
+    int64 getTimestamp();
+
+    /** Reads numSamples samples of each channel, in the units given by their
+        bitVolts, into the first channels of buffer, and advances the position.*/
+    void read(AudioSampleBuffer& buffer, int numSamples);
+
+    /** Same as read(), for an array of channel pointers.*/
+    void read(float* const* channelData, int numDestChannels, int numSamples);
+
+private:
+
+    enum Format
+    {
+        CONTINUOUS, INTERLEAVED
+    };
+
+    bool openContinuous(const File& file);
+    bool openInterleaved(const File& file);
+
+    /** Reads the "header.name = value;" pairs of a text header.*/
+    static StringPairArray parseHeader(const String& header);
+
+    /** Splits a header value like "{'CH1', 'CH2'}" or "[0.195, 0.195]".*/
+    static StringArray parseList(const String& value);
+
+    /** Reads samples that don't cross the end of the recording.*/
+    void readSection(float* const* channelData, int numDestChannels, int destOffset,
+                     int64 startSample, int numSamples);
+
+    Format format;
+
+    OwnedArray<MemoryMappedFile> files;
+
+    int numChannels;
+    float sampleRate;
+    Array<float> bitVolts;
+    StringArray channelNames;
+
+    int64 numSamples;
+    int64 position;
+
+    /** Header size and record length of .continuous files.*/
+    int headerBytes;
+    int samplesPerRecord;
+    int recordBytes;
+
+    /** (timestamp, sample number) pairs of an interleaved recording.*/
+    Array<int64> timestampEntries;
+
+    int rawNumChannels;
+    float rawSampleRate;
+    float rawBitVolts;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RecordingReader);
+
+};
+
+
+#endif  // __RECORDINGREADER_H_2C9E47A1__
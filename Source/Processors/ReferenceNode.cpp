@@ -22,13 +22,22 @@
 */
 
 #include <stdio.h>
+#include <algorithm>
 #include "ReferenceNode.h"
 #include "Editors/ReferenceNodeEditor.h"
 
+// samples per chunk for the common average (a chunk of every channel of a
+// group should stay in the cache between summing and subtracting)
+#define AVERAGE_CHUNK_SIZE 256
+
+// samples per chunk for the common median (the channels are far apart in
+// memory, so a run of samples of each is transposed at once)
+#define MEDIAN_CHUNK_SIZE 64
 
 
 ReferenceNode::ReferenceNode()
-    : GenericProcessor("Digital Ref"), referenceChannel(-1), referenceBuffer(1,10000)
+    : GenericProcessor("Digital Ref"), referenceChannel(-1), referenceMode(SINGLE_CHANNEL),
+      groupSize(0), referenceBuffer(1,10000), medianBufferChannels(0)
 {
 
 }
@@ -52,7 +61,11 @@ AudioProcessorEditor* ReferenceNode::createEditor()
 void ReferenceNode::updateSettings()
 {
 
-
+    if (getNumInputs() > medianBufferChannels)
+    {
+        medianBufferChannels = getNumInputs();
+        medianBuffer.malloc(MEDIAN_CHUNK_SIZE * medianBufferChannels);
+    }
 
 }
 
@@ -60,9 +73,24 @@ void ReferenceNode::setParameter(int parameterIndex, float newValue)
 {
     editor->updateParameterButtons(parameterIndex);
 
-    referenceChannel = (int) newValue;
+    if (parameterIndex == 2)
+    {
+        referenceMode = (int) newValue;
 
-    std::cout << "Reference set to " << referenceChannel << std::endl;
+        std::cout << "Reference mode set to " << referenceMode << std::endl;
+    }
+    else if (parameterIndex == 3)
+    {
+        groupSize = jmax(0, (int) newValue);
+
+        std::cout << "Reference group size set to " << groupSize << std::endl;
+    }
+    else
+    {
+        referenceChannel = (int) newValue;
+
+        std::cout << "Reference set to " << referenceChannel << std::endl;
+    }
 
 }
 
@@ -71,7 +99,25 @@ void ReferenceNode::process(AudioSampleBuffer& buffer,
                             int& nSamples)
 {
 
-    if (referenceChannel > -1)
+    if (referenceMode != SINGLE_CHANNEL)
+    {
+        const int numChannels = jmin(getNumInputs(), buffer.getNumChannels(), medianBufferChannels);
+        const int numSamples = jmin(nSamples, referenceBuffer.getNumSamples());
+        const int channelsPerGroup = (groupSize > 0) ? groupSize : numChannels;
+
+        for (int first = 0; first < numChannels; first += channelsPerGroup)
+        {
+            float* const* channelData = buffer.getArrayOfChannels() + first;
+            const int numGroupChannels = jmin(channelsPerGroup, numChannels - first);
+
+            if (referenceMode == COMMON_AVERAGE)
+                subtractCommonAverage(channelData, numGroupChannels, numSamples);
+            else
+                subtractCommonMedian(channelData, numGroupChannels, numSamples);
+        }
+
+    }
+    else if (referenceChannel > -1)
     {
         referenceBuffer.clear(0, 0, nSamples);
 
@@ -101,3 +147,66 @@ void ReferenceNode::process(AudioSampleBuffer& buffer,
 
 }
 
+void ReferenceNode::subtractCommonAverage(float* const* channelData, int numChannels, int numSamples)
+{
+    float* mean = referenceBuffer.getSampleData(0);
+    const float scale = 1.0f / float(numChannels);
+
+    for (int start = 0; start < numSamples; start += AVERAGE_CHUNK_SIZE)
+    {
+        const int n = jmin(AVERAGE_CHUNK_SIZE, numSamples - start);
+
+        FloatVectorOperations::copy(mean, channelData[0] + start, n);
+
+        for (int ch = 1; ch < numChannels; ch++)
+            FloatVectorOperations::add(mean, channelData[ch] + start, n);
+
+        FloatVectorOperations::multiply(mean, -scale, n);
+
+        for (int ch = 0; ch < numChannels; ch++)
+            FloatVectorOperations::add(channelData[ch] + start, mean, n);
+    }
+
+}
+
+void ReferenceNode::subtractCommonMedian(float* const* channelData, int numChannels, int numSamples)
+{
+    float medians[MEDIAN_CHUNK_SIZE];
+    const int middle = numChannels / 2;
+
+    for (int start = 0; start < numSamples; start += MEDIAN_CHUNK_SIZE)
+    {
+        const int n = jmin(MEDIAN_CHUNK_SIZE, numSamples - start);
+
+        // row i holds sample i of every channel
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            const float* source = channelData[ch] + start;
+
+            for (int i = 0; i < n; i++)
+                medianBuffer[i * numChannels + ch] = source[i];
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            float* row = medianBuffer + i * numChannels;
+
+            std::nth_element(row, row + middle, row + numChannels);
+            medians[i] = row[middle];
+
+            // with an even number of channels, the lower middle value is the
+            // largest one in front of the upper one
+            if ((numChannels & 1) == 0)
+                medians[i] = 0.5f * (medians[i] + *std::max_element(row, row + middle));
+        }
+
+        for (int ch = 0; ch < numChannels; ch++)
+        {
+            float* dest = channelData[ch] + start;
+
+            for (int i = 0; i < n; i++)
+                dest[i] -= medians[i];
+        }
+    }
+
+}
@@ -34,6 +34,15 @@
 
   Digital reference node
 
+  Subtracts a reference from every channel: either a single channel (including from itself),
+  or the common average or common median of the channel's group. Groups are consecutive
+  channels, e.g. the channels of one shank or one headstage; by default all channels are
+  in one group.
+
+  The average is computed with vector operations over chunks of samples. For the median,
+  chunks of 64 samples are transposed so that all channels of one sample are contiguous,
+  and the median of each sample is found with std::nth_element.
+
   @see GenericProcessor
 
 */
@@ -60,10 +69,29 @@ public:
 
 private:
 
+    enum ReferenceMode
+    {
+        SINGLE_CHANNEL = 0,
+        COMMON_AVERAGE,
+        COMMON_MEDIAN
+    };
+
+    /** Subtract the mean or the median of numChannels channels from each of them.*/
+    void subtractCommonAverage(float* const* channelData, int numChannels, int numSamples);
+    void subtractCommonMedian(float* const* channelData, int numChannels, int numSamples);
+
     int referenceChannel;
+    int referenceMode;
+
+    /** Number of channels per group; 0 puts all channels in one group.*/
+    int groupSize;
 
     AudioSampleBuffer referenceBuffer;
 
+    /** A few samples of all channels of a group, sample-major.*/
+    HeapBlock<float> medianBuffer;
+    int medianBufferChannels;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ReferenceNode);
 
 };
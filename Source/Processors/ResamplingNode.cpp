@@ -28,12 +28,9 @@
 
 ResamplingNode::ResamplingNode()
     : GenericProcessor("Resampler"),
-      targetSampleRate(5000.0f), ratio(1.0)
+      targetSampleRate(5000.0f), sourceBufferSampleRate(44100.0), numPendingSamples(0)
 {
 
-    filter = new Dsp::SmoothedFilterDesign
-    <Dsp::RBJ::Design::LowPass, 1> (1024);
-
     parameters.add(Parameter("Hz",500.0f, 10000.0f, targetSampleRate, 0, true));
 
     tempBuffer = new AudioSampleBuffer(16, TEMP_BUFFER_WIDTH);
@@ -42,7 +39,7 @@ ResamplingNode::ResamplingNode()
 
 ResamplingNode::~ResamplingNode()
 {
-    filter = 0;
+
 }
 
 AudioProcessorEditor* ResamplingNode::createEditor()
@@ -65,17 +62,15 @@ void ResamplingNode::setParameter(int parameterIndex, float newValue)
 
         targetSampleRate = newValue;
 
-        settings.sampleRate = targetSampleRate;
+        updateResampler();
 
-        ratio = sourceBufferSampleRate / targetSampleRate;
+        settings.sampleRate = resampler.getTargetRate();
 
         for (int i = 0; i < channels.size(); i++)
         {
-            channels[i]->sampleRate = targetSampleRate;
+            channels[i]->sampleRate = settings.sampleRate;
         }
 
-        updateFilter();
-
         //std::cout << "Got parameter update." << std::endl;
     }
 
@@ -86,10 +81,10 @@ void ResamplingNode::setParameter(int parameterIndex, float newValue)
 bool ResamplingNode::enable()
 {
 
-
     tempBuffer->clear();
+    numPendingSamples = 0;
 
-    updateFilter();
+    resampler.reset();
 
     return true;
 
@@ -99,137 +94,68 @@ void ResamplingNode::updateSettings()
 {
 
     sourceBufferSampleRate = settings.sampleRate;
-    settings.sampleRate = targetSampleRate;
 
     if (getNumInputs() > 0)
         tempBuffer->setSize(getNumInputs(), TEMP_BUFFER_WIDTH);
 
-    ratio = sourceBufferSampleRate / targetSampleRate;
+    updateResampler();
+
+    settings.sampleRate = resampler.getTargetRate();
 
     for (int i = 0; i < channels.size(); i++)
     {
-        channels[i]->sampleRate = targetSampleRate;
+        channels[i]->sampleRate = settings.sampleRate;
     }
 
-    updateFilter();
-
 }
 
 
-void ResamplingNode::updateFilter()
+void ResamplingNode::updateResampler()
 {
 
-    double cutoffFreq = (ratio > 1.0) ? 2 * targetSampleRate  // downsample
-                        : targetSampleRate / 2; // upsample
-
-    double sampleFreq = (ratio > 1.0) ? sourceBufferSampleRate // downsample
-                        : targetSampleRate;  // upsample
+    resampler.setRates(getNumInputs(), sourceBufferSampleRate, targetSampleRate);
 
-    Dsp::Params params;
-    params[0] = sampleFreq; // sample rate
-    params[1] = cutoffFreq; // cutoff frequency
-    params[2] = 1.25; //Q //
-
-    filter->setParams(params);
+    std::cout << "Resampler: " << sourceBufferSampleRate << " Hz to " << resampler.getTargetRate()
+              << " Hz in " << resampler.getNumStages() << " stages ("
+              << PolyphaseResampler::getInstructionSet() << ")" << std::endl;
 
 }
 
-// void ResamplingNode::releaseResources()
-// {
-// 	//fclose(file);
-// }
-
 void ResamplingNode::process(AudioSampleBuffer& buffer,
                              MidiBuffer& midiMessages,
                              int& nSamples)
 {
 
-    //std::cout << "Resampling node sample count: " << nSamples << std::endl; ///buffer.getNumSamples() << std::endl;
+    const int numChannels = jmin(getNumInputs(), buffer.getNumChannels());
 
-    // save data at the beginning of each round of processing
-    //writeContinuousBuffer(buffer.getSampleData(0), nSamples, 0);
-
-
-    int nSamps = float(nSamples);
-    int valuesNeeded = int(nSamps / ratio);
-
-    if (ratio > 1.0001)
+    if (numPendingSamples == 0
+        && resampler.getUpsamplingFactor() <= resampler.getDownsamplingFactor())
     {
-        // pre-apply filter before downsampling
-        filter->process(nSamples, buffer.getArrayOfChannels());
+        // downsampling never writes past the samples it has read
+        nSamples = resampler.process(buffer.getArrayOfChannels(), nSamples,
+                                     buffer.getArrayOfChannels());
+        return;
     }
 
-    // initialize variables
-    tempBuffer->clear();
-    int sourceBufferPos = 0;
-    int sourceBufferSize = buffer.getNumSamples();
-    float subSampleOffset = 0.0;
-    int nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-
-    int tempBufferPos;
-
-    // code modified from "juce_ResamplingAudioSource.cpp":
+    const int maxNumSamples = numPendingSamples + resampler.getMaxNumOutputSamples(nSamples);
 
-    for (tempBufferPos = 0; tempBufferPos < valuesNeeded; tempBufferPos++)
-    {
-        float gain = 1.0;
-        float alpha = (float) subSampleOffset;
-        float invAlpha = 1.0f - alpha;
+    if (tempBuffer->getNumSamples() < maxNumSamples)
+        tempBuffer->setSize(tempBuffer->getNumChannels(), maxNumSamples, true);
 
-        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-        {
+    const int numSamples = numPendingSamples
+                           + resampler.process(buffer.getArrayOfChannels(), nSamples,
+                                               tempBuffer->getArrayOfChannels(), numPendingSamples);
 
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,  // destSampleOffset
-                                buffer,			// source
-                                channel,		// sourceChannel
-                                sourceBufferPos,// sourceSampleOffset
-                                1,				// number of samples
-                                invAlpha*gain);      // gain to apply to source
-
-            tempBuffer->addFrom(channel, 		// destChannel
-                                tempBufferPos,   // destSampleOffset
-                                buffer,			// source
-                                channel,			// sourceChannel
-                                nextPos,		 	// sourceSampleOffset
-                                1,				// number of samples
-                                alpha*gain);     	 // gain to apply to source
+    nSamples = jmin(numSamples, buffer.getNumSamples());
+    numPendingSamples = numSamples - nSamples;
 
-        }
-
-        subSampleOffset += ratio;
-
-        while (subSampleOffset >= 1.0)
-        {
-            if (++sourceBufferPos >= sourceBufferSize)
-                sourceBufferPos = 0;
-
-            nextPos = (sourceBufferPos + 1) % sourceBufferSize;
-            subSampleOffset -= 1.0;
-        }
-    }
-
-    // std::cout << sourceBufferPos << " " << tempBufferPos << std::endl;
-
-
-    if (ratio < 0.9999)
-    {
-
-        filter->process(tempBufferPos, tempBuffer->getArrayOfChannels());
-        // apply the filter after upsampling
-        ///////filter->process (totalSamples, buffer.getArrayOfChannels());
-    }
-    else if (ratio <= 1.0001)
+    for (int i = 0; i < numChannels; i++)
     {
+        buffer.copyFrom(i, 0, *tempBuffer, i, 0, nSamples);
 
-        // no resampling is being applied, no need to filter, BUT...
-        // keep the filter stoked with samples to avoid discontinuities
-
+        if (numPendingSamples > 0)
+            memmove(tempBuffer->getSampleData(i), tempBuffer->getSampleData(i, nSamples),
+                    numPendingSamples * sizeof(float));
     }
 
-    // copy the tempBuffer back into the original buffer
-    buffer = AudioSampleBuffer(tempBuffer->getArrayOfChannels(), 2, tempBufferPos);//buffer.getNumSamples());
-
-    nSamples = valuesNeeded;
-
 }
@@ -26,8 +26,8 @@
 
 
 #include "../../JuceLibraryCode/JuceHeader.h"
-#include "../Dsp/Dsp.h"
 #include "GenericProcessor.h"
+#include "PolyphaseResampler.h"
 
 #define TEMP_BUFFER_WIDTH 5000
 
@@ -35,9 +35,11 @@
 
   Changes the sample rate of continuous data.
 
-  Code is based on Juce's ResamplingAudioSource class.
+  Uses a PolyphaseResampler, so the signal stays continuous across buffers
+  and is low-pass filtered before decimation. When upsampling produces more
+  samples than fit into the buffer, the rest are sent with the next one.
 
-  @see GenericProcessor
+  @see GenericProcessor, PolyphaseResampler
 
 */
 
@@ -55,7 +57,8 @@ public:
 
     void updateSettings();
 
-    void updateFilter();
+    /** Designs the resampler for the current input and target rates.*/
+    void updateResampler();
 
     bool enable();
 
@@ -67,24 +70,16 @@ public:
 
 private:
 
-    // sample rate, timebase, and ratio info:
+    // sample rate info:
     double targetSampleRate;
-    double sourceBufferSampleRate; //, destBufferSampleRate;
-    double ratio; //, lastRatio;
-    //double destBufferTimebaseSecs;
-    //int destBufferWidth;
-
-    // major objects:
-    Dsp::Filter* filter;
-    //ScopedPointer<AudioSampleBuffer> destBuffer;
-    ScopedPointer<AudioSampleBuffer> tempBuffer;
+    double sourceBufferSampleRate;
 
-    // is the destBuffer a temp buffer or not?
-    //bool destBufferIsTempBuffer;
-    //bool isTransmitting;
+    PolyphaseResampler resampler;
 
-    // indexing objects that persist between rounds:
-    //int destBufferPos;
+    // output of the resampler when it can't be written in place; samples
+    // that didn't fit into the last buffer wait at its start
+    ScopedPointer<AudioSampleBuffer> tempBuffer;
+    int numPendingSamples;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResamplingNode);
 
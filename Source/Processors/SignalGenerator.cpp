@@ -27,14 +27,253 @@
 #include <math.h>
 #include "Visualization/SpikeObject.h"
 
-#ifdef WIN32
-#define copysign(x,y) _copysign(x,y)
+#if defined(__AVX__)
+ #include <immintrin.h>
+ #define SIGNAL_GENERATOR_AVX 1
+ #define SIGNAL_GENERATOR_SSE2 1 // the phases and the noise only need SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define SIGNAL_GENERATOR_SSE2 1
 #endif
 
+// Phases are stored as unsigned fractions of a cycle (2^32 is one cycle). The
+// kernels work on the "centred" phase q = phase - 0.5, in [-0.5, 0.5), which
+// is what converting the accumulator with its top bit flipped gives directly.
+
+static const float phaseScale = 1.0f / 4294967296.0f;
+static const float noiseScale = 1.0f / 2147483648.0f;
+
+// Taylor coefficients of sin(2 pi r) for |r| <= 0.25 (error below 1e-7)
+static const float sinC1 = 6.28318531f;
+static const float sinC3 = -41.3417022f;
+static const float sinC5 = 81.6052493f;
+static const float sinC7 = -76.7058597f;
+static const float sinC9 = 42.0587743f;
+static const float sinC11 = -15.0946426f;
+
+static const int numNoiseLanes = 8;
+
+/** Writes the centred phase of numSamples samples.*/
+static void generatePhase(float* q, uint32 start, uint32 increment, int numSamples)
+{
+    int i = 0;
+
+#if SIGNAL_GENERATOR_SSE2
+    const __m128i topBit = _mm_set1_epi32(0x80000000);
+    const __m128i step = _mm_set1_epi32((int) (increment * 4));
+    const __m128 scale = _mm_set1_ps(phaseScale);
+
+    __m128i p = _mm_set_epi32((int) (start + increment * 3), (int) (start + increment * 2),
+                              (int) (start + increment), (int) start);
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        _mm_storeu_ps(q + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_xor_si128(p, topBit)), scale));
+        p = _mm_add_epi32(p, step);
+    }
+#endif
+
+    for (; i < numSamples; i++)
+    {
+        q[i] = float((int32) ((start + increment * (uint32) i) ^ 0x80000000)) * phaseScale;
+    }
+}
+
+/** Turns centred phases into a sine wave, in place.*/
+static void generateSine(float* data, float amplitude, int numSamples)
+{
+    // sin(2 pi (q + 0.5)) = -sin(2 pi q), and sin(2 pi q) = sin(2 pi r) with
+    // r = copysign(min(|q|, 0.5 - |q|), q), so that |r| <= 0.25
+    const float gain = -amplitude;
+    int i = 0;
+
+#if SIGNAL_GENERATOR_AVX
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 g = _mm256_set1_ps(gain);
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        const __m256 q = _mm256_loadu_ps(data + i);
+        const __m256 sign = _mm256_and_ps(q, signMask);
+        const __m256 a = _mm256_andnot_ps(signMask, q);
+        const __m256 r = _mm256_or_ps(_mm256_min_ps(a, _mm256_sub_ps(half, a)), sign);
+        const __m256 r2 = _mm256_mul_ps(r, r);
+
+        __m256 s = _mm256_set1_ps(sinC11);
+        s = _mm256_add_ps(_mm256_mul_ps(s, r2), _mm256_set1_ps(sinC9));
+        s = _mm256_add_ps(_mm256_mul_ps(s, r2), _mm256_set1_ps(sinC7));
+        s = _mm256_add_ps(_mm256_mul_ps(s, r2), _mm256_set1_ps(sinC5));
+        s = _mm256_add_ps(_mm256_mul_ps(s, r2), _mm256_set1_ps(sinC3));
+        s = _mm256_add_ps(_mm256_mul_ps(s, r2), _mm256_set1_ps(sinC1));
+
+        _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_mul_ps(s, r), g));
+    }
+#elif SIGNAL_GENERATOR_SSE2
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 g = _mm_set1_ps(gain);
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const __m128 q = _mm_loadu_ps(data + i);
+        const __m128 sign = _mm_and_ps(q, signMask);
+        const __m128 a = _mm_andnot_ps(signMask, q);
+        const __m128 r = _mm_or_ps(_mm_min_ps(a, _mm_sub_ps(half, a)), sign);
+        const __m128 r2 = _mm_mul_ps(r, r);
+
+        __m128 s = _mm_set1_ps(sinC11);
+        s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(sinC9));
+        s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(sinC7));
+        s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(sinC5));
+        s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(sinC3));
+        s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(sinC1));
+
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_mul_ps(s, r), g));
+    }
+#endif
+
+    for (; i < numSamples; i++)
+    {
+        const float q = data[i];
+        const float a = fabsf(q);
+        const float r = (q < 0.0f) ? -jmin(a, 0.5f - a) : jmin(a, 0.5f - a);
+        const float r2 = r * r;
+
+        float s = sinC11;
+        s = s * r2 + sinC9;
+        s = s * r2 + sinC7;
+        s = s * r2 + sinC5;
+        s = s * r2 + sinC3;
+        s = s * r2 + sinC1;
+
+        data[i] = s * r * gain;
+    }
+}
+
+/** Turns centred phases into a square wave (high during the first half of
+    each cycle, like the sine), in place.*/
+static void generateSquare(float* data, float amplitude, int numSamples)
+{
+    int i = 0;
+
+#if SIGNAL_GENERATOR_AVX
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 high = _mm256_set1_ps(amplitude);
+    const __m256 low = _mm256_set1_ps(-amplitude);
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        const __m256 isHigh = _mm256_cmp_ps(_mm256_loadu_ps(data + i), zero, _CMP_LT_OQ);
+        _mm256_storeu_ps(data + i, _mm256_or_ps(_mm256_and_ps(isHigh, high), _mm256_andnot_ps(isHigh, low)));
+    }
+#elif SIGNAL_GENERATOR_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 high = _mm_set1_ps(amplitude);
+    const __m128 low = _mm_set1_ps(-amplitude);
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const __m128 isHigh = _mm_cmplt_ps(_mm_loadu_ps(data + i), zero);
+        _mm_storeu_ps(data + i, _mm_or_ps(_mm_and_ps(isHigh, high), _mm_andnot_ps(isHigh, low)));
+    }
+#endif
+
+    for (; i < numSamples; i++)
+    {
+        data[i] = (data[i] < 0.0f) ? amplitude : -amplitude;
+    }
+}
+
+/** Turns centred phases into a triangle wave (lowest at the start of each
+    cycle, highest halfway), in place.*/
+static void generateTriangle(float* data, float amplitude, int numSamples)
+{
+    // 1 - 4|q|
+    int i = 0;
+
+#if SIGNAL_GENERATOR_AVX
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 g = _mm256_set1_ps(-4.0f * amplitude);
+    const __m256 offset = _mm256_set1_ps(amplitude);
+
+    for (; i + 8 <= numSamples; i += 8)
+    {
+        const __m256 a = _mm256_andnot_ps(signMask, _mm256_loadu_ps(data + i));
+        _mm256_storeu_ps(data + i, _mm256_add_ps(_mm256_mul_ps(a, g), offset));
+    }
+#elif SIGNAL_GENERATOR_SSE2
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 g = _mm_set1_ps(-4.0f * amplitude);
+    const __m128 offset = _mm_set1_ps(amplitude);
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const __m128 a = _mm_andnot_ps(signMask, _mm_loadu_ps(data + i));
+        _mm_storeu_ps(data + i, _mm_add_ps(_mm_mul_ps(a, g), offset));
+    }
+#endif
+
+    for (; i < numSamples; i++)
+    {
+        data[i] = fabsf(data[i]) * (-4.0f * amplitude) + amplitude;
+    }
+}
+
+/** Turns centred phases into a rising saw wave, in place.*/
+static void generateSaw(float* data, float amplitude, int numSamples)
+{
+    // 2q, from -1 at the start of each cycle to 1 at its end
+    FloatVectorOperations::multiply(data, 2.0f * amplitude, numSamples);
+}
+
+/** Writes uniform noise in [-amplitude, amplitude); sample i comes from
+    generator i % 8, so every instruction set gives the same values.*/
+static void generateNoise(float* data, uint32* state, float amplitude, int numSamples)
+{
+    const float gain = amplitude * noiseScale;
+    int i = 0;
+
+#if SIGNAL_GENERATOR_SSE2
+    __m128i s0 = _mm_loadu_si128((const __m128i*) state);
+    __m128i s1 = _mm_loadu_si128((const __m128i*) (state + 4));
+    const __m128 g = _mm_set1_ps(gain);
+
+    for (; i + numNoiseLanes <= numSamples; i += numNoiseLanes)
+    {
+        // xorshift32 (13, 17, 5)
+        s0 = _mm_xor_si128(s0, _mm_slli_epi32(s0, 13));
+        s1 = _mm_xor_si128(s1, _mm_slli_epi32(s1, 13));
+        s0 = _mm_xor_si128(s0, _mm_srli_epi32(s0, 17));
+        s1 = _mm_xor_si128(s1, _mm_srli_epi32(s1, 17));
+        s0 = _mm_xor_si128(s0, _mm_slli_epi32(s0, 5));
+        s1 = _mm_xor_si128(s1, _mm_slli_epi32(s1, 5));
+
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_cvtepi32_ps(s0), g));
+        _mm_storeu_ps(data + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(s1), g));
+    }
+
+    _mm_storeu_si128((__m128i*) state, s0);
+    _mm_storeu_si128((__m128i*) (state + 4), s1);
+#endif
+
+    for (; i < numSamples; i++)
+    {
+        uint32& s = state[i % numNoiseLanes];
+
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+
+        data[i] = float((int32) s) * gain;
+    }
+}
+
 SignalGenerator::SignalGenerator()
     : GenericProcessor("Signal Generator"),
       nOut(5), defaultFrequency(10.0), defaultAmplitude(0.5f),
-      previousPhase(1000), spikeDelay(0)
+      sampleRate(44100.0f), sampleRateRatio(1.0), samplesOwed(0.0),
+      numNoiseChannels(0), noiseSeed(1)
 {
     parameters.add(Parameter("Amplitude", 0.0005f, 500.0f, .5f, 0, true));
     parameters.add(Parameter("Frequency", 0.01, 10000.0, 10, 1, true));
@@ -62,6 +301,17 @@ AudioProcessorEditor* SignalGenerator::createEditor()
     return editor;
 }
 
+const char* SignalGenerator::getInstructionSet()
+{
+#if SIGNAL_GENERATOR_AVX
+    return "AVX";
+#elif SIGNAL_GENERATOR_SSE2
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
 void SignalGenerator::updateSettings()
 {
 
@@ -73,16 +323,74 @@ void SignalGenerator::updateSettings()
         frequency.add(defaultFrequency);
         amplitude.add(defaultAmplitude);
         phase.add(0);
-        phasePerSample.add(double_Pi * 2.0 / (getSampleRate() / frequency.getLast()));
+        phaseIncrement.add(0);
         currentPhase.add(0);
+
+        SpikeState spikeState = { 0, 0, 0 };
+        spikeStates.add(spikeState);
+    }
+
+    for (int n = 0; n < waveformType.size(); n++)
+    {
+        updatePhaseIncrement(n);
+    }
+
+    if (numNoiseChannels < waveformType.size())
+    {
+        numNoiseChannels = waveformType.size();
+        noiseState.malloc(numNoiseChannels * numNoiseLanes);
+        resetNoise();
     }
 
     sampleRateRatio = getSampleRate() / 44100.0;
+    samplesOwed = 0.0;
 
     std::cout << "Sample rate ratio: " << sampleRateRatio << std::endl;
 
 }
 
+void SignalGenerator::updatePhaseIncrement(int chan)
+{
+    const double cyclesPerSample = frequency[chan] / getDefaultSampleRate();
+
+    phaseIncrement.set(chan, (uint32) (int64) (cyclesPerSample * 4294967296.0));
+}
+
+void SignalGenerator::setSampleRate(float rate)
+{
+    sampleRate = rate;
+
+    for (int n = 0; n < waveformType.size(); n++)
+    {
+        updatePhaseIncrement(n);
+    }
+}
+
+void SignalGenerator::setNoiseSeed(int64 seed)
+{
+    noiseSeed = seed;
+
+    resetNoise();
+}
+
+void SignalGenerator::resetNoise()
+{
+    // different, non-zero starting states for every generator
+    Random seeder(noiseSeed);
+
+    for (int n = 0; n < numNoiseChannels * numNoiseLanes; n++)
+    {
+        uint32 s = 0;
+
+        while (s == 0)
+            s = (uint32) seeder.nextInt();
+
+        noiseState[n] = s;
+    }
+
+    spikeRandom.setSeed(noiseSeed);
+}
+
 void SignalGenerator::setParameter(int parameterIndex, float newValue)
 {
     editor->updateParameterButtons(parameterIndex);
@@ -101,7 +409,7 @@ void SignalGenerator::setParameter(int parameterIndex, float newValue)
         else if (parameterIndex == 1)
         {
             frequency.set(currentChannel,newValue);
-            phasePerSample.set(currentChannel, double_Pi * 2.0 / (getSampleRate() / frequency[currentChannel]));
+            updatePhaseIncrement(currentChannel);
             parameterPointer->setValue(newValue, currentChannel);
         }
         else if (parameterIndex == 2)
@@ -114,7 +422,6 @@ void SignalGenerator::setParameter(int parameterIndex, float newValue)
             waveformType.set(currentChannel, (int) newValue);
             parameterPointer->setValue(newValue, currentChannel);
         }
-        //updateWaveform(currentChannel);
     }
 
 }
@@ -125,56 +432,12 @@ bool SignalGenerator::enable()
 
     std::cout << "Signal generator received enable signal." << std::endl;
 
-    // for (int n = 0; n < waveformType.size(); n++)
-    // {
-    // 	updateWaveform(n);
-
-    // }
+    resetNoise();
+    samplesOwed = 0.0;
 
     return true;
 }
 
-// void SignalGenerator::updateWaveform(int n)
-// {
-
-// Array<float> cycleData;
-
-// int cycleLength = int(getSampleRate() / frequency[n]);
-// float phasePerSample = double_Pi * 2.0 / (getSampleRate() / frequency[n]);
-
-// cycleData.ensureStorageAllocated(cycleLength);
-
-// for (int i = 0; i < cycleLength; i++)
-// {
-// 	switch (waveformType[n])
-// 	{
-// 		case SINE:
-// 			cycleData.add(amplitude[n] * std::sin(i*phasePerSample + phase[n]));
-// 			break;
-// 		case SQUARE:
-// 			cycleData.add(amplitude[n] * copysign(1,std::sin(i*phasePerSample + phase[n])));
-// 			break;
-// 		case TRIANGLE:
-// 			cycleData.add(0);
-// 			break;
-// 		case SAW:
-// 			cycleData.add(0);
-// 			break;
-// 		case NOISE:
-// 			cycleData.add(0);
-// 			break;
-// 		default:
-// 			cycleData.set(i, 0);
-// 	}
-
-// }
-
-// waveforms.set(n, cycleData);
-
-// currentSample.set(n,0);
-
-// }
-
 bool SignalGenerator::disable()
 {
 
@@ -188,153 +451,99 @@ void SignalGenerator::process(AudioSampleBuffer& buffer,
                               int& nSamps)
 {
 
-    nSamps = int((float) buffer.getNumSamples() * sampleRateRatio);
-
-    for (int i = 0; i < nSamps; ++i)
-    {
-        for (int j = buffer.getNumChannels(); --j >= 0;)
-        {
-
-            float sample;
-
-            switch (waveformType[j])
-            {
-                case SINE:
-                    sample = amplitude[j] * (float) std::sin(currentPhase[j] + phase[j]);
-                    break;
-                case SQUARE:
-                    sample = amplitude[j] * copysign(1,std::sin(currentPhase[j] + phase[j]));
-                    break;
-                case TRIANGLE:
-                    sample = amplitude[j] * ((currentPhase[j] + phase[j]) / double_Pi - 1) *
-                             copysign(2,std::sin(currentPhase[j] + phase[j]));
-                    break;
-                case SAW:
-                    sample = amplitude[j] * ((currentPhase[j] + phase[j]) / double_Pi - 1);
-                    break;
-                case NOISE:
-                    // sample = amplitude[j] * (float(rand()) / float(RAND_MAX)-0.5f);
-                    // break;
-                case SPIKE:
-                    sample = generateSpikeSample(amplitude[j], currentPhase[j], phase[j]);
-                    break;
-                default:
-                    sample = 0;
-            }
-
-            currentPhase.set(j,currentPhase[j] + phasePerSample[j]);
-
-            if (currentPhase[j] > double_Pi*2)
-                currentPhase.set(j,0);
-
-            // dereference pointer to one of the buffer's samples
-            *buffer.getSampleData(j, i) = sample;
-        }
-    }
-
+    // carry the fraction over, so the mean rate is exact
+    samplesOwed += double(buffer.getNumSamples()) * sampleRateRatio;
 
-    // for (int chan = 0; chan < buffer.getNumChannels(); chan++)
-    // {
+    nSamps = jmin(int(samplesOwed), buffer.getNumSamples());
 
-    // 	int dataSize = waveforms[chan].size();
-    // 	int destSample = -dataSize;
-    // 	int lastSample = dataSize;
+    samplesOwed = jmin(samplesOwed - nSamps, 1.0);
 
-    // 	while (lastSample < nSamps)
-    // 	{
+    const int numChannels = jmin(buffer.getNumChannels(), waveformType.size());
 
-    // 		destSample += dataSize;
-
-    // 		//std::cout << lastSample << " " << destSample << " " << currentSample[chan] << " " << dataSize << std::endl;
-
-    // 		// buffer.copyFrom(chan,
-    // 		//  				destSample,
-    // 		//  				waveforms[chan].getRawDataPointer() + currentSample[chan],
-    // 		//  				dataSize - currentSample[chan]);
-
-    // 		lastSample += dataSize;
-
-    // 		currentSample.set(chan,0);
-
-    // 		//std::cout << "DONE" << std::endl;
-    // 	}
-
-    // 	//std::cout << lastSample << " " << destSample << " " << currentSample[chan] << " " << dataSize << std::endl;
-
-    // 	if (destSample < 0)
-    // 		destSample = 0;
-
-    // 	int samplesLeft = nSamps - destSample;
-
-    // 	if (samplesLeft < dataSize - currentSample[chan])
-    // 	{
-    // 	 	// buffer.copyFrom(chan,
-    // 	 	// 			destSample,
-    // 	 	// 			waveforms[chan].getRawDataPointer() + currentSample[chan],
-    // 	 	// 			samplesLeft);
-
-    // 	 	currentSample.set(chan, currentSample[chan] + samplesLeft);
-
-    // 	} else {
-
-    // 		int samps = dataSize - currentSample[chan];
-
-    // 		// buffer.copyFrom(chan,
-    // 	 // 				destSample,
-    // 	 // 				waveforms[chan].getRawDataPointer() + currentSample[chan],
-    // 	 // 				samps);
+    for (int j = 0; j < numChannels; j++)
+    {
+        float* data = buffer.getSampleData(j);
 
-    // 		destSample += samps;
-    // 		samplesLeft -= samps;
+        const float amp = (float) amplitude[j];
+        const uint32 increment = phaseIncrement[j];
+        const uint32 start = currentPhase[j];
 
-    // 		// buffer.copyFrom(chan,
-    // 	 // 				destSample,
-    // 	 // 				waveforms[chan].getRawDataPointer(),
-    // 	 // 				samplesLeft);
+        // the phase parameter shifts the whole wave
+        const uint32 offset = (uint32) (int64) (phase[j] / (2.0 * double_Pi) * 4294967296.0);
 
-    // 		currentSample.set(chan, samplesLeft);
-    // 	}
+        switch (waveformType[j])
+        {
+            case SINE:
+                generatePhase(data, start + offset, increment, nSamps);
+                generateSine(data, amp, nSamps);
+                break;
+            case SQUARE:
+                generatePhase(data, start + offset, increment, nSamps);
+                generateSquare(data, amp, nSamps);
+                break;
+            case TRIANGLE:
+                generatePhase(data, start + offset, increment, nSamps);
+                generateTriangle(data, amp, nSamps);
+                break;
+            case SAW:
+                generatePhase(data, start + offset, increment, nSamps);
+                generateSaw(data, amp, nSamps);
+                break;
+            case NOISE:
+                generateNoise(data, noiseState + j * numNoiseLanes, amp, nSamps);
+                break;
+            case SPIKE:
+                for (int i = 0; i < nSamps; i++)
+                {
+                    data[i] = generateSpikeSample(j, amplitude[j], start + increment * (uint32) i, phase[j]);
+                }
+                break;
+            default:
+                FloatVectorOperations::clear(data, nSamps);
+        }
 
-    // }
+        currentPhase.set(j, start + increment * (uint32) nSamps);
+    }
 
 }
-float SignalGenerator::generateSpikeSample(double amp, double phase, double noise)
+
+float SignalGenerator::generateSpikeSample(int chan, double amp, uint32 phase, double noise)
 {
 
+    SpikeState& state = spikeStates.getReference(chan);
 
     // if the current phase is less than the previous phase we've probably wrapped and its time to select a new spike
     // if we've delayed long enough then draw a new spike otherwise wait until spikeDelay==0
-    if (phase < previousPhase)
+    if (phase < state.previousPhase)
     {
-        spikeIdx = rand()%5;
+        state.index = spikeRandom.nextInt(5);
 
-        if (spikeDelay <= 0)
-            spikeDelay = rand()%200 + 50;
-        if (spikeDelay > 0)
-            spikeDelay --;
+        if (state.delay <= 0)
+            state.delay = spikeRandom.nextInt(200) + 50;
+        if (state.delay > 0)
+            state.delay --;
     }
 
 
-    previousPhase = phase;
+    state.previousPhase = phase;
 
     int shift = -9500;//1000 + 32768;
     int gain = 8000;
 
-    double r = ((rand() % 201) - 100) / 1000.0; // Generate random number between -.1 and .1
+    double r = (spikeRandom.nextInt(201) - 100) / 1000.0; // Generate random number between -.1 and .1
     noise = r  * noise / (double_Pi * 2); // Shrink the range of r based upon the value of noise
 
-    int sampIdx = (int)(phase / (2 * double_Pi) * (N_WAVEFORM_SAMPLES-1));  // bind between 0 and N_SAMP-1, too tired to figure out the proper math
-    //sampIdx = sampIdx + 8;
+    int sampIdx = (int)(phase / 4294967296.0 * (N_WAVEFORM_SAMPLES-1));  // bind between 0 and N_SAMP-1
 
     // Right now only sample from the 3rd waveform. I need to figure out a way to only sample from a single spike until the phase wraps
-    float baseline = shift + gain *  SPIKE_WAVEFORMS[spikeIdx][1] ;
+    float baseline = shift + gain *  SPIKE_WAVEFORMS[state.index][1] ;
 
-    float sample = shift + gain * (SPIKE_WAVEFORMS[spikeIdx][sampIdx] + noise);  // * pow( WAVEFORM_SCALE[sampIdx], amp / 200.0 ) ) ;
+    float sample = shift + gain * (SPIKE_WAVEFORMS[state.index][sampIdx] + noise);  // * pow( WAVEFORM_SCALE[sampIdx], amp / 200.0 ) ) ;
     float dV = sample  - baseline;
     dV = dV * (1 + amp / 250);
     sample = baseline + dV;
 
-    if (spikeDelay==0)
+    if (state.delay==0)
         return sample;
     else
         return baseline;
@@ -33,6 +33,13 @@
 
   Outputs synthesized data of one of 5 different waveform types.
 
+  Each block is generated one channel at a time. Every channel keeps a
+  32-bit phase accumulator that wraps around once per cycle; the phases of a
+  block are computed with integer SIMD adds, and turned into sine (odd
+  polynomial), triangle, square or saw waves by vectorized kernels. Noise
+  comes from eight xorshift generators per channel, seeded with
+  setNoiseSeed() at the start of acquisition, so runs can be repeated.
+
   @see GenericProcessor, SignalGeneratorEditor
 
 */
@@ -49,11 +56,19 @@ public:
 
     void setParameter(int parameterIndex, float newValue);
 
-    float getSampleRate()
+    float getDefaultSampleRate()
     {
-        return 44100.0;
+        return sampleRate;
     }
 
+    /** Sets the rate of the generated data; takes effect at the next update.
+        Rates above that of the audio device are limited by its block size.*/
+    void setSampleRate(float rate);
+
+    /** Sets the seed of the noise generators, which restart from it each
+        time acquisition begins.*/
+    void setNoiseSeed(int64 seed);
+
     float getDefaultBitVolts()
     {
         return 0.03;
@@ -82,17 +97,27 @@ public:
 
     int nOut;
 
+    /** Returns the name of the instruction set the kernels were compiled for.*/
+    static const char* getInstructionSet();
 
 private:
 
     double defaultFrequency;
     double defaultAmplitude;
 
-    float generateSpikeSample(double amp, double phase, double noise);
+    float generateSpikeSample(int chan, double amp, uint32 phase, double noise);
+
+    /** Sets the phase increment of a channel from its frequency.*/
+    void updatePhaseIncrement(int chan);
+
+    /** Seeds the noise generators of all channels.*/
+    void resetNoise();
 
-    float sampleRateRatio;
+    float sampleRate;
+    double sampleRateRatio;
 
-    //void updateWaveform(int chan);
+    /** Fraction of a sample that was not generated in the last block.*/
+    double samplesOwed;
 
     void initializeParameters();
 
@@ -106,12 +131,25 @@ private:
     Array<double> frequency;
     Array<double> amplitude;
     Array<double> phase;
-    Array<double> phasePerSample;
-    Array<double> currentPhase;
 
-    double previousPhase;
-    int spikeIdx;
-    int spikeDelay;
+    /** Phases are fractions of a cycle scaled to 2^32.*/
+    Array<uint32> phaseIncrement;
+    Array<uint32> currentPhase;
+
+    /** State of the 8 noise generators of each channel.*/
+    HeapBlock<uint32> noiseState;
+    int numNoiseChannels;
+    int64 noiseSeed;
+
+    struct SpikeState
+    {
+        uint32 previousPhase;
+        int index;
+        int delay;
+    };
+
+    Array<SpikeState> spikeStates;
+    Random spikeRandom;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SignalGenerator);
 
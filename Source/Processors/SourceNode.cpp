@@ -36,7 +36,8 @@
 SourceNode::SourceNode(const String& name_)
     : GenericProcessor(name_),
       sourceCheckInterval(2000), wasDisabled(true), dataThread(0),
-      inputBuffer(0), ttlState(0)
+      inputBuffer(0), expectedTimestamp(-1),
+      numGaps(0), numMissingSamples(0), ttlState(0)
 {
 
     std::cout << "creating source node." << std::endl;
@@ -83,7 +84,7 @@ SourceNode::SourceNode(const String& name_)
     // check for input source every few seconds
     startTimer(sourceCheckInterval);
 
-    timestamp = 0;
+    timestampBuffer = new uint64[10000];
     eventCodeBuffer = new int16[10000]; //10000 samples per buffer max?
 
 
@@ -101,6 +102,9 @@ SourceNode::~SourceNode()
 
     if (eventChannelState)
         delete[] eventChannelState;
+
+    delete[] timestampBuffer;
+    delete[] eventCodeBuffer;
 }
 
 DataThread* SourceNode::getThread()
@@ -271,6 +275,10 @@ bool SourceNode::enable()
 
     wasDisabled = false;
 
+    expectedTimestamp = -1;
+    numGaps = 0;
+    numMissingSamples = 0;
+
     if (dataThread != 0)
     {
         dataThread->startAcquisition();
@@ -293,6 +301,12 @@ bool SourceNode::disable()
     if (dataThread != 0)
         dataThread->stopAcquisition();
 
+    if (numGaps > 0)
+    {
+        std::cout << "Source node found " << numGaps << " gaps in the timestamps, "
+                  << numMissingSamples << " samples missing." << std::endl;
+    }
+
     startTimer(2000);
 
     wasDisabled = true;
@@ -329,7 +343,10 @@ void SourceNode::process(AudioSampleBuffer& buffer,
     events.clear();
     buffer.clear();
 
-    nSamples = inputBuffer->readAllFromBuffer(buffer, &timestamp, eventCodeBuffer, buffer.getNumSamples());
+    nSamples = inputBuffer->readAllFromBuffer(buffer, timestampBuffer, eventCodeBuffer, buffer.getNumSamples());
+
+    if (nSamples == 0)
+        return;
 
     //std::cout << *buffer.getSampleData(0) << std::endl;
 
@@ -338,7 +355,7 @@ void SourceNode::process(AudioSampleBuffer& buffer,
     //std::cout << "Samples per buffer: " << nSamples << std::endl;
 
     uint8 data[8];
-    memcpy(data, &timestamp, 8);
+    memcpy(data, timestampBuffer, 8);
 
     // generate timestamp
     addEvent(events,    // MidiBuffer
@@ -360,6 +377,9 @@ void SourceNode::process(AudioSampleBuffer& buffer,
     //                 (int) *(data + 0) << std::endl;
 
 
+    if (dataThread->hasContinuousTimestamps())
+        checkForGaps(events, nSamples);
+
     // fill event buffer
     for (int i = 0; i < nSamples; i++)
     {
@@ -408,6 +428,41 @@ void SourceNode::process(AudioSampleBuffer& buffer,
 
 
 
+void SourceNode::checkForGaps(MidiBuffer& events, int nSamples)
+{
+
+    for (int i = 0; i < nSamples; i++)
+    {
+        int64 ts = (int64) timestampBuffer[i];
+
+        if (ts != expectedTimestamp && expectedTimestamp >= 0)
+        {
+            numGaps++;
+
+            // the timestamps can also jump backwards, e.g. if the source restarts
+            if (ts > expectedTimestamp)
+                numMissingSamples += ts - expectedTimestamp;
+
+            // the event holds the expected and the actual timestamp
+            uint8 data[16];
+            memcpy(data, &expectedTimestamp, 8);
+            memcpy(data + 8, &ts, 8);
+
+            addEvent(events,    // MidiBuffer
+                     DATA_GAP,  // eventType
+                     i,         // sampleNum
+                     nodeId,    // eventID
+                     0,         // eventChannel
+                     16,        // numBytes
+                     data       // data
+                    );
+        }
+
+        expectedTimestamp = ts + 1;
+    }
+
+}
+
 void SourceNode::saveCustomParametersToXml(XmlElement* parentElement)
 {
 
@@ -89,6 +89,19 @@ public:
 
     bool tryEnablingEditor();
 
+    /** Returns the number of discontinuities found in the source's timestamps
+    since acquisition started.*/
+    int64 getNumGaps()
+    {
+        return numGaps;
+    }
+
+    /** Returns the total number of samples missing from those gaps.*/
+    int64 getNumMissingSamples()
+    {
+        return numMissingSamples;
+    }
+
 private:
 
     int numEventChannels;
@@ -102,10 +115,19 @@ private:
     ScopedPointer<DataThread> dataThread;
     DataBuffer* inputBuffer;
 
-    uint64 timestamp;
+    uint64* timestampBuffer;
     int16* eventCodeBuffer;
     int* eventChannelState;
 
+    /** Adds a DATA_GAP event wherever the timestamps are not contiguous.*/
+    void checkForGaps(MidiBuffer& events, int nSamples);
+
+    /** Timestamp the next sample should have; -1 before the first sample.*/
+    int64 expectedTimestamp;
+
+    int64 numGaps;
+    int64 numMissingSamples;
+
 
     int ttlState;
 
@@ -22,14 +22,27 @@
 */
 
 #include <stdio.h>
+#include <cfloat>
 #include "SpikeDetector.h"
 
 #include "Channel.h"
 
+#if defined(__AVX__)
+ #include <immintrin.h>
+ #define SPIKE_DETECTOR_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define SPIKE_DETECTOR_SSE2 1
+#endif
+
+// samples of the previous blocks kept in front of each new block; enough
+// for a trigger held back from the previous block plus its pre-peak samples
+#define SPIKE_HISTORY_SIZE (3 * MAX_NUMBER_OF_SPIKE_CHANNEL_SAMPLES)
+
 SpikeDetector::SpikeDetector()
     : GenericProcessor("Spike Detector"),
-      overflowBuffer(2,100), dataBuffer(overflowBuffer),
-      overflowBufferSize(100), currentElectrode(-1)
+      historyBuffer(1, SPIKE_HISTORY_SIZE), lastBlockSize(0), currentElectrode(-1),
+      useAdaptiveThresholds(false), thresholdMultiplier(getDefaultThresholdMultiplier())
 {
     //// the standard form:
     electrodeTypes.add("single electrode");
@@ -70,6 +83,9 @@ SpikeDetector::SpikeDetector()
 SpikeDetector::~SpikeDetector()
 {
 
+    for (int i = 0; i < electrodes.size(); i++)
+        delete[] electrodes[i]->noiseEstimators;
+
 }
 
 
@@ -83,7 +99,7 @@ void SpikeDetector::updateSettings()
 {
 
     if (getNumInputs() > 0)
-        overflowBuffer.setSize(getNumInputs(), overflowBufferSize);
+        historyBuffer.setSize(getNumInputs(), historyBuffer.getNumSamples());
 
     for (int i = 0; i < electrodes.size(); i++)
     {
@@ -147,6 +163,7 @@ bool SpikeDetector::addElectrode(int nChans)
     newElectrode->thresholds = new double[nChans];
     newElectrode->isActive = new bool[nChans];
     newElectrode->channels = new int[nChans];
+    newElectrode->noiseEstimators = new NoiseEstimator[nChans];
 
     for (int i = 0; i < nChans; i++)
     {
@@ -168,6 +185,11 @@ float SpikeDetector::getDefaultThreshold()
     return 50.0f;
 }
 
+float SpikeDetector::getDefaultThresholdMultiplier()
+{
+    return 4.0f;
+}
+
 StringArray SpikeDetector::getElectrodeNames()
 {
     StringArray names;
@@ -190,9 +212,11 @@ bool SpikeDetector::removeElectrode(int index)
 
     // std::cout << "Spike detector removing electrode" << std::endl;
 
-    if (index > electrodes.size() || index < 0)
+    if (index >= electrodes.size() || index < 0)
         return false;
 
+    delete[] electrodes[index]->noiseEstimators;
+
     electrodes.remove(index);
     return true;
 }
@@ -209,6 +233,8 @@ void SpikeDetector::setChannel(int electrodeIndex, int channelNum, int newChanne
               " to " << newChannel << std::endl;
 
     *(electrodes[electrodeIndex]->channels+channelNum) = newChannel;
+
+    electrodes[electrodeIndex]->noiseEstimators[channelNum].requestReset();
 }
 
 int SpikeDetector::getNumChannels(int index)
@@ -256,6 +282,31 @@ double SpikeDetector::getChannelThreshold(int electrodeNum, int channelNum)
     return *(electrodes[electrodeNum]->thresholds+channelNum);
 }
 
+double SpikeDetector::getChannelNoiseLevel(int electrodeNum, int channelNum)
+{
+    return electrodes[electrodeNum]->noiseEstimators[channelNum].getNoiseLevel();
+}
+
+void SpikeDetector::setAdaptiveThresholds(bool enabled)
+{
+    setParameter(97, enabled ? 1.0f : 0.0f);
+}
+
+bool SpikeDetector::hasAdaptiveThresholds()
+{
+    return useAdaptiveThresholds;
+}
+
+void SpikeDetector::setThresholdMultiplier(float multiplier)
+{
+    setParameter(96, multiplier);
+}
+
+float SpikeDetector::getThresholdMultiplier()
+{
+    return thresholdMultiplier;
+}
+
 void SpikeDetector::setParameter(int parameterIndex, float newValue)
 {
     //editor->updateParameterButtons(parameterIndex);
@@ -271,13 +322,29 @@ void SpikeDetector::setParameter(int parameterIndex, float newValue)
         else
             *(electrodes[currentElectrode]->isActive+currentChannelIndex) = true;
     }
+    else if (parameterIndex == 97)
+    {
+        useAdaptiveThresholds = (newValue != 0.0f);
+    }
+    else if (parameterIndex == 96 && newValue > 0.0f)
+    {
+        thresholdMultiplier = newValue;
+    }
 }
 
 
 bool SpikeDetector::enable()
 {
 
-    useOverflowBuffer = false;
+    historyBuffer.clear();
+    lastBlockSize = 0;
+
+    for (int n = 0; n < electrodes.size(); n++)
+    {
+        for (int chan = 0; chan < electrodes[n]->numChannels; chan++)
+            electrodes[n]->noiseEstimators[chan].setSampleRate(getSampleRate());
+    }
+
     return true;
 }
 
@@ -303,303 +370,298 @@ void SpikeDetector::addSpikeEvent(SpikeObject* s, MidiBuffer& eventBuffer, int p
                              spikeBuffer,              // uint8_t*
                              MAX_SPIKE_BUFFER_LEN);    // int
 
+    // a spike held back from the previous block has a negative peak index;
+    // its timestamp is still exact
     if (numBytes > 0)
-        eventBuffer.addEvent(spikeBuffer, numBytes, peakIndex);
+        eventBuffer.addEvent(spikeBuffer, numBytes, jmax(0, peakIndex));
     
     //std::cout << "Adding spike" << std::endl;
 }
 
 void SpikeDetector::addWaveformToSpikeObject(SpikeObject* s,
-                                             int& peakIndex,
-                                             int& electrodeNumber,
-                                             int& currentChannel)
+                                             int peakIndex,
+                                             int electrodeNumber,
+                                             int currentChannel)
 {
-    int spikeLength = electrodes[electrodeNumber]->prePeakSamples +
-                      + electrodes[electrodeNumber]->postPeakSamples;
+    Electrode* electrode = electrodes[electrodeNumber];
+
+    int spikeLength = electrode->prePeakSamples + electrode->postPeakSamples;
 
     s->timestamp = timestamp + peakIndex;
 
     s->nSamples = spikeLength;
 
-    int chan = *(electrodes[electrodeNumber]->channels+currentChannel);
+    int chan = *(electrode->channels+currentChannel);
 
     s->gain[currentChannel] = (int)(1.0f / channels[chan]->bitVolts)*1000;
-    s->threshold[currentChannel] = (int) *(electrodes[electrodeNumber]->thresholds+currentChannel); // / channels[chan]->bitVolts * 1000;
+    s->threshold[currentChannel] = (int) *(electrode->thresholds+currentChannel); // / channels[chan]->bitVolts * 1000;
 
-    // cycle through buffer
+    uint16* dest = s->data + currentChannel * spikeLength;
 
     if (isChannelActive(electrodeNumber, currentChannel))
     {
+        // the waveform starts one sample before the pre-peak window
+        const float* source = getHistory(chan) + peakIndex - electrode->prePeakSamples - 1;
+        const float bitVolts = channels[chan]->bitVolts;
 
         for (int sample = 0; sample < spikeLength; sample++)
-        { 
-
+        {
             // warning -- be careful of bitvolts conversion
-            s->data[currentIndex] = uint16(getNextSample(*(electrodes[electrodeNumber]->channels+currentChannel)) / channels[chan]->bitVolts + 32768);
-
-            currentIndex++;
-            sampleIndex++;
-
-            //std::cout << currentIndex << std::endl;
-
+            dest[sample] = uint16(source[sample] / bitVolts + 32768);
         }
     }
     else
     {
-        for (int sample = 0; sample < spikeLength; sample++)
-        {
+        // insert a blank spike
+        memset(dest, 0, spikeLength * sizeof(uint16));
+    }
 
-            // insert a blank spike if the
-            s->data[currentIndex] = 0;
-            currentIndex++;
-            sampleIndex++;
+}
 
-            //std::cout << currentIndex << std::endl;
+void SpikeDetector::process(AudioSampleBuffer& buffer,
+                            MidiBuffer& events,
+                            int& nSamples)
+{
 
-        }
-    }
+    // need to find any timestamp events before extracting spikes
+    EventArena::Reader timestamps(getIncomingEvents(), events, TIMESTAMP);
+    EventArena::Event event;
 
+    while (timestamps.getNextEvent(event))
+    {
+        timestamp = EventArena::getTimestamp(event);
+    }
 
-    sampleIndex -= spikeLength; // reset sample index
+    updateHistory(buffer, nSamples);
 
+    for (int i = 0; i < electrodes.size(); i++)
+    {
+        updateNoiseLevels(i, nSamples);
+        detectSpikes(i, events, nSamples);
+    }
 
 }
 
-void SpikeDetector::handleEvent(int eventType, MidiMessage& event, int sampleNum)
+void SpikeDetector::updateHistory(AudioSampleBuffer& buffer, int nSamples)
 {
 
-    if (eventType == TIMESTAMP)
+    const int numChannels = jmin(buffer.getNumChannels(), historyBuffer.getNumChannels());
+
+    if (historyBuffer.getNumSamples() < SPIKE_HISTORY_SIZE + nSamples)
     {
-        const uint8* dataptr = event.getRawData();
+        historyBuffer.setSize(historyBuffer.getNumChannels(),
+                              SPIKE_HISTORY_SIZE + nSamples,
+                              true);
+    }
+
+    for (int i = 0; i < numChannels; i++)
+    {
+        float* history = historyBuffer.getSampleData(i);
 
-        memcpy(&timestamp, dataptr + 4, 8); // remember to skip first four bytes
+        // keep the end of the previous block in front of the new one
+        memmove(history, history + lastBlockSize, SPIKE_HISTORY_SIZE * sizeof(float));
+        memcpy(history + SPIKE_HISTORY_SIZE, buffer.getSampleData(i), nSamples * sizeof(float));
     }
 
+    lastBlockSize = nSamples;
 
 }
 
-void SpikeDetector::process(AudioSampleBuffer& buffer,
-                            MidiBuffer& events,
-                            int& nSamples)
+void SpikeDetector::updateNoiseLevels(int electrodeNumber, int nSamples)
 {
 
-    // cycle through electrodes
-    Electrode* electrode;
-    dataBuffer = buffer;
-
-    checkForEvents(events); // need to find any timestamp events before extracting spikes
-
-    //std::cout << dataBuffer.getMagnitude(0,nSamples) << std::endl;
+    Electrode* electrode = electrodes[electrodeNumber];
 
-    for (int i = 0; i < electrodes.size(); i++)
+    for (int chan = 0; chan < electrode->numChannels; chan++)
     {
+        NoiseEstimator& estimator = electrode->noiseEstimators[chan];
 
-        //  std::cout << "ELECTRODE " << i << std::endl;
-
-        electrode = electrodes[i];
+        estimator.addSamples(getHistory(*(electrode->channels+chan)), nSamples);
 
-        // refresh buffer index for this electrode
-        sampleIndex = electrode->lastBufferIndex - 1; // subtract 1 to account for
-        // increment at start of getNextSample()
-
-        // cycle through samples
-        while (samplesAvailable(nSamples))
+        if (useAdaptiveThresholds && estimator.hasEstimate())
         {
+            *(electrode->thresholds+chan) = thresholdMultiplier * estimator.getNoiseLevel();
+        }
+    }
 
-            sampleIndex++;
+}
 
+const float* SpikeDetector::getHistory(int chan)
+{
+    // index 0 is the first sample of the current block
+    return historyBuffer.getSampleData(chan, SPIKE_HISTORY_SIZE);
+}
 
-            // cycle through channels
-            for (int chan = 0; chan < electrode->numChannels; chan++)
-            {
+void SpikeDetector::detectSpikes(int electrodeNumber, MidiBuffer& events, int nSamples)
+{
 
-                // std::cout << "  channel " << chan << std::endl;
+    Electrode* electrode = electrodes[electrodeNumber];
 
-                if (*(electrode->isActive+chan))
-                {
+    const int numChannels = jmin(electrode->numChannels, MAX_NUMBER_OF_SPIKE_CHANNELS);
+    const int prePeak = electrode->prePeakSamples;
+    const int postPeak = electrode->postPeakSamples;
 
-                    int currentChannel = *(electrode->channels+chan);
+    // a trigger is only handled once all the samples its peak and waveform
+    // can need have arrived; later ones are left for the next block
+    const int lastTrigger = nSamples - 2 * postPeak;
 
-                    if (-getNextSample(currentChannel) > *(electrode->thresholds+chan)) // trigger spike
-                    {
+    int sampleIndex = jmax(electrode->lastBufferIndex, prePeak + 1 - SPIKE_HISTORY_SIZE);
 
-                        //std::cout << "Spike detected on electrode " << i << std::endl;
-                        // find the peak
-                        int peakIndex = sampleIndex;
+    int nextCrossing[MAX_NUMBER_OF_SPIKE_CHANNELS];
 
-                        while (-getCurrentSample(currentChannel) <
-                               -getNextSample(currentChannel) &&
-                               sampleIndex < peakIndex + electrode->postPeakSamples)
-                        {
-                            sampleIndex++;
-                        }
+    for (int chan = 0; chan < numChannels; chan++)
+        nextCrossing[chan] = sampleIndex - 1;
 
-                        peakIndex = sampleIndex;
-                        sampleIndex -= (electrode->prePeakSamples+1);
+    while (sampleIndex < lastTrigger)
+    {
 
-                        SpikeObject newSpike;
-                        newSpike.timestamp = peakIndex;
-                        newSpike.source = i;
-                        newSpike.nChannels = electrode->numChannels;
+        // the earliest crossing of any active channel, the lowest channel first
+        int triggerIndex = lastTrigger;
+        int triggerChannel = -1;
 
-                        currentIndex = 0;
+        for (int chan = 0; chan < numChannels; chan++)
+        {
+            if (!*(electrode->isActive+chan))
+                continue;
 
-                        // package spikes;
-                        for (int channel = 0; channel < electrode->numChannels; channel++)
-                        {
+            if (nextCrossing[chan] < sampleIndex)
+            {
+                nextCrossing[chan] = findThresholdCrossing(getHistory(*(electrode->channels+chan)),
+                                                           sampleIndex,
+                                                           lastTrigger,
+                                                           *(electrode->thresholds+chan));
+            }
 
-                            addWaveformToSpikeObject(&newSpike,
-                                                     peakIndex,
-                                                     i,
-                                                     channel);
+            if (nextCrossing[chan] < triggerIndex)
+            {
+                triggerIndex = nextCrossing[chan];
+                triggerChannel = chan;
+            }
+        }
 
-                            // if (*(electrode->isActive+currentChannel))
-                            // {
+        if (triggerChannel < 0)
+            break;
 
-                            //     createSpikeEvent(peakIndex,       // peak index
-                            //                      i,               // electrodeNumber
-                            //                      currentChannel,  // channel number
-                            //                      events);         // event buffer
+        // find the peak
+        const float* data = getHistory(*(electrode->channels+triggerChannel));
+        int peakIndex = triggerIndex;
 
+        while (-data[peakIndex - 1] < -data[peakIndex] &&
+               peakIndex < triggerIndex + postPeak)
+        {
+            peakIndex++;
+        }
 
-                            // } // end if channel is active
+        SpikeObject newSpike;
+        newSpike.timestamp = peakIndex;
+        newSpike.source = electrodeNumber;
+        newSpike.nChannels = electrode->numChannels;
 
-                        }
+        // package spikes;
+        for (int channel = 0; channel < numChannels; channel++)
+        {
+            addWaveformToSpikeObject(&newSpike,
+                                     peakIndex,
+                                     electrodeNumber,
+                                     channel);
+        }
 
-                       //for (int xxx = 0; xxx < 1000; xxx++) // overload with spikes for testing purposes
-                            addSpikeEvent(&newSpike, events, peakIndex);
+        addSpikeEvent(&newSpike, events, peakIndex);
 
-                        // advance the sample index
-                        sampleIndex = peakIndex + electrode->postPeakSamples;
+        // advance the sample index
+        sampleIndex = peakIndex + postPeak + 1;
 
-                        break; // quit spike "for" loop
-                    } // end spike trigger
+    }
 
-                } // end if channel is active
-            } // end cycle through channels on electrode
+    electrode->lastBufferIndex = jmax(sampleIndex, lastTrigger) - nSamples; // usually negative
 
-        } // end cycle through samples
+}
 
-        electrode->lastBufferIndex = sampleIndex - nSamples; // should be negative
+int SpikeDetector::findThresholdCrossing(const float* data, int startIndex, int endIndex, double threshold)
+{
 
-        //jassert(electrode->lastBufferIndex < 0);
+    // a spike is triggered when -sample > threshold; the vector comparison
+    // uses a float level that can only let through a few extra candidates,
+    // which are checked again in double precision
+    float level = float(-threshold);
 
-    } // end cycle through electrodes
+    if (double(level) < -threshold)
+        level += std::abs(level) * FLT_EPSILON;
 
-    // copy end of this buffer into the overflow buffer
+    int n = startIndex;
 
-    //std::cout << "Copying buffer" << std::endl;
-    // std::cout << "nSamples: " << nSamples;
-    //std::cout << "overflowBufferSize:" << overflowBufferSize;
+#if SPIKE_DETECTOR_AVX
 
-    //std::cout << "sourceStartSample = " << nSamples-overflowBufferSize << std::endl;
-    // std::cout << "numSamples = " << overflowBufferSize << std::endl;
-    // std::cout << "buffer size = " << buffer.getNumSamples() << std::endl;
+    const __m256 levelVec = _mm256_set1_ps(level);
 
-    if (nSamples > overflowBufferSize)
+    while (n + 8 <= endIndex)
     {
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(data + n), levelVec, _CMP_LT_OQ));
 
-        for (int i = 0; i < overflowBuffer.getNumChannels(); i++)
+        if (mask == 0)
         {
+            n += 8;
+            continue;
+        }
 
-            overflowBuffer.copyFrom(i, 0,
-                                    buffer, i,
-                                    nSamples-overflowBufferSize,
-                                    overflowBufferSize);
-
-            useOverflowBuffer = true;
+        while ((mask & 1) == 0)
+        {
+            mask >>= 1;
+            n++;
         }
 
-    }
-    else
-    {
+        if (-data[n] > threshold)
+            return n;
 
-        useOverflowBuffer = false;
+        n++;
     }
 
+#elif SPIKE_DETECTOR_SSE2
 
+    const __m128 levelVec = _mm_set1_ps(level);
 
-}
-
-float SpikeDetector::getNextSample(int& chan)
-{
-
-
-
-    //if (useOverflowBuffer)
-    //{
-    if (sampleIndex < 0)
+    while (n + 4 <= endIndex)
     {
-        // std::cout << "  sample index " << sampleIndex << "from overflowBuffer" << std::endl;
-        int ind = overflowBufferSize + sampleIndex;
-
-        if (ind < overflowBuffer.getNumSamples())
-            return *overflowBuffer.getSampleData(chan, ind);
-        else
-            return 0;
+        int mask = _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(data + n), levelVec));
 
-    }
-    else
-    {
-        //  useOverflowBuffer = false;
-        // std::cout << "  sample index " << sampleIndex << "from regular buffer" << std::endl;
-
-        if (sampleIndex < dataBuffer.getNumSamples())
-            return *dataBuffer.getSampleData(chan, sampleIndex);
-        else
-            return 0;
-    }
-    //} else {
-    //    std::cout << "  sample index " << sampleIndex << "from regular buffer" << std::endl;
-    //     return *dataBuffer.getSampleData(chan, sampleIndex);
-    //}
-
-}
+        if (mask == 0)
+        {
+            n += 4;
+            continue;
+        }
 
-float SpikeDetector::getCurrentSample(int& chan)
-{
+        while ((mask & 1) == 0)
+        {
+            mask >>= 1;
+            n++;
+        }
 
-    // if (useOverflowBuffer)
-    // {
-    //     return *overflowBuffer.getSampleData(chan, overflowBufferSize + sampleIndex - 1);
-    // } else {
-    //     return *dataBuffer.getSampleData(chan, sampleIndex - 1);
-    // }
+        if (-data[n] > threshold)
+            return n;
 
-    if (sampleIndex < 1)
-    {
-        //std::cout << "  sample index " << sampleIndex << "from overflowBuffer" << std::endl;
-        return *overflowBuffer.getSampleData(chan, overflowBufferSize + sampleIndex - 1);
+        n++;
     }
-    else
-    {
-        //  useOverflowBuffer = false;
-        // std::cout << "  sample index " << sampleIndex << "from regular buffer" << std::endl;
-        return *dataBuffer.getSampleData(chan, sampleIndex - 1);
-    }
-    //} else {
-
-}
-
 
-bool SpikeDetector::samplesAvailable(int& nSamples)
-{
+#endif
 
-    if (sampleIndex > nSamples - overflowBufferSize/2)
-    {
-        return false;
-    }
-    else
+    for (; n < endIndex; n++)
     {
-        return true;
+        if (-data[n] > threshold)
+            return n;
     }
 
+    return endIndex;
+
 }
 
 
 void SpikeDetector::saveCustomParametersToXml(XmlElement* parentElement)
 {
 
+    XmlElement* thresholdNode = parentElement->createNewChildElement("ADAPTIVE_THRESHOLDS");
+    thresholdNode->setAttribute("enabled", useAdaptiveThresholds);
+    thresholdNode->setAttribute("multiplier", thresholdMultiplier);
+
     for (int i = 0; i < electrodes.size(); i++)
     {
         XmlElement* electrodeNode = parentElement->createNewChildElement("ELECTRODE");
@@ -614,6 +676,7 @@ void SpikeDetector::saveCustomParametersToXml(XmlElement* parentElement)
             channelNode->setAttribute("ch",*(electrodes[i]->channels+j));
             channelNode->setAttribute("thresh",*(electrodes[i]->thresholds+j));
             channelNode->setAttribute("isActive",*(electrodes[i]->isActive+j));
+            channelNode->setAttribute("noise",electrodes[i]->noiseEstimators[j].getNoiseLevel());
 
         }
     }
@@ -632,7 +695,12 @@ void SpikeDetector::loadCustomParametersFromXml()
 
         forEachXmlChildElement(*parametersAsXml, xmlNode)
         {
-            if (xmlNode->hasTagName("ELECTRODE"))
+            if (xmlNode->hasTagName("ADAPTIVE_THRESHOLDS"))
+            {
+                setThresholdMultiplier(xmlNode->getDoubleAttribute("multiplier", getDefaultThresholdMultiplier()));
+                setAdaptiveThresholds(xmlNode->getBoolAttribute("enabled", false));
+            }
+            else if (xmlNode->hasTagName("ELECTRODE"))
             {
 
                 electrodeIndex++;
@@ -657,6 +725,8 @@ void SpikeDetector::loadCustomParametersFromXml()
                         setChannel(electrodeIndex, channelIndex, channelNode->getIntAttribute("ch"));
                         setChannelThreshold(electrodeIndex, channelIndex, channelNode->getDoubleAttribute("thresh"));
                         setChannelActive(electrodeIndex, channelIndex, channelNode->getBoolAttribute("isActive"));
+
+                        electrodes[electrodeIndex]->noiseEstimators[channelIndex].setNoiseLevel(channelNode->getDoubleAttribute("noise"));
                     }
                }
 
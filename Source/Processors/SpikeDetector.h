@@ -30,6 +30,7 @@
 #include "Editors/SpikeDetectorEditor.h"
 
 #include "Visualization/SpikeObject.h"
+#include "NoiseEstimator.h"
 
 class SpikeDetectorEditor;
 
@@ -79,9 +80,9 @@ public:
 
     // INTERNAL BUFFERS //
 
-    /** Extra samples are placed in this buffer to allow seamless
-        transitions between callbacks. */
-    AudioSampleBuffer overflowBuffer;
+    /** The end of the previous blocks followed by the current block, for
+        every input channel, so that a spike's samples are always contiguous. */
+    AudioSampleBuffer historyBuffer;
 
 
     // CREATE AND DELETE ELECTRODES //
@@ -126,30 +127,56 @@ public:
 
     double getChannelThreshold(int electrodeNum, int channelNum);
 
+    /** Returns the estimated noise level (standard deviation) of an
+        electrode channel, in microvolts. */
+    double getChannelNoiseLevel(int electrodeNum, int channelNum);
+
+    /** When enabled, the threshold of every channel follows its noise
+        level, multiplied by the threshold multiplier. */
+    void setAdaptiveThresholds(bool enabled);
+
+    bool hasAdaptiveThresholds();
+
+    void setThresholdMultiplier(float multiplier);
+
+    float getThresholdMultiplier();
+
     void saveCustomParametersToXml(XmlElement* parentElement);
     void loadCustomParametersFromXml();
 
 private:
-    /** Reference to a continuous buffer. */
-    AudioSampleBuffer& dataBuffer;
 
     float getDefaultThreshold();
+    float getDefaultThresholdMultiplier();
 
-    int overflowBufferSize;
-
-    int sampleIndex;
+    /** Number of samples in the previous block. */
+    int lastBlockSize;
 
     Array<int> electrodeCounter;
 
-    float getNextSample(int& chan);
-    float getCurrentSample(int& chan);
-    bool samplesAvailable(int& nSamples);
+    /** Appends the new block to the history of each channel. */
+    void updateHistory(AudioSampleBuffer& buffer, int nSamples);
 
-    bool useOverflowBuffer;
+    /** Returns the samples of an input channel; index 0 is the first sample of
+        the current block, and negative indices reach into the history. */
+    const float* getHistory(int chan);
+
+    /** Feeds the current block to the noise estimators of one electrode and,
+        if adaptive thresholds are enabled, updates its thresholds. */
+    void updateNoiseLevels(int electrodeNumber, int nSamples);
+
+    /** Finds the spikes of one electrode in the current block. */
+    void detectSpikes(int electrodeNumber, MidiBuffer& events, int nSamples);
+
+    /** Returns the first index in [startIndex, endIndex) at which -data[index]
+        exceeds the threshold, or endIndex if there is none. */
+    static int findThresholdCrossing(const float* data, int startIndex, int endIndex, double threshold);
 
     int currentElectrode;
     int currentChannelIndex;
-    int currentIndex;
+
+    bool useAdaptiveThresholds;
+    float thresholdMultiplier;
 
     struct Electrode
     {
@@ -158,11 +185,13 @@ private:
 
         int numChannels;
         int prePeakSamples, postPeakSamples;
+        /** First sample not yet tested, relative to the next block. */
         int lastBufferIndex;
 
         int* channels;
         double* thresholds;
         bool* isActive;
+        NoiseEstimator* noiseEstimators;
 
     };
 
@@ -176,13 +205,11 @@ private:
     // 					  int& currentChannel,
     // 					  MidiBuffer& eventBuffer);
 
-    void handleEvent(int eventType, MidiMessage& event, int sampleNum);
-
     void addSpikeEvent(SpikeObject* s, MidiBuffer& eventBuffer, int peakIndex);
     void addWaveformToSpikeObject(SpikeObject* s,
-                                  int& peakIndex,
-                                  int& electrodeNumber,
-                                  int& currentChannel);
+                                  int peakIndex,
+                                  int electrodeNumber,
+                                  int currentChannel);
 
     void resetElectrode(Electrode*);
 
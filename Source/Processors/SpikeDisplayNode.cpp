@@ -30,7 +30,7 @@
 
 
 SpikeDisplayNode::SpikeDisplayNode()
-    : GenericProcessor("Spike Viewer"), displayBufferSize(5),  redrawRequested(false), isRecording(false),
+    : GenericProcessor("Spike Viewer"), spikeChannel(512), isRecording(false),
 	  signalFilesShouldClose(false)
 {
  
@@ -67,8 +67,6 @@ void SpikeDisplayNode::updateSettings()
             Electrode elec;
             elec.numChannels = eventChannels[i]->eventType - 100;
             elec.name = eventChannels[i]->name;
-            elec.currentSpikeIndex = 0;
-            elec.mostRecentSpikes.ensureStorageAllocated(displayBufferSize);
 
             for (int j = 0; j < elec.numChannels; j++)
             {
@@ -128,19 +126,23 @@ String SpikeDisplayNode::getNameForElectrode(int i)
     }
 }
 
-void SpikeDisplayNode::addSpikePlotForElectrode(SpikePlot* sp, int i)
+void SpikeDisplayNode::setDisplayThreshold(int electrode, int channel, float threshold)
 {
-    Electrode& e = electrodes.getReference(i);
-    e.spikePlot = sp;
-
+    if (electrode > -1 && electrode < electrodes.size())
+    {
+        // the array is not resized while acquiring, so this is only a
+        // single float store seen by process()
+        electrodes.getReference(electrode).displayThresholds.set(channel, threshold);
+    }
 }
 
-void SpikeDisplayNode::removeSpikePlots()
+float SpikeDisplayNode::getDetectorThreshold(int electrode, int channel)
 {
-    for (int i = 0; i < getNumElectrodes(); i++)
+    if (electrode > -1 && electrode < electrodes.size())
     {
-        Electrode& e = electrodes.getReference(i);
-        e.spikePlot = nullptr;
+        return electrodes.getReference(electrode).detectorThresholds[channel];
+    } else {
+        return 0;
     }
 }
 
@@ -189,10 +191,6 @@ void SpikeDisplayNode::setParameter(int param, float val)
         {
             openFile(i);
         }
-    } else if (param == 2) // redraw
-    {
-        redrawRequested = true;
-
     }
 
 }
@@ -202,107 +200,61 @@ void SpikeDisplayNode::setParameter(int param, float val)
 void SpikeDisplayNode::process(AudioSampleBuffer& buffer, MidiBuffer& events, int& nSamples)
 {
 
-    checkForEvents(events); // automatically calls 'handleEvent
+    // only the spikes are needed, so they are taken from the incoming
+    // events directly rather than through checkForEvents()
+    EventArena::Reader spikes(getIncomingEvents(), events, SPIKE);
+    EventArena::Event event;
 
-    if (signalFilesShouldClose)
+    while (spikes.getNextEvent(event))
     {
-        for (int i = 0; i < getNumElectrodes(); i++)
-        {
-            closeFile(i);
-        }
+        SpikeObject newSpike;
 
-        signalFilesShouldClose = false;
+        if (EventArena::getSpike(event, newSpike))
+            handleSpike(newSpike);
     }
 
-    if (redrawRequested)
+    if (signalFilesShouldClose)
     {
-        // update incoming thresholds
         for (int i = 0; i < getNumElectrodes(); i++)
         {
-
-            Electrode& e = electrodes.getReference(i);
-
-            // update thresholds
-            for (int j = 0; j < e.numChannels; j++)
-            {
-                e.displayThresholds.set(j, 
-                    e.spikePlot->getDisplayThresholdForChannel(j));
-
-                e.spikePlot->setDetectorThresholdForChannel(j, e.detectorThresholds[j]);
-            }
-
-            // transfer buffered spikes to spike plot
-            for (int j = 0; j < e.currentSpikeIndex; j++)
-            {
-                //std::cout << "Transferring spikes." << std::endl;
-                e.spikePlot->processSpikeObject(e.mostRecentSpikes[j]);
-                e.currentSpikeIndex = 0;
-            }
-
+            closeFile(i);
         }
 
-        redrawRequested = false;
+        signalFilesShouldClose = false;
     }
 
 }
 
-void SpikeDisplayNode::handleEvent(int eventType, MidiMessage& event, int samplePosition)
+void SpikeDisplayNode::handleSpike(SpikeObject& newSpike)
 {
 
-    //std::cout << "Received event of type " << eventType << std::endl;
+    int electrodeNum = newSpike.source;
 
-    if (eventType == SPIKE)
-    {
+    Electrode& e = electrodes.getReference(electrodeNum);
+   // std::cout << electrodeNum << std::endl;
 
-        const uint8_t* dataptr = event.getRawData();
-        int bufferSize = event.getRawDataSize();
-            
-        if (bufferSize > 0)
-        {
+    bool aboveThreshold = false;
 
-            SpikeObject newSpike;
+    // update threshold / check threshold
+    for (int i = 0; i < e.numChannels; i++)
+    {
+        e.detectorThresholds.set(i, float(newSpike.threshold[i])); // / float(newSpike.gain[i]));
 
-            bool isValid = unpackSpike(&newSpike, dataptr, bufferSize);
+        aboveThreshold = aboveThreshold | checkThreshold(i, e.displayThresholds[i], newSpike);
+    }
 
-            if (isValid)
-            {
-                int electrodeNum = newSpike.source;
-
-                Electrode& e = electrodes.getReference(electrodeNum);
-               // std::cout << electrodeNum << std::endl;
-
-                 bool aboveThreshold = false;
-
-                // update threshold / check threshold
-                for (int i = 0; i < e.numChannels; i++)
-                {
-                    e.detectorThresholds.set(i, float(newSpike.threshold[i])); // / float(newSpike.gain[i]));
-
-                    aboveThreshold = aboveThreshold | checkThreshold(i, e.displayThresholds[i], newSpike);   
-                }
-
-                if (aboveThreshold)
-                {
-
-                    // add to buffer
-                    if (e.currentSpikeIndex < displayBufferSize)
-                    {
-                      //  std::cout << "Adding spike " << e.currentSpikeIndex + 1 << std::endl;
-                        e.mostRecentSpikes.set(e.currentSpikeIndex, newSpike);
-                        e.currentSpikeIndex++;
-                    }
-                    
-                    // save spike
-                    if (isRecording)
-                    {
-                        writeSpike(newSpike, electrodeNum);
-                    }
-                }
+    if (aboveThreshold)
+    {
 
-            }
-        
-        }
+        // hand it to the canvas; if the canvas falls behind, the oldest
+        // spikes are overwritten and counted as dropped
+        spikeChannel.push(newSpike);
 
+        // save spike
+        if (isRecording)
+        {
+            writeSpike(newSpike, electrodeNum);
+        }
     }
 
 }
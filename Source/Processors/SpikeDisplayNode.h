@@ -29,14 +29,15 @@
 #include "Editors/VisualizerEditor.h"
 #include "GenericProcessor.h"
 #include "Visualization/SpikeObject.h"
+#include "Visualization/SnapshotChannel.h"
 
 class DataViewport;
-class SpikePlot;
 
 /**
 
  Takes in MidiEvents and extracts SpikeObjects from the MidiEvent buffers.
- Those Events are then held in a queue until they are pulled by the SpikeDisplayCanvas.
+ Spikes above the display thresholds are pushed into a SnapshotChannel, from
+ which they are pulled by the SpikeDisplayCanvas.
 
   @see GenericProcessor, SpikeDisplayEditor, SpikeDisplayCanvas
 
@@ -60,7 +61,9 @@ public:
 
     void setParameter(int, float);
 
-    void handleEvent(int, MidiMessage&, int);
+    /** Checks an incoming spike against the display thresholds, then hands
+        it to the canvas and saves it. */
+    void handleSpike(SpikeObject& newSpike);
 
     void updateSettings();
 
@@ -74,8 +77,19 @@ public:
     int getNumberOfChannelsForElectrode(int i);
     int getNumElectrodes();
 
-    void addSpikePlotForElectrode(SpikePlot* sp, int i);
-    void removeSpikePlots();
+    /** Returns the channel through which spikes are passed to the canvas.*/
+    SnapshotChannel<SpikeObject>* getSpikeChannel()
+    {
+        return &spikeChannel;
+    }
+
+    /** Sets the threshold that spikes must cross on a channel of an electrode
+        to be displayed and saved; called by the canvas.*/
+    void setDisplayThreshold(int electrode, int channel, float threshold);
+
+    /** Returns the threshold of the most recent spike on a channel of an
+        electrode, as set in the SpikeDetector.*/
+    float getDetectorThreshold(int electrode, int channel);
 
     bool checkThreshold(int, float, SpikeObject&);
 
@@ -90,19 +104,13 @@ private:
         Array<float> displayThresholds;
         Array<float> detectorThresholds;
 
-        Array<SpikeObject> mostRecentSpikes;
-        int currentSpikeIndex;
-
-        SpikePlot* spikePlot;
-
         FILE* file;
 
     };
 
     Array<Electrode> electrodes;
 
-    int displayBufferSize;
-    bool redrawRequested;
+    SnapshotChannel<SpikeObject> spikeChannel;
 
     // methods for recording:
     void openFile(int index);
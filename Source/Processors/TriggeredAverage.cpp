@@ -0,0 +1,182 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#include "TriggeredAverage.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+TriggeredAverage::TriggeredAverage()
+    : numChannels(0), numSamples(0), numTrials(0), stride(0)
+{
+
+}
+
+TriggeredAverage::~TriggeredAverage()
+{
+
+}
+
+void TriggeredAverage::setSize(int numChannels_, int numSamples_)
+{
+    numChannels = jmax(0, numChannels_);
+    numSamples = jmax(0, numSamples_);
+    stride = (numSamples + 7) & ~7;
+
+    means.calloc(jmax(1, numChannels * stride));
+    m2s.calloc(jmax(1, numChannels * stride));
+
+    numTrials = 0;
+}
+
+void TriggeredAverage::reset()
+{
+    means.clear(numChannels * stride);
+    m2s.clear(numChannels * stride);
+
+    numTrials = 0;
+}
+
+void TriggeredAverage::addTrial(AudioSampleBuffer& buffer, int startSample)
+{
+    const int bufferSize = buffer.getNumSamples();
+
+    if (numSamples == 0 || numSamples > bufferSize)
+        return;
+
+    startSample = ((startSample % bufferSize) + bufferSize) % bufferSize;
+
+    const int firstPart = jmin(numSamples, bufferSize - startSample);
+    const float weight = 1.0f / float(numTrials + 1);
+
+    for (int ch = 0; ch < jmin(numChannels, buffer.getNumChannels()); ch++)
+    {
+        float* mean = means + ch * stride;
+        float* m2 = m2s + ch * stride;
+
+        accumulate(mean, m2, buffer.getSampleData(ch, startSample), firstPart, weight);
+
+        if (firstPart < numSamples)
+            accumulate(mean + firstPart, m2 + firstPart, buffer.getSampleData(ch, 0),
+                       numSamples - firstPart, weight);
+    }
+
+    numTrials++;
+}
+
+void TriggeredAverage::getMeanAndError(int channel, int startSample, int num,
+                                       float& mean, float& error)
+{
+    mean = 0;
+    error = 0;
+
+    startSample = jlimit(0, numSamples, startSample);
+    num = jmin(num, numSamples - startSample);
+
+    if (channel < 0 || channel >= numChannels || num <= 0 || numTrials == 0)
+        return;
+
+    const float* m = means + channel * stride + startSample;
+    const float* m2 = m2s + channel * stride + startSample;
+
+    float meanSum = 0;
+    float m2Sum = 0;
+
+    for (int i = 0; i < num; i++)
+    {
+        meanSum += m[i];
+        m2Sum += m2[i];
+    }
+
+    mean = meanSum / num;
+
+    // variance of the trials is M2/(n-1), and the SEM divides it by n again
+    if (numTrials > 1)
+        error = sqrtf(m2Sum / num / float(numTrials - 1) / float(numTrials));
+}
+
+void TriggeredAverage::accumulate(float* mean, float* m2, const float* data,
+                                  int num, float weight)
+{
+    int i = 0;
+
+#if defined(__AVX__)
+
+    const __m256 w = _mm256_set1_ps(weight);
+
+    for (; i + 8 <= num; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(data + i);
+        __m256 mu = _mm256_loadu_ps(mean + i);
+
+        const __m256 delta = _mm256_sub_ps(x, mu);
+        mu = _mm256_add_ps(mu, _mm256_mul_ps(delta, w));
+
+        const __m256 m = _mm256_add_ps(_mm256_loadu_ps(m2 + i),
+                                       _mm256_mul_ps(delta, _mm256_sub_ps(x, mu)));
+
+        _mm256_storeu_ps(mean + i, mu);
+        _mm256_storeu_ps(m2 + i, m);
+    }
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+    const __m128 w = _mm_set1_ps(weight);
+
+    for (; i + 4 <= num; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(data + i);
+        __m128 mu = _mm_loadu_ps(mean + i);
+
+        const __m128 delta = _mm_sub_ps(x, mu);
+        mu = _mm_add_ps(mu, _mm_mul_ps(delta, w));
+
+        const __m128 m = _mm_add_ps(_mm_loadu_ps(m2 + i),
+                                    _mm_mul_ps(delta, _mm_sub_ps(x, mu)));
+
+        _mm_storeu_ps(mean + i, mu);
+        _mm_storeu_ps(m2 + i, m);
+    }
+
+#endif
+
+    for (; i < num; i++)
+    {
+        const float delta = data[i] - mean[i];
+        mean[i] += delta * weight;
+        m2[i] += delta * (data[i] - mean[i]);
+    }
+}
+
+const char* TriggeredAverage::getInstructionSet()
+{
+#if defined(__AVX__)
+    return "AVX";
+#elif defined(__SSE2__) || defined(_M_X64)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,108 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef __TRIGGEREDAVERAGE_H_61D4A2B7__
+#define __TRIGGEREDAVERAGE_H_61D4A2B7__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Keeps the running mean and variance of a window of samples of many
+  channels, over all the trials added so far.
+
+  Each trial updates every sample of the window with Welford's method
+  (mean += delta/n, M2 += delta*(x - mean)), which stays accurate after
+  many thousands of trials, unlike sums of squares. Each channel's window
+  is contiguous, so the update is vectorized along it (8 samples at a time
+  with AVX, 4 with SSE2).
+
+  @see LfpTriggeredAverageNode
+
+*/
+
+class TriggeredAverage
+{
+public:
+
+    TriggeredAverage();
+    ~TriggeredAverage();
+
+    /** Allocates the mean and M2 of numSamples samples of numChannels
+        channels, and clears them.*/
+    void setSize(int numChannels, int numSamples);
+
+    /** Forgets all trials.*/
+    void reset();
+
+    /** Adds one trial, taken from a circular buffer with at least as many
+        channels; the window starts at startSample and may wrap around the
+        end of the buffer.*/
+    void addTrial(AudioSampleBuffer& buffer, int startSample);
+
+    int getNumTrials()
+    {
+        return numTrials;
+    }
+
+    int getNumChannels()
+    {
+        return numChannels;
+    }
+
+    int getNumSamples()
+    {
+        return numSamples;
+    }
+
+    /** Finds the mean and the standard error of the mean of one channel,
+        averaged over numSamples samples of the window starting at
+        startSample.*/
+    void getMeanAndError(int channel, int startSample, int numSamples,
+                         float& mean, float& error);
+
+    /** Returns the name of the instruction set the kernel was compiled for.*/
+    static const char* getInstructionSet();
+
+private:
+
+    /** Adds numSamples samples of one trial to the mean and M2 of one
+        channel; weight is 1/n for the nth trial.*/
+    static void accumulate(float* mean, float* m2, const float* data,
+                           int numSamples, float weight);
+
+    int numChannels;
+    int numSamples;
+    int numTrials;
+
+    /** Distance between channels in means and m2s, a multiple of 8.*/
+    int stride;
+
+    HeapBlock<float> means;
+    HeapBlock<float> m2s;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TriggeredAverage);
+
+};
+
+
+#endif  // __TRIGGEREDAVERAGE_H_61D4A2B7__
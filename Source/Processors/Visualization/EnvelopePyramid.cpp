@@ -0,0 +1,260 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "EnvelopePyramid.h"
+
+// samples in a bucket of the finest level, and buckets of one level in a
+// bucket of the next
+#define FIRST_BUCKET_SIZE 16
+#define BUCKETS_PER_BUCKET 8
+
+EnvelopePyramid::EnvelopePyramid() : buffer(nullptr), eventChannel(-1)
+{
+
+}
+
+EnvelopePyramid::~EnvelopePyramid()
+{
+
+}
+
+void EnvelopePyramid::setBuffer(AudioSampleBuffer* buffer_, int eventChannel_)
+{
+
+    buffer = buffer_;
+    eventChannel = eventChannel_;
+
+    levels.clear();
+
+    if (buffer == nullptr)
+        return;
+
+    const int numSamples = buffer->getNumSamples();
+
+    for (int bucketSize = FIRST_BUCKET_SIZE;
+         bucketSize * BUCKETS_PER_BUCKET <= numSamples;
+         bucketSize *= BUCKETS_PER_BUCKET)
+    {
+        const int numBuckets = (numSamples + bucketSize - 1) / bucketSize;
+
+        Level* level = new Level();
+        level->bucketSize = bucketSize;
+        level->minima.setSize(buffer->getNumChannels(), numBuckets);
+        level->maxima.setSize(buffer->getNumChannels(), numBuckets);
+        level->minima.clear();
+        level->maxima.clear();
+
+        levels.add(level);
+    }
+
+}
+
+// a plain loop is faster than FloatVectorOperations for the few values
+// that a query reads at each level
+static inline void findMinAndMax(const float* minima, const float* maxima, int numValues,
+                                 float& minValue, float& maxValue)
+{
+    float lo = minima[0];
+    float hi = maxima[0];
+
+    for (int i = 1; i < numValues; i++)
+    {
+        lo = jmin(lo, minima[i]);
+        hi = jmax(hi, maxima[i]);
+    }
+
+    minValue = lo;
+    maxValue = hi;
+}
+
+int EnvelopePyramid::combineEvents(const float* values, int numValues)
+{
+    int state = 0;
+
+    for (int i = 0; i < numValues; i++)
+        state |= (int) values[i];
+
+    return state;
+}
+
+void EnvelopePyramid::update(int startSample, int numSamples)
+{
+
+    if (buffer == nullptr || numSamples <= 0)
+        return;
+
+    const int endSample = startSample + numSamples;
+    const int numChannels = buffer->getNumChannels();
+
+    for (int k = 0; k < levels.size(); k++)
+    {
+        Level* level = levels[k];
+        const int bucketSize = level->bucketSize;
+
+        for (int bucket = startSample / bucketSize; bucket <= (endSample - 1) / bucketSize; bucket++)
+        {
+            const int bucketStart = bucket * bucketSize;
+
+            // the finest level is built from the samples, the others from
+            // the buckets below them; either way the bucket is rebuilt from
+            // its start, which was written before, up to the newest sample
+            const float* source;
+            int first, count;
+            const AudioSampleBuffer* sourceMinima;
+            const AudioSampleBuffer* sourceMaxima;
+
+            if (k == 0)
+            {
+                sourceMinima = buffer;
+                sourceMaxima = buffer;
+                first = bucketStart;
+                count = jmin(endSample, bucketStart + bucketSize) - first;
+            }
+            else
+            {
+                const int childSize = levels[k-1]->bucketSize;
+
+                sourceMinima = &levels[k-1]->minima;
+                sourceMaxima = &levels[k-1]->maxima;
+                first = bucket * BUCKETS_PER_BUCKET;
+                count = (jmin(endSample, bucketStart + bucketSize) - 1) / childSize - first + 1;
+            }
+
+            for (int chan = 0; chan < numChannels; chan++)
+            {
+                float minValue, maxValue;
+
+                if (chan == eventChannel)
+                {
+                    source = sourceMaxima->getSampleData(chan, first);
+                    minValue = maxValue = (float) combineEvents(source, count);
+                }
+                else
+                {
+                    float unused;
+
+                    FloatVectorOperations::findMinAndMax(sourceMinima->getSampleData(chan, first), count,
+                                                         minValue, unused);
+                    FloatVectorOperations::findMinAndMax(sourceMaxima->getSampleData(chan, first), count,
+                                                         unused, maxValue);
+                }
+
+                *level->minima.getSampleData(chan, bucket) = minValue;
+                *level->maxima.getSampleData(chan, bucket) = maxValue;
+            }
+        }
+    }
+
+}
+
+void EnvelopePyramid::getRange(int channel, int startSample, int numSamples, float& minValue, float& maxValue)
+{
+
+    minValue = std::numeric_limits<float>::max();
+    maxValue = -std::numeric_limits<float>::max();
+
+    if (buffer == nullptr || numSamples <= 0)
+    {
+        minValue = maxValue = 0;
+        return;
+    }
+
+    const int bufferSize = buffer->getNumSamples();
+
+    startSample %= bufferSize;
+    numSamples = jmin(numSamples, bufferSize);
+
+    const int firstPart = jmin(numSamples, bufferSize - startSample);
+
+    addRange(channel, levels.size() - 1, startSample, startSample + firstPart, minValue, maxValue);
+
+    if (firstPart < numSamples)
+        addRange(channel, levels.size() - 1, 0, numSamples - firstPart, minValue, maxValue);
+
+}
+
+void EnvelopePyramid::addRange(int channel, int level, int startSample, int endSample,
+                               float& minValue, float& maxValue)
+{
+
+    if (endSample <= startSample)
+        return;
+
+    // use the coarsest level with whole buckets inside the span
+    while (level >= 0 && levels[level]->bucketSize > endSample - startSample)
+        level--;
+
+    float lo, hi;
+
+    if (level < 0)
+    {
+        const float* samples = buffer->getSampleData(channel, startSample);
+
+        if (channel == eventChannel)
+            lo = hi = (float) combineEvents(samples, endSample - startSample);
+        else
+            findMinAndMax(samples, samples, endSample - startSample, lo, hi);
+    }
+    else
+    {
+        const int bucketSize = levels[level]->bucketSize;
+        const int firstBucket = (startSample + bucketSize - 1) / bucketSize;
+        const int lastBucket = endSample / bucketSize; // exclusive
+
+        if (firstBucket >= lastBucket)
+        {
+            addRange(channel, level - 1, startSample, endSample, minValue, maxValue);
+            return;
+        }
+
+        // the parts before and after the whole buckets
+        addRange(channel, level - 1, startSample, firstBucket * bucketSize, minValue, maxValue);
+        addRange(channel, level - 1, lastBucket * bucketSize, endSample, minValue, maxValue);
+
+        const float* minima = levels[level]->minima.getSampleData(channel, firstBucket);
+        const float* maxima = levels[level]->maxima.getSampleData(channel, firstBucket);
+        const int numBuckets = lastBucket - firstBucket;
+
+        if (channel == eventChannel)
+        {
+            lo = hi = (float) combineEvents(maxima, numBuckets);
+        }
+        else
+        {
+            findMinAndMax(minima, maxima, numBuckets, lo, hi);
+        }
+    }
+
+    if (channel == eventChannel)
+    {
+        // the previous values are OR masks as well
+        const int state = (int) hi | (maxValue < 0 ? 0 : (int) maxValue);
+        minValue = maxValue = (float) state;
+    }
+    else
+    {
+        minValue = jmin(minValue, lo);
+        maxValue = jmax(maxValue, hi);
+    }
+
+}
@@ -0,0 +1,100 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __ENVELOPEPYRAMID_H_2F8C41A6__
+#define __ENVELOPEPYRAMID_H_2F8C41A6__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Keeps the minimum and maximum of a circular display buffer over buckets of
+  16, 128, 1024... samples, so the range of any span of samples can be found
+  with a few dozen operations, however long the span is.
+
+  update() is called by the processor after it writes a block into the
+  display buffer; getRange() is called by the canvas for each pixel. Both
+  only touch the part of the buffer that has been written since the write
+  position last wrapped around, which is all the canvas reads.
+
+  One channel can be set aside for events: its values are bit masks of TTL
+  states, which are combined with a bitwise OR instead of min and max.
+
+  @see LfpDisplayNode, LfpDisplayCanvas
+
+*/
+
+class EnvelopePyramid
+{
+public:
+
+    EnvelopePyramid();
+    ~EnvelopePyramid();
+
+    /** Allocates the levels for a display buffer and clears them. The buffer
+        must stay the same size until setBuffer() is called again.*/
+    void setBuffer(AudioSampleBuffer* buffer, int eventChannel = -1);
+
+    /** Updates the buckets covering samples [startSample, startSample+numSamples)
+        of the display buffer, which must not wrap around.*/
+    void update(int startSample, int numSamples);
+
+    /** Finds the minimum and maximum of numSamples samples of one channel,
+        starting at startSample; the span may wrap around the end of the
+        buffer. For the event channel, both are set to the OR of the values.*/
+    void getRange(int channel, int startSample, int numSamples, float& minValue, float& maxValue);
+
+    int getNumLevels()
+    {
+        return levels.size();
+    }
+
+private:
+
+    struct Level
+    {
+        Level() : bucketSize(0), minima(1, 1), maxima(1, 1) {}
+
+        int bucketSize;
+        AudioSampleBuffer minima;
+        AudioSampleBuffer maxima;
+    };
+
+    /** Combines the range of [startSample, endSample) into minValue and maxValue,
+        using buckets of the given level or finer.*/
+    void addRange(int channel, int level, int startSample, int endSample,
+                  float& minValue, float& maxValue);
+
+    static int combineEvents(const float* values, int numValues);
+
+    AudioSampleBuffer* buffer;
+    int eventChannel;
+
+    OwnedArray<Level> levels;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EnvelopePyramid);
+
+};
+
+
+#endif  // __ENVELOPEPYRAMID_H_2F8C41A6__
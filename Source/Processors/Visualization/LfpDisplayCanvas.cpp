@@ -28,7 +28,9 @@
 LfpDisplayCanvas::LfpDisplayCanvas(LfpDisplayNode* processor_) :
     screenBufferIndex(0), timebase(1.0f), displayGain(1.0f),   timeOffset(0.0f),
     processor(processor_),
-    displayBufferIndex(0)
+    paintTicks(0), numFrames(0), lastReadoutTicks(0),
+    displayBufferIndex(0), displaySampleNumber(-1),
+    latestSampleNumber(0), latestBufferIndex(0), numDroppedFrames(0)
 {
 
     nChans = processor->getNumInputs();
@@ -39,9 +41,14 @@ LfpDisplayCanvas::LfpDisplayCanvas(LfpDisplayNode* processor_) :
     displayBufferSize = displayBuffer->getNumSamples();
     std::cout << "Setting displayBufferSize on LfpDisplayCanvas to " << displayBufferSize << std::endl;
 
+    envelope = processor->getEnvelopeAddress();
+
     screenBuffer = new AudioSampleBuffer(MAX_N_CHAN, MAX_N_SAMP);
     screenBuffer->clear();
 
+    screenBufferMin = new AudioSampleBuffer(MAX_N_CHAN, MAX_N_SAMP);
+    screenBufferMin->clear();
+
     viewport = new Viewport();
     lfpDisplay = new LfpDisplay(this, viewport);
     timescale = new LfpTimescale(this);
@@ -114,6 +121,12 @@ LfpDisplayCanvas::LfpDisplayCanvas(LfpDisplayNode* processor_) :
     colorGroupingSelection->addListener(this);
     addAndMakeVisible(colorGroupingSelection);
 
+    performanceLabel = new Label("Performance", "");
+    performanceLabel->setFont(Font("Default", 14, Font::plain));
+    performanceLabel->setColour(Label::textColourId, Colour(100,100,100));
+    performanceLabel->setJustificationType(Justification::right);
+    addAndMakeVisible(performanceLabel);
+
 
     lfpDisplay->setNumChannels(nChans);
     lfpDisplay->setRange(1000.0f);
@@ -139,6 +152,7 @@ LfpDisplayCanvas::~LfpDisplayCanvas()
 {
 
     deleteAndZero(screenBuffer);
+    deleteAndZero(screenBufferMin);
 }
 
 void LfpDisplayCanvas::resized()
@@ -154,6 +168,8 @@ void LfpDisplayCanvas::resized()
     spreadSelection->setBounds(345,getHeight()-30,100,25);
     colorGroupingSelection->setBounds(620,getHeight()-30,100,25);
 
+    performanceLabel->setBounds(getWidth()-scrollBarThickness-225,getHeight()-55,220,20);
+
 
     for (int i = 0; i < 8; i++)
     {
@@ -175,6 +191,9 @@ void LfpDisplayCanvas::beginAnimation()
 
     screenBufferIndex = 0;
 
+    displaySampleNumber = -1; // start reading at the next block
+    numDroppedFrames = 0;
+
     startCallbacks();
 }
 
@@ -271,7 +290,7 @@ void LfpDisplayCanvas::setParameter(int param, float val)
 void LfpDisplayCanvas::refreshState()
 {
     // called when the component's tab becomes visible again
-    displayBufferIndex = processor->getDisplayBufferIndex();
+    displaySampleNumber = -1;
     screenBufferIndex = 0;
 
 }
@@ -282,6 +301,7 @@ void LfpDisplayCanvas::refreshScreenBuffer()
     screenBufferIndex = 0;
 
     screenBuffer->clear();
+    screenBufferMin->clear();
 
     // int w = lfpDisplay->getWidth();
     // //std::cout << "Refreshing buffer size to " << w << "pixels." << std::endl;
@@ -311,15 +331,42 @@ void LfpDisplayCanvas::updateScreenBuffer()
 
     lastScreenBufferIndex = screenBufferIndex;
 
-    int index = processor->getDisplayBufferIndex();
+    // only the newest write position matters, older ones are skipped
+    LfpDisplayNode::DisplayBlock block;
 
-    int nSamples =  index - displayBufferIndex; // N new samples to be addeddisplayBufferIndex
+    if (processor->getDisplayChannel()->popLatest(block))
+    {
+        latestSampleNumber = block.sampleNumber;
+        latestBufferIndex = block.bufferIndex;
+    }
 
-    if (nSamples < 0) // buffer has reset to 0
+    if (displaySampleNumber < 0)
     {
-        nSamples = (displayBufferSize - displayBufferIndex) + index;
+        if (processor->getDisplayChannel()->getNumPushed() == 0)
+            return;
+
+        // (re)start reading where the processor is now
+        displayBufferIndex = latestBufferIndex;
+        displaySampleNumber = latestSampleNumber;
     }
 
+    int64 samplesBehind = latestSampleNumber - displaySampleNumber;
+
+    if (samplesBehind < 0 || samplesBehind > displayBufferSize / 2)
+    {
+        // the buffer was reset, or the samples still to be drawn are about
+        // to be overwritten: skip ahead instead of reading them while they
+        // are being written
+        if (samplesBehind > 0)
+            numDroppedFrames++;
+
+        displayBufferIndex = latestBufferIndex;
+        displaySampleNumber = latestSampleNumber;
+        samplesBehind = 0;
+    }
+
+    int nSamples = (int) samplesBehind; // N new samples to be added
+
     float ratio = sampleRate * timebase / float(getWidth() - leftmargin - scrollBarThickness);
 
     // this number is crucial: converting from samples to values (in px) for the screen buffer
@@ -341,39 +388,48 @@ void LfpDisplayCanvas::updateScreenBuffer()
 
         for (int i = 0; i < valuesNeeded; i++) // also fill one extra sample for line drawing interpolation to match across draws
         {
-            float gain = 1.0;
-            float alpha = (float) subSampleOffset;
-            float invAlpha = 1.0f - alpha;
-
-            screenBuffer->clear(screenBufferIndex, 1);
-
             displayBufferIndex = displayBufferIndex % displayBufferSize; // just to be sure
 
-            for (int channel = 0; channel <= nChans; channel++) // pull one extra channel for event display
-            {
-
-                screenBuffer->addFrom(channel, // destChannel
-                                      screenBufferIndex, // destStartSample
-                                      displayBuffer->getSampleData(channel, displayBufferIndex), // source
-                                      1, // numSamples
-                                      invAlpha*gain); // gain
+            // number of samples covered by this pixel
+            int samplesInPixel = (int)(subSampleOffset + ratio);
 
-                screenBuffer->addFrom(channel, // destChannel
-                                      screenBufferIndex, // destStartSample
-                                      displayBuffer->getSampleData(channel, nextPos), // source
-                                      1, // numSamples
-                                      alpha*gain); // gain
+            if (samplesInPixel > 1)
+            {
+                // several samples per pixel: keep their full range, so that
+                // spikes and artifacts are not skipped
+                for (int channel = 0; channel <= nChans; channel++) // pull one extra channel for event display
+                {
+                    envelope->getRange(channel,
+                                       displayBufferIndex,
+                                       samplesInPixel,
+                                       *screenBufferMin->getSampleData(channel, screenBufferIndex),
+                                       *screenBuffer->getSampleData(channel, screenBufferIndex));
+                }
+            }
+            else
+            {
+                float alpha = (float) subSampleOffset;
+                float invAlpha = 1.0f - alpha;
 
+                for (int channel = 0; channel <= nChans; channel++) // pull one extra channel for event display
+                {
+                    float value = *displayBuffer->getSampleData(channel, displayBufferIndex) * invAlpha
+                                  + *displayBuffer->getSampleData(channel, nextPos) * alpha;
 
+                    *screenBuffer->getSampleData(channel, screenBufferIndex) = value;
+                    *screenBufferMin->getSampleData(channel, screenBufferIndex) = value;
+                }
             }
 
             subSampleOffset += ratio;
 
             while (subSampleOffset >= 1.0)
             {
-                if (++displayBufferIndex > displayBufferSize)
+                if (++displayBufferIndex >= displayBufferSize)
                     displayBufferIndex = 0;
 
+                displaySampleNumber++;
+
                 nextPos = (displayBufferIndex + 1) % displayBufferSize;
                 subSampleOffset -= 1.0;
             }
@@ -405,6 +461,11 @@ float LfpDisplayCanvas::getYCoord(int chan, int samp)
     return *screenBuffer->getSampleData(chan, samp);
 }
 
+float LfpDisplayCanvas::getYCoordMin(int chan, int samp)
+{
+    return *screenBufferMin->getSampleData(chan, samp);
+}
+
 void LfpDisplayCanvas::paint(Graphics& g)
 {
 
@@ -460,6 +521,48 @@ void LfpDisplayCanvas::refresh()
 
     //getPeer()->performAnyPendingRepaintsNow();
 
+    numFrames++;
+    updatePerformanceLabel();
+
+}
+
+void LfpDisplayCanvas::addPaintTime(int64 ticks)
+{
+    paintTicks += ticks;
+}
+
+void LfpDisplayCanvas::updatePerformanceLabel()
+{
+    // the refresh timer runs late when painting can't keep up,
+    // so the number of refreshes per second is the frame rate
+    const int64 now = Time::getHighResolutionTicks();
+
+    if (lastReadoutTicks == 0)
+    {
+        lastReadoutTicks = now;
+        numFrames = 0;
+        paintTicks = 0;
+        return;
+    }
+
+    const double elapsed = Time::highResolutionTicksToSeconds(now - lastReadoutTicks);
+
+    if (elapsed < 1.0)
+        return;
+
+    const double fps = numFrames / elapsed;
+    const double paintMs = Time::highResolutionTicksToSeconds(paintTicks) * 1000.0 / jmax(numFrames, 1);
+
+    String text = String(fps, 1) + " fps, paint " + String(paintMs, 2) + " ms";
+
+    if (numDroppedFrames > 0)
+        text += ", " + String(numDroppedFrames) + " dropped";
+
+    performanceLabel->setText(text, dontSendNotification);
+
+    lastReadoutTicks = now;
+    numFrames = 0;
+    paintTicks = 0;
 }
 
 void LfpDisplayCanvas::saveVisualizerParameters(XmlElement* xml)
@@ -1019,6 +1122,8 @@ void LfpChannelDisplay::setEnabledState(bool state)
 void LfpChannelDisplay::paint(Graphics& g)
 {
 
+    const int64 paintStart = Time::getHighResolutionTicks();
+
     //g.fillAll(Colours::grey);
 
     g.setColour(Colours::yellow);   // draw most recent drawn sample position
@@ -1054,8 +1159,6 @@ void LfpChannelDisplay::paint(Graphics& g)
     g.drawLine(0, getHeight()/2, getWidth(), getHeight()/2);
 
     int stepSize = 1;
-    int from = 0; // for vertical line drawing in the LFP data
-    int to = 0;
 
     //for (int i = 0; i < getWidth()-stepSize; i += stepSize) // redraw entire display
     int ifrom = canvas->lastScreenBufferIndex - 3; // need to start drawing a bit before the actual redraw windowfor the interpolated line to join correctly
@@ -1072,77 +1175,59 @@ void LfpChannelDisplay::paint(Graphics& g)
         fullredraw = false;
     }
 
-    for (int i = ifrom; i < ito ; i += stepSize) // redraw only changed portion
-    {
-
-        // draw event markers
-        int rawEventState = canvas->getYCoord(canvas->getNumChannels(), i);// get last channel+1 in buffer (represents events)
-        for (int ev_ch = 0; ev_ch < 8 ; ev_ch++) // for all event channels
-        {
-            if (display->getEventDisplayState(ev_ch))  // check if plotting for this channel is enabled
-            {
-                if (rawEventState & (1 << ev_ch))    // events are  representet by a bit code, so we have to extract the individual bits with a mask
-                {
-                    g.setColour(display->channelColours[ev_ch*2]); // get color from lfp color scheme
-                    g.setOpacity(0.35f);
-                    g.drawLine(i, center-channelHeight/2 , i, center+channelHeight/2);
-                }
-            }
-        }
+    // draw event markers: one rectangle for each run of pixels in which
+    // an event channel is on
+    const int eventChannel = canvas->getNumChannels(); // last channel+1 in buffer (represents events)
 
-        //std::cout << "e " << canvas->getYCoord(canvas->getNumChannels()-1, i) << std::endl;
+    for (int ev_ch = 0; ev_ch < 8 ; ev_ch++) // for all event channels
+    {
+        if (!display->getEventDisplayState(ev_ch))  // check if plotting for this channel is enabled
+            continue;
 
-        g.setColour(lineColour);
-        g.setOpacity(1);
+        g.setColour(display->channelColours[ev_ch*2].withAlpha(0.35f)); // get color from lfp color scheme
 
-        // drawLine makes for ok anti-aliased plots, but is pretty slow
-        g.drawLine(i,
-                   (canvas->getYCoord(chan, i)/range*channelHeightFloat)+getHeight()/2,
-                   i+stepSize,
-                   (canvas->getYCoord(chan, i+stepSize)/range*channelHeightFloat)+getHeight()/2);
+        int runStart = -1;
 
-        if (false) // switched back to line drawing now that we only draw partial updates
+        for (int i = ifrom; i <= ito; i += stepSize)
         {
+            // events are represented by a bit code, so we have to extract the individual bits with a mask
+            bool isOn = (i < ito) && (((int) canvas->getYCoord(eventChannel, i)) & (1 << ev_ch));
 
-            // // pixel wise line plot has no anti-aliasing, but runs much faster
-            double a = (canvas->getYCoord(chan, i)/range*channelHeightFloat)+getHeight()/2;
-            double b = (canvas->getYCoord(chan, i+stepSize)/range*channelHeightFloat)+getHeight()/2;
-
-            if (a<b)
+            if (isOn && runStart < 0)
             {
-                from = (a);
-                to = (b);
+                runStart = i;
             }
-            else
+            else if (!isOn && runStart >= 0)
             {
-                from = (b);
-                to = (a);
+                g.fillRect(runStart, center-channelHeight/2, i-runStart, channelHeight);
+                runStart = -1;
             }
+        }
+    }
 
-            if ((to-from) < 40)  // if there is too much vertical range in one pixel, don't draw the full line for speed reasons
-            {
-                for (int j = from; j <= to; j += 1)
-                {
-                    g.setPixel(i,j);
-                }
-            }
-            else if ((to-from) < 100)
-            {
-                for (int j = from; j <= to; j += 2)
-                {
-                    g.setPixel(i,j);
-                }
-            }
-            else
-            {
-                g.setPixel(i,to);
-                g.setPixel(i,from);
-            }
+    // draw the trace: each pixel column is a one pixel wide span from its
+    // min-max range to the start of the next column (for a pixel covering a
+    // single sample this is the segment to the next one), and all spans go
+    // into one path that is filled once
+    const float scale = channelHeightFloat/range;
+    const float offset = getHeight()/2;
 
-        }
+    Path spans;
+
+    for (int i = ifrom; i < ito ; i += stepSize) // redraw only changed portion
+    {
+        float lo = jmin(canvas->getYCoordMin(chan, i), canvas->getYCoord(chan, i+stepSize));
+        float hi = jmax(canvas->getYCoord(chan, i), canvas->getYCoordMin(chan, i+stepSize));
 
+        spans.addRectangle(i, lo*scale+offset, stepSize, (hi-lo)*scale+1.0f);
     }
-}	
+
+    g.setColour(lineColour);
+    g.fillPath(spans);
+
+}
+
+    canvas->addPaintTime(Time::getHighResolutionTicks() - paintStart);
 
     // g.setColour(lineColour.withAlpha(0.7f)); // alpha on seems to decrease draw speed
     // g.setFont(channelFont);
@@ -25,6 +25,7 @@
 
 #include "../../../JuceLibraryCode/JuceHeader.h"
 #include "../LfpDisplayNode.h"
+#include "EnvelopePyramid.h"
 #include "Visualizer.h"
 
 class LfpDisplayNode;
@@ -73,6 +74,14 @@ public:
     float getXCoord(int chan, int samp);
     float getYCoord(int chan, int samp);
 
+    /** Returns the lowest value of a channel within a pixel; getYCoord()
+        returns the highest. They are equal when a pixel spans less than
+        one sample. */
+    float getYCoordMin(int chan, int samp);
+
+    /** Adds the time spent painting one channel to the paint-time readout. */
+    void addPaintTime(int64 ticks);
+
     int screenBufferIndex;
     int lastScreenBufferIndex;
 
@@ -103,6 +112,8 @@ private:
     LfpDisplayNode* processor;
     AudioSampleBuffer* displayBuffer;
     AudioSampleBuffer* screenBuffer;
+    AudioSampleBuffer* screenBufferMin;
+    EnvelopePyramid* envelope;
     MidiBuffer* eventBuffer;
 
     ScopedPointer<LfpTimescale> timescale;
@@ -121,12 +132,28 @@ private:
 
     OwnedArray<EventDisplayInterface> eventDisplayInterfaces;
 
+    /** Shows the refresh rate, the paint time per frame and the number of
+        frames dropped because the display fell behind. */
+    ScopedPointer<Label> performanceLabel;
+    int64 paintTicks;
+    int numFrames;
+    int64 lastReadoutTicks;
+
+    void updatePerformanceLabel();
+
     void refreshScreenBuffer();
     void updateScreenBuffer();
 
     int displayBufferIndex;
     int displayBufferSize;
 
+    /** Number of samples the processor had written when the sample at
+        displayBufferIndex was written; -1 until the first block arrives. */
+    int64 displaySampleNumber;
+    int64 latestSampleNumber;
+    int latestBufferIndex;
+    int numDroppedFrames;
+
     int scrollBarThickness;
 
     int nChans;
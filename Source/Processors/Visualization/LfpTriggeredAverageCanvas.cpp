@@ -26,28 +26,26 @@
 #include <math.h>
 
 LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* processor_) :
-    screenBufferIndex(0), timebase(1.0f), displayGain(1.0f),   timeOffset(0.0f),
+    screenBufferIndex(0), lastScreenBufferIndex(0), fullredraw(true),
+    displayGain(1.0f),   timeOffset(0.0f),
     processor(processor_),
-    displayBufferIndex(0)
+    displayedTrigger(0), numTrials(0)
 {
 
     nChans = processor->getNumInputs();
     sampleRate = processor->getSampleRate();
     std::cout << "Setting num inputs on LfpTriggeredAverageCanvas to " << nChans << std::endl;
 
-    displayBuffer = processor->getDisplayBufferAddress();
-    displayBufferSize = displayBuffer->getNumSamples();
-    std::cout << "Setting displayBufferSize on LfpTriggeredAverageCanvas to " << displayBufferSize << std::endl;
-
     screenBuffer = new AudioSampleBuffer(MAX_N_CHAN, MAX_N_SAMP);
     screenBuffer->clear();
 
+    errorBuffer = new AudioSampleBuffer(MAX_N_CHAN, MAX_N_SAMP);
+    errorBuffer->clear();
+
     viewport = new Viewport();
     display = new LfpTriggeredAverageDisplay(this, viewport);
     timescale = new LfpTriggeredAverageTimescale(this);
 
-    timescale->setTimebase(timebase);
-
     viewport->setViewedComponent(display, false);
     viewport->setScrollBarsShown(true, false);
 
@@ -68,12 +66,14 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
     voltageRanges.add("2000");
     voltageRanges.add("5000");
 
-    timebases.add("0.2");
-    timebases.add("0.5");
-    timebases.add("1.0");
-    timebases.add("2.0");
-    timebases.add("5.0");
-    timebases.add("10.0");
+    preWindows.add(50.0f);
+    postWindows.add(200.0f);
+    preWindows.add(100.0f);
+    postWindows.add(400.0f);
+    preWindows.add(200.0f);
+    postWindows.add(800.0f);
+    preWindows.add(500.0f);
+    postWindows.add(1000.0f);
 
 
     spreads.add("10");
@@ -90,11 +90,17 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
     rangeSelection->addListener(this);
     addAndMakeVisible(rangeSelection);
 
-    timebaseSelection = new ComboBox("Timebase");
-    timebaseSelection->addItemList(timebases, 1);
-    timebaseSelection->setSelectedId(3,false);
-    timebaseSelection->addListener(this);
-    addAndMakeVisible(timebaseSelection);
+    windowSelection = new ComboBox("Window");
+    for (int i = 0; i < preWindows.size(); i++)
+    {
+        windowSelection->addItem("-" + String(preWindows[i]) + " / " + String(postWindows[i]), i+1);
+    }
+    windowSelection->setSelectedId(2,false);
+    windowSelection->addListener(this);
+    addAndMakeVisible(windowSelection);
+
+    processor->setWindow(preWindows[1], postWindows[1]);
+    timescale->setWindow(preWindows[1], postWindows[1]);
 
 
     spreadSelection = new ComboBox("Spread");
@@ -104,21 +110,39 @@ LfpTriggeredAverageCanvas::LfpTriggeredAverageCanvas(LfpTriggeredAverageNode* pr
     addAndMakeVisible(spreadSelection);
 
 
+    triggerSelection = new ComboBox("Trigger");
+    for (int i = 0; i < 8; i++)
+    {
+        triggerSelection->addItem(String(i+1), i+1);
+    }
+    triggerSelection->setSelectedId(1,false);
+    triggerSelection->addListener(this);
+    addAndMakeVisible(triggerSelection);
+
+    resetButton = new UtilityButton("Reset", Font("Small Text", 13, Font::plain));
+    resetButton->setRadius(5.0f);
+    resetButton->addListener(this);
+    addAndMakeVisible(resetButton);
+
+    trialLabel = new Label("Trials", "0 trials");
+    trialLabel->setFont(Font("Default", 16, Font::plain));
+    trialLabel->setColour(Label::textColourId, Colour(100,100,100));
+    addAndMakeVisible(trialLabel);
+
     display->setNumChannels(nChans);
     display->setRange(1000.0f);
 
-    // add event display-specific controls (currently just an enable/disable button)
+    // add trigger channel controls (one enable/disable button per TTL channel)
     for (int i = 0; i < 8; i++)
     {
 
+        display->setEventDisplayState(i, processor->isTriggerChannel(i));
 
         LfpTriggeredAverageEventInterface* eventOptions = new LfpTriggeredAverageEventInterface(display, this, i);
         LfpTriggeredAverageEventInterfaces.add(eventOptions);
         addAndMakeVisible(eventOptions);
         eventOptions->setBounds(500+(floor(i/2)*20), getHeight()-20-(i%2)*20, 40, 20);
 
-        display->setEventDisplayState(i,true);
-
     }
 
 
@@ -128,6 +152,7 @@ LfpTriggeredAverageCanvas::~LfpTriggeredAverageCanvas()
 {
 
     deleteAndZero(screenBuffer);
+    deleteAndZero(errorBuffer);
 }
 
 void LfpTriggeredAverageCanvas::resized()
@@ -139,8 +164,11 @@ void LfpTriggeredAverageCanvas::resized()
     display->setBounds(0,0,getWidth()-scrollBarThickness, getChannelHeight()*nChans);
 
     rangeSelection->setBounds(5,getHeight()-30,100,25);
-    timebaseSelection->setBounds(175,getHeight()-30,100,25);
+    windowSelection->setBounds(175,getHeight()-30,100,25);
     spreadSelection->setBounds(345,getHeight()-30,100,25);
+    triggerSelection->setBounds(620,getHeight()-30,60,25);
+    resetButton->setBounds(700,getHeight()-30,60,25);
+    trialLabel->setBounds(780,getHeight()-30,200,25);
 
     for (int i = 0; i < 8; i++)
     {
@@ -158,9 +186,7 @@ void LfpTriggeredAverageCanvas::beginAnimation()
 {
     std::cout << "Beginning animation." << std::endl;
 
-    displayBufferSize = displayBuffer->getNumSamples();
-
-    screenBufferIndex = 0;
+    numTrials = -1; // read the average again, even if it is empty
 
     startCallbacks();
 }
@@ -202,9 +228,20 @@ void LfpTriggeredAverageCanvas::update()
 void LfpTriggeredAverageCanvas::comboBoxChanged(ComboBox* cb)
 {
 
-    if (cb == timebaseSelection)
+    if (cb == windowSelection)
+    {
+        const float preMs = preWindows[cb->getSelectedId()-1];
+        const float postMs = postWindows[cb->getSelectedId()-1];
+
+        processor->setWindow(preMs, postMs); // clears the averages
+        timescale->setWindow(preMs, postMs);
+        numTrials = -1;
+        repaint();
+    }
+    else if (cb == triggerSelection)
     {
-        timebase = timebases[cb->getSelectedId()-1].getFloatValue();
+        displayedTrigger = cb->getSelectedId()-1;
+        numTrials = -1;
     }
     else if (cb == rangeSelection)
     {
@@ -220,7 +257,31 @@ void LfpTriggeredAverageCanvas::comboBoxChanged(ComboBox* cb)
         //std::cout << "Setting spread to " << spreads[cb->getSelectedId()-1].getFloatValue() << std::endl;
     }
 
-    timescale->setTimebase(timebase);
+    refresh();
+}
+
+void LfpTriggeredAverageCanvas::buttonClicked(Button* button)
+{
+    if (button == resetButton)
+    {
+        processor->resetAverages();
+        numTrials = -1;
+        refresh();
+    }
+}
+
+void LfpTriggeredAverageCanvas::setTriggerChannel(int channel, bool isTrigger)
+{
+    display->setEventDisplayState(channel, isTrigger);
+    processor->setTriggerChannel(channel, isTrigger);
+
+    LfpTriggeredAverageEventInterfaces[channel]->repaint();
+
+    if (channel == displayedTrigger)
+    {
+        numTrials = -1;
+        refresh();
+    }
 }
 
 
@@ -251,8 +312,7 @@ void LfpTriggeredAverageCanvas::setParameter(int param, float val)
 void LfpTriggeredAverageCanvas::refreshState()
 {
     // called when the component's tab becomes visible again
-    displayBufferIndex = processor->getDisplayBufferIndex();
-    screenBufferIndex = 0;
+    numTrials = -1;
 
 }
 
@@ -279,93 +339,27 @@ void LfpTriggeredAverageCanvas::refreshScreenBuffer()
 
 }
 
-void LfpTriggeredAverageCanvas::updateScreenBuffer()
+bool LfpTriggeredAverageCanvas::updateScreenBuffer()
 {
 
+    // one point per pixel across the whole window
+    int numPoints = jmin(display->getWidth() - leftmargin, (int) MAX_N_SAMP);
 
-    // copy new samples from the displayBuffer into the screenBuffer (waves)
-    int maxSamples = display->getWidth() - leftmargin;
+    int trials = processor->getNumTrials(displayedTrigger);
 
-    if (screenBufferIndex >= maxSamples) // wrap around if we reached right edge before
-        screenBufferIndex = 0;
+    if (trials == numTrials && numPoints == screenBufferIndex)
+        return false; // nothing has been added since the last time
 
-    lastScreenBufferIndex = screenBufferIndex;
+    if (numPoints > 0)
+        trials = processor->getAverage(displayedTrigger, numPoints, *screenBuffer, *errorBuffer);
 
-    int index = processor->getDisplayBufferIndex();
-
-    int nSamples =  index - displayBufferIndex; // N new samples to be addeddisplayBufferIndex
-
-    if (nSamples < 0) // buffer has reset to 0
-    {
-        nSamples = (displayBufferSize - displayBufferIndex) + index;
-    }
-
-    float ratio = sampleRate * timebase / float(getWidth() - leftmargin - scrollBarThickness);
-
-    // this number is crucial: converting from samples to values (in px) for the screen buffer
-    int valuesNeeded = (int) float(nSamples) / ratio;
-
-
-    if (screenBufferIndex + valuesNeeded > maxSamples)  // crop number of samples to fit cavas width
-    {
-        valuesNeeded = maxSamples - screenBufferIndex;
-    }
-
-    float subSampleOffset = 0.0;
-
-    displayBufferIndex = displayBufferIndex % displayBufferSize; // make sure we're not overshooting
-    int nextPos = (displayBufferIndex + 1) % displayBufferSize; //  position next to displayBufferIndex in display buffer to copy from
-
-    if (valuesNeeded > 0 && valuesNeeded < 1000)
-    {
-
-        for (int i = 0; i < valuesNeeded; i++) // also fill one extra sample for line drawing interpolation to match across draws
-        {
-            float gain = 1.0;
-            float alpha = (float) subSampleOffset;
-            float invAlpha = 1.0f - alpha;
-
-            screenBuffer->clear(screenBufferIndex, 1);
-
-            for (int channel = 0; channel <= nChans; channel++) // pull one extra channel for event display
-            {
-
-                screenBuffer->addFrom(channel, // destChannel
-                                      screenBufferIndex, // destStartSample
-                                      displayBuffer->getSampleData(channel, displayBufferIndex), // source
-                                      1, // numSamples
-                                      invAlpha*gain); // gain
-
-                screenBuffer->addFrom(channel, // destChannel
-                                      screenBufferIndex, // destStartSample
-                                      displayBuffer->getSampleData(channel, nextPos), // source
-                                      1, // numSamples
-                                      alpha*gain); // gain
-
-
-            }
-
-            subSampleOffset += ratio;
-
-            while (subSampleOffset >= 1.0)
-            {
-                if (++displayBufferIndex > displayBufferSize)
-                    displayBufferIndex = 0;
-
-                nextPos = (displayBufferIndex + 1) % displayBufferSize;
-                subSampleOffset -= 1.0;
-            }
-
-            screenBufferIndex++;
-
-        }
+    numTrials = trials;
+    lastScreenBufferIndex = 0;
+    screenBufferIndex = jmax(numPoints, 0);
 
+    trialLabel->setText(String(numTrials) + " trials on TTL " + String(displayedTrigger+1), dontSendNotification);
 
-    }
-    else
-    {
-        //std::cout << "Skip." << std::endl;
-    }
+    return true;
 }
 
 float LfpTriggeredAverageCanvas::getXCoord(int chan, int samp)
@@ -383,6 +377,19 @@ float LfpTriggeredAverageCanvas::getYCoord(int chan, int samp)
     return *screenBuffer->getSampleData(chan, samp);
 }
 
+float LfpTriggeredAverageCanvas::getYCoordError(int chan, int samp)
+{
+    return *errorBuffer->getSampleData(chan, samp);
+}
+
+int LfpTriggeredAverageCanvas::getTriggerPosition()
+{
+    const float preMs = processor->getPreWindowMs();
+    const float postMs = processor->getPostWindowMs();
+
+    return int(float(display->getWidth()-leftmargin) * preMs / (preMs + postMs));
+}
+
 void LfpTriggeredAverageCanvas::paint(Graphics& g)
 {
 
@@ -406,12 +413,15 @@ void LfpTriggeredAverageCanvas::paint(Graphics& g)
 
     for (int i = 0; i < 10; i++)
     {
-        if (i == 5 || i == 0)
+        if (i == 0)
             g.drawLine(w/10*i+leftmargin,0,w/10*i+leftmargin,getHeight()-60,3.0f);
         else
             g.drawLine(w/10*i+leftmargin,0,w/10*i+leftmargin,getHeight()-60,1.0f);
     }
 
+    // the trigger
+    g.drawLine(getTriggerPosition()+leftmargin,0,getTriggerPosition()+leftmargin,getHeight()-60,3.0f);
+
     g.drawLine(0,getHeight()-60,getWidth(),getHeight()-60,3.0f);
 
     g.setFont(Font("Default", 16, Font::plain));
@@ -419,10 +429,11 @@ void LfpTriggeredAverageCanvas::paint(Graphics& g)
     g.setColour(Colour(100,100,100));
 
     g.drawText("Voltage range (uV)",5,getHeight()-55,300,20,Justification::left, false);
-    g.drawText("Timebase (s)",175,getHeight()-55,300,20,Justification::left, false);
+    g.drawText("Window (ms)",175,getHeight()-55,300,20,Justification::left, false);
     g.drawText("Spread (px)",345,getHeight()-55,300,20,Justification::left, false);
 
-    g.drawText("Event display",500,getHeight()-55,300,20,Justification::left, false);
+    g.drawText("Triggers",500,getHeight()-55,300,20,Justification::left, false);
+    g.drawText("Averaged on",620,getHeight()-55,300,20,Justification::left, false);
 
 
 
@@ -430,9 +441,11 @@ void LfpTriggeredAverageCanvas::paint(Graphics& g)
 
 void LfpTriggeredAverageCanvas::refresh()
 {
-    updateScreenBuffer();
-
-    display->refresh(); // redraws only the new part of the screen buffer
+    if (updateScreenBuffer())
+    {
+        fullredraw = true; // a new trial changes the whole average
+        display->refresh();
+    }
 
     //getPeer()->performAnyPendingRepaintsNow();
 
@@ -445,8 +458,9 @@ void LfpTriggeredAverageCanvas::saveVisualizerParameters(XmlElement* xml)
 
 
     xmlNode->setAttribute("Range",rangeSelection->getSelectedId());
-    xmlNode->setAttribute("Timebase",timebaseSelection->getSelectedId());
+    xmlNode->setAttribute("Window",windowSelection->getSelectedId());
     xmlNode->setAttribute("Spread",spreadSelection->getSelectedId());
+    xmlNode->setAttribute("Trigger",triggerSelection->getSelectedId());
 
     int eventButtonState = 0;
 
@@ -472,17 +486,18 @@ void LfpTriggeredAverageCanvas::loadVisualizerParameters(XmlElement* xml)
         if (xmlNode->hasTagName("LfpTriggeredAverageDisplay"))
         {
             rangeSelection->setSelectedId(xmlNode->getIntAttribute("Range"));
-            timebaseSelection->setSelectedId(xmlNode->getIntAttribute("Timebase"));
+            windowSelection->setSelectedId(xmlNode->getIntAttribute("Window", 2));
             spreadSelection->setSelectedId(xmlNode->getIntAttribute("Spread"));
+            triggerSelection->setSelectedId(xmlNode->getIntAttribute("Trigger", 1));
 
             viewport->setViewPosition(xmlNode->getIntAttribute("ScrollX"),
                                       xmlNode->getIntAttribute("ScrollY"));
 
-            int eventButtonState = xmlNode->getIntAttribute("eventButtonState");
+            int eventButtonState = xmlNode->getIntAttribute("EventButtonState", 1);
 
             for (int i = 0; i < 8; i++)
             {
-            	display->eventDisplayEnabled[i] = (eventButtonState >> i) & 1;
+            	setTriggerChannel(i, (eventButtonState >> i) & 1);
 
             	LfpTriggeredAverageEventInterfaces[i]->checkEnabledState();
             }
@@ -518,27 +533,24 @@ void LfpTriggeredAverageTimescale::paint(Graphics& g)
 
     for (int i = 1; i < 10; i++)
     {
-        if (i == 5)
-            g.drawLine(getWidth()/10*i,0,getWidth()/10*i,getHeight(),3.0f);
-        else
-            g.drawLine(getWidth()/10*i,0,getWidth()/10*i,getHeight(),1.0f);
+        g.drawLine(getWidth()/10*i,0,getWidth()/10*i,getHeight(),1.0f);
 
         g.drawText(labels[i-1],getWidth()/10*i+3,0,100,getHeight(),Justification::left, false);
     }
 
+    g.drawLine(canvas->getTriggerPosition(),0,canvas->getTriggerPosition(),getHeight(),3.0f);
+
 }
 
-void LfpTriggeredAverageTimescale::setTimebase(float t)
+void LfpTriggeredAverageTimescale::setWindow(float preMs, float postMs)
 {
-    timebase = t;
-
     labels.clear();
 
     for (float i = 1.0f; i < 10.0; i++)
     {
-        String labelString = String(timebase/10.0f*1000.0f*i);
+        String labelString = String((preMs+postMs)/10.0f*i - preMs);
 
-        labels.add(labelString.substring(0,4));
+        labels.add(labelString.substring(0,5));
     }
 
     repaint();
@@ -878,17 +890,6 @@ LfpTriggeredAverageChannelDisplay::~LfpTriggeredAverageChannelDisplay()
 void LfpTriggeredAverageChannelDisplay::paint(Graphics& g)
 {
 
-    //g.fillAll(Colours::grey);
-
-    g.setColour(Colours::yellow);   // draw most recent drawn sample position
-    g.drawLine(canvas->screenBufferIndex+1, 0, canvas->screenBufferIndex+1, getHeight());
-
-
-
-
-    //g.setColour(Colours::red); // draw oldest drawn sample position
-    //g.drawLine(canvas->lastScreenBufferIndex, 0, canvas->lastScreenBufferIndex, getHeight()-channelOverlap);
-
     int center = getHeight()/2;
 
     if (isSelected)
@@ -909,110 +910,47 @@ void LfpTriggeredAverageChannelDisplay::paint(Graphics& g)
     g.setColour(Colour(40,40,40));
     g.drawLine(0, getHeight()/2, getWidth(), getHeight()/2);
 
-    int stepSize = 1;
-    int from = 0; // for vertical line drawing in the LFP data
-    int to = 0;
+    // the trigger, in the colour of its TTL channel
+    g.setColour(display->channelColours[canvas->getDisplayedTrigger()*2].withAlpha(0.35f));
+    g.drawLine(canvas->getTriggerPosition(), center-channelHeight/2, canvas->getTriggerPosition(), center+channelHeight/2);
 
-    //for (int i = 0; i < getWidth()-stepSize; i += stepSize) // redraw entire display
-    int ifrom = canvas->lastScreenBufferIndex - 3; // need to start drawing a bit before the actual redraw windowfor the interpolated line to join correctly
+    fullredraw = false; // the average is always drawn in full
 
-    if (ifrom < 0)
-        ifrom = 0;
+    if (canvas->getNumTrials() <= 0)
+        return;
 
-    int ito = canvas->screenBufferIndex - 1;
+    const float scale = channelHeightFloat/range;
+    const int numPoints = canvas->screenBufferIndex;
 
-    if (fullredraw)
-    {
-        ifrom = 0; //canvas->leftmargin;
-        ito = getWidth()-stepSize;
-        fullredraw = false;
-    }
+    // the SEM as one band and the mean as one line, each made of one rectangle
+    // per pixel column and filled in a single call
+    Path errorBand;
+    Path meanLine;
 
-    for (int i = ifrom; i < ito ; i += stepSize) // redraw only changed portion
+    for (int i = 0; i < numPoints; i++)
     {
+        const float mean = canvas->getYCoord(chan, i);
+        const float error = canvas->getYCoordError(chan, i);
 
-        // draw event markers
-        int rawEventState = canvas->getYCoord(canvas->getNumChannels(), i);// get last channel+1 in buffer (represents events)
-        for (int ev_ch = 0; ev_ch < 8 ; ev_ch++) // for all event channels
-        {
-            if (display->getEventDisplayState(ev_ch))  // check if plotting for this channel is enabled
-            {
-                if (rawEventState & (1 << ev_ch))    // events are  representet by a bit code, so we have to extract the individual bits with a mask
-                {
-                    g.setColour(display->channelColours[ev_ch*2]); // get color from lfp color scheme
-                    g.setOpacity(0.35f);
-                    g.drawLine(i, center-channelHeight/2 , i, center+channelHeight/2);
-                }
-            }
-        }
-
-        //std::cout << "e " << canvas->getYCoord(canvas->getNumChannels()-1, i) << std::endl;
-
-        g.setColour(lineColour);
-        g.setOpacity(1);
+        errorBand.addRectangle(float(i), (mean-error)*scale+center, 1.0f, 2.0f*error*scale);
 
-        // drawLine makes for ok anti-aliased plots, but is pretty slow
-        g.drawLine(i,
-                   (canvas->getYCoord(chan, i)/range*channelHeightFloat)+getHeight()/2,
-                   i+stepSize,
-                   (canvas->getYCoord(chan, i+stepSize)/range*channelHeightFloat)+getHeight()/2);
-
-        if (false) // switched back to line drawing now that we only draw partial updates
-        {
-
-            // // pixel wise line plot has no anti-aliasing, but runs much faster
-            double a = (canvas->getYCoord(chan, i)/range*channelHeightFloat)+getHeight()/2;
-            double b = (canvas->getYCoord(chan, i+stepSize)/range*channelHeightFloat)+getHeight()/2;
-
-            if (a<b)
-            {
-                from = (a);
-                to = (b);
-            }
-            else
-            {
-                from = (b);
-                to = (a);
-            }
-
-            if ((to-from) < 40)  // if there is too much vertical range in one pixel, don't draw the full line for speed reasons
-            {
-                for (int j = from; j <= to; j += 1)
-                {
-                    g.setPixel(i,j);
-                }
-            }
-            else if ((to-from) < 100)
-            {
-                for (int j = from; j <= to; j += 2)
-                {
-                    g.setPixel(i,j);
-                }
-            }
-            else
-            {
-                g.setPixel(i,to);
-                g.setPixel(i,from);
-            }
-
-        }
+        // join this point to the next one
+        const float next = (i < numPoints-1) ? canvas->getYCoord(chan, i+1) : mean;
+        const float low = jmin(mean, next)*scale+center;
+        const float high = jmax(mean, next)*scale+center;
 
+        meanLine.addRectangle(float(i), low, 1.0f, high-low+1.0f);
     }
 
-    // g.setColour(lineColour.withAlpha(0.7f)); // alpha on seems to decrease draw speed
-    // g.setFont(channelFont);
-    //  g.setFont(channelHeightFloat*0.6);
-
-    // g.drawText(String(chan+1), 10, center-channelHeight/2, 200, channelHeight, Justification::left, false);
+    g.setColour(lineColour.withAlpha(0.3f));
+    g.fillPath(errorBand);
 
+    g.setColour(lineColour);
+    g.fillPath(meanLine);
 
 }
 
 
-
-
-
-
 void LfpTriggeredAverageChannelDisplay::setRange(float r)
 {
     range = r;
@@ -1134,14 +1072,8 @@ void LfpTriggeredAverageEventInterface::checkEnabledState()
 void LfpTriggeredAverageEventInterface::buttonClicked(Button* button)
 {
     checkEnabledState();
-    if (isEnabled)
-    {
-        display->setEventDisplayState(channelNumber, false);
-    }
-    else
-    {
-        display->setEventDisplayState(channelNumber, true);
-    }
+
+    canvas->setTriggerChannel(channelNumber, !isEnabled);
 
     repaint();
 
@@ -37,14 +37,18 @@ class LfpTriggeredAverageEventInterface;
 
 /**
 
-  Displays multiple channels of continuous data.
+  Displays the mean (+/- SEM) of every channel around the triggers of one
+  TTL channel, as computed by LfpTriggeredAverageNode.
+
+  The averages are only read again when new trials have been added.
 
   @see LfpTriggeredAverageNode, LfpTriggeredAverageDisplayEditor
 
 */
 
 class LfpTriggeredAverageCanvas : public Visualizer,
-    public ComboBox::Listener
+    public ComboBox::Listener,
+    public Button::Listener
 
 {
 public:
@@ -73,12 +77,31 @@ public:
 
     float getXCoord(int chan, int samp);
     float getYCoord(int chan, int samp);
+    float getYCoordError(int chan, int samp);
+
+    /** Returns the x position of the trigger in the channel displays.*/
+    int getTriggerPosition();
+
+    int getNumTrials()
+    {
+        return numTrials;
+    }
+
+    int getDisplayedTrigger()
+    {
+        return displayedTrigger;
+    }
+
+    /** Starts or stops averaging on a TTL channel.*/
+    void setTriggerChannel(int channel, bool isTrigger);
 
     int screenBufferIndex;
     int lastScreenBufferIndex;
 
     void comboBoxChanged(ComboBox* cb);
 
+    void buttonClicked(Button* button);
+
     void saveVisualizerParameters(XmlElement* xml);
 
     void loadVisualizerParameters(XmlElement* xml);
@@ -91,7 +114,6 @@ public:
 private:
 
     float sampleRate;
-    float timebase;
     float displayGain;
     float timeOffset;
     //int spread ; // vertical spacing between channels
@@ -101,29 +123,35 @@ private:
     //float waves[MAX_N_CHAN][MAX_N_SAMP*2]; // we need an x and y point for each sample
 
     LfpTriggeredAverageNode* processor;
-    AudioSampleBuffer* displayBuffer;
     AudioSampleBuffer* screenBuffer;
-    MidiBuffer* eventBuffer;
+    AudioSampleBuffer* errorBuffer;
 
     ScopedPointer<LfpTriggeredAverageTimescale> timescale;
     ScopedPointer<LfpTriggeredAverageDisplay> display;
     ScopedPointer<Viewport> viewport;
 
-    ScopedPointer<ComboBox> timebaseSelection;
+    ScopedPointer<ComboBox> windowSelection;
     ScopedPointer<ComboBox> rangeSelection;
     ScopedPointer<ComboBox> spreadSelection;
+    ScopedPointer<ComboBox> triggerSelection;
+
+    ScopedPointer<UtilityButton> resetButton;
+    ScopedPointer<Label> trialLabel;
 
     StringArray voltageRanges;
-    StringArray timebases;
+    Array<float> preWindows; // ms before and after the trigger, per window option
+    Array<float> postWindows;
     StringArray spreads; // option for vertical spacing between channels
 
     OwnedArray<LfpTriggeredAverageEventInterface> LfpTriggeredAverageEventInterfaces;
 
     void refreshScreenBuffer();
-    void updateScreenBuffer();
 
-    int displayBufferIndex;
-    int displayBufferSize;
+    /** Reads the average again if it has changed; returns true if it has.*/
+    bool updateScreenBuffer();
+
+    int displayedTrigger;
+    int numTrials;
 
     int scrollBarThickness;
 
@@ -141,14 +169,12 @@ public:
 
     void paint(Graphics& g);
 
-    void setTimebase(float t);
+    void setWindow(float preMs, float postMs);
 
 private:
 
     LfpTriggeredAverageCanvas* canvas;
 
-    float timebase;
-
     Font font;
 
     StringArray labels;
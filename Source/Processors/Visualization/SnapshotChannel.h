@@ -0,0 +1,190 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+#ifndef __SNAPSHOTCHANNEL_H_7A3D91E4__
+#define __SNAPSHOTCHANNEL_H_7A3D91E4__
+
+#include "../../../JuceLibraryCode/JuceHeader.h"
+
+/**
+
+  Hands objects from the processing thread to a visualizer without locks.
+
+  There must be exactly one producer (a processor's process() method) and one
+  consumer (its canvas, on the message thread). The producer never waits:
+  push() writes into the next slot of a ring, overwriting the oldest object
+  if the consumer has fallen more than getCapacity() objects behind.
+
+  Every slot carries a sequence number, which is odd while the slot is being
+  written. The consumer checks it before and after copying an object, so an
+  object that was overwritten in the meantime is thrown away rather than
+  displayed half-updated. Objects lost in either way are counted by
+  getNumDropped().
+
+  ObjectType must be safe to copy with memcpy (e.g. SpikeObject).
+
+  @see SpikeDisplayNode, LfpDisplayNode
+
+*/
+
+template <typename ObjectType>
+class SnapshotChannel
+{
+public:
+
+    SnapshotChannel(int capacity_ = 64)
+        : capacity(0), numRead(0), numDropped(0)
+    {
+        setCapacity(capacity_);
+    }
+
+    ~SnapshotChannel() {}
+
+    /** Reallocates the ring and empties it. Must not be called while the
+        producer or the consumer is using the channel.*/
+    void setCapacity(int newCapacity)
+    {
+        capacity = jmax(1, newCapacity);
+        slots.calloc(capacity);
+        numWritten.set(0);
+        numRead = 0;
+        numDropped = 0;
+    }
+
+    int getCapacity()
+    {
+        return capacity;
+    }
+
+    /** Called by the producer: publishes a copy of object.*/
+    void push(const ObjectType& object)
+    {
+        const int64 n = numWritten.get();
+        Slot& slot = slots[(int) (n % capacity)];
+
+        slot.sequence.set(2*n + 1);
+        Atomic<int64>::memoryBarrier();
+
+        slot.object = object;
+
+        Atomic<int64>::memoryBarrier();
+        slot.sequence.set(2*n + 2);
+
+        numWritten.set(n + 1);
+    }
+
+    /** Called by the consumer: copies the oldest object that has not been
+        read yet. Returns false if there is none.*/
+    bool pop(ObjectType& object)
+    {
+        for (;;)
+        {
+            const int64 written = numWritten.get();
+
+            if (numRead >= written)
+                return false;
+
+            if (written - numRead > capacity)
+            {
+                // the oldest objects have already been overwritten
+                numDropped += written - capacity - numRead;
+                numRead = written - capacity;
+            }
+
+            Slot& slot = slots[(int) (numRead % capacity)];
+            const int64 expected = 2*numRead + 2;
+
+            if (slot.sequence.get() == expected)
+            {
+                object = slot.object;
+                Atomic<int64>::memoryBarrier();
+
+                if (slot.sequence.get() == expected)
+                {
+                    numRead++;
+                    return true;
+                }
+            }
+
+            // the producer got to this slot while it was being copied
+            numDropped++;
+            numRead++;
+        }
+    }
+
+    /** Called by the consumer: copies the newest object, and skips the older
+        ones without counting them as dropped. Returns false if no object
+        has been pushed since the last read.*/
+    bool popLatest(ObjectType& object)
+    {
+        const int64 written = numWritten.get();
+
+        if (numRead >= written)
+            return false;
+
+        numRead = written - 1;
+
+        return pop(object);
+    }
+
+    /** Called by the consumer: skips all objects pushed so far.*/
+    void flush()
+    {
+        numRead = numWritten.get();
+    }
+
+    /** Returns the number of objects pushed since the last setCapacity().*/
+    int64 getNumPushed()
+    {
+        return numWritten.get();
+    }
+
+    /** Returns the number of objects that were overwritten before the
+        consumer could read them. Only meaningful on the consumer's thread.*/
+    int64 getNumDropped()
+    {
+        return numDropped;
+    }
+
+private:
+
+    struct Slot
+    {
+        Atomic<int64> sequence;
+        ObjectType object;
+    };
+
+    HeapBlock<Slot> slots;
+    int capacity;
+
+    Atomic<int64> numWritten;
+
+    // only touched by the consumer
+    int64 numRead;
+    int64 numDropped;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SnapshotChannel);
+
+};
+
+
+#endif  // __SNAPSHOTCHANNEL_H_7A3D91E4__
@@ -59,7 +59,7 @@ SpikeDisplayCanvas::SpikeDisplayCanvas(SpikeDisplayNode* n) :
 
 SpikeDisplayCanvas::~SpikeDisplayCanvas()
 {
-    processor->removeSpikePlots();
+
 }
 
 void SpikeDisplayCanvas::beginAnimation()
@@ -74,6 +74,9 @@ void SpikeDisplayCanvas::endAnimation()
     std::cout << "SpikeDisplayCanvas ending animation." << std::endl;
 
     stopCallbacks();
+
+    std::cout << processor->getSpikeChannel()->getNumDropped()
+              << " spikes were dropped because the display fell behind." << std::endl;
 }
 
 void SpikeDisplayCanvas::update()
@@ -83,13 +86,14 @@ void SpikeDisplayCanvas::update()
 
     int nPlots = processor->getNumElectrodes();
     spikeDisplay->removePlots();
-    processor->removeSpikePlots();
+
+    // spikes still waiting may belong to electrodes that no longer exist
+    processor->getSpikeChannel()->flush();
 
     for (int i = 0; i < nPlots; i++)
     {
-        SpikePlot* sp = spikeDisplay->addSpikePlot(processor->getNumberOfChannelsForElectrode(i), i,
+        spikeDisplay->addSpikePlot(processor->getNumberOfChannelsForElectrode(i), i,
                                    processor->getNameForElectrode(i));
-        processor->addSpikePlotForElectrode(sp, i);
     }
 
     spikeDisplay->resized();
@@ -133,7 +137,26 @@ void SpikeDisplayCanvas::refresh()
 void SpikeDisplayCanvas::processSpikeEvents()
 {
 
-    processor->setParameter(2, 0.0f); // request redraw
+    // take the spikes the processor has pushed since the last refresh
+    SnapshotChannel<SpikeObject>* spikeChannel = processor->getSpikeChannel();
+
+    while (spikeChannel->pop(spike))
+    {
+        if (spike.source < spikeDisplay->getNumPlots())
+            spikeDisplay->plotSpike(spike, spike.source);
+    }
+
+    // exchange thresholds with the processor
+    for (int i = 0; i < spikeDisplay->getNumPlots(); i++)
+    {
+        SpikePlot* sp = spikeDisplay->getSpikePlot(i);
+
+        for (int j = 0; j < processor->getNumberOfChannelsForElectrode(i); j++)
+        {
+            processor->setDisplayThreshold(i, j, sp->getDisplayThresholdForChannel(j));
+            sp->setDetectorThresholdForChannel(j, processor->getDetectorThreshold(i, j));
+        }
+    }
 
 }
 
@@ -139,6 +139,16 @@ public:
 
     void plotSpike(const SpikeObject& spike, int electrodeNum);
 
+    int getNumPlots()
+    {
+        return spikePlots.size();
+    }
+
+    SpikePlot* getSpikePlot(int electrodeNum)
+    {
+        return spikePlots[electrodeNum];
+    }
+
     int getTotalHeight()
     {
         return totalHeight;
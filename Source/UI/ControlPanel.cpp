@@ -128,7 +128,7 @@ void CPUMeter::paint(Graphics& g)
 
 
 DiskSpaceMeter::DiskSpaceMeter()
-
+    : writeFailed(false)
 {
 
     font = Font("Small Text", 12, Font::plain);
@@ -151,10 +151,23 @@ void DiskSpaceMeter::updateDiskSpace(float percent)
     diskFree = percent;
 }
 
+void DiskSpaceMeter::setWriteFailed(bool failed)
+{
+    if (failed == writeFailed)
+        return;
+
+    writeFailed = failed;
+
+    if (writeFailed)
+        setTooltip("Samples could not be written to disk");
+    else
+        setTooltip("Disk space available");
+}
+
 void DiskSpaceMeter::paint(Graphics& g)
 {
 
-    g.fillAll(Colours::grey);
+    g.fillAll(writeFailed ? Colours::red : Colours::grey);
 
     g.setColour(Colours::lightgrey);
     if (diskFree > 0)
@@ -361,7 +374,7 @@ void ControlPanelButton::setState(bool b)
 
 
 ControlPanel::ControlPanel(ProcessorGraph* graph_, AudioComponent* audio_)
-    : graph(graph_), audio(audio_), initialize(true), open(false)
+    : graph(graph_), audio(audio_), initialize(true), reportedWriteFailure(false), open(false)
 {
 
     if (1)
@@ -443,6 +456,14 @@ ControlPanel::ControlPanel(ProcessorGraph* graph_, AudioComponent* audio_)
     addChildComponent(appendText);
     appendText->setTooltip("Append to name of data directory");
 
+    recordFormatSelector = new ComboBox("Record format");
+    recordFormatSelector->addItem("Open Ephys", RecordNode::OPEN_EPHYS_FORMAT + 1);
+    recordFormatSelector->addItem("Interleaved", RecordNode::INTERLEAVED_FORMAT + 1);
+    recordFormatSelector->setSelectedId(RecordNode::OPEN_EPHYS_FORMAT + 1, true);
+    recordFormatSelector->addListener(this);
+    recordFormatSelector->setTooltip("Format for continuous data files");
+    addChildComponent(recordFormatSelector);
+
     //diskMeter->updateDiskSpace(graph->getRecordNode()->getFreeSpace());
     //diskMeter->repaint();
     //refreshMeters();
@@ -468,6 +489,13 @@ void ControlPanel::setRecordState(bool t)
 
 }
 
+void ControlPanel::setAcquisitionState(bool t)
+{
+
+    playButton->setToggleState(t, true);
+
+}
+
 void ControlPanel::updateChildComponents()
 {
 
@@ -544,9 +572,12 @@ void ControlPanel::resized()
 
     if (open)
     {
-        filenameComponent->setBounds(165, h+5, w-500, h-10);
+        filenameComponent->setBounds(165, h+5, w-615, h-10);
         filenameComponent->setVisible(true);
 
+        recordFormatSelector->setBounds(165+w-605, h+5, 105, h-10);
+        recordFormatSelector->setVisible(true);
+
         newDirectoryButton->setBounds(w-h+4, h+5, h-10, h-10);
         newDirectoryButton->setVisible(true);
 
@@ -563,6 +594,7 @@ void ControlPanel::resized()
     else
     {
         filenameComponent->setVisible(false);
+        recordFormatSelector->setVisible(false);
         newDirectoryButton->setVisible(false);
         prependText->setVisible(false);
         dateText->setVisible(false);
@@ -586,6 +618,15 @@ void ControlPanel::labelTextChanged(Label* label)
 
 }
 
+void ControlPanel::comboBoxChanged(ComboBox* comboBox)
+{
+    if (comboBox == recordFormatSelector)
+    {
+        // takes effect the next time recording starts
+        graph->getRecordNode()->setRecordingFormat(comboBox->getSelectedId() - 1);
+    }
+}
+
 void ControlPanel::startRecording()
 {
     playButton->setToggleState(true,false);
@@ -774,6 +815,17 @@ void ControlPanel::refreshMeters()
     masterClock->repaint();
 
     diskMeter->updateDiskSpace(graph->getRecordNode()->getFreeSpace());
+
+    // the counter is reset when the next recording starts
+    const int unwrittenSamples = graph->getRecordNode()->getDiskWriteThread()->getNumUnwrittenSamples();
+
+    diskMeter->setWriteFailed(unwrittenSamples > 0);
+
+    if (unwrittenSamples > 0 && !reportedWriteFailure)
+        sendActionMessage("Could not write to disk; samples are being lost.");
+
+    reportedWriteFailure = unwrittenSamples > 0;
+
     diskMeter->repaint();
 
     if (initialize)
@@ -841,6 +893,7 @@ void ControlPanel::saveStateToXml(XmlElement* xml)
     controlPanelState->setAttribute("isOpen",open);
     controlPanelState->setAttribute("prependText",prependText->getText());
     controlPanelState->setAttribute("appendText",appendText->getText());
+    controlPanelState->setAttribute("recordingFormat",recordFormatSelector->getSelectedId() - 1);
 
 }
 
@@ -855,6 +908,9 @@ void ControlPanel::loadStateFromXml(XmlElement* xml)
             appendText->setText(xmlNode->getStringAttribute("appendText", ""), dontSendNotification);
             prependText->setText(xmlNode->getStringAttribute("prependText", ""), dontSendNotification);
 
+            int format = xmlNode->getIntAttribute("recordingFormat", RecordNode::OPEN_EPHYS_FORMAT);
+            recordFormatSelector->setSelectedId(format + 1, false);
+
             bool isOpen = xmlNode->getBoolAttribute("isOpen");
             openState(isOpen);
 
@@ -141,6 +141,10 @@ public:
     	the ControlPanel. */
     void updateDiskSpace(float percent);
 
+    /** Shows whether samples could not be written to disk. Called by
+    	the ControlPanel. */
+    void setWriteFailed(bool failed);
+
     /** Draws the DiskSpaceMeter. */
     void paint(Graphics& g);
 
@@ -150,6 +154,8 @@ private:
 
     float diskFree;
 
+    bool writeFailed;
+
 };
 
 /**
@@ -267,8 +273,8 @@ class UtilityButton;
   Displays useful information and provides buttons to control acquistion and recording.
 
   The ControlPanel contains the PlayButton, the RecordButton, the CPUMeter,
-  the DiskSpaceMeter, the Clock, the AudioEditor, and a FilenameComponent for switching the
-  current data directory.
+  the DiskSpaceMeter, the Clock, the AudioEditor, a FilenameComponent for switching the
+  current data directory, and a ComboBox for selecting the recording format.
 
   @see UIComponent
 
@@ -278,7 +284,8 @@ class ControlPanel : public Component,
     public Button::Listener,
     public Timer,
     public AccessClass,
-    public Label::Listener
+    public Label::Listener,
+    public ComboBox::Listener
 
 {
 public:
@@ -304,6 +311,9 @@ public:
     /** Used to manually turn recording on and off.*/
     void setRecordState(bool isRecording);
 
+    /** Used to manually start and stop acquisition.*/
+    void setAcquisitionState(bool isAcquiring);
+
     /** Returns a boolean that indicates whether or not the FilenameComponet
         is visible. */
     bool isOpen()
@@ -314,6 +324,9 @@ public:
     /** Notifies the control panel when the filename is updated */
     void labelTextChanged(Label*);
 
+    /** Passes the selected recording format to the RecordNode */
+    void comboBoxChanged(ComboBox*);
+
     /** Used by RecordNode to set the filename. */
     String getTextToPrepend();
 
@@ -343,6 +356,8 @@ private:
     ScopedPointer<Label> dateText;
     ScopedPointer<Label> appendText;
 
+    ScopedPointer<ComboBox> recordFormatSelector;
+
     ProcessorGraph* graph;
     AudioComponent* audio;
     AudioEditor* audioEditor;
@@ -361,6 +376,9 @@ private:
 
     bool initialize;
 
+    /** True once the loss of samples during the current recording has been reported.*/
+    bool reportedWriteFailure;
+
     /** Adds the RecordNode as a listener of the FilenameComponent
     (so it knows when the data directory has changed).*/
     void updateChildComponents();
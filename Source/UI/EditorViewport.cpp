@@ -1245,6 +1245,7 @@ const String EditorViewport::saveState(File fileToUse)
     XmlElement* audioSettings = new XmlElement("AUDIO");
 
     audioSettings->setAttribute("bufferSize", getAudioComponent()->getBufferSize());
+    audioSettings->setAttribute("internalClock", getAudioComponent()->isUsingInternalClock());
     xml->addChildElement(audioSettings);
 
 
@@ -1391,6 +1392,11 @@ const String EditorViewport::loadState(File fileToLoad)
 
         } else if (element->hasTagName("AUDIO"))
         {
+            // a configuration saved with an audio card doesn't turn the internal
+            // clock off, so it can still be loaded on machines without one
+            if (element->getBoolAttribute("internalClock", false))
+                getAudioComponent()->setUseInternalClock(true);
+
             int bufferSize = element->getIntAttribute("bufferSize");
             getAudioComponent()->setBufferSize(bufferSize);
         }
@@ -0,0 +1,286 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "PerformancePanel.h"
+#include "../Processors/ProcessorGraph.h"
+#include "../Processors/GenericProcessor.h"
+#include "../Processors/Editors/GenericEditor.h" // for UtilityButton
+
+// height of one row of the table
+#define ROW_HEIGHT 20
+
+// left edge of each column of the table
+static const int columnX[] = { 10, 200, 270, 340, 410, 480, 550, 630, 700 };
+static const char* columnNames[] = { "Processor", "Mean", "p99", "Max", "Block", "Load",
+                                     "Overruns", "Events", "Overflow"
+                                   };
+static const int numColumns = sizeof(columnX) / sizeof(columnX[0]);
+
+PerformancePanel::PerformancePanel(ProcessorGraph* graph_)
+    : graph(graph_)
+{
+
+    font = Font("Small Text", 13, Font::plain);
+
+    resetButton = new UtilityButton("Reset", Font("Small Text", 13, Font::plain));
+    resetButton->addListener(this);
+    resetButton->setTooltip("Clear the statistics of all processors");
+    addAndMakeVisible(resetButton);
+
+    csvButton = new UtilityButton("Save CSV", Font("Small Text", 13, Font::plain));
+    csvButton->addListener(this);
+    addAndMakeVisible(csvButton);
+
+    jsonButton = new UtilityButton("Save JSON", Font("Small Text", 13, Font::plain));
+    jsonButton->addListener(this);
+    addAndMakeVisible(jsonButton);
+
+    updateRows();
+
+    startTimer(500);
+
+}
+
+PerformancePanel::~PerformancePanel()
+{
+
+}
+
+void PerformancePanel::updateRows()
+{
+    rows.clearQuick();
+
+    for (int i = 0; i < graph->getNumNodes(); i++)
+    {
+        GenericProcessor* p = dynamic_cast<GenericProcessor*>(graph->getNode(i)->getProcessor());
+
+        if (p == nullptr) // the graph's output node
+            continue;
+
+        Row row;
+        row.name = p->getName();
+        row.nodeId = p->getNodeId();
+        row.stats = p->getStats().getSnapshot();
+
+        rows.add(row);
+    }
+}
+
+void PerformancePanel::timerCallback()
+{
+    if (isShowing())
+    {
+        updateRows();
+        repaint();
+    }
+}
+
+void PerformancePanel::paint(Graphics& g)
+{
+    g.fillAll(Colour(58,58,58));
+
+    g.setFont(font);
+    g.setColour(Colours::lightgrey);
+
+    for (int c = 0; c < numColumns; c++)
+        g.drawText(columnNames[c], columnX[c], 40, 70, ROW_HEIGHT, Justification::left, false);
+
+    g.drawLine(10.0f, 40.0f + ROW_HEIGHT, float(getWidth() - 10), 40.0f + ROW_HEIGHT);
+
+    for (int i = 0; i < rows.size(); i++)
+    {
+        const Row& row = rows.getReference(i);
+        const ProcessorStats::Snapshot& s = row.stats;
+        const int y = 45 + (i + 1) * ROW_HEIGHT;
+
+        if (s.meanBlockDurationMs > 0 && s.p99TimeMs > s.meanBlockDurationMs)
+            g.setColour(Colours::red);
+        else if (s.meanBlockDurationMs > 0 && s.p99TimeMs > 0.5 * s.meanBlockDurationMs)
+            g.setColour(Colours::orange);
+        else
+            g.setColour(Colours::white);
+
+        String load = (s.meanBlockDurationMs > 0)
+                      ? String(100.0 * s.meanTimeMs / s.meanBlockDurationMs, 1) + " %"
+                      : String("-");
+
+        const String values[] = { row.name + " (" + String(row.nodeId) + ")",
+                                  String(s.meanTimeMs, 3),
+                                  String(s.p99TimeMs, 3),
+                                  String(s.maxTimeMs, 3),
+                                  String(s.meanBlockDurationMs, 2),
+                                  load,
+                                  String(s.numOverruns),
+                                  String(s.numEvents),
+                                  String(s.numDroppedEvents)
+                                };
+
+        for (int c = 0; c < numColumns; c++)
+        {
+            const int width = (c + 1 < numColumns) ? columnX[c + 1] - columnX[c] - 5 : 70;
+            g.drawText(values[c], columnX[c], y, width, ROW_HEIGHT, Justification::left, true);
+        }
+    }
+
+    g.setColour(Colours::lightgrey);
+
+    if (rows.size() == 0)
+        g.drawText("No processors.", 10, 45 + ROW_HEIGHT, 200, ROW_HEIGHT, Justification::left, false);
+
+    g.drawText("Times in ms, since acquisition started", 250, 10, 300, ROW_HEIGHT,
+               Justification::left, false);
+}
+
+void PerformancePanel::resized()
+{
+    resetButton->setBounds(10,10,60,20);
+    csvButton->setBounds(getWidth()-160,10,70,20);
+    jsonButton->setBounds(getWidth()-85,10,75,20);
+}
+
+void PerformancePanel::buttonClicked(Button* button)
+{
+    if (button == resetButton)
+    {
+        for (int i = 0; i < graph->getNumNodes(); i++)
+        {
+            GenericProcessor* p = dynamic_cast<GenericProcessor*>(graph->getNode(i)->getProcessor());
+
+            if (p != nullptr)
+                p->getStats().requestReset();
+        }
+    }
+    else if (button == csvButton)
+    {
+        updateRows();
+        saveToFile(getStatsAsCsv(), "csv");
+    }
+    else if (button == jsonButton)
+    {
+        updateRows();
+        saveToFile(getStatsAsJson(), "json");
+    }
+}
+
+String PerformancePanel::getStatsAsCsv()
+{
+    String text = "processor,node_id,blocks,samples,events,mean_ms,p99_ms,max_ms,block_ms,overruns,overflow_events\n";
+
+    for (int i = 0; i < rows.size(); i++)
+    {
+        const Row& row = rows.getReference(i);
+        const ProcessorStats::Snapshot& s = row.stats;
+
+        text << row.name.replaceCharacter(',', ' ') << ","
+             << row.nodeId << ","
+             << s.numBlocks << ","
+             << s.numSamples << ","
+             << s.numEvents << ","
+             << String(s.meanTimeMs, 6) << ","
+             << String(s.p99TimeMs, 6) << ","
+             << String(s.maxTimeMs, 6) << ","
+             << String(s.meanBlockDurationMs, 6) << ","
+             << s.numOverruns << ","
+             << s.numDroppedEvents << "\n";
+    }
+
+    return text;
+}
+
+String PerformancePanel::getStatsAsJson()
+{
+    var processors;
+
+    for (int i = 0; i < rows.size(); i++)
+    {
+        const Row& row = rows.getReference(i);
+        const ProcessorStats::Snapshot& s = row.stats;
+
+        DynamicObject* processor = new DynamicObject();
+
+        processor->setProperty("name", row.name);
+        processor->setProperty("nodeId", row.nodeId);
+        processor->setProperty("blocks", s.numBlocks);
+        processor->setProperty("samples", s.numSamples);
+        processor->setProperty("events", s.numEvents);
+        processor->setProperty("meanMs", s.meanTimeMs);
+        processor->setProperty("p99Ms", s.p99TimeMs);
+        processor->setProperty("maxMs", s.maxTimeMs);
+        processor->setProperty("blockMs", s.meanBlockDurationMs);
+        processor->setProperty("overruns", s.numOverruns);
+        processor->setProperty("overflowEvents", s.numDroppedEvents);
+
+        processors.append(var(processor));
+    }
+
+    DynamicObject* root = new DynamicObject();
+    root->setProperty("time", Time::getCurrentTime().formatted("%Y-%m-%dT%H:%M:%S"));
+    root->setProperty("processors", processors);
+
+    return JSON::toString(var(root));
+}
+
+void PerformancePanel::saveToFile(const String& text, const String& extension)
+{
+    FileChooser fc("Save processor statistics...",
+                   File::getCurrentWorkingDirectory().getChildFile("processor_stats." + extension),
+                   "*." + extension,
+                   true);
+
+    if (fc.browseForFileToSave(true))
+    {
+        File file = fc.getResult();
+
+        if (file.replaceWithText(text))
+            std::cout << "Saved processor statistics to " << file.getFullPathName() << std::endl;
+        else
+            std::cout << "Could not write " << file.getFullPathName() << std::endl;
+    }
+}
+
+
+PerformanceWindow::PerformanceWindow(ProcessorGraph* graph)
+    : DocumentWindow("Processor Performance",
+                     Colours::darkgrey,
+                     DocumentWindow::closeButton)
+{
+    setUsingNativeTitleBar(true);
+    setResizable(true, false);
+
+    PerformancePanel* panel = new PerformancePanel(graph);
+    panel->setSize(790, 300);
+
+    setContentOwned(panel, true);
+    centreWithSize(790, 300);
+    setVisible(false);
+}
+
+PerformanceWindow::~PerformanceWindow()
+{
+
+}
+
+void PerformanceWindow::closeButtonPressed()
+{
+    setVisible(false);
+}
@@ -0,0 +1,123 @@
+/*
+    ------------------------------------------------------------------
+
+    This file is part of the Open Ephys GUI
+    Copyright (C) 2013 Open Ephys
+
+    ------------------------------------------------------------------
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PERFORMANCEPANEL_H_A4E07C19__
+#define __PERFORMANCEPANEL_H_A4E07C19__
+
+#include "../../JuceLibraryCode/JuceHeader.h"
+#include "../Processors/ProcessorStats.h"
+
+class ProcessorGraph;
+class UtilityButton;
+
+/**
+
+  Shows how long each processor takes to process a block.
+
+  For every processor in the ProcessorGraph, the panel lists the mean, 99th
+  percentile and maximum time spent in process() since acquisition started,
+  next to the duration of a block (the deadline for the whole graph), and
+  the number of blocks that took longer than that. Rows are drawn in orange
+  when the 99th percentile exceeds half of the block, and in red when it
+  exceeds the whole block.
+
+  The values can be reset, and saved as CSV or JSON.
+
+  @see ProcessorStats, PerformanceWindow
+
+*/
+
+class PerformancePanel : public Component,
+    public Button::Listener,
+    public Timer
+{
+public:
+    PerformancePanel(ProcessorGraph* graph);
+    ~PerformancePanel();
+
+    void paint(Graphics& g);
+    void resized();
+
+    void buttonClicked(Button* button);
+
+    /** Returns the current values of all processors, one line per processor.*/
+    String getStatsAsCsv();
+
+    /** Returns the current values of all processors as a JSON object.*/
+    String getStatsAsJson();
+
+private:
+
+    void timerCallback();
+
+    /** Reads the statistics of all processors of the graph.*/
+    void updateRows();
+
+    /** Asks for a file and writes text to it.*/
+    void saveToFile(const String& text, const String& extension);
+
+    struct Row
+    {
+        String name;
+        int nodeId;
+        ProcessorStats::Snapshot stats;
+    };
+
+    Array<Row> rows;
+
+    ProcessorGraph* graph;
+
+    ScopedPointer<UtilityButton> resetButton;
+    ScopedPointer<UtilityButton> csvButton;
+    ScopedPointer<UtilityButton> jsonButton;
+
+    Font font;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PerformancePanel);
+
+};
+
+/**
+
+  Window holding the PerformancePanel; it is hidden, not deleted, when closed.
+
+  @see UIComponent
+
+*/
+
+class PerformanceWindow : public DocumentWindow
+{
+public:
+    PerformanceWindow(ProcessorGraph* graph);
+    ~PerformanceWindow();
+
+private:
+
+    void closeButtonPressed();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PerformanceWindow);
+
+};
+
+
+#endif  // __PERFORMANCEPANEL_H_A4E07C19__
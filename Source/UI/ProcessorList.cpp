@@ -62,7 +62,7 @@ ProcessorList::ProcessorList()
     filters->addSubItem(new ProcessorListItem("Bandpass Filter"));
     //filters->addSubItem(new ProcessorListItem("Event Detector"));
     filters->addSubItem(new ProcessorListItem("Spike Detector"));
-    //filters->addSubItem(new ProcessorListItem("Resampler"));
+    filters->addSubItem(new ProcessorListItem("Resampler"));
     filters->addSubItem(new ProcessorListItem("Phase Detector"));
     //filters->addSubItem(new ProcessorListItem("Digital Ref"));
     filters->addSubItem(new ProcessorListItem("Channel Map"));
@@ -261,6 +261,7 @@ PopupMenu UIComponent::getMenuForIndex(int menuIndex, const String& menuName)
         menu.addCommandItem(commandManager, toggleProcessorList);
         menu.addCommandItem(commandManager, toggleSignalChain);
         menu.addCommandItem(commandManager, toggleFileInfo);
+        menu.addCommandItem(commandManager, togglePerformance);
         menu.addSeparator();
         menu.addCommandItem(commandManager, resizeWindow);
 
@@ -302,7 +303,8 @@ void UIComponent::getAllCommands(Array <CommandID>& commands)
                              toggleSignalChain,
                              toggleFileInfo,
                              showHelp,
-                             resizeWindow
+                             resizeWindow,
+                             togglePerformance
                             };
 
     commands.addArray(ids, numElementsInArray(ids));
@@ -385,6 +387,12 @@ void UIComponent::getCommandInfo(CommandID commandID, ApplicationCommandInfo& re
             result.setInfo("Reset window bounds", "Reset window bounds", "General", 0);
             break;
 
+        case togglePerformance:
+            result.setInfo("Processor Performance", "Show/hide the processing time of each processor.", "General", 0);
+            result.addDefaultKeypress('T', ModifierKeys::shiftModifier);
+            result.setTicked(performanceWindow != nullptr && performanceWindow->isVisible());
+            break;
+
         default:
             break;
     };
@@ -455,6 +463,13 @@ bool UIComponent::perform(const InvocationInfo& info)
         case toggleSignalChain:
             editorViewportButton->toggleState();
             break;
+
+        case togglePerformance:
+            if (performanceWindow == nullptr)
+                performanceWindow = new PerformanceWindow(processorGraph);
+
+            performanceWindow->setVisible(!performanceWindow->isVisible());
+            break;
             
         case resizeWindow:
             mainWindow->centreWithSize(800, 600);